@@ -0,0 +1,53 @@
+// analysisthread.cpp
+#include "analysisthread.h"
+#include "ratingdistributionanalyzer.h"
+#include "tracer.h"
+#include <QDebug>
+
+AnalysisThread::AnalysisThread(DatabaseManager* dbManager, QObject *parent)
+    : QThread(parent), m_dbManager(dbManager), m_success(false) {}
+
+AnalysisThread::~AnalysisThread() {}
+
+void AnalysisThread::cancel() {
+    m_cancelled = true;
+}
+
+bool AnalysisThread::isCancelled() const {
+    return m_cancelled;
+}
+
+bool AnalysisThread::success() const {
+    return m_success;
+}
+
+const RatingAnalysis &AnalysisThread::result() const {
+    return m_result;
+}
+
+void AnalysisThread::run() {
+    TRACE_SCOPE("AnalysisThread::run");
+    // Счетчик берется до чтения: изменения, закоммиченные во время анализа,
+    // сделают результат устаревшим, а не будут приписаны ему
+    m_result.changeCounter = m_dbManager->changeCounter();
+
+    // Гистограмма и рейтинги по уровням навыка - из одного состояния БД
+    QSqlDatabase &db = m_dbManager->database();
+    const bool inTransaction = db.transaction();
+    const bool read = !isCancelled() && m_dbManager->getDistributionSnapshot(m_result.distribution);
+    if (inTransaction) {
+        db.commit();
+    }
+    m_dbManager->releaseThreadConnection();
+
+    if (read && !isCancelled() && !m_result.distribution.isEmpty()) {
+        RatingDistributionAnalyzer analyzer;
+        analyzer.setSnapshot(m_result.distribution);
+        m_result.statistics = analyzer.calculateStatistics();
+        if (!isCancelled()) {
+            m_result.fairness = analyzer.analyzeDistributionFairness();
+        }
+    }
+    m_success = read && !isCancelled();
+    emit finished();
+}
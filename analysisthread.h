@@ -0,0 +1,49 @@
+// analysisthread.h
+#ifndef ANALYSISTHREAD_H
+#define ANALYSISTHREAD_H
+
+#include <QMap>
+#include <QThread>
+#include <atomic>
+#include "databasemanager.h"
+
+// Результат анализа распределения рейтинга; действителен, пока
+// DatabaseManager::changeCounter() равен changeCounter
+struct RatingAnalysis {
+    quint64 changeCounter = 0;
+    DistributionSnapshot distribution;
+    QMap<QString, double> statistics;
+    QString fairness;
+};
+
+// Анализ распределения рейтинга в фоне: гистограмма и рейтинги по уровням навыка
+// читаются через собственное соединение потока в одной транзакции чтения,
+// статистика и текст анализа считаются по ним без обращения к БД. Графики строятся
+// в GUI по result().distribution. Отмена проверяется между шагами: уже
+// выполняемый запрос SQLite не прерывается, но его результат отбрасывается.
+class AnalysisThread : public QThread {
+    Q_OBJECT
+
+public:
+    explicit AnalysisThread(DatabaseManager* dbManager, QObject *parent = nullptr);
+    ~AnalysisThread() override;
+
+    void cancel();
+    bool isCancelled() const;
+    bool success() const;
+    const RatingAnalysis &result() const;
+
+signals:
+    void finished();
+
+protected:
+    void run() override;
+
+private:
+    DatabaseManager* m_dbManager;
+    RatingAnalysis m_result;
+    std::atomic<bool> m_cancelled{false};
+    bool m_success;
+};
+
+#endif // ANALYSISTHREAD_H
@@ -0,0 +1,60 @@
+// backupthread.cpp
+#include "backupthread.h"
+#include "tracer.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+
+BackupThread::BackupThread(DatabaseManager* dbManager, QObject *parent)
+    : QThread(parent), m_dbManager(dbManager), m_expectedBytes(dbManager->estimatedBackupSize()),
+    m_pollTimer(new QTimer(this)), m_success(false)
+{
+    QDir().mkpath(m_dbManager->backupDirectory());
+    m_backupPath = QDir(m_dbManager->backupDirectory()).filePath(
+        "backup_" + QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss") + ".db");
+
+    // Таймер живет в потоке GUI и опрашивает размер файла, пока идет копирование
+    m_pollTimer->setInterval(100);
+    connect(m_pollTimer, &QTimer::timeout, this, &BackupThread::pollProgress);
+    connect(this, &QThread::started, m_pollTimer, qOverload<>(&QTimer::start));
+    connect(this, &QThread::finished, m_pollTimer, &QTimer::stop);
+}
+
+BackupThread::~BackupThread() {
+    if (isRunning()) {
+        wait();
+    }
+}
+
+bool BackupThread::success() const {
+    return m_success;
+}
+
+QString BackupThread::backupPath() const {
+    return m_backupPath;
+}
+
+void BackupThread::setKeepBackup(const QString &path) {
+    m_keepBackup = path;
+}
+
+void BackupThread::pollProgress() {
+    if (m_expectedBytes <= 0) {
+        return;
+    }
+    qint64 written = QFileInfo(m_backupPath).size();
+    emit progressUpdate(static_cast<int>(qMin<qint64>(99, written * 100 / m_expectedBytes)));
+}
+
+void BackupThread::run() {
+    TRACE_SCOPE("BackupThread::run");
+    m_success = m_dbManager->backupTo(m_backupPath);
+    if (m_success) {
+        int removed = m_dbManager->pruneBackups(KeepBackups, m_keepBackup);
+        if (removed > 0) {
+            qDebug() << "Removed" << removed << "old backups";
+        }
+    }
+    emit progressUpdate(100);
+    emit finished();
+}
@@ -0,0 +1,45 @@
+// backupthread.h
+#ifndef BACKUPTHREAD_H
+#define BACKUPTHREAD_H
+
+#include <QThread>
+#include <QTimer>
+#include "databasemanager.h"
+
+// Резервная копия БД (VACUUM INTO) в фоновом потоке. Прогресс оценивается
+// по размеру создаваемого файла относительно ожидаемого размера копии.
+class BackupThread : public QThread {
+    Q_OBJECT
+
+public:
+    // Сколько последних автоматических копий хранить
+    static constexpr int KeepBackups = 5;
+
+    BackupThread(DatabaseManager* dbManager, QObject *parent = nullptr);
+    ~BackupThread() override;
+
+    bool success() const;
+    QString backupPath() const;
+    // Копия, которую не удалять при ротации (из нее сейчас будет восстановление)
+    void setKeepBackup(const QString &path);
+
+signals:
+    void progressUpdate(int value);
+    void finished();
+
+protected:
+    void run() override;
+
+private slots:
+    void pollProgress();
+
+private:
+    DatabaseManager* m_dbManager;
+    QString m_backupPath;
+    QString m_keepBackup;
+    qint64 m_expectedBytes;
+    QTimer* m_pollTimer;
+    bool m_success;
+};
+
+#endif // BACKUPTHREAD_H
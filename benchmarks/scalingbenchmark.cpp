@@ -0,0 +1,1400 @@
+// scalingbenchmark.cpp
+// Сквозной бенчмарк масштабирования: генерация игр, представления таблиц и анализ
+// распределения для сетки (игроки x игры x размер команды). Каждая точка сетки
+// выполняется в отдельном процессе, чтобы пиковый RSS относился только к ней.
+//
+//   RatingSystemBenchmark --suite quick --out scaling.csv
+//   RatingSystemBenchmark --suite full --max-games 10000000 --out scaling.csv
+//   RatingSystemBenchmark --point --players 10000 --games 100000 --team 5 --out scaling.csv
+//   RatingSystemBenchmark --check-plans
+//   RatingSystemBenchmark --check-snapshot
+//   RatingSystemBenchmark --check-partitions
+//   RatingSystemBenchmark --check-log
+//   RatingSystemBenchmark --check-statistics
+//   RatingSystemBenchmark --summary --out scaling.csv
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QtMath>
+#include <QDebug>
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+#include "analysisthread.h"
+#include "databasemanager.h"
+#include "gamegenerator.h"
+#include "logstoragebackend.h"
+#include "ratingdistributionanalyzer.h"
+#include "ratingstatistics.h"
+#include "sqlitestoragebackend.h"
+#include "tracer.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const char *CsvHeader = "players,team_size,profile,games,status,generate_ms,games_per_sec,"
+                        "peak_rss_mb,db_size_mb,games_view_ms,players_view_ms,analysis_ms,index_ms";
+
+// Точка сетки; profile - профиль хранения на время генерации ("interactive", "bulk", "concurrent")
+// или "log" - хранилище в памяти с журналом (LogStorageBackend) вместо SQLite
+struct BenchmarkPoint {
+    qint64 players;
+    qint64 games;
+    int teamSize;
+    QString profile;
+
+    QString csvPrefix() const
+    {
+        return QString("%1,%2,%3,%4").arg(players).arg(teamSize).arg(profile).arg(games);
+    }
+};
+
+StorageProfile profileFromName(const QString &name)
+{
+    if (name == "interactive") {
+        return StorageProfile::Interactive;
+    }
+    return name == "concurrent" ? StorageProfile::ConcurrentBulkLoad : StorageProfile::BulkLoad;
+}
+
+double peakRssMb()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+    }
+    return 0.0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+#if defined(Q_OS_MACOS)
+    return usage.ru_maxrss / (1024.0 * 1024.0); // байты
+#else
+    return usage.ru_maxrss / 1024.0;            // килобайты
+#endif
+#endif
+}
+
+QList<qint64> parseList(const QString &value)
+{
+    QList<qint64> result;
+    for (const QString &part : value.split(',', Qt::SkipEmptyParts)) {
+        result.append(part.trimmed().toLongLong());
+    }
+    return result;
+}
+
+void removeDatabaseFiles(const QString &dbPath)
+{
+    QFile::remove(dbPath);
+    QFile::remove(dbPath + "-wal");
+    QFile::remove(dbPath + "-shm");
+    QFile::remove(dbPath + "-journal");
+    QFile::remove(dbPath + ".log");
+    QFile::remove(dbPath + ".rss");
+}
+
+bool appendCsvRow(const QString &csvPath, const QString &row)
+{
+    QFile file(csvPath);
+    bool writeHeader = !file.exists() || file.size() == 0;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qDebug() << "Failed to open CSV for writing:" << csvPath;
+        return false;
+    }
+    QTextStream out(&file);
+    if (writeHeader) {
+        out << CsvHeader << "\n";
+    }
+    out << row << "\n";
+    return true;
+}
+
+// Точка сетки на хранилище с журналом: <dbPath>.log и <dbPath>.rss. Время генерации
+// включает итоговое сжатие журнала в снимок; представлений таблиц и анализа через SQL
+// у этого хранилища нет, их колонки остаются пустыми
+int runLogPoint(const BenchmarkPoint &point, const QString &dbPath, const QString &csvPath, bool keepDb)
+{
+    const qint64 games = point.games;
+
+    removeDatabaseFiles(dbPath);
+
+    QString row;
+    {
+        LogStorageBackend storage(dbPath);
+        if (!storage.open()) {
+            appendCsvRow(csvPath, point.csvPrefix() + ",db_error,,,,,,,,");
+            return 1;
+        }
+        // Как synchronous=OFF у BulkLoad: пакеты без fsync, журнал остается согласованным
+        storage.setSyncOnCommit(false);
+
+        GameGenerator generator(&storage);
+        int perSkill = static_cast<int>(point.players / 4);
+        if (!generator.generatePlayersBySkill(perSkill, perSkill, perSkill, perSkill)) {
+            appendCsvRow(csvPath, point.csvPrefix() + ",players_error,,,,,,,,");
+            return 1;
+        }
+
+        QDateTime endDate = QDateTime::currentDateTime();
+        QDateTime startDate = endDate.addYears(-1);
+
+        QElapsedTimer timer;
+        timer.start();
+        bool generated = generator.generateGames(static_cast<int>(games), startDate, endDate, point.teamSize)
+                         && storage.compact();
+        qint64 generateMs = timer.elapsed();
+
+        double sizeMb = (QFileInfo(storage.logPath()).size() + QFileInfo(storage.snapshotPath()).size())
+                        / (1024.0 * 1024.0);
+        double gamesPerSec = generateMs > 0 ? games * 1000.0 / generateMs : 0.0;
+
+        qDebug() << "Log point" << point.players << "players," << games << "games, team" << point.teamSize
+                 << "->" << storage.gameCount() << "games," << storage.participationCount() << "participations";
+
+        row = point.csvPrefix() + QString(",%1,%2,%3,%4,%5,,,,")
+                  .arg(generated ? "ok" : "generate_error")
+                  .arg(generateMs)
+                  .arg(gamesPerSec, 0, 'f', 1)
+                  .arg(peakRssMb(), 0, 'f', 1)
+                  .arg(sizeMb, 0, 'f', 1);
+    }
+
+    if (!keepDb) {
+        removeDatabaseFiles(dbPath);
+    }
+
+    return appendCsvRow(csvPath, row) ? 0 : 1;
+}
+
+// Одна точка сетки в текущем процессе
+int runPoint(const BenchmarkPoint &point, const QString &dbPath, const QString &csvPath, bool keepDb)
+{
+    if (point.profile == "log") {
+        return runLogPoint(point, dbPath, csvPath, keepDb);
+    }
+
+    const qint64 players = point.players;
+    const qint64 games = point.games;
+    const int teamSize = point.teamSize;
+
+    removeDatabaseFiles(dbPath);
+
+    QString row;
+    {
+        DatabaseManager dbManager(dbPath);
+        if (!dbManager.initialize()) {
+            appendCsvRow(csvPath, point.csvPrefix() + ",db_error,,,,,,,,");
+            return 1;
+        }
+
+        GameGenerator generator(&dbManager);
+        int perSkill = static_cast<int>(players / 4);
+        if (!generator.generatePlayersBySkill(perSkill, perSkill, perSkill, perSkill)) {
+            appendCsvRow(csvPath, point.csvPrefix() + ",players_error,,,,,,,,");
+            return 1;
+        }
+
+        QDateTime endDate = QDateTime::currentDateTime();
+        QDateTime startDate = endDate.addYears(-1);
+
+        QElapsedTimer timer;
+        timer.start();
+        dbManager.setStorageProfile(profileFromName(point.profile));
+        bool generated = generator.generateGames(static_cast<int>(games), startDate, endDate, teamSize);
+        // Возврат к Interactive включает построение отложенных индексов - это часть стоимости загрузки;
+        // отдельно оно записывается в index_ms
+        QElapsedTimer indexTimer;
+        indexTimer.start();
+        dbManager.setStorageProfile(StorageProfile::Interactive);
+        qint64 indexMs = indexTimer.elapsed();
+        qint64 generateMs = timer.elapsed();
+
+        timer.restart();
+        qint64 gamesRows = dbManager.getGamesTable().size();
+        qint64 gamesViewMs = timer.elapsed();
+
+        timer.restart();
+        qint64 playersRows = dbManager.getPlayersWithRatings().size();
+        qint64 playersViewMs = timer.elapsed();
+
+        timer.restart();
+        RatingDistributionAnalyzer analyzer;
+        analyzer.setDatabase(dbManager.database());
+        QMap<int, qint64> ratingData = dbManager.getRatingData();
+        for (auto it = ratingData.constBegin(); it != ratingData.constEnd(); ++it) {
+            analyzer.addData(it.key(), it.value());
+        }
+        analyzer.calculateStatistics();
+        analyzer.analyzeDistributionFairness();
+        qint64 analysisMs = timer.elapsed();
+
+        StatementCacheStats cacheStats = dbManager.statementCacheStats();
+        dbManager.releaseThreadConnection();
+        double dbSizeMb = QFileInfo(dbPath).size() / (1024.0 * 1024.0);
+        double gamesPerSec = generateMs > 0 ? games * 1000.0 / generateMs : 0.0;
+
+        qDebug() << "Point" << players << "players," << games << "games, team" << teamSize
+                 << "->" << gamesRows << "games rows," << playersRows << "player rows";
+        qDebug() << "Statement cache:" << cacheStats.hits << "hits," << cacheStats.misses << "prepares";
+
+        row = point.csvPrefix() + QString(",%1,%2,%3,%4,%5,%6,%7,%8,%9")
+                  .arg(generated ? "ok" : "generate_error")
+                  .arg(generateMs)
+                  .arg(gamesPerSec, 0, 'f', 1)
+                  .arg(peakRssMb(), 0, 'f', 1)
+                  .arg(dbSizeMb, 0, 'f', 1)
+                  .arg(gamesViewMs)
+                  .arg(playersViewMs)
+                  .arg(analysisMs)
+                  .arg(indexMs);
+    }
+
+    if (!keepDb) {
+        removeDatabaseFiles(dbPath);
+    }
+
+    return appendCsvRow(csvPath, row) ? 0 : 1;
+}
+
+// Проверка планов запросов: горячие запросы должны идти через индексы схемы,
+// без полного сканирования game_participation и без сортировки во временном B-дереве
+int checkQueryPlans(const QString &dbPath)
+{
+    struct PlanCheck {
+        const char *name;
+        QString sql;
+        QStringList forbidden;
+    };
+
+    QList<PlanCheck> checks = {
+        {"player history",
+         "SELECT gp.game_id, g.team1_score, g.team2_score, g.game_date, gp.rating_change "
+         "FROM game_participation gp JOIN games g ON gp.game_id = g.game_id "
+         "WHERE gp.player_id = 1 ORDER BY gp.game_id DESC",
+         {"SCAN gp", "TEMP B-TREE"}},
+        {"player history page",
+         "SELECT gp.game_id, g.team1_score, g.team2_score, g.game_date, gp.rating_change "
+         "FROM game_participation gp JOIN games g ON gp.game_id = g.game_id "
+         "WHERE gp.player_id = 1 AND gp.game_id < 1000 ORDER BY gp.game_id DESC LIMIT 500",
+         {"SCAN gp", "TEMP B-TREE"}},
+        {"team squad",
+         "SELECT p.nickname FROM players p JOIN game_participation gp ON p.player_id = gp.player_id "
+         "WHERE gp.game_id = 1 AND gp.team = 1",
+         {"SCAN gp"}},
+        {"game details",
+         "SELECT p.nickname, gp.team, p.glicko_rating, gp.rating_change "
+         "FROM game_participation gp JOIN players p ON gp.player_id = p.player_id "
+         "WHERE gp.game_id = 1",
+         {"SCAN gp"}},
+        {"game participants",
+         "SELECT gp.player_id, gp.team FROM game_participation gp WHERE gp.game_id = 1",
+         {"SCAN gp"}},
+        {"players by rating",
+         "SELECT p.nickname, p.glicko_rating FROM players p ORDER BY p.glicko_rating DESC",
+         {"TEMP B-TREE"}},
+        {"games by date",
+         "SELECT game_id FROM games WHERE game_date BETWEEN 1704067200 AND 1706745600",
+         {"SCAN games"}},
+        {"games page",
+         "SELECT game_id, game_date FROM games WHERE game_id > 1000 ORDER BY game_id LIMIT 500",
+         {"SCAN games", "TEMP B-TREE"}},
+        {"games page by date",
+         "SELECT game_id, game_date FROM games WHERE (game_date, game_id) < (1706745600, 1000) "
+         "ORDER BY game_date DESC, game_id DESC LIMIT 500",
+         {"SCAN games", "TEMP B-TREE"}},
+        {"players page",
+         "SELECT player_id, nickname FROM players WHERE (glicko_rating, player_id) < (1500.0, 10) "
+         "ORDER BY glicko_rating DESC, player_id DESC LIMIT 500",
+         {"SCAN players", "TEMP B-TREE"}},
+        {"rating history",
+         "SELECT point_count, data FROM rating_history WHERE player_id = 1 ORDER BY seq",
+         {"SCAN rating_history", "TEMP B-TREE"}},
+    };
+
+    removeDatabaseFiles(dbPath);
+    int failures = 0;
+    {
+        DatabaseManager dbManager(dbPath);
+        if (!dbManager.initialize()) {
+            return 1;
+        }
+        if (dbManager.hasNicknameIndex()) {
+            checks.append({"nickname search",
+                           "SELECT player_id FROM players WHERE player_id IN "
+                           "(SELECT rowid FROM players_fts WHERE players_fts MATCH '\"abc\"')",
+                           {"SCAN players"}});
+        } else {
+            qDebug() << "SQLite without FTS5 trigram tokenizer: nickname search uses LIKE";
+        }
+
+        for (const PlanCheck &check : checks) {
+            QStringList plan = dbManager.queryPlan(check.sql);
+            bool ok = !plan.isEmpty();
+            for (const QString &line : plan) {
+                for (const QString &pattern : check.forbidden) {
+                    if (line.contains(pattern)) {
+                        ok = false;
+                    }
+                }
+            }
+            qDebug().noquote() << (ok ? "[ok]  " : "[FAIL]") << check.name << "->" << plan.join(" | ");
+            if (!ok) {
+                ++failures;
+            }
+        }
+        dbManager.releaseThreadConnection();
+    }
+    removeDatabaseFiles(dbPath);
+    return failures == 0 ? 0 : 1;
+}
+
+// Хэш содержимого таблицы в порядке первичного ключа
+QByteArray tableChecksum(QSqlDatabase &db, const QString &tableName)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT * FROM " + tableName + " ORDER BY 1, 2")) {
+        qDebug() << "Error reading table" << tableName << ":" << query.lastError().text();
+        return QByteArray();
+    }
+    while (query.next()) {
+        for (int i = 0; i < query.record().count(); ++i) {
+            const QVariant value = query.value(i);
+            hash.addData(value.typeId() == QMetaType::QByteArray ? value.toByteArray() : value.toString().toUtf8());
+            hash.addData(QByteArrayView("\x1f", 1));
+        }
+        hash.addData(QByteArrayView("\n", 1));
+    }
+    return hash.result().toHex();
+}
+
+// Гистограмма рейтинга, которую ведут триггеры, против пересчета по всем игрокам
+bool histogramMatchesPlayers(DatabaseManager &dbManager)
+{
+    QMap<int, QPair<int, qint64>> expected;
+    for (const PlayerData &player : dbManager.getPlayersForMatching()) {
+        const int ratingFrom = qFloor(player.rating / DatabaseManager::RatingHistogramBinWidth)
+                               * DatabaseManager::RatingHistogramBinWidth;
+        ++expected[ratingFrom].first;
+        expected[ratingFrom].second += player.totalMatches;
+    }
+
+    const QVector<RatingBin> bins = dbManager.getRatingHistogram();
+    if (bins.size() != expected.size()) {
+        return false;
+    }
+    auto it = expected.constBegin();
+    for (const RatingBin &bin : bins) {
+        if (bin.ratingFrom != it.key() || bin.playerCount != it->first || bin.games != it->second) {
+            return false;
+        }
+        ++it;
+    }
+    return true;
+}
+
+// Проверка бинарного снимка: сгенерированная БД -> exportSnapshot -> importSnapshot
+// в пустую БД, содержимое таблиц должно совпасть. Заодно сравниваются размер
+// и время со снимком JSON.
+int checkSnapshotRoundTrip(const QString &workDir)
+{
+    const QString sourcePath = QDir(workDir).filePath("bench_snapshot_src.db");
+    const QString targetPath = QDir(workDir).filePath("bench_snapshot_dst.db");
+    const QString snapshotPath = QDir(workDir).filePath("bench_snapshot.rss");
+    const QString jsonPath = QDir(workDir).filePath("bench_snapshot.json");
+    const QString jsonTargetPath = QDir(workDir).filePath("bench_snapshot_json.db");
+    removeDatabaseFiles(sourcePath);
+    removeDatabaseFiles(targetPath);
+    removeDatabaseFiles(jsonTargetPath);
+
+    int failures = 0;
+    {
+        DatabaseManager source(sourcePath);
+        DatabaseManager target(targetPath);
+        if (!source.initialize() || !target.initialize()) {
+            return 1;
+        }
+
+        GameGenerator generator(&source);
+        QDateTime endDate = QDateTime::currentDateTime();
+        if (!generator.generatePlayersBySkill(100, 100, 100, 100)
+            || !generator.generateGames(5000, endDate.addYears(-1), endDate, 5)) {
+            qDebug() << "Failed to generate data for the snapshot check";
+            return 1;
+        }
+
+        bool trajectoriesOk = true;
+        for (const PlayerData &player : source.getPlayersForMatching()) {
+            const QVector<RatingPoint> points = source.getRatingHistory(player.playerId);
+            trajectoriesOk = trajectoriesOk && points.size() == player.totalMatches
+                             && (points.isEmpty() || qAbs(points.last().rating - player.rating) <= 0.001);
+        }
+        qDebug().noquote() << (trajectoriesOk ? "[ok]  " : "[FAIL]") << "rating trajectories";
+        if (!trajectoriesOk) {
+            ++failures;
+        }
+
+        bool histogramOk = histogramMatchesPlayers(source);
+        qDebug().noquote() << (histogramOk ? "[ok]  " : "[FAIL]") << "rating histogram (triggers)";
+        if (!histogramOk) {
+            ++failures;
+        }
+
+        // Без триггеров (BulkLoad) гистограмма отстает и пересчитывается при возврате к Interactive.
+        // Заодно генератор публикует снимки распределения, последний должен совпасть с гистограммой
+        LiveDistribution live;
+        generator.setLiveDistribution(&live);
+        const quint64 counterBefore = source.changeCounter();
+        // Уведомления об изменениях: по одному на коммит пакета игроков и пакета игр
+        QHash<int, int> matchesBefore;
+        for (const PlayerData &player : source.getPlayersForMatching()) {
+            matchesBefore.insert(player.playerId, player.totalMatches);
+        }
+        DataChange notified;
+        int notifications = 0;
+        auto onChange = [&](quint64, const DataChange &change) {
+            notified.merge(change);
+            ++notifications;
+        };
+        const QMetaObject::Connection notifier = QObject::connect(&source, &DatabaseManager::dataChanged, onChange);
+        source.setStorageProfile(StorageProfile::BulkLoad);
+        // Ники повторяются по номеру, поэтому новыми будут только игроки 101-110 каждого уровня
+        if (!generator.generatePlayersBySkill(110, 110, 110, 110)
+            || !generator.generateGames(500, endDate.addMonths(-1), endDate, 5)) {
+            ++failures;
+        }
+        source.setStorageProfile(StorageProfile::Interactive);
+        generator.setLiveDistribution(nullptr);
+        QObject::disconnect(notifier);
+
+        // Новые игры и игроки - диапазоны, каждый сыгравший игрок - в измененных
+        bool changesOk = notifications == 2 && !notified.reset
+                         && notified.newGames.last - notified.newGames.first + 1 >= 500
+                         && notified.newPlayers.last - notified.newPlayers.first + 1 == 40;
+        for (const PlayerData &player : source.getPlayersForMatching()) {
+            if (player.totalMatches != matchesBefore.value(player.playerId)) {
+                changesOk = changesOk && notified.playerChanged(player.playerId);
+            }
+        }
+        qDebug().noquote() << (changesOk ? "[ok]  " : "[FAIL]") << "data change notifications";
+        if (!changesOk) {
+            ++failures;
+        }
+        histogramOk = histogramMatchesPlayers(source);
+        qDebug().noquote() << (histogramOk ? "[ok]  " : "[FAIL]") << "rating histogram (rebuild)";
+        if (!histogramOk) {
+            ++failures;
+        }
+
+        bool liveOk = live.update() && live.snapshot().gamesDone == 500;
+        if (liveOk) {
+            const DistributionSnapshot &snapshot = live.snapshot();
+            QVector<RatingBin> liveBins;
+            for (int i = 0; i < snapshot.binPlayers.size(); ++i) {
+                if (snapshot.binPlayers[i] > 0) {
+                    liveBins.append({(snapshot.firstBin + i) * DatabaseManager::RatingHistogramBinWidth,
+                                     snapshot.binPlayers[i], snapshot.binGames[i]});
+                }
+            }
+            const QVector<RatingBin> bins = source.getRatingHistogram();
+            liveOk = liveBins.size() == bins.size();
+            for (int i = 0; liveOk && i < bins.size(); ++i) {
+                liveOk = liveBins[i].ratingFrom == bins[i].ratingFrom && liveBins[i].playerCount == bins[i].playerCount
+                         && liveBins[i].games == bins[i].games;
+            }
+        }
+        qDebug().noquote() << (liveOk ? "[ok]  " : "[FAIL]") << "live distribution snapshot";
+        if (!liveOk) {
+            ++failures;
+        }
+
+        // Фоновый анализ читает то же распределение из БД, счетчик изменений вырос с генерацией
+        AnalysisThread analysis(&source);
+        analysis.start();
+        analysis.wait();
+        const RatingAnalysis &result = analysis.result();
+        bool analysisOk = liveOk && analysis.success() && source.changeCounter() > counterBefore
+                          && result.changeCounter == source.changeCounter()
+                          && result.distribution.firstBin == live.snapshot().firstBin
+                          && result.distribution.binPlayers == live.snapshot().binPlayers
+                          && result.distribution.binGames == live.snapshot().binGames
+                          && result.distribution.skills.keys() == live.snapshot().skills.keys()
+                          && !result.statistics.isEmpty();
+        for (auto it = result.distribution.skills.constBegin(); analysisOk && it != result.distribution.skills.constEnd(); ++it) {
+            const SkillRating &expected = live.snapshot().skills.value(it.key());
+            analysisOk = it.value().players == expected.players && qAbs(it.value().mean - expected.mean) < 1e-6
+                         && it.value().min == expected.min && it.value().max == expected.max;
+        }
+        // Моменты рейтинга - точные по игрокам: SQL и снимок в памяти совпадают, а не
+        // расходятся на ошибку середины корзины
+        const RatingMoments &sqlMoments = result.distribution.moments;
+        const RatingMoments &liveMoments = live.snapshot().moments;
+        analysisOk = analysisOk && sqlMoments.count == liveMoments.count && sqlMoments.count > 0
+                     && qAbs(sqlMoments.mean - liveMoments.mean) < 1e-6
+                     && qAbs(sqlMoments.stdDeviation() - liveMoments.stdDeviation()) < 1e-6
+                     && qAbs(result.statistics.value("Средний рейтинг") - sqlMoments.mean) < 1e-9;
+        qDebug().noquote() << (analysisOk ? "[ok]  " : "[FAIL]") << "background distribution analysis";
+        if (!analysisOk) {
+            ++failures;
+        }
+
+        // Поиск по подстроке никнейма (FTS5 или LIKE) находит игрока и только подходящих
+        const QVector<PlayerData> players = source.getPlayersForMatching();
+        bool searchOk = !players.isEmpty();
+        for (int length : {2, 4}) {
+            if (!searchOk) {
+                break;
+            }
+            const PlayerData &target = players[players.size() / 2];
+            PlayersQuery search;
+            search.nickname = target.nickname.mid(target.nickname.size() - length);
+            bool found = false;
+            RowKey after;
+            for (PlayersTable page = source.getPlayersPage(search, after, 500); page.size() > 0;
+                 page = source.getPlayersPage(search, after, 500)) {
+                for (int i = 0; i < page.size(); ++i) {
+                    searchOk = searchOk && page.nicknames.at(i).contains(search.nickname, Qt::CaseInsensitive);
+                    found = found || page.playerIds[i] == target.playerId;
+                }
+                after.value = page.ratings.last();
+                after.id = page.playerIds.last();
+            }
+            searchOk = searchOk && found;
+        }
+        qDebug().noquote() << (searchOk ? "[ok]  " : "[FAIL]") << "nickname search"
+                           << (source.hasNicknameIndex() ? "(fts5)" : "(like)");
+        if (!searchOk) {
+            ++failures;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        bool exported = source.exportSnapshot(snapshotPath);
+        qint64 snapshotExportMs = timer.restart();
+        bool jsonExported = source.exportToJson(jsonPath);
+        qint64 jsonExportMs = timer.restart();
+        bool imported = exported && target.importSnapshot(snapshotPath);
+        qint64 snapshotImportMs = timer.elapsed();
+
+        if (!exported || !jsonExported || !imported) {
+            qDebug() << "Snapshot export/import failed";
+            ++failures;
+        }
+
+        for (const QString &tableName : {QString("players"), QString("games"), QString("game_participation"),
+                                         QString("rating_history")}) {
+            QByteArray expected = tableChecksum(source.database(), tableName);
+            QByteArray actual = tableChecksum(target.database(), tableName);
+            bool ok = !expected.isEmpty() && expected == actual;
+            qDebug().noquote() << (ok ? "[ok]  " : "[FAIL]") << "snapshot round trip:" << tableName;
+            if (!ok) {
+                ++failures;
+            }
+        }
+
+        histogramOk = histogramMatchesPlayers(target);
+        qDebug().noquote() << (histogramOk ? "[ok]  " : "[FAIL]") << "rating histogram after import";
+        if (!histogramOk) {
+            ++failures;
+        }
+
+        // Траектории рейтинга переживают и JSON: блоки пишутся base64-строками
+        {
+            DatabaseManager jsonTarget(jsonTargetPath);
+            bool ok = jsonExported && jsonTarget.initialize() && jsonTarget.importFromJson(jsonPath);
+            ok = ok && tableChecksum(source.database(), "rating_history")
+                           == tableChecksum(jsonTarget.database(), "rating_history");
+            qDebug().noquote() << (ok ? "[ok]  " : "[FAIL]") << "json round trip: rating_history";
+            if (!ok) {
+                ++failures;
+            }
+            jsonTarget.releaseThreadConnection();
+        }
+
+        qDebug().noquote() << QString("snapshot %1 KB (export %2 ms, import %3 ms), json %4 KB (export %5 ms)")
+                                  .arg(QFileInfo(snapshotPath).size() / 1024)
+                                  .arg(snapshotExportMs)
+                                  .arg(snapshotImportMs)
+                                  .arg(QFileInfo(jsonPath).size() / 1024)
+                                  .arg(jsonExportMs);
+
+        source.releaseThreadConnection();
+        target.releaseThreadConnection();
+    }
+
+    removeDatabaseFiles(sourcePath);
+    removeDatabaseFiles(targetPath);
+    removeDatabaseFiles(jsonTargetPath);
+    QFile::remove(snapshotPath);
+    QFile::remove(jsonPath);
+    return failures == 0 ? 0 : 1;
+}
+
+// Проверка помесячных разделов: генерация в разбитую на разделы БД, затем
+// маршрутизация списка игр, состава игры и истории игроков, удаление и архивация
+// старых разделов. Количество строк сверяется с каталогом разделов.
+int checkPartitions(const QString &workDir)
+{
+    const QString dbPath = QDir(workDir).filePath("bench_partitions.db");
+    const QString archiveDir = QDir(workDir).filePath("bench_partitions_archive");
+    removeDatabaseFiles(dbPath);
+    QDir(QDir(workDir).filePath("partitions")).removeRecursively();
+    QDir(archiveDir).removeRecursively();
+
+    const int gameCount = 3000;
+    const int teamSize = 5;
+    int failures = 0;
+    auto check = [&failures](bool ok, const QString &name) {
+        qDebug().noquote() << (ok ? "[ok]  " : "[FAIL]") << name;
+        if (!ok) {
+            ++failures;
+        }
+    };
+    auto activeGames = [](const DatabaseManager &dbManager) {
+        qint64 total = 0;
+        for (const PartitionCatalog::Partition &partition : dbManager.partitions()) {
+            if (!partition.archived) {
+                total += partition.gameCount;
+            }
+        }
+        return total;
+    };
+
+    {
+        DatabaseManager dbManager(dbPath);
+        if (!dbManager.initialize() || !dbManager.setPartitioningEnabled(true)) {
+            return 1;
+        }
+
+        GameGenerator generator(&dbManager);
+        QDateTime endDate = QDateTime::currentDateTime();
+        QElapsedTimer timer;
+        timer.start();
+        if (!generator.generatePlayersBySkill(100, 100, 100, 100)
+            || !generator.generateGames(gameCount, endDate.addYears(-1), endDate, teamSize)) {
+            qDebug() << "Failed to generate data for the partition check";
+            return 1;
+        }
+        qDebug() << "Generated" << gameCount << "games into" << dbManager.partitions().size()
+                 << "partitions in" << timer.elapsed() << "ms";
+
+        check(dbManager.partitions().size() >= 12, "one partition per month");
+        check(activeGames(dbManager) == gameCount, "catalog game count");
+        check(dbManager.getGamesTable().size() == gameCount, "games table across partitions");
+
+        bool detailsOk = true;
+        for (int gameId = 1; gameId <= gameCount; gameId += 97) {
+            detailsOk = detailsOk && dbManager.getGameDetails(gameId).size() == teamSize * 2;
+        }
+        check(detailsOk, "game details routed by game id");
+
+        timer.restart();
+        qint64 historyRows = 0;
+        const QVector<PlayerData> players = dbManager.getPlayersForMatching();
+        for (const PlayerData &player : players) {
+            historyRows += dbManager.getPlayerHistory(player.playerId).size();
+        }
+        check(historyRows == qint64(gameCount) * teamSize * 2, "player history across partitions");
+        qDebug() << "Player histories:" << players.size() << "players in" << timer.elapsed() << "ms";
+
+        // Постраничная история совпадает с полной: те же игры в том же порядке
+        bool historyPagesOk = true;
+        for (int i = 0; i < players.size() && historyPagesOk; i += 37) {
+            const QVector<PlayerGameRecord> full = dbManager.getPlayerHistory(players[i].playerId);
+            QVector<PlayerGameRecord> paged;
+            RowKey after;
+            for (QVector<PlayerGameRecord> page = dbManager.getPlayerHistoryPage(players[i].playerId, after, 50);
+                 !page.isEmpty(); page = dbManager.getPlayerHistoryPage(players[i].playerId, after, 50)) {
+                paged += page;
+                after.value = after.id = page.last().gameId;
+            }
+            historyPagesOk = paged.size() == full.size();
+            for (int j = 0; historyPagesOk && j < full.size(); ++j) {
+                historyPagesOk = paged[j].gameId == full[j].gameId;
+            }
+        }
+        check(historyPagesOk, "paged player history across partitions");
+
+        // Игра месяца без подключенного раздела внутри пакета - ошибка, а не
+        // фиксация пакета; откат убирает все игры пакета
+        {
+            SqliteStorageBackend storage(&dbManager);
+            const qint64 gamesBefore = activeGames(dbManager);
+            const QDateTime otherMonth = endDate.addMonths(2);
+            const bool inserted = storage.beginBatch()
+                                  && storage.insertGame(endDate, 5, 0, Team1) > 0
+                                  && storage.insertGame(otherMonth, 5, 0, Team1) > 0;
+            storage.rollbackBatch();
+            check(!inserted && !storage.isPeriodReady(otherMonth)
+                      && dbManager.getGamesTable().size() == gamesBefore,
+                  "unattached partition inside a batch fails without committing");
+        }
+
+        // Резервная копия включает разделы; экспорт без них не создается
+        const QString backupPath = QDir(workDir).filePath("bench_partitions_backup.db");
+        check(dbManager.backupTo(backupPath)
+                  && QDir(DatabaseManager::backupPartitionDirectory(backupPath)).entryList(QDir::Files).size()
+                         == dbManager.partitions().size(),
+              "backup copies partitions");
+        check(!dbManager.exportToJson(QDir(workDir).filePath("bench_partitions.json")),
+              "JSON export refuses partitioned history");
+        {
+            const QString restoredPath = QDir(workDir).filePath("bench_restored.db");
+            DatabaseManager restored(restoredPath);
+            check(restored.initialize() && restored.restoreBackup(backupPath) && restored.isPartitioned()
+                      && restored.getGamesTable().size() == gameCount
+                      && restored.countPlayers() == dbManager.countPlayers(),
+                  "restore partitioned backup");
+            restored.dropPartitions();
+            restored.releaseThreadConnection();
+        }
+
+        const QDate dropBefore = endDate.date().addMonths(-6);
+        const QString droppedFile = QDir(workDir).filePath(
+            QString("partitions/bench_partitions_%1.db").arg(PartitionCatalog::monthOf(dropBefore.addMonths(-1))));
+        timer.restart();
+        int dropped = dbManager.dropPartitions(dropBefore);
+        qDebug() << "Dropped" << dropped << "partitions in" << timer.elapsed() << "ms";
+        check(dropped > 0 && !QFile::exists(droppedFile), "drop old partitions");
+        check(dbManager.getGamesTable().size() == activeGames(dbManager), "games table after drop");
+
+        timer.restart();
+        int archived = dbManager.archivePartitions(endDate.date().addMonths(-3), archiveDir);
+        qDebug() << "Archived" << archived << "partitions in" << timer.elapsed() << "ms";
+        check(archived > 0 && QDir(archiveDir).entryList(QDir::Files).size() >= archived, "archive old partitions");
+        check(dbManager.getGamesTable().size() == activeGames(dbManager), "games table after archive");
+
+        // Постраничное чтение по ключу проходит все активные разделы по возрастанию game_id
+        qint64 pagedGames = 0;
+        qint64 lastGameId = 0;
+        bool pagesOrdered = true;
+        RowKey after;
+        for (GamesTable page = dbManager.getGamesPage(GamesQuery(), after, 500); page.size() > 0;
+             page = dbManager.getGamesPage(GamesQuery(), after, 500)) {
+            pagesOrdered = pagesOrdered && page.gameIds.first() > lastGameId;
+            for (int i = 1; i < page.size(); ++i) {
+                pagesOrdered = pagesOrdered && page.gameIds[i] > page.gameIds[i - 1];
+            }
+            pagedGames += page.size();
+            lastGameId = page.gameIds.last();
+            after.value = lastGameId;
+            after.id = lastGameId;
+        }
+        check(pagesOrdered && pagedGames == activeGames(dbManager), "games pages across partitions");
+
+        // Новые игры первыми: слияние разделов по дате, каждая игра - ровно один раз
+        GamesQuery byDate;
+        byDate.sortColumn = GamesDateColumn;
+        byDate.order = Qt::DescendingOrder;
+        QSet<qint64> seenGames;
+        qint64 lastDate = std::numeric_limits<qint64>::max();
+        bool datesOrdered = true;
+        after = RowKey();
+        for (GamesTable page = dbManager.getGamesPage(byDate, after, 500); page.size() > 0;
+             page = dbManager.getGamesPage(byDate, after, 500)) {
+            for (int i = 0; i < page.size(); ++i) {
+                datesOrdered = datesOrdered && page.gameDates[i] <= lastDate;
+                lastDate = page.gameDates[i];
+                seenGames.insert(page.gameIds[i]);
+            }
+            after.value = page.gameDates.last();
+            after.id = page.gameIds.last();
+        }
+        check(datesOrdered && seenGames.size() == activeGames(dbManager), "games pages by date across partitions");
+
+        dbManager.releaseThreadConnection();
+    }
+
+    removeDatabaseFiles(dbPath);
+    QDir(QDir(workDir).filePath("partitions")).removeRecursively();
+    QDir(archiveDir).removeRecursively();
+    const QString backupPath = QDir(workDir).filePath("bench_partitions_backup.db");
+    QFile::remove(backupPath);
+    QDir(DatabaseManager::backupPartitionDirectory(backupPath)).removeRecursively();
+    removeDatabaseFiles(QDir(workDir).filePath("bench_restored.db"));
+    return failures == 0 ? 0 : 1;
+}
+
+// Проверка хранилища с журналом: состояние после повторного открытия совпадает с
+// состоянием в памяти, недописанный пакет в конце журнала отбрасывается, откат пакета
+// восстанавливает состояние, после сжатия все читается из снимка
+int checkLogStorage(const QString &workDir)
+{
+    const QString basePath = QDir(workDir).filePath("bench_log");
+    removeDatabaseFiles(basePath);
+
+    const int gameCount = 2000;
+    const int teamSize = 5;
+    int failures = 0;
+    auto check = [&failures](bool ok, const QString &name) {
+        qDebug().noquote() << (ok ? "[ok]  " : "[FAIL]") << name;
+        if (!ok) {
+            ++failures;
+        }
+    };
+    // Траектория каждого игрока: точка на каждую игру, последняя совпадает с рейтингом
+    auto trajectoriesMatch = [](StorageBackend &storage, const QVector<PlayerData> &players) {
+        for (const PlayerData &player : players) {
+            const QVector<RatingPoint> points = storage.ratingHistory(player.playerId);
+            if (points.size() != player.totalMatches
+                || (!points.isEmpty() && (qAbs(points.last().rating - player.rating) > 0.001
+                                          || qAbs(points.last().rd - player.rd) > 0.001))) {
+                return false;
+            }
+            for (int i = 1; i < points.size(); ++i) {
+                if (points[i].timestamp < points[i - 1].timestamp) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    auto samePlayers = [](const QVector<PlayerData> &a, const QVector<PlayerData> &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (int i = 0; i < a.size(); ++i) {
+            if (a[i].playerId != b[i].playerId || a[i].nickname != b[i].nickname
+                || a[i].rating != b[i].rating || a[i].rd != b[i].rd
+                || a[i].totalMatches != b[i].totalMatches || a[i].wins != b[i].wins) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    QVector<PlayerData> expected;
+    {
+        LogStorageBackend storage(basePath);
+        if (!storage.open()) {
+            return 1;
+        }
+        storage.setSyncOnCommit(false);
+
+        GameGenerator generator(&storage);
+        QDateTime endDate = QDateTime::currentDateTime();
+        QElapsedTimer timer;
+        timer.start();
+        if (!generator.generatePlayersBySkill(100, 100, 100, 100)
+            || !generator.generateGames(gameCount, endDate.addYears(-1), endDate, teamSize)) {
+            qDebug() << "Failed to generate data for the log check";
+            return 1;
+        }
+        qDebug() << "Generated" << gameCount << "games into the log in" << timer.elapsed() << "ms,"
+                 << QFileInfo(storage.logPath()).size() << "bytes";
+
+        expected = storage.players();
+        check(storage.gameCount() == gameCount, "game count");
+        check(storage.participationCount() == qint64(gameCount) * teamSize * 2, "participation count");
+
+        qint64 historyRows = 0;
+        for (const PlayerData &player : expected) {
+            historyRows += storage.playerHistory(player.playerId).size();
+        }
+        check(historyRows == qint64(gameCount) * teamSize * 2, "player history");
+        check(trajectoriesMatch(storage, expected), "rating trajectories");
+    }
+
+    const qint64 logSize = QFileInfo(basePath + ".log").size();
+    {
+        LogStorageBackend storage(basePath);
+        QElapsedTimer timer;
+        timer.start();
+        check(storage.open() && samePlayers(storage.players(), expected), "replay after reopen");
+        qDebug() << "Replayed" << logSize << "bytes in" << timer.elapsed() << "ms";
+    }
+
+    // Сбой посреди записи пакета: в конце журнала часть записи без маркера фиксации
+    {
+        QFile log(basePath + ".log");
+        if (log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            log.write(QByteArray("\x03\x01\x00\x00", 4));
+        }
+    }
+    {
+        LogStorageBackend storage(basePath);
+        check(storage.open() && samePlayers(storage.players(), expected)
+                  && QFileInfo(basePath + ".log").size() == logSize,
+              "unfinished batch discarded");
+
+        storage.setSyncOnCommit(false);
+        bool rolledBack = storage.beginBatch()
+                          && storage.insertGame(QDateTime::currentDateTime(), 5, 0, Team1) > 0
+                          && storage.applyGameResult(expected.first().playerId, 2000.0, 50.0, true);
+        storage.rollbackBatch();
+        check(rolledBack && storage.gameCount() == gameCount && samePlayers(storage.players(), expected),
+              "batch rollback");
+
+        check(storage.compact() && QFileInfo(storage.logPath()).size() < logSize, "compact");
+    }
+    {
+        LogStorageBackend storage(basePath);
+        check(storage.open() && samePlayers(storage.players(), expected)
+                  && storage.participationCount() == qint64(gameCount) * teamSize * 2,
+              "load from snapshot");
+        check(trajectoriesMatch(storage, expected), "rating trajectories from snapshot");
+    }
+
+    removeDatabaseFiles(basePath);
+    return failures == 0 ? 0 : 1;
+}
+
+// Прогон сетки: каждая точка - дочерний процесс этого же бинарника
+int runSuite(const QList<qint64> &playersList, const QList<qint64> &gamesList,
+             const QList<qint64> &teamList, const QStringList &profiles,
+             const QString &workDir, const QString &csvPath, bool keepDb)
+{
+    QList<BenchmarkPoint> points;
+    for (qint64 players : playersList) {
+        for (qint64 teamSize : teamList) {
+            if (teamSize * 2 >= players) {
+                continue; // Ограничение как в MainWindow: команда меньше половины игроков
+            }
+            for (qint64 games : gamesList) {
+                for (const QString &profile : profiles) {
+                    points.append({players, games, static_cast<int>(teamSize), profile});
+                }
+            }
+        }
+    }
+
+    int failures = 0;
+    for (const BenchmarkPoint &point : points) {
+        QString dbPath = QDir(workDir).filePath(
+            QString("bench_%1_%2_%3_%4.db").arg(point.players).arg(point.games).arg(point.teamSize).arg(point.profile));
+
+        QStringList args;
+        args << "--point"
+             << "--players" << QString::number(point.players)
+             << "--games" << QString::number(point.games)
+             << "--team" << QString::number(point.teamSize)
+             << "--profile" << point.profile
+             << "--db" << dbPath
+             << "--out" << csvPath;
+        if (keepDb) {
+            args << "--keep-db";
+        }
+
+        qDebug().noquote() << "Running point:" << args.join(' ');
+        QProcess process;
+        process.setProcessChannelMode(QProcess::ForwardedChannels);
+        process.start(QCoreApplication::applicationFilePath(), args);
+        process.waitForFinished(-1);
+
+        if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+            ++failures;
+            // Упавшая точка (например, нехватка памяти) тоже попадает в CSV
+            if (process.exitStatus() != QProcess::NormalExit) {
+                appendCsvRow(csvPath, point.csvPrefix() + ",crashed,,,,,,,,");
+            }
+            removeDatabaseFiles(dbPath);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Сводка CSV таблицей Markdown для README: строка на каждую успешную точку.
+// Колонки ищутся по заголовку, поэтому читаются и CSV без новых колонок
+int printSummary(const QString &csvPath)
+{
+    QFile file(csvPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Failed to open CSV for reading:" << csvPath;
+        return 1;
+    }
+    QTextStream in(&file);
+    const QStringList header = in.readLine().split(',');
+    auto column = [&header](const QStringList &fields, const QString &name) {
+        return fields.value(header.indexOf(name));
+    };
+
+    QTextStream out(stdout);
+    out << "| Игроки | Игры | Команда | Профиль | Игр/с | БД, МБ | Пиковый RSS, МБ | Перестроение индексов, мс "
+           "| Список игр, мс | Список игроков, мс |\n";
+    out << "|---:|---:|---:|---|---:|---:|---:|---:|---:|---:|\n";
+    while (!in.atEnd()) {
+        const QStringList fields = in.readLine().split(',');
+        if (column(fields, "status") != "ok") {
+            continue;
+        }
+        out << "| " << column(fields, "players") << " | " << column(fields, "games")
+            << " | " << column(fields, "team_size") << " | " << column(fields, "profile")
+            << " | " << column(fields, "games_per_sec") << " | " << column(fields, "db_size_mb")
+            << " | " << column(fields, "peak_rss_mb") << " | " << column(fields, "index_ms")
+            << " | " << column(fields, "games_view_ms") << " | " << column(fields, "players_view_ms") << " |\n";
+    }
+    return 0;
+}
+
+// Накладные расходы трассировки: одна и та же генерация с выключенным и включенным
+// трассировщиком, прогоны чередуются, сравниваются медианы. Допуск - 2% времени
+// генерации; отдельно - стоимость одного TRACE_SCOPE в плотном цикле
+int checkTracerOverhead(const QString &workDir)
+{
+    const QString dbPath = QDir(workDir).filePath("bench_tracer.db");
+    const int runs = 5;
+    const int gameCount = 20000;
+    const int teamSize = 5;
+
+    auto timeGeneration = [&](bool traced) -> qint64 {
+        removeDatabaseFiles(dbPath);
+        qint64 elapsed = -1;
+        {
+            DatabaseManager dbManager(dbPath);
+            GameGenerator generator(&dbManager);
+            QDateTime endDate = QDateTime::currentDateTime();
+            if (dbManager.initialize() && generator.generatePlayersBySkill(250, 250, 250, 250)) {
+                Tracer::instance().setEnabled(traced);
+                QElapsedTimer timer;
+                timer.start();
+                if (generator.generateGames(gameCount, endDate.addYears(-1), endDate, teamSize)) {
+                    elapsed = timer.nsecsElapsed();
+                }
+                Tracer::instance().setEnabled(false);
+            }
+            dbManager.releaseThreadConnection();
+        }
+        removeDatabaseFiles(dbPath);
+        return elapsed;
+    };
+
+    QVector<qint64> plain;
+    QVector<qint64> traced;
+    for (int run = 0; run < runs; ++run) {
+        plain << timeGeneration(false);
+        traced << timeGeneration(true);
+        if (plain.last() < 0 || traced.last() < 0) {
+            qDebug() << "Failed to generate data for the tracer check";
+            return 1;
+        }
+    }
+    std::sort(plain.begin(), plain.end());
+    std::sort(traced.begin(), traced.end());
+    const double overhead = 100.0 * (traced[runs / 2] - plain[runs / 2]) / plain[runs / 2];
+
+    // Стоимость пустого спана: выключенный флаг против записи пары B/E
+    const int spans = 1000000;
+    auto timeSpans = [&](bool enabled) {
+        Tracer::instance().setEnabled(enabled);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < spans; ++i) {
+            TRACE_SCOPE("benchSpan");
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+        Tracer::instance().setEnabled(false);
+        return double(elapsed) / spans;
+    };
+    const double spanOffNs = timeSpans(false);
+    const double spanOnNs = timeSpans(true);
+
+    const QString tracePath = QDir(workDir).filePath("bench_tracer.json");
+    const bool written = Tracer::instance().writeChromeTrace(tracePath) && QFileInfo(tracePath).size() > 0;
+    QFile::remove(tracePath);
+
+    qDebug().noquote() << QString("generation of %1 games: %2 ms untraced, %3 ms traced (median of %4), overhead %5%")
+                              .arg(gameCount)
+                              .arg(plain[runs / 2] / 1e6, 0, 'f', 1)
+                              .arg(traced[runs / 2] / 1e6, 0, 'f', 1)
+                              .arg(runs)
+                              .arg(overhead, 0, 'f', 2);
+    qDebug().noquote() << QString("TRACE_SCOPE: %1 ns disabled, %2 ns enabled")
+                              .arg(spanOffNs, 0, 'f', 1)
+                              .arg(spanOnNs, 0, 'f', 1);
+
+    int failures = 0;
+    auto check = [&failures](bool ok, const QString &name) {
+        qDebug().noquote() << (ok ? "[ok]  " : "[FAIL]") << name;
+        if (!ok) {
+            ++failures;
+        }
+    };
+    check(overhead < 2.0, "tracing overhead below 2% of generation time");
+    check(written, "trace written");
+    return failures == 0 ? 0 : 1;
+}
+
+// Однопроходные моменты и медиана RatingAccumulator против прежнего расчета в два
+// прохода с развертыванием по игре; частичные накопители потоков после merge
+// против одного прохода; моменты не зависят от сдвига рейтинга на большое число
+int checkStatistics()
+{
+    int failures = 0;
+    auto check = [&failures](bool ok, const QString &name) {
+        qDebug().noquote() << (ok ? "[ok]  " : "[FAIL]") << name;
+        if (!ok) {
+            ++failures;
+        }
+    };
+    auto close = [](double a, double b, double tolerance) {
+        return qAbs(a - b) <= tolerance * qMax(1.0, qMax(qAbs(a), qAbs(b)));
+    };
+
+    // Рейтинг и число игр: сумма 12 равномерных - близко к нормальному, с тяжелым хвостом сверху
+    quint64 seed = 0x9E3779B97F4A7C15ull;
+    auto next = [&seed]() {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<double>(seed >> 11) / static_cast<double>(1ull << 53);
+    };
+    QVector<QPair<int, qint64>> data;
+    for (int i = 0; i < 20000; ++i) {
+        double sum = 0.0;
+        for (int k = 0; k < 12; ++k) {
+            sum += next();
+        }
+        const int rating = static_cast<int>(1500 + (sum - 6.0) * 200 + (next() < 0.05 ? next() * 800 : 0.0));
+        data.append({rating, 1 + static_cast<qint64>(next() * 40)});
+    }
+
+    // Прежний расчет: среднее, затем отклонения через pow, медиана по развернутому списку
+    qint64 total = 0;
+    double sum = 0.0;
+    for (const auto &entry : data) {
+        total += entry.second;
+        sum += double(entry.first) * entry.second;
+    }
+    const double mean = sum / total;
+    double m2 = 0.0, m3 = 0.0, m4 = 0.0;
+    for (const auto &entry : data) {
+        m2 += pow(entry.first - mean, 2) * entry.second;
+        m3 += pow(entry.first - mean, 3) * entry.second;
+        m4 += pow(entry.first - mean, 4) * entry.second;
+    }
+    const double stdDeviation = qSqrt(m2 / total);
+    const double skewness = m3 / total / pow(stdDeviation, 3);
+    const double kurtosis = m4 / total / pow(stdDeviation, 4) - 3;
+    QVector<int> expanded;
+    expanded.reserve(total);
+    for (const auto &entry : data) {
+        for (qint64 i = 0; i < entry.second; ++i) {
+            expanded.append(entry.first);
+        }
+    }
+    std::sort(expanded.begin(), expanded.end());
+    const double median = expanded.size() % 2 == 0
+                              ? (expanded[expanded.size() / 2 - 1] + expanded[expanded.size() / 2]) / 2.0
+                              : expanded[expanded.size() / 2];
+
+    RatingAccumulator single;
+    for (const auto &entry : data) {
+        single.add(entry.first, entry.second);
+    }
+    const RatingMoments &moments = single.moments();
+    check(moments.count == total && close(moments.mean, mean, 1e-12)
+              && close(moments.stdDeviation(), stdDeviation, 1e-9) && close(moments.skewness(), skewness, 1e-8)
+              && close(moments.kurtosis(), kurtosis, 1e-8) && single.median() == median,
+          "single pass moments and weighted median");
+
+    // Медиана при нечетном числе игр
+    RatingAccumulator odd = single;
+    odd.add(expanded.last() + 1);
+    const double oddMedian = expanded[expanded.size() / 2];
+    check(odd.count() % 2 == 1 && odd.median() == oddMedian, "weighted median (odd count)");
+
+    // Части данных в отдельных потоках, затем merge
+    const int threadCount = 8;
+    QVector<RatingAccumulator> partials(threadCount);
+    QVector<QThread *> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.append(QThread::create([&data, &partials, t, threadCount]() {
+            for (int i = t; i < data.size(); i += threadCount) {
+                partials[t].add(data[i].first, data[i].second);
+            }
+        }));
+        threads.last()->start();
+    }
+    RatingAccumulator merged;
+    for (int t = 0; t < threadCount; ++t) {
+        threads[t]->wait();
+        delete threads[t];
+        merged.merge(partials[t]);
+    }
+    const RatingMoments &mergedMoments = merged.moments();
+    check(mergedMoments.count == total && close(mergedMoments.mean, moments.mean, 1e-12)
+              && close(mergedMoments.variance(), moments.variance(), 1e-10)
+              && close(mergedMoments.skewness(), moments.skewness(), 1e-8)
+              && close(mergedMoments.kurtosis(), moments.kurtosis(), 1e-8) && merged.median() == single.median(),
+          QString("merged per-thread accumulators (%1 threads)").arg(threadCount));
+
+    // Сдвиг на 10^8: форма распределения та же, у суммы квадратов без центрирования
+    // точность здесь уже теряется
+    RatingAccumulator shifted;
+    for (const auto &entry : data) {
+        shifted.add(entry.first + 100000000, entry.second);
+    }
+    check(close(shifted.moments().mean - 100000000, moments.mean, 1e-9)
+              && close(shifted.moments().stdDeviation(), moments.stdDeviation(), 1e-6)
+              && close(shifted.moments().skewness(), moments.skewness(), 1e-5)
+              && close(shifted.moments().kurtosis(), moments.kurtosis(), 1e-5),
+          "moments stable under a large rating offset");
+
+    // Анализатор: статистика по накопителю, повторный вызов - без пересчета
+    RatingDistributionAnalyzer analyzer;
+    analyzer.addData(merged);
+    const QMap<QString, double> stats = analyzer.calculateStatistics();
+    check(close(stats.value("Средний рейтинг"), mean, 1e-12) && stats.value("Медиана") == median
+              && close(stats.value("Эксцесс"), kurtosis, 1e-8) && analyzer.calculateStatistics() == stats,
+          "analyzer statistics from merged accumulator");
+
+    // Линейный проход по 10^8 значениям: моменты по частям в потоках, затем merge
+    const qint64 scanValues = 100000000;
+    QVector<RatingMoments> scanPartials(threadCount);
+    QElapsedTimer timer;
+    timer.start();
+    for (int t = 0; t < threadCount; ++t) {
+        threads[t] = QThread::create([&scanPartials, t, threadCount, scanValues]() {
+            for (qint64 i = t; i < scanValues; i += threadCount) {
+                scanPartials[t].add(1000 + (i * 7919) % 1500);
+            }
+        });
+        threads[t]->start();
+    }
+    RatingMoments scanned;
+    for (int t = 0; t < threadCount; ++t) {
+        threads[t]->wait();
+        delete threads[t];
+        scanned.merge(scanPartials[t]);
+    }
+    qDebug().noquote() << QString("       %1 values in %2 threads: %3 ms")
+                              .arg(scanValues).arg(threadCount).arg(timer.elapsed());
+    check(scanned.count == scanValues && scanned.mean > 1000 && scanned.mean < 2500, "linear scan of 1e8 values");
+
+    return failures == 0 ? 0 : 1;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("RatingSystemBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("End-to-end scaling benchmark for the rating system simulation");
+    parser.addHelpOption();
+
+    QCommandLineOption suiteOption("suite", "Predefined grid: quick or full.", "name", "quick");
+    QCommandLineOption pointOption("point", "Run a single grid point in this process.");
+    QCommandLineOption playersOption("players", "Player counts (comma separated).", "list");
+    QCommandLineOption gamesOption("games", "Game counts (comma separated).", "list");
+    QCommandLineOption teamOption("team", "Team sizes (comma separated).", "list");
+    QCommandLineOption maxGamesOption("max-games", "Skip grid points with more games.", "n");
+    QCommandLineOption maxPlayersOption("max-players", "Skip grid points with more players.", "n");
+    QCommandLineOption dbOption("db", "Database file for --point.", "path");
+    QCommandLineOption workDirOption("work-dir", "Directory for benchmark databases.", "path", QDir::tempPath());
+    QCommandLineOption outOption("out", "CSV file to append results to.", "path", "scaling.csv");
+    QCommandLineOption keepDbOption("keep-db", "Keep benchmark databases after the run.");
+    QCommandLineOption profileOption("profile", "Storage profiles during generation: interactive, bulk, concurrent, log (comma separated).",
+                                     "list", "interactive,bulk");
+    QCommandLineOption checkPlansOption("check-plans", "Verify that hot queries use the schema indexes.");
+    QCommandLineOption checkSnapshotOption("check-snapshot", "Verify binary snapshot export/import round trip.");
+    QCommandLineOption checkPartitionsOption("check-partitions", "Verify monthly partition routing, drop and archive.");
+    QCommandLineOption checkLogOption("check-log", "Verify log storage replay, torn batch recovery and compaction.");
+    QCommandLineOption checkStatisticsOption("check-statistics", "Verify single-pass mergeable rating statistics.");
+    QCommandLineOption checkTracerOption("check-tracer", "Compare generation time with tracing off and on.");
+    QCommandLineOption summaryOption("summary", "Print the --out CSV as a Markdown table.");
+
+    parser.addOptions({suiteOption, pointOption, playersOption, gamesOption, teamOption,
+                       maxGamesOption, maxPlayersOption, dbOption, workDirOption, outOption, keepDbOption,
+                       profileOption, checkPlansOption, checkSnapshotOption, checkPartitionsOption,
+                       checkLogOption, checkStatisticsOption, checkTracerOption, summaryOption});
+    parser.process(app);
+
+    const QString csvPath = parser.value(outOption);
+    const bool keepDb = parser.isSet(keepDbOption);
+
+    if (parser.isSet(checkPlansOption)) {
+        return checkQueryPlans(QDir(parser.value(workDirOption)).filePath("bench_plans.db"));
+    }
+
+    if (parser.isSet(checkSnapshotOption)) {
+        return checkSnapshotRoundTrip(parser.value(workDirOption));
+    }
+
+    if (parser.isSet(checkPartitionsOption)) {
+        return checkPartitions(parser.value(workDirOption));
+    }
+
+    if (parser.isSet(checkLogOption)) {
+        return checkLogStorage(parser.value(workDirOption));
+    }
+
+    if (parser.isSet(checkStatisticsOption)) {
+        return checkStatistics();
+    }
+
+    if (parser.isSet(checkTracerOption)) {
+        return checkTracerOverhead(parser.value(workDirOption));
+    }
+
+    if (parser.isSet(summaryOption)) {
+        return printSummary(csvPath);
+    }
+
+    if (parser.isSet(pointOption)) {
+        qint64 players = parser.value(playersOption).toLongLong();
+        qint64 games = parser.value(gamesOption).toLongLong();
+        int teamSize = parser.value(teamOption).toInt();
+        if (players <= 0 || games <= 0 || teamSize <= 0) {
+            qDebug() << "--point requires --players, --games and --team";
+            return 2;
+        }
+        QString dbPath = parser.isSet(dbOption)
+                             ? parser.value(dbOption)
+                             : QDir(parser.value(workDirOption)).filePath("bench_point.db");
+        BenchmarkPoint point{players, games, teamSize, parser.value(profileOption).section(',', 0, 0)};
+        return runPoint(point, dbPath, csvPath, keepDb);
+    }
+
+    // Сетки по умолчанию: quick - для проверки регрессий, full - весь диапазон
+    QList<qint64> playersList;
+    QList<qint64> gamesList;
+    QList<qint64> teamList = {1, 5, 16};
+    if (parser.value(suiteOption) == "full") {
+        playersList = {1000, 10000, 100000, 1000000};
+        gamesList = {10000, 100000, 1000000, 10000000, 100000000};
+    } else {
+        playersList = {1000, 10000};
+        gamesList = {10000, 100000};
+    }
+
+    if (parser.isSet(playersOption)) playersList = parseList(parser.value(playersOption));
+    if (parser.isSet(gamesOption)) gamesList = parseList(parser.value(gamesOption));
+    if (parser.isSet(teamOption)) teamList = parseList(parser.value(teamOption));
+
+    if (parser.isSet(maxGamesOption)) {
+        qint64 maxGames = parser.value(maxGamesOption).toLongLong();
+        gamesList.erase(std::remove_if(gamesList.begin(), gamesList.end(),
+                                       [maxGames](qint64 g) { return g > maxGames; }), gamesList.end());
+    }
+    if (parser.isSet(maxPlayersOption)) {
+        qint64 maxPlayers = parser.value(maxPlayersOption).toLongLong();
+        playersList.erase(std::remove_if(playersList.begin(), playersList.end(),
+                                         [maxPlayers](qint64 p) { return p > maxPlayers; }), playersList.end());
+    }
+
+    QStringList profiles = parser.value(profileOption).split(',', Qt::SkipEmptyParts);
+    return runSuite(playersList, gamesList, teamList, profiles, parser.value(workDirOption), csvPath, keepDb);
+}
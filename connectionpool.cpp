@@ -0,0 +1,102 @@
+#include "connectionpool.h"
+#include <QSqlError>
+#include <QMutexLocker>
+#include <QDebug>
+
+// Данные QThreadStorage: удаляются Qt при завершении потока-владельца
+struct ConnectionPool::LocalConnection {
+    ConnectionPool *pool = nullptr;
+    Connection connection;
+
+    ~LocalConnection()
+    {
+        qDeleteAll(connection.statements);
+        connection.statements.clear();
+
+        QString name = connection.db.connectionName();
+        connection.db.close();
+        connection.db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+
+        QMutexLocker locker(&pool->m_mutex);
+        pool->m_openNames.remove(name);
+    }
+};
+
+ConnectionPool::ConnectionPool(const QString &dbPath)
+    : m_dbPath(dbPath),
+    m_namePrefix(QString("rss_%1_").arg(reinterpret_cast<quintptr>(this), 0, 16))
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    // Соединение текущего потока закрываем сразу; рабочие потоки к этому моменту
+    // должны быть завершены и уже закрыли свои соединения
+    m_local.setLocalData(nullptr);
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_openNames.isEmpty()) {
+        qDebug() << "Warning: connection pool destroyed with open connections:" << m_openNames.values();
+    }
+}
+
+void ConnectionPool::setConnectionPragmas(const QStringList &pragmas)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pragmas = pragmas;
+}
+
+ConnectionPool::Connection &ConnectionPool::local()
+{
+    if (!m_local.hasLocalData() || !m_local.localData()) {
+        return *open();
+    }
+    return m_local.localData()->connection;
+}
+
+void ConnectionPool::releaseLocal()
+{
+    m_local.setLocalData(nullptr);
+}
+
+int ConnectionPool::openConnections() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_openNames.size();
+}
+
+ConnectionPool::Connection *ConnectionPool::open()
+{
+    QString name;
+    QStringList pragmas;
+    {
+        QMutexLocker locker(&m_mutex);
+        name = m_namePrefix + QString::number(m_nextId++);
+        pragmas = m_pragmas;
+        m_openNames.insert(name);
+    }
+
+    LocalConnection *local = new LocalConnection;
+    local->pool = this;
+    local->connection.db = QSqlDatabase::addDatabase("QSQLITE", name);
+    local->connection.db.setDatabaseName(m_dbPath);
+    // Писатель держит блокировку недолго (коммит пачки), остальные подождут
+    local->connection.db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    m_local.setLocalData(local);
+
+    QSqlDatabase &db = local->connection.db;
+    if (!db.open()) {
+        qDebug() << "Error: Failed to open connection" << name << ":" << db.lastError().text();
+        return &local->connection;
+    }
+
+    QSqlQuery query(db);
+    for (const QString &pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qDebug() << "Query error:" << query.lastError().text() << "for query:" << pragma;
+        }
+    }
+
+    return &local->connection;
+}
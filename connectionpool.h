@@ -0,0 +1,76 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QThreadStorage>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+
+// Профиль хранения SQLite-соединения
+enum class StorageProfile {
+    Interactive, // WAL + synchronous=FULL: каждая закоммиченная транзакция переживает сбой
+    BulkLoad,    // WAL + synchronous=OFF, большой кэш и mmap, отложенные индексы
+    // Как BulkLoad, но индексы, которые читают представления, остаются: запись
+    // идет, пока открытые таблицы читают ту же БД
+    ConcurrentBulkLoad
+};
+
+// Счетчики попаданий/промахов кэша подготовленных запросов
+struct StatementCacheStats {
+    quint64 hits = 0;
+    quint64 misses = 0;
+};
+
+// Пул SQLite-соединений к одному файлу: каждый поток получает собственное
+// именованное соединение (Qt запрещает использовать QSqlDatabase из другого потока).
+// Соединение открывается при первом обращении из потока и закрывается при его завершении.
+// В режиме WAL читатели не блокируют писателя, поэтому GUI может читать во время генерации.
+class ConnectionPool
+{
+public:
+    // Соединение потока вместе с его кэшем подготовленных запросов
+    struct Connection {
+        QSqlDatabase db;
+        QHash<int, QSqlQuery*> statements;
+        StatementCacheStats stats;
+        // Подключенные (ATTACH) разделы истории игр, от давно использованных к недавним
+        QList<int> attachedPartitions;
+        // Профиль, PRAGMA которого действуют на этом соединении; подключаемые
+        // разделы получают настройки того же профиля
+        StorageProfile profile = StorageProfile::Interactive;
+    };
+
+    explicit ConnectionPool(const QString &dbPath);
+    ~ConnectionPool();
+
+    // PRAGMA, выполняемые на каждом новом соединении
+    void setConnectionPragmas(const QStringList &pragmas);
+
+    // Соединение вызывающего потока; открывается при первом обращении
+    Connection &local();
+
+    // Закрыть соединение вызывающего потока раньше завершения потока
+    void releaseLocal();
+
+    int openConnections() const;
+
+private:
+    struct LocalConnection;
+
+    Connection *open();
+
+    QString m_dbPath;
+    QString m_namePrefix;
+    QStringList m_pragmas;
+    QThreadStorage<LocalConnection*> m_local;
+
+    mutable QMutex m_mutex;
+    QSet<QString> m_openNames;
+    int m_nextId = 0;
+};
+
+#endif // CONNECTIONPOOL_H
@@ -1,503 +1,2878 @@
 #include "databasemanager.h"
+#include "tracer.h"
+#include "jsonstream.h"
+#include "snapshot.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QSet>
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace {
+// Настройки профилей. journal_mode=WAL сохраняется в файле БД,
+// остальные PRAGMA действуют только на соединение, где выполнены
+const QStringList interactivePragmas = {
+    "PRAGMA journal_mode = WAL;",
+    "PRAGMA synchronous = FULL;",
+    "PRAGMA cache_size = -16384;",       // 16 МБ
+    "PRAGMA mmap_size = 268435456;",     // 256 МБ
+    "PRAGMA temp_store = DEFAULT;",
+};
+
+const QStringList bulkLoadPragmas = {
+    "PRAGMA journal_mode = WAL;",
+    "PRAGMA synchronous = OFF;",
+    "PRAGMA cache_size = -262144;",      // 256 МБ
+    "PRAGMA mmap_size = 1073741824;",    // 1 ГБ
+    "PRAGMA temp_store = MEMORY;",
+};
+}
 
 DatabaseManager::DatabaseManager(const QString &dbPath, QObject *parent)
-    : QObject(parent), m_dbPath(dbPath)
+    : QObject(parent), m_dbPath(dbPath), m_pool(dbPath), m_partitions(dbPath)
 {
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
-    m_db.setDatabaseName(dbPath);
+    // Новые соединения пула открываются в интерактивном профиле
+    m_pool.setConnectionPragmas(interactivePragmas);
+    qRegisterMetaType<DataChange>("DataChange");
 }
 
 DatabaseManager::~DatabaseManager()
 {
-    if (m_db.isOpen()) {
-        m_db.close();
-    }
 }
 
-bool DatabaseManager::isOpen() const
+bool DataChange::playerChanged(qint64 playerId) const
 {
-    return m_db.isOpen();
+    auto it = std::lower_bound(changedPlayers.cbegin(), changedPlayers.cend(), playerId,
+                               [](const IdRange &range, qint64 id) { return range.last < id; });
+    return (it != changedPlayers.cend() && it->contains(playerId)) || newPlayers.contains(playerId);
 }
 
-bool DatabaseManager::initialize()
+void DataChange::merge(const DataChange &other)
 {
-    if (!m_db.open()) {
-        qDebug() << "Error: Failed to connect to database:" << m_db.lastError().text();
-        return false;
+    if (reset || other.reset) {
+        *this = all();
+        return;
+    }
+    if (!other.newGames.isEmpty()) {
+        newGames.add(other.newGames.first);
+        newGames.add(other.newGames.last);
+    }
+    if (!other.newPlayers.isEmpty()) {
+        newPlayers.add(other.newPlayers.first);
+        newPlayers.add(other.newPlayers.last);
+    }
+    if (other.changedPlayers.isEmpty()) {
+        return;
     }
 
-    return createTables();
+    // Диапазоны обоих изменений по возрастанию, смежные и пересекающиеся - в один
+    QVector<IdRange> ranges = changedPlayers + other.changedPlayers;
+    std::sort(ranges.begin(), ranges.end(), [](const IdRange &a, const IdRange &b) { return a.first < b.first; });
+    changedPlayers.clear();
+    for (const IdRange &range : ranges) {
+        if (!changedPlayers.isEmpty() && range.first <= changedPlayers.last().last + 1) {
+            changedPlayers.last().last = qMax(changedPlayers.last().last, range.last);
+        } else {
+            changedPlayers.append(range);
+        }
+    }
 }
 
-bool DatabaseManager::createTables()
+void DatabaseManager::notifyDataChanged(const DataChange &change)
 {
-    // Begin transaction
-    if (!executeQuery("BEGIN TRANSACTION;")) {
-        return false;
-    }
-
-    // Create tables
-    QStringList tables = {
-        "CREATE TABLE IF NOT EXISTS \"players\" ("
-        "\"player_id\" INTEGER,"
-        "\"nickname\" TEXT NOT NULL UNIQUE,"
-        "\"glicko_rating\" REAL DEFAULT 1000.0,"
-        "\"skill_level\" INTEGER DEFAULT 1," // Уровень навыка игрока
-        "\"wins\" INTEGER DEFAULT 0," // Количество побед
-        "\"total_matches\" INTEGER DEFAULT 0," // Общее количество игр
-        "\"win_rate\" REAL DEFAULT 0.0," // Процент побед
-        "PRIMARY KEY(\"player_id\" AUTOINCREMENT)"
-        ");",
-
-        "CREATE TABLE IF NOT EXISTS \"games\" ("
-        "\"game_id\" INTEGER,"
-        "\"game_date\" DATETIME DEFAULT CURRENT_TIMESTAMP,"
-        "\"team1_score\" INTEGER NOT NULL,"
-        "\"team2_score\" INTEGER NOT NULL,"
-        "\"winner_team\" TEXT NOT NULL CHECK(\"winner_team\" IN ('team1', 'team2')),"
-        "PRIMARY KEY(\"game_id\" AUTOINCREMENT)"
-        ");",
-
-        "CREATE TABLE IF NOT EXISTS \"game_participation\" ("
-        "\"participation_id\" INTEGER,"
-        "\"game_id\" INTEGER NOT NULL,"
-        "\"player_id\" INTEGER NOT NULL,"
-        "\"team\" TEXT NOT NULL CHECK(\"team\" IN ('team1', 'team2')),"
-        "\"rating_change\" REAL DEFAULT 0.0," // Изменение рейтинга после игры
-        "PRIMARY KEY(\"participation_id\" AUTOINCREMENT),"
-        "FOREIGN KEY(\"game_id\") REFERENCES \"games\"(\"game_id\"),"
-        "FOREIGN KEY(\"player_id\") REFERENCES \"players\"(\"player_id\")"
-        ");",
-
-        "CREATE TABLE IF NOT EXISTS \"ratings\" ("
-        "\"rating_id\" INTEGER,"
-        "\"player_id\" INTEGER NOT NULL UNIQUE,"
-        "\"glicko_rating\" REAL DEFAULT 1000.0,"
-        "\"rd\" REAL DEFAULT 350.0,"
-        "\"total_matches\" INTEGER DEFAULT 0,"
-        "PRIMARY KEY(\"rating_id\" AUTOINCREMENT),"
-        "FOREIGN KEY(\"player_id\") REFERENCES \"players\"(\"player_id\")"
-        ");"
-    };
-
-    for (const QString &query : tables) {
-        if (!executeQuery(query)) {
-            executeQuery("ROLLBACK;");
-            return false;
-        }
+    if (change.isEmpty()) {
+        return;
     }
+    const quint64 counter = m_changeCounter.fetch_add(1, std::memory_order_acq_rel) + 1;
+    emit dataChanged(counter, change);
+}
 
-    // Commit transaction
-    return executeQuery("COMMIT;");
+bool DatabaseManager::isOpen()
+{
+    return database().isOpen();
 }
 
-bool DatabaseManager::executeQuery(const QString &query)
+QSqlDatabase &DatabaseManager::database()
 {
-    QSqlQuery sqlQuery;
-    if (!sqlQuery.exec(query)) {
-        qDebug() << "Query error:" << sqlQuery.lastError().text() << "for query:" << query;
-        return false;
-    }
-    return true;
+    return m_pool.local().db;
 }
 
-bool DatabaseManager::addPlayer(const QString &nickname, int skillLevel, double glickoRating)
+void DatabaseManager::releaseThreadConnection()
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO players (nickname, glicko_rating, skill_level, wins, total_matches, win_rate) "
-                  "VALUES (:nickname, :rating, :skillLevel, 0, 0, 0.0)");
-    query.bindValue(":nickname", nickname);
-    query.bindValue(":rating", glickoRating);
-    query.bindValue(":skillLevel", skillLevel);
+    m_pool.releaseLocal();
+}
 
-    if (!query.exec()) {
-        qDebug() << "Error adding player:" << query.lastError().text();
+bool DatabaseManager::initialize()
+{
+    QSqlDatabase &db = database();
+    if (!db.isOpen()) {
+        qDebug() << "Error: Failed to connect to database:" << db.lastError().text();
         return false;
     }
 
-    int playerId = query.lastInsertId().toInt();
-
-    // Also add an entry to the ratings table
-    QSqlQuery ratingQuery;
-    ratingQuery.prepare("INSERT INTO ratings (player_id, glicko_rating) VALUES (:playerId, :rating)");
-    ratingQuery.bindValue(":playerId", playerId);
-    ratingQuery.bindValue(":rating", glickoRating);
-
-    if (!ratingQuery.exec()) {
-        qDebug() << "Error adding rating:" << ratingQuery.lastError().text();
+    if (!migrateSchema() || !loadPartitionCatalog()) {
         return false;
     }
+    // Без FTS5 поиск по никнейму работает через LIKE, это не ошибка инициализации
+    createNicknameIndex();
 
-    return true;
+    // Индексы могли остаться удаленными, если массовая загрузка была прервана
+    return setStorageProfile(StorageProfile::Interactive);
 }
 
-bool DatabaseManager::addGame(int team1Score, int team2Score, const QString &winnerTeam)
+namespace {
+// Миграция схемы: версия, которую получает БД после применения, и ее SQL.
+// Миграции применяются строго по порядку, каждая - в своей транзакции.
+struct SchemaMigration {
+    int version;
+    const char *description;
+    QStringList statements;
+    bool vacuumAfter = false; // Перестройка таблиц: вернуть освободившееся место файлу
+};
+
+const QVector<SchemaMigration> &schemaMigrations()
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO games (team1_score, team2_score, winner_team) "
-                  "VALUES (:team1Score, :team2Score, :winnerTeam)");
-    query.bindValue(":team1Score", team1Score);
-    query.bindValue(":team2Score", team2Score);
-    query.bindValue(":winnerTeam", winnerTeam);
+    static const QVector<SchemaMigration> migrations = {
+        {1, "Base schema", {
+             "CREATE TABLE IF NOT EXISTS \"players\" ("
+             "\"player_id\" INTEGER,"
+             "\"nickname\" TEXT NOT NULL UNIQUE,"
+             "\"glicko_rating\" REAL DEFAULT 1000.0,"
+             "\"skill_level\" INTEGER DEFAULT 1," // Уровень навыка игрока
+             "\"wins\" INTEGER DEFAULT 0," // Количество побед
+             "\"total_matches\" INTEGER DEFAULT 0," // Общее количество игр
+             "\"win_rate\" REAL DEFAULT 0.0," // Процент побед
+             "PRIMARY KEY(\"player_id\" AUTOINCREMENT)"
+             ");",
+
+             "CREATE TABLE IF NOT EXISTS \"games\" ("
+             "\"game_id\" INTEGER,"
+             "\"game_date\" DATETIME DEFAULT CURRENT_TIMESTAMP,"
+             "\"team1_score\" INTEGER NOT NULL,"
+             "\"team2_score\" INTEGER NOT NULL,"
+             "\"winner_team\" TEXT NOT NULL CHECK(\"winner_team\" IN ('team1', 'team2')),"
+             "PRIMARY KEY(\"game_id\" AUTOINCREMENT)"
+             ");",
+
+             "CREATE TABLE IF NOT EXISTS \"game_participation\" ("
+             "\"participation_id\" INTEGER,"
+             "\"game_id\" INTEGER NOT NULL,"
+             "\"player_id\" INTEGER NOT NULL,"
+             "\"team\" TEXT NOT NULL CHECK(\"team\" IN ('team1', 'team2')),"
+             "\"rating_change\" REAL DEFAULT 0.0," // Изменение рейтинга после игры
+             "PRIMARY KEY(\"participation_id\" AUTOINCREMENT),"
+             "FOREIGN KEY(\"game_id\") REFERENCES \"games\"(\"game_id\"),"
+             "FOREIGN KEY(\"player_id\") REFERENCES \"players\"(\"player_id\")"
+             ");",
+
+             "CREATE TABLE IF NOT EXISTS \"ratings\" ("
+             "\"rating_id\" INTEGER,"
+             "\"player_id\" INTEGER NOT NULL UNIQUE,"
+             "\"glicko_rating\" REAL DEFAULT 1000.0,"
+             "\"rd\" REAL DEFAULT 350.0,"
+             "\"total_matches\" INTEGER DEFAULT 0,"
+             "PRIMARY KEY(\"rating_id\" AUTOINCREMENT),"
+             "FOREIGN KEY(\"player_id\") REFERENCES \"players\"(\"player_id\")"
+             ");"
+         }},
+
+        // Вторичные индексы: состав игры, история игрока, сортировка по рейтингу и по дате
+        {2, "Secondary indexes", {
+             "CREATE INDEX IF NOT EXISTS idx_participation_game ON game_participation(game_id);",
+             "CREATE INDEX IF NOT EXISTS idx_participation_player_game ON game_participation(player_id, game_id);",
+             "CREATE INDEX IF NOT EXISTS idx_players_rating ON players(glicko_rating);",
+             "CREATE INDEX IF NOT EXISTS idx_games_date ON games(game_date);"
+         }},
+
+        // Единая таблица состояния рейтинга: rd переезжает в players, таблица ratings
+        // (дублировавшая glicko_rating и total_matches) удаляется, win_rate вычисляется при чтении.
+        // players пересоздается: ALTER TABLE DROP COLUMN есть только с SQLite 3.35
+        {3, "Single rating table", {
+             "CREATE TABLE \"players_v3\" ("
+             "\"player_id\" INTEGER,"
+             "\"nickname\" TEXT NOT NULL UNIQUE,"
+             "\"glicko_rating\" REAL DEFAULT 1000.0,"
+             "\"skill_level\" INTEGER DEFAULT 1,"
+             "\"wins\" INTEGER DEFAULT 0,"
+             "\"total_matches\" INTEGER DEFAULT 0,"
+             "\"rd\" REAL DEFAULT 350.0,"
+             "PRIMARY KEY(\"player_id\" AUTOINCREMENT)"
+             ");",
+             "INSERT INTO players_v3 (player_id, nickname, glicko_rating, skill_level, wins, total_matches, rd) "
+             "SELECT player_id, nickname, glicko_rating, skill_level, wins, total_matches, "
+             "COALESCE((SELECT r.rd FROM ratings r WHERE r.player_id = players.player_id), 350.0) FROM players;",
+             "DROP TABLE ratings;",
+             "DROP TABLE players;",
+             "ALTER TABLE players_v3 RENAME TO players;",
+             "CREATE INDEX IF NOT EXISTS idx_players_rating ON players(glicko_rating);"
+         }, true},
+
+        // Компактные кодировки: сторона команды - INTEGER 1/2 вместо 'team1'/'team2',
+        // game_date - секунды эпохи (UTC) вместо ISO-текста. Таблицы пересоздаются,
+        // старая дата трактуется как локальное время, как ее писал QDateTime.
+        {4, "Integer team and date encodings", {
+             "CREATE TABLE \"games_v4\" ("
+             "\"game_id\" INTEGER,"
+             "\"game_date\" INTEGER NOT NULL DEFAULT (CAST(strftime('%s', 'now') AS INTEGER)),"
+             "\"team1_score\" INTEGER NOT NULL,"
+             "\"team2_score\" INTEGER NOT NULL,"
+             "\"winner_team\" INTEGER NOT NULL CHECK(\"winner_team\" IN (1, 2)),"
+             "PRIMARY KEY(\"game_id\" AUTOINCREMENT)"
+             ");",
+             "INSERT INTO games_v4 (game_id, game_date, team1_score, team2_score, winner_team) "
+             "SELECT game_id, COALESCE(CAST(strftime('%s', game_date, 'utc') AS INTEGER), 0), team1_score, team2_score, "
+             "CASE winner_team WHEN 'team1' THEN 1 ELSE 2 END FROM games;",
+             "DROP TABLE games;",
+             "ALTER TABLE games_v4 RENAME TO games;",
+             "CREATE INDEX IF NOT EXISTS idx_games_date ON games(game_date);",
+
+             "CREATE TABLE \"game_participation_v4\" ("
+             "\"participation_id\" INTEGER,"
+             "\"game_id\" INTEGER NOT NULL,"
+             "\"player_id\" INTEGER NOT NULL,"
+             "\"team\" INTEGER NOT NULL CHECK(\"team\" IN (1, 2)),"
+             "\"rating_change\" REAL DEFAULT 0.0,"
+             "PRIMARY KEY(\"participation_id\" AUTOINCREMENT),"
+             "FOREIGN KEY(\"game_id\") REFERENCES \"games\"(\"game_id\"),"
+             "FOREIGN KEY(\"player_id\") REFERENCES \"players\"(\"player_id\")"
+             ");",
+             "INSERT INTO game_participation_v4 (participation_id, game_id, player_id, team, rating_change) "
+             "SELECT participation_id, game_id, player_id, CASE team WHEN 'team1' THEN 1 ELSE 2 END, rating_change "
+             "FROM game_participation;",
+             "DROP TABLE game_participation;",
+             "ALTER TABLE game_participation_v4 RENAME TO game_participation;",
+             "CREATE INDEX IF NOT EXISTS idx_participation_game ON game_participation(game_id);",
+             "CREATE INDEX IF NOT EXISTS idx_participation_player_game ON game_participation(player_id, game_id);"
+         }, true},
+
+        // Каталог помесячных разделов истории игр и настройки хранения (включены ли разделы)
+        {5, "Game history partitions catalog", {
+             "CREATE TABLE IF NOT EXISTS \"storage_settings\" ("
+             "\"name\" TEXT PRIMARY KEY,"
+             "\"value\" TEXT"
+             ") WITHOUT ROWID;",
+
+             "CREATE TABLE IF NOT EXISTS \"game_partitions\" ("
+             "\"month\" INTEGER PRIMARY KEY," // ГГГГММ
+             "\"min_game_id\" INTEGER NOT NULL,"
+             "\"max_game_id\" INTEGER NOT NULL,"
+             "\"game_count\" INTEGER NOT NULL DEFAULT 0,"
+             "\"archived\" INTEGER NOT NULL DEFAULT 0"
+             ");"
+         }},
+
+        // Траектории рейтинга: блоки точек в разностном varint-кодировании (ratinghistory.h),
+        // кластеризованные по (player_id, seq) - траектория игрока читается одним диапазоном.
+        // Для игр до этой версии RD не сохранялся, поэтому траектории начинаются с нее
+        {6, "Per-player rating history blocks", {
+             "CREATE TABLE IF NOT EXISTS \"rating_history\" ("
+             "\"player_id\" INTEGER NOT NULL,"
+             "\"seq\" INTEGER NOT NULL,"            // номер блока игрока
+             "\"point_count\" INTEGER NOT NULL,"
+             "\"data\" BLOB NOT NULL,"
+             "PRIMARY KEY (\"player_id\", \"seq\")"
+             ") WITHOUT ROWID;"
+         }},
+
+        // Гистограмма рейтинга: корзина = floor(glicko_rating / RatingHistogramBinWidth).
+        // Заполняется и поддерживается триггерами на players (createHistogramTriggers),
+        // которые создаются при переходе к профилю Interactive
+        {7, "Rating histogram", {
+             "CREATE TABLE IF NOT EXISTS \"rating_histogram\" ("
+             "\"bin\" INTEGER PRIMARY KEY,"
+             "\"player_count\" INTEGER NOT NULL DEFAULT 0,"
+             "\"games\" INTEGER NOT NULL DEFAULT 0"
+             ");"
+         }},
+    };
+    return migrations;
+}
+}
 
-    if (!query.exec()) {
-        qDebug() << "Error adding game:" << query.lastError().text();
-        return false;
-    }
+namespace {
+// Индексы, которые не нужны при массовой записи: при профиле BulkLoad они
+// удаляются и строятся заново одним проходом при возврате к Interactive.
+// idx_participation_game остается - по нему генератор читает участников игры.
+struct DeferredIndex {
+    const char *name;
+    const char *definition;
+};
+
+const DeferredIndex deferredIndexes[] = {
+    {"idx_participation_player_game", "game_participation(player_id, game_id)"},
+    {"idx_players_rating", "players(glicko_rating)"},
+    {"idx_games_date", "games(game_date)"},
+};
+
+// Триггеры гистограммы рейтинга. При BulkLoad они удаляются так же, как отложенные
+// индексы, - массовая запись не платит за каждое изменение рейтинга, - а при
+// возврате к Interactive гистограмма пересчитывается одним GROUP BY.
+const char *const histogramTriggers[] = {
+    "trg_histogram_insert",
+    "trg_histogram_delete",
+    "trg_histogram_update_games",
+    "trg_histogram_update_bin",
+};
+
+// Номер корзины для рейтинга: floor без функций math-расширения SQLite
+QString ratingBinSql(const QString &rating)
+{
+    const QString scaled = QString("(%1 / %2.0)").arg(rating).arg(DatabaseManager::RatingHistogramBinWidth);
+    return QString("(CAST(%1 AS INTEGER) - (%1 < CAST(%1 AS INTEGER)))").arg(scaled);
+}
 
-    return true;
+QStringList histogramTriggerSql()
+{
+    const QString oldBin = ratingBinSql("OLD.glicko_rating");
+    const QString newBin = ratingBinSql("NEW.glicko_rating");
+    const QString addPlayer =
+        "INSERT INTO rating_histogram (bin, player_count, games) VALUES (" + newBin + ", 1, NEW.total_matches) "
+        "ON CONFLICT (bin) DO UPDATE SET player_count = player_count + 1, games = games + excluded.games;";
+    const QString removePlayer =
+        "UPDATE rating_histogram SET player_count = player_count - 1, games = games - OLD.total_matches "
+        "WHERE bin = " + oldBin + ";";
+
+    return {
+        "CREATE TRIGGER trg_histogram_insert AFTER INSERT ON players BEGIN " + addPlayer + " END;",
+        "CREATE TRIGGER trg_histogram_delete AFTER DELETE ON players BEGIN " + removePlayer + " END;",
+        // Рейтинг остался в той же корзине - меняется только число игр
+        "CREATE TRIGGER trg_histogram_update_games AFTER UPDATE OF glicko_rating, total_matches ON players "
+        "WHEN " + oldBin + " = " + newBin + " AND OLD.total_matches <> NEW.total_matches BEGIN "
+        "UPDATE rating_histogram SET games = games + NEW.total_matches - OLD.total_matches "
+        "WHERE bin = " + newBin + "; END;",
+        "CREATE TRIGGER trg_histogram_update_bin AFTER UPDATE OF glicko_rating, total_matches ON players "
+        "WHEN " + oldBin + " <> " + newBin + " BEGIN " + removePlayer + " " + addPlayer + " END;",
+    };
+}
 }
 
-bool DatabaseManager::addPlayerToGame(int gameId, int playerId, const QString &team, double ratingChange)
+bool DatabaseManager::setStorageProfile(StorageProfile profile)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO game_participation (game_id, player_id, team, rating_change) "
-                  "VALUES (:gameId, :playerId, :team, :ratingChange)");
-    query.bindValue(":gameId", gameId);
-    query.bindValue(":playerId", playerId);
-    query.bindValue(":team", team);
-    query.bindValue(":ratingChange", ratingChange);
+    TRACE_SCOPE("setStorageProfile");
+    const QStringList &pragmas = (profile == StorageProfile::Interactive) ? interactivePragmas : bulkLoadPragmas;
+    for (const QString &pragma : pragmas) {
+        if (!executeQuery(pragma)) {
+            return false;
+        }
+    }
 
-    if (!query.exec()) {
-        qDebug() << "Error adding player to game:" << query.lastError().text();
+    // Отложенные индексы читают список игроков, история игрока и список игр;
+    // при ConcurrentBulkLoad они остаются, удаляются только триггеры гистограммы
+    bool indexesOk = false;
+    switch (profile) {
+    case StorageProfile::Interactive:
+        indexesOk = createDeferredIndexes() && createHistogramTriggers();
+        break;
+    case StorageProfile::BulkLoad:
+        indexesOk = dropDeferredIndexes() && dropHistogramTriggers();
+        break;
+    case StorageProfile::ConcurrentBulkLoad:
+        indexesOk = createDeferredIndexes() && dropHistogramTriggers();
+        break;
+    }
+    if (!indexesOk) {
         return false;
     }
 
-    // Не обновляем здесь статистику игроков, это будет делаться централизованно
-    // при обработке всего игрового процесса для предотвращения проблемы
-    // с подсчетом побед
+    m_storageProfile = profile;
 
+    // PRAGMA действуют только на соединении вызывающего потока: его профиль
+    // запоминается на нем, и по нему настраиваются подключенные и будущие разделы
+    // этого соединения. Другие потоки (таблицы GUI) остаются в своем профиле.
+    // Индексы разделов не откладываются
+    ConnectionPool::Connection &connection = m_pool.local();
+    connection.profile = profile;
+    for (int month : connection.attachedPartitions) {
+        if (!applyPartitionPragmas(connection, month)) {
+            return false;
+        }
+    }
     return true;
 }
 
-int DatabaseManager::getPlayerId(const QString &nickname)
+bool DatabaseManager::createDeferredIndexes()
 {
-    QSqlQuery query;
-    query.prepare("SELECT player_id FROM players WHERE nickname = :nickname");
-    query.bindValue(":nickname", nickname);
-
-    if (!query.exec() || !query.next()) {
-        qDebug() << "Error retrieving player:" << query.lastError().text();
-        return -1;
+    for (const DeferredIndex &index : deferredIndexes) {
+        if (!executeQuery(QString("CREATE INDEX IF NOT EXISTS %1 ON %2;").arg(index.name, index.definition))) {
+            return false;
+        }
     }
-
-    return query.value(0).toInt();
+    return true;
 }
 
-bool DatabaseManager::updatePlayerRating(int playerId, double glickoRating, double rd, int totalMatches, int wins)
+bool DatabaseManager::dropDeferredIndexes()
 {
-    QSqlQuery playerQuery;
-    // Рассчитываем winRate
-    double winRate = (totalMatches > 0) ? (static_cast<double>(wins) / totalMatches * 100.0) : 0.0;
-
-    playerQuery.prepare("UPDATE players SET glicko_rating = :rating, total_matches = :matches, "
-                        "wins = :wins, win_rate = :winRate WHERE player_id = :playerId");
-    playerQuery.bindValue(":rating", glickoRating);
-    playerQuery.bindValue(":matches", totalMatches);
-    playerQuery.bindValue(":wins", wins);
-    playerQuery.bindValue(":winRate", winRate);
-    playerQuery.bindValue(":playerId", playerId);
+    for (const DeferredIndex &index : deferredIndexes) {
+        if (!executeQuery(QString("DROP INDEX IF EXISTS %1;").arg(index.name))) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    if (!playerQuery.exec()) {
-        qDebug() << "Error updating player rating:" << playerQuery.lastError().text();
+bool DatabaseManager::createHistogramTriggers()
+{
+    QSqlQuery query(database());
+    if (!query.exec("SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND name LIKE 'trg_histogram_%'")
+        || !query.next()) {
+        qDebug() << "Error checking histogram triggers:" << query.lastError().text();
         return false;
     }
+    if (query.value(0).toInt() == int(std::size(histogramTriggers))) {
+        return true;
+    }
+    query.finish();
+
+    // Триггеров нет (после BulkLoad или прерванной загрузки) - гистограмма могла
+    // устареть: пересчитывается и снова подключается к players в одной транзакции
+    TRACE_SCOPE("rebuildRatingHistogram");
+    const QString bin = ratingBinSql("glicko_rating");
+    QStringList statements;
+    for (const char *name : histogramTriggers) {
+        statements << QString("DROP TRIGGER IF EXISTS %1;").arg(name);
+    }
+    statements << "DELETE FROM rating_histogram;"
+               << "INSERT INTO rating_histogram (bin, player_count, games) "
+                  "SELECT " + bin + " AS b, COUNT(*), SUM(total_matches) FROM players GROUP BY b;";
+    statements << histogramTriggerSql();
 
-    QSqlQuery ratingQuery;
-    ratingQuery.prepare("UPDATE ratings SET glicko_rating = :rating, rd = :rd, total_matches = :matches "
-                        "WHERE player_id = :playerId");
-    ratingQuery.bindValue(":rating", glickoRating);
-    ratingQuery.bindValue(":rd", rd);
-    ratingQuery.bindValue(":matches", totalMatches);
-    ratingQuery.bindValue(":playerId", playerId);
-
-    if (!ratingQuery.exec()) {
-        qDebug() << "Error updating rating details:" << ratingQuery.lastError().text();
+    if (!executeQuery("BEGIN TRANSACTION;")) {
         return false;
     }
+    for (const QString &statement : statements) {
+        if (!executeQuery(statement)) {
+            executeQuery("ROLLBACK;");
+            return false;
+        }
+    }
+    return executeQuery("COMMIT;");
+}
 
+bool DatabaseManager::dropHistogramTriggers()
+{
+    for (const char *name : histogramTriggers) {
+        if (!executeQuery(QString("DROP TRIGGER IF EXISTS %1;").arg(name))) {
+            return false;
+        }
+    }
     return true;
 }
 
-bool DatabaseManager::exportToJson(const QString& filePath) {
-    QSqlDatabase db = database();
-    QJsonObject databaseObject;
+bool DatabaseManager::createNicknameIndex()
+{
+    // Внешнее содержимое: индекс хранит только триграммы, текст берется из players
+    const QStringList triggers = {
+        "CREATE TRIGGER IF NOT EXISTS trg_players_fts_insert AFTER INSERT ON players BEGIN "
+        "INSERT INTO players_fts (rowid, nickname) VALUES (NEW.player_id, NEW.nickname); END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_players_fts_delete AFTER DELETE ON players BEGIN "
+        "INSERT INTO players_fts (players_fts, rowid, nickname) VALUES ('delete', OLD.player_id, OLD.nickname); END;",
+        "CREATE TRIGGER IF NOT EXISTS trg_players_fts_update AFTER UPDATE OF nickname ON players BEGIN "
+        "INSERT INTO players_fts (players_fts, rowid, nickname) VALUES ('delete', OLD.player_id, OLD.nickname); "
+        "INSERT INTO players_fts (rowid, nickname) VALUES (NEW.player_id, NEW.nickname); END;",
+    };
 
-    QStringList tableNames;
-    tableNames << "players" << "ratings" << "games" << "game_participation";
+    QSqlQuery query(database());
+    const bool exists = query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'players_fts'")
+                        && query.next();
+    query.finish();
+
+    bool ok = true;
+    bool rebuild = !exists;
+    if (exists) {
+        // Триггеров нет, если БД открывалась сборкой без FTS5: индекс мог отстать
+        ok = query.exec("SELECT rowid FROM players_fts LIMIT 0")
+             && query.exec("SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND name LIKE 'trg_players_fts_%'")
+             && query.next();
+        rebuild = ok && query.value(0).toInt() < triggers.size();
+        query.finish();
+    }
 
-    for (const QString& tableName : tableNames) {
-        QSqlQuery query(db);
-        if (!query.exec("SELECT * FROM " + tableName)) {
-            qDebug() << "Error querying table" << tableName << ":" << query.lastError().text();
-            return false;
+    if (rebuild && !executeQuery("BEGIN TRANSACTION;")) {
+        ok = false;
+    } else if (rebuild) {
+        TRACE_SCOPE("buildNicknameIndex");
+        if (!exists) {
+            ok = query.exec("CREATE VIRTUAL TABLE players_fts USING fts5("
+                            "nickname, content='players', content_rowid='player_id', tokenize='trigram')");
         }
-
-        QJsonArray tableArray;
-        while (query.next()) {
-            QJsonObject rowObject;
-            QSqlRecord record = query.record();
-            for (int i = 0; i < record.count(); ++i) {
-                rowObject[record.fieldName(i)] = QJsonValue::fromVariant(record.value(i));
-            }
-            tableArray.append(rowObject);
+        ok = ok && query.exec("INSERT INTO players_fts (players_fts) VALUES ('rebuild')");
+        for (const QString &trigger : triggers) {
+            ok = ok && query.exec(trigger);
+        }
+        if (ok) {
+            ok = executeQuery("COMMIT;");
+        } else {
+            qDebug() << "Nickname index is not available, search falls back to LIKE:" << query.lastError().text();
+            query.finish();
+            executeQuery("ROLLBACK;");
         }
-        databaseObject[tableName] = tableArray;
     }
 
-    QJsonDocument jsonDoc(databaseObject);
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly)) {
-        qDebug() << "Failed to open file for writing:" << filePath;
-        return false;
+    if (!ok) {
+        // БД создана сборкой с FTS5, а открыта без него: триггеры сломали бы запись в players
+        for (const char *name : {"trg_players_fts_insert", "trg_players_fts_delete", "trg_players_fts_update"}) {
+            executeQuery(QString("DROP TRIGGER IF EXISTS %1;").arg(name));
+        }
     }
+    m_nicknameIndex = ok;
+    return ok;
+}
 
-    file.write(jsonDoc.toJson());
-    file.close();
+int DatabaseManager::latestSchemaVersion()
+{
+    return schemaMigrations().last().version;
+}
 
-    return true;
+int DatabaseManager::schemaVersion()
+{
+    QSqlQuery query(database());
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        qDebug() << "Error reading schema version:" << query.lastError().text();
+        return -1;
+    }
+    return query.value(0).toInt();
 }
 
-bool DatabaseManager::importFromJson(const QString& filePath) {
-    QSqlDatabase db = database();
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "Failed to open file for reading:" << filePath;
+bool DatabaseManager::migrateSchema()
+{
+    int currentVersion = schemaVersion();
+    if (currentVersion < 0) {
         return false;
     }
 
-    QByteArray jsonData = file.readAll();
-    file.close();
-
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData);
-    if (jsonDoc.isNull()) {
-        qDebug() << "Failed to parse JSON data.";
+    if (currentVersion > latestSchemaVersion()) {
+        qDebug() << "Error: database schema version" << currentVersion
+                 << "is newer than supported version" << latestSchemaVersion();
         return false;
     }
 
-    QJsonObject databaseObject = jsonDoc.object();
-
-    QStringList tableNames;
-    tableNames << "players" << "ratings" << "games" << "game_participation";
+    for (const SchemaMigration &migration : schemaMigrations()) {
+        if (migration.version <= currentVersion) {
+            continue;
+        }
 
-    for (const QString& tableName : tableNames) {
-        if (!databaseObject.contains(tableName)) {
-            qDebug() << "JSON data does not contain table:" << tableName;
+        // Begin transaction
+        if (!executeQuery("BEGIN TRANSACTION;")) {
             return false;
         }
 
-        QJsonArray tableArray = databaseObject[tableName].toArray();
-        for (int i = 0; i < tableArray.size(); ++i) {
-            QJsonObject rowObject = tableArray[i].toObject();
+        QStringList statements = migration.statements;
+        // user_version меняется в той же транзакции, что и схема
+        statements << QString("PRAGMA user_version = %1;").arg(migration.version);
 
-            // Build the INSERT query
-            QStringList keys = rowObject.keys();
-            QString insertQuery = "INSERT INTO " + tableName + " (";
-            QString valuesQuery = "VALUES (";
-
-            for (int j = 0; j < keys.size(); ++j) {
-                insertQuery += keys[j];
-                valuesQuery += ":" + keys[j];
-
-                if (j < keys.size() - 1) {
-                    insertQuery += ", ";
-                    valuesQuery += ", ";
-                }
+        for (const QString &statement : statements) {
+            if (!executeQuery(statement)) {
+                qDebug() << "Schema migration" << migration.version << "failed:" << migration.description;
+                executeQuery("ROLLBACK;");
+                return false;
             }
+        }
 
-            insertQuery += ") ";
-            valuesQuery += ")";
-
-            QSqlQuery query(db);
-            query.prepare(insertQuery + valuesQuery);
+        // Commit transaction
+        if (!executeQuery("COMMIT;")) {
+            return false;
+        }
 
-            for (const QString& key : keys) {
-                query.bindValue(":" + key, rowObject[key].toVariant());
-            }
+        qDebug() << "Database schema migrated to version" << migration.version << "-" << migration.description;
+        currentVersion = migration.version;
 
-            if (!query.exec()) {
-                qDebug() << "Error inserting into table" << tableName << ":" << query.lastError().text();
-                return false;
-            }
+        if (migration.vacuumAfter && !executeQuery("VACUUM;")) {
+            qDebug() << "Warning: VACUUM after schema migration" << migration.version << "failed";
         }
     }
 
     return true;
 }
 
-QVector<QVector<QString>> DatabaseManager::getGamesTable() {
-    QSqlDatabase db = database();
-    QSqlQuery query(db);
-    if (!query.exec("SELECT game_id, game_date, team1_score, team2_score, winner_team FROM games")) {
-        qDebug() << "Error retrieving games table with ID:" << query.lastError().text();
-        return QVector<QVector<QString>>();
+QStringList DatabaseManager::queryPlan(const QString &sql)
+{
+    QStringList plan;
+    QSqlQuery query(database());
+    if (!query.exec("EXPLAIN QUERY PLAN " + sql)) {
+        qDebug() << "Error explaining query:" << query.lastError().text() << "for query:" << sql;
+        return plan;
     }
 
-    QVector<QVector<QString>> result;
+    // Столбцы: id, parent, notused, detail
     while (query.next()) {
-        QSqlRecord record = query.record();
-        QVector<QString> row;
-        for (int i = 0; i < record.count(); ++i) {
-            row.append(record.value(i).toString());
-        }
-        result.append(row);
+        plan << query.value(3).toString();
     }
-    return result;
+    return plan;
 }
 
-QVector<QVector<QString>> DatabaseManager::getPlayersWithRatings() {
-    QSqlDatabase db = database();
-    QSqlQuery query(db);
-    if (!query.exec("SELECT p.nickname, p.glicko_rating, r.rd, p.total_matches, p.skill_level, p.wins, p.win_rate "
-                    "FROM players p JOIN ratings r ON p.player_id = r.player_id "
-                    "ORDER BY p.glicko_rating DESC")) {
-        qDebug() << "Error retrieving players with ratings:" << query.lastError().text();
-        return QVector<QVector<QString>>();
+namespace {
+// Ключ кэша запросов: месяц раздела * StatementSlots + Statement (0 - основная БД)
+constexpr int StatementSlots = 64;
+
+// Текст запроса; {part} перед таблицами истории игр заменяется схемой раздела
+// ("p_ГГГГММ.") или пустой строкой для основной БД
+QString statementSql(Statement id)
+{
+    switch (id) {
+    case Statement::AddPlayer:
+        return "INSERT INTO players (nickname, glicko_rating, rd, skill_level, wins, total_matches) "
+               "VALUES (:nickname, :rating, 350.0, :skillLevel, 0, 0)";
+    case Statement::AddGame:
+        return "INSERT INTO games (team1_score, team2_score, winner_team) "
+               "VALUES (:team1Score, :team2Score, :winnerTeam)";
+    case Statement::InsertGame:
+        return "INSERT INTO games (game_date, team1_score, team2_score, winner_team) "
+               "VALUES (:gameDate, :team1Score, :team2Score, :winnerTeam)";
+    case Statement::AddPlayerToGame:
+        return "INSERT INTO {part}game_participation (game_id, player_id, team, rating_change) "
+               "VALUES (:gameId, :playerId, :team, :ratingChange)";
+    case Statement::GetPlayerId:
+        return "SELECT player_id FROM players WHERE nickname = :nickname";
+    case Statement::UpdatePlayerRating:
+        return "UPDATE players SET glicko_rating = :rating, rd = :rd, total_matches = :matches, "
+               "wins = :wins WHERE player_id = :playerId";
+    case Statement::UpdatePlayerWinStats:
+        return "UPDATE players SET wins = wins + 1 WHERE player_id = :playerId";
+    case Statement::GameDetails:
+        return "SELECT p.nickname, gp.team, p.glicko_rating, gp.rating_change, p.skill_level, "
+               "CASE WHEN p.total_matches > 0 THEN p.wins * 100.0 / p.total_matches ELSE 0 END "
+               "FROM {part}game_participation gp "
+               "JOIN players p ON gp.player_id = p.player_id "
+               "WHERE gp.game_id = :gameId "
+               "ORDER BY gp.team, p.nickname";
+    case Statement::GameWinner:
+        return "SELECT winner_team FROM {part}games WHERE game_id = :gameId";
+    case Statement::ApplyGameResult:
+        return "UPDATE players SET glicko_rating = :rating, rd = :rd, "
+               "total_matches = total_matches + 1, wins = wins + :win "
+               "WHERE player_id = :playerId";
+    case Statement::RatingHistogram:
+        return "SELECT bin, player_count, games FROM rating_histogram WHERE player_count > 0 ORDER BY bin";
+    case Statement::CountPlayers:
+        return "SELECT COUNT(*) FROM players";
+    case Statement::SkillRatings:
+        return "SELECT skill_level, COUNT(*), AVG(glicko_rating), MIN(glicko_rating), MAX(glicko_rating) "
+               "FROM players GROUP BY skill_level ORDER BY skill_level";
+    case Statement::RatingMoments:
+        // Вес - игры игрока, как у корзин гистограммы. Центральные суммы - вторым
+        // проходом от уже посчитанного среднего, без вычитания больших сумм степеней
+        return "WITH w AS (SELECT SUM(total_matches) AS n, "
+               "SUM(total_matches * glicko_rating) / SUM(total_matches) AS mean "
+               "FROM players WHERE total_matches > 0) "
+               "SELECT w.n, w.mean, "
+               "SUM(p.total_matches * (p.glicko_rating - w.mean) * (p.glicko_rating - w.mean)), "
+               "SUM(p.total_matches * (p.glicko_rating - w.mean) * (p.glicko_rating - w.mean) "
+               "* (p.glicko_rating - w.mean)), "
+               "SUM(p.total_matches * (p.glicko_rating - w.mean) * (p.glicko_rating - w.mean) "
+               "* (p.glicko_rating - w.mean) * (p.glicko_rating - w.mean)) "
+               "FROM players p, w WHERE p.total_matches > 0";
+    case Statement::AppendRatingHistory:
+        // Точки дописываются к блоку; || над BLOB дает TEXT, поэтому результат приводится обратно
+        return "INSERT INTO rating_history (player_id, seq, point_count, data) "
+               "VALUES (:playerId, :seq, :pointCount, :data) "
+               "ON CONFLICT (player_id, seq) DO UPDATE SET "
+               "point_count = point_count + excluded.point_count, "
+               "data = CAST(data || excluded.data AS BLOB)";
+    case Statement::LastRatingHistoryBlock:
+        return "SELECT seq, data FROM rating_history WHERE player_id = :playerId ORDER BY seq DESC LIMIT 1";
+    case Statement::RatingHistory:
+        return "SELECT point_count, data FROM rating_history WHERE player_id = :playerId ORDER BY seq";
+    case Statement::PlayerCard:
+        return "SELECT nickname, glicko_rating, rd, skill_level, total_matches, wins, "
+               "CASE WHEN total_matches > 0 THEN wins * 100.0 / total_matches ELSE 0 END "
+               "FROM players WHERE player_id = :playerId";
+    case Statement::InsertPartitionGame:
+        return "INSERT INTO {part}games (game_id, game_date, team1_score, team2_score, winner_team) "
+               "VALUES (:gameId, :gameDate, :team1Score, :team2Score, :winnerTeam)";
+    case Statement::RecordPartitionGame:
+        return "INSERT INTO game_partitions (month, min_game_id, max_game_id, game_count) "
+               "VALUES (:month, :minGameId, :maxGameId, 1) "
+               "ON CONFLICT(month) DO UPDATE SET "
+               "min_game_id = min(min_game_id, excluded.min_game_id), "
+               "max_game_id = max(max_game_id, excluded.max_game_id), "
+               "game_count = game_count + 1";
+    case Statement::GameScore:
+        return "SELECT team1_score, team2_score, winner_team FROM {part}games WHERE game_id = :gameId";
+    case Statement::TeamSquad:
+        return "SELECT p.nickname FROM players p "
+               "JOIN {part}game_participation gp ON p.player_id = gp.player_id "
+               "WHERE gp.game_id = :gameId AND gp.team = :team";
+    case Statement::PlayerHistory:
+        return "SELECT gp.game_id, g.team1_score, g.team2_score, g.game_date, "
+               "gp.team = g.winner_team, gp.rating_change "
+               "FROM {part}game_participation gp "
+               "JOIN {part}games g ON gp.game_id = g.game_id "
+               "WHERE gp.player_id = :playerId "
+               "ORDER BY gp.game_id DESC";
+    case Statement::PlayerHistoryPage:
+        return "SELECT gp.game_id, g.team1_score, g.team2_score, g.game_date, "
+               "gp.team = g.winner_team, gp.rating_change "
+               "FROM {part}game_participation gp "
+               "JOIN {part}games g ON gp.game_id = g.game_id "
+               "WHERE gp.player_id = :playerId AND gp.game_id < :beforeGameId "
+               "ORDER BY gp.game_id DESC LIMIT :limit";
     }
+    return QString();
+}
+}
 
-    QVector<QVector<QString>> result;
-    while (query.next()) {
-        QSqlRecord record = query.record();
-        QVector<QString> row;
+QSqlQuery &DatabaseManager::cachedStatement(Statement id)
+{
+    // Основная схема подключена всегда
+    return *preparedStatement(id, 0);
+}
 
-        row.append(record.value(0).toString()); // Никнейм
-        row.append(QString::number(qRound(record.value(1).toDouble()))); // Рейтинг
-        row.append(QString::number(qRound(record.value(2).toDouble()))); // RD
-        row.append(record.value(3).toString()); // Общее количество игр
+QSqlQuery *DatabaseManager::partitionStatement(Statement id, int gameId)
+{
+    return preparedStatement(id, partitionForGame(gameId));
+}
 
-        // Текстовое представление уровня навыка
-        int skillLevel = record.value(4).toInt();
-        QString skillText;
-        switch (skillLevel) {
-        case 1: skillText = "Низкий"; break;
-        case 2: skillText = "Средний"; break;
-        case 3: skillText = "Выше среднего"; break;
-        case 4: skillText = "Высокий"; break;
-        default: skillText = "Неизвестный";
+QSqlQuery *DatabaseManager::preparedStatement(Statement id, int month)
+{
+    ConnectionPool::Connection &connection = m_pool.local();
+    QString prefix;
+    if (month > 0) {
+        // Без раздела запрос не переадресуется в основную схему: строка попала бы
+        // мимо каталога, а чтение вернуло бы пустой результат вместо ошибки
+        if (!attachPartition(connection, month)) {
+            qDebug() << "Error preparing statement" << static_cast<int>(id) << ": partition" << month
+                     << "is not attached";
+            return nullptr;
         }
-        row.append(skillText); // Уровень навыка
+        prefix = PartitionCatalog::schemaName(month) + ".";
+    }
 
-        row.append(record.value(5).toString()); // Количество побед
-        row.append(QString::number(record.value(6).toDouble(), 'f', 1) + "%"); // Процент побед
+    const int key = month * StatementSlots + static_cast<int>(id);
+    auto it = connection.statements.constFind(key);
+    if (it != connection.statements.constEnd()) {
+        ++connection.stats.hits;
+        return *it;
+    }
 
-        result.append(row);
+    ++connection.stats.misses;
+    QSqlQuery *query = new QSqlQuery(connection.db);
+    if (!query->prepare(statementSql(id).replace("{part}", prefix))) {
+        qDebug() << "Error preparing statement" << key << ":" << query->lastError().text();
     }
-    return result;
+    connection.statements.insert(key, query);
+    return query;
 }
 
-QMap<int, int> DatabaseManager::getRatingData() {
-    QMap<int, int> ratingData;
-    QSqlDatabase db = database();
-    QSqlQuery query(db);
-
-    // Запрос для получения рейтинга и количества игр для каждого игрока
-    query.prepare("SELECT r.glicko_rating, p.total_matches FROM ratings r JOIN players p ON r.player_id = p.player_id");
+void DatabaseManager::clearStatementCache()
+{
+    ConnectionPool::Connection &connection = m_pool.local();
+    qDeleteAll(connection.statements);
+    connection.statements.clear();
+}
 
-    if (!query.exec()) {
-        qDebug() << "Error retrieving rating data:" << query.lastError().text();
-        return ratingData; // Возвращаем пустую карту в случае ошибки
+bool DatabaseManager::executeQuery(const QString &query)
+{
+    QSqlQuery sqlQuery(database());
+    if (!sqlQuery.exec(query)) {
+        qDebug() << "Query error:" << sqlQuery.lastError().text() << "for query:" << query;
+        return false;
     }
+    return true;
+}
 
-    while (query.next()) {
-        int rating = qRound(query.value(0).toDouble()); // Округляем рейтинг до целого числа
-        int totalMatches = query.value(1).toInt();
-        ratingData[rating] = totalMatches;
+bool DatabaseManager::addPlayer(const QString &nickname, int skillLevel, double glickoRating)
+{
+    QSqlQuery &query = cachedStatement(Statement::AddPlayer);
+    query.bindValue(":nickname", nickname);
+    query.bindValue(":rating", glickoRating);
+    query.bindValue(":skillLevel", skillLevel);
+
+    if (!query.exec()) {
+        qDebug() << "Error adding player:" << query.lastError().text();
+        return false;
     }
 
-    return ratingData;
+    return true;
 }
 
-QVector<PlayerData> DatabaseManager::getPlayersForMatching() {
-    QSqlDatabase db = database();
-    QSqlQuery query(db);
-
-    if (!query.exec("SELECT p.player_id, p.nickname, p.glicko_rating, r.rd, p.skill_level, p.total_matches, p.wins, p.win_rate "
-                    "FROM players p JOIN ratings r ON p.player_id = r.player_id")) {
-        qDebug() << "Error retrieving players for matching:" << query.lastError().text();
-        return QVector<PlayerData>();
+bool DatabaseManager::addGame(int team1Score, int team2Score, TeamSide winnerTeam)
+{
+    if (isPartitioned()) {
+        return insertGame(QDateTime::currentDateTime(), team1Score, team2Score, winnerTeam) >= 0;
     }
 
-    QVector<PlayerData> result;
-    while (query.next()) {
-        PlayerData player;
-        player.playerId = query.value(0).toInt();
-        player.nickname = query.value(1).toString();
-        player.rating = query.value(2).toDouble();
-        player.rd = query.value(3).toDouble();
-        player.skillLevel = query.value(4).toInt();
-        player.totalMatches = query.value(5).toInt();
-        player.wins = query.value(6).toInt();
-        player.winRate = query.value(7).toDouble();
+    QSqlQuery &query = cachedStatement(Statement::AddGame);
+    query.bindValue(":team1Score", team1Score);
+    query.bindValue(":team2Score", team2Score);
+    query.bindValue(":winnerTeam", static_cast<int>(winnerTeam));
 
-        result.append(player);
+    if (!query.exec()) {
+        qDebug() << "Error adding game:" << query.lastError().text();
+        return false;
     }
 
-    return result;
+    return true;
 }
 
-QVector<QVector<QString>> DatabaseManager::getGameDetails(int gameId) {
-    QSqlDatabase db = database();
-    QSqlQuery query(db);
+int DatabaseManager::insertGame(const QDateTime &gameDate, int team1Score, int team2Score, TeamSide winnerTeam)
+{
+    if (isPartitioned()) {
+        // game_id выдает каталог, строка пишется в раздел месяца игры
+        const int month = PartitionCatalog::monthOf(gameDate);
+        if (m_partitions.isArchived(month)) {
+            qDebug() << "Error creating game: partition" << month << "is archived";
+            return -1;
+        }
+        // Внутри транзакции раздел не подключить: без preparePartition - ошибка
+        if (!isPartitionReady(gameDate) && !preparePartition(gameDate)) {
+            qDebug() << "Error creating game: partition" << month << "is not attached";
+            return -1;
+        }
 
-    query.prepare("SELECT p.nickname, gp.team, p.glicko_rating, gp.rating_change, p.skill_level, p.win_rate "
-                  "FROM game_participation gp "
-                  "JOIN players p ON gp.player_id = p.player_id "
-                  "WHERE gp.game_id = :gameId "
-                  "ORDER BY gp.team, p.nickname");
-    query.bindValue(":gameId", gameId);
+        const qint64 gameId = m_partitions.allocateGameId();
+        QSqlQuery *query = preparedStatement(Statement::InsertPartitionGame, month);
+        if (!query) {
+            return -1;
+        }
+        query->bindValue(":gameId", gameId);
+        query->bindValue(":gameDate", gameDate.toSecsSinceEpoch());
+        query->bindValue(":team1Score", team1Score);
+        query->bindValue(":team2Score", team2Score);
+        query->bindValue(":winnerTeam", static_cast<int>(winnerTeam));
+        if (!query->exec()) {
+            qDebug() << "Error creating game:" << query->lastError().text();
+            return -1;
+        }
 
-    if (!query.exec()) {
-        qDebug() << "Error retrieving game details:" << query.lastError().text();
-        return QVector<QVector<QString>>();
+        QSqlQuery &catalogQuery = cachedStatement(Statement::RecordPartitionGame);
+        catalogQuery.bindValue(":month", month);
+        catalogQuery.bindValue(":minGameId", gameId);
+        catalogQuery.bindValue(":maxGameId", gameId);
+        if (!catalogQuery.exec()) {
+            qDebug() << "Error updating partition catalog:" << catalogQuery.lastError().text();
+            return -1;
+        }
+        m_partitions.recordGame(month, gameId);
+        return static_cast<int>(gameId);
     }
 
-    QVector<QVector<QString>> result;
-    while (query.next()) {
-        QVector<QString> row;
-        row.append(query.value(0).toString()); // Никнейм
-        row.append(query.value(1).toString()); // Команда
-        row.append(QString::number(qRound(query.value(2).toDouble()))); // Рейтинг
+    QSqlQuery &query = cachedStatement(Statement::InsertGame);
+    query.bindValue(":gameDate", gameDate.toSecsSinceEpoch());
+    query.bindValue(":team1Score", team1Score);
+    query.bindValue(":team2Score", team2Score);
+    query.bindValue(":winnerTeam", static_cast<int>(winnerTeam));
 
-        // Форматируем изменение рейтинга
-        double ratingChange = query.value(3).toDouble();
-        QString ratingChangeStr = QString::number(ratingChange, 'f', 1);
-        if (ratingChange > 0) ratingChangeStr = "+" + ratingChangeStr;
-        row.append(ratingChangeStr); // Изменение рейтинга
+    if (!query.exec()) {
+        qDebug() << "Error creating game:" << query.lastError().text();
+        return -1;
+    }
 
-        // Уровень навыка
-        int skillLevel = query.value(4).toInt();
-        QString skillText;
-        switch (skillLevel) {
-        case 1: skillText = "Низкий"; break;
-        case 2: skillText = "Средний"; break;
-        case 3: skillText = "Выше среднего"; break;
-        case 4: skillText = "Высокий"; break;
-        default: skillText = "Неизвестный";
-        }
-        row.append(skillText);
+    return query.lastInsertId().toInt();
+}
 
-        // Винрейт
-        row.append(QString::number(query.value(5).toDouble(), 'f', 1) + "%");
+bool DatabaseManager::addPlayerToGame(int gameId, int playerId, TeamSide team, double ratingChange)
+{
+    QSqlQuery *query = partitionStatement(Statement::AddPlayerToGame, gameId);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(":gameId", gameId);
+    query->bindValue(":playerId", playerId);
+    query->bindValue(":team", static_cast<int>(team));
+    query->bindValue(":ratingChange", ratingChange);
 
-        result.append(row);
+    if (!query->exec()) {
+        qDebug() << "Error adding player to game:" << query->lastError().text();
+        return false;
     }
 
-    return result;
+    // Не обновляем здесь статистику игроков, это будет делаться централизованно
+    // при обработке всего игрового процесса для предотвращения проблемы
+    // с подсчетом побед
+
+    return true;
 }
 
-bool DatabaseManager::updatePlayerWinStats(int playerId, bool isWin) {
+int DatabaseManager::getPlayerId(const QString &nickname)
+{
+    QSqlQuery &query = cachedStatement(Statement::GetPlayerId);
+    query.bindValue(":nickname", nickname);
+
+    if (!query.exec() || !query.next()) {
+        qDebug() << "Error retrieving player:" << query.lastError().text();
+        query.finish();
+        return -1;
+    }
+
+    int playerId = query.value(0).toInt();
+    query.finish();
+    return playerId;
+}
+
+bool DatabaseManager::updatePlayerRating(int playerId, double glickoRating, double rd, int totalMatches, int wins)
+{
+    // winRate не хранится: он вычисляется из wins и total_matches при чтении
+    QSqlQuery &playerQuery = cachedStatement(Statement::UpdatePlayerRating);
+    playerQuery.bindValue(":rating", glickoRating);
+    playerQuery.bindValue(":rd", rd);
+    playerQuery.bindValue(":matches", totalMatches);
+    playerQuery.bindValue(":wins", wins);
+    playerQuery.bindValue(":playerId", playerId);
+
+    if (!playerQuery.exec()) {
+        qDebug() << "Error updating player rating:" << playerQuery.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+namespace {
+// JSON-формат резервных копий не меняется вместе со схемой: стороны команд
+// пишутся как 'team1'/'team2', дата игры - как ISO-строка локального времени,
+// блоки траектории рейтинга (rating_history.data) - как base64-строка
+enum class ExportColumn {
+    Plain,
+    TeamSide,
+    EpochDate,
+    Base64Blob
+};
+
+ExportColumn exportColumnKind(const QString& column)
+{
+    if (column == "team" || column == "winner_team") {
+        return ExportColumn::TeamSide;
+    }
+    if (column == "game_date") {
+        return ExportColumn::EpochDate;
+    }
+    if (column == "data") {
+        return ExportColumn::Base64Blob;
+    }
+    return ExportColumn::Plain;
+}
+
+void writeExportValue(JsonStreamWriter& writer, ExportColumn kind, const QVariant& value)
+{
+    switch (kind) {
+    case ExportColumn::TeamSide:
+        writer.writeString(teamSideName(value.toInt()));
+        break;
+    case ExportColumn::EpochDate:
+        writer.writeString(QDateTime::fromSecsSinceEpoch(value.toLongLong()).toString(Qt::ISODateWithMs));
+        break;
+    case ExportColumn::Base64Blob:
+        writer.writeString(QString::fromLatin1(value.toByteArray().toBase64()));
+        break;
+    case ExportColumn::Plain:
+        writer.writeValue(value);
+        break;
+    }
+}
+
+// Строки таблицы как JSON-массив, прямо из курсора: в памяти только текущая строка
+bool writeTableRows(QSqlDatabase& db, const QString& tableName, JsonStreamWriter& writer)
+{
+    QSqlQuery query(db);
+    // Без forwardOnly QSQLITE кэширует все прочитанные строки
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT * FROM " + tableName)) {
+        qDebug() << "Error querying table" << tableName << ":" << query.lastError().text();
+        return false;
+    }
+
+    QSqlRecord record = query.record();
+    QVector<QByteArray> keys;
+    QVector<ExportColumn> kinds;
+    for (int i = 0; i < record.count(); ++i) {
+        keys << (i > 0 ? ", \"" : "\"") + record.fieldName(i).toUtf8() + "\": ";
+        kinds << exportColumnKind(record.fieldName(i));
+    }
+
+    writer.write("[");
+    bool first = true;
+    while (query.next()) {
+        writer.write(first ? "\n    {" : ",\n    {");
+        first = false;
+        for (int i = 0; i < keys.size(); ++i) {
+            writer.write(keys[i]);
+            writeExportValue(writer, kinds[i], query.value(i));
+        }
+        writer.write("}");
+        if (writer.hasError()) {
+            return false;
+        }
+    }
+    writer.write(first ? "]" : "\n  ]");
+    return !writer.hasError();
+}
+
+// Дописать содержимое временного фрагмента в итоговый файл
+bool appendPart(QIODevice& out, QIODevice& part)
+{
+    if (!part.seek(0)) {
+        return false;
+    }
+    while (!part.atEnd()) {
+        QByteArray chunk = part.read(1 << 20);
+        if (chunk.isEmpty() || out.write(chunk) != chunk.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Обратное преобразование; принимает и старые текстовые, и числовые значения
+QVariant importValue(ExportColumn kind, const QVariant& value)
+{
+    const bool isString = value.userType() == QMetaType::QString;
+    switch (kind) {
+    case ExportColumn::TeamSide:
+        return isString ? static_cast<int>(teamSideFromName(value.toString())) : value.toInt();
+    case ExportColumn::EpochDate:
+        if (isString) {
+            QDateTime dateTime = QDateTime::fromString(value.toString(), Qt::ISODateWithMs);
+            if (!dateTime.isValid()) {
+                dateTime = QDateTime::fromString(value.toString(), "yyyy-MM-dd HH:mm:ss");
+            }
+            return dateTime.toSecsSinceEpoch();
+        }
+        return value.toLongLong();
+    case ExportColumn::Base64Blob:
+        return QByteArray::fromBase64(value.toString().toLatin1());
+    case ExportColumn::Plain:
+        break;
+    }
+    return value;
+}
+
+// Подготовленный INSERT для набора ключей строки. Набор берется из первой строки
+// таблицы; для строк с другим набором ключей готовится отдельный запрос.
+// Колонки, которых больше нет в схеме (например, win_rate из старых копий), пропускаются.
+struct RowInserter {
+    explicit RowInserter(QSqlDatabase& db) : query(db) {}
+
     QSqlQuery query;
+    QVector<int> sourceIndexes; // позиция значения в строке JSON для каждого параметра
+    QVector<ExportColumn> kinds;
+};
+
+std::unique_ptr<RowInserter> makeRowInserter(QSqlDatabase& db, const QString& tableName,
+                                             const QSqlRecord& tableRecord, const QStringList& keys)
+{
+    auto inserter = std::make_unique<RowInserter>(db);
+    QStringList columns;
+    QStringList placeholders;
+    for (int i = 0; i < keys.size(); ++i) {
+        if (tableRecord.contains(keys[i])) {
+            columns << keys[i];
+            placeholders << "?";
+            inserter->sourceIndexes << i;
+            inserter->kinds << exportColumnKind(keys[i]);
+        }
+    }
+
+    if (!columns.isEmpty()
+        && !inserter->query.prepare("INSERT INTO " + tableName + " (" + columns.join(", ") + ") "
+                                    "VALUES (" + placeholders.join(", ") + ")")) {
+        qDebug() << "Error preparing insert for table" << tableName << ":" << inserter->query.lastError().text();
+        return nullptr;
+    }
+    return inserter;
+}
+}
+}
+
+bool DatabaseManager::exportToJson(const QString& filePath) {
+    TRACE_SCOPE("exportToJson");
+    // Экспорт читает только основной файл: без разделов копия вышла бы без игр
+    if (isPartitioned()) {
+        qDebug() << "Cannot export to" << filePath << ": game history is partitioned, use backupTo instead";
+        return false;
+    }
+    const bool gzip = filePath.endsWith(".gz", Qt::CaseInsensitive);
+    if (gzip && !JsonStreamWriter::gzipSupported()) {
+        qDebug() << "Cannot export to" << filePath << ": gzip support requires zlib";
+        return false;
+    }
+    const JsonStreamWriter::Compression compression =
+        gzip ? JsonStreamWriter::Compression::Gzip : JsonStreamWriter::Compression::None;
+
+    const QStringList tableNames = {"players", "games", "game_participation", "rating_history"};
+
+    // Каждая таблица пишется в свой временный фрагмент отдельным потоком через
+    // собственное соединение пула; фрагменты затем склеиваются в итоговый файл.
+    // Сжатые фрагменты - самостоятельные gzip-члены, склейка не требует пересжатия.
+    std::vector<std::unique_ptr<QTemporaryFile>> parts;
+    std::vector<char> results(tableNames.size(), 0);
+    for (int i = 0; i < tableNames.size(); ++i) {
+        parts.push_back(std::make_unique<QTemporaryFile>(filePath + ".XXXXXX.part"));
+        if (!parts.back()->open()) {
+            qDebug() << "Failed to create temporary file for table" << tableNames[i] << ":" << parts.back()->errorString();
+            return false;
+        }
+    }
 
-    if (isWin) {
-        query.prepare("UPDATE players SET wins = wins + 1, "
-                      "win_rate = CASE WHEN total_matches > 0 THEN (wins * 100.0 / total_matches) ELSE 0 END "
-                      "WHERE player_id = :playerId");
+    // Копия - один момент времени: пока вызывающее соединение держит блокировку
+    // записи (BEGIN IMMEDIATE), ни один писатель не фиксирует транзакцию, и все
+    // потоки открывают снимки чтения одного состояния БД. Если запись уже идет
+    // (например, генерация), таблицы читаются по очереди в одной транзакции чтения
+    QSqlDatabase &db = database();
+    QSqlQuery lockQuery(db);
+    if (lockQuery.exec("BEGIN IMMEDIATE")) {
+        QSemaphore snapshotsStarted;
+        QList<QThread*> threads;
+        for (int i = 0; i < tableNames.size(); ++i) {
+            QTemporaryFile *part = parts[i].get();
+            const QString tableName = tableNames[i];
+            char *result = &results[i];
+            QThread *thread = QThread::create([this, part, tableName, compression, result, &snapshotsStarted]() {
+                TRACE_SCOPE("exportTable");
+                QSqlDatabase &threadDb = database();
+                // Снимок фиксируется первым чтением транзакции
+                const bool inTransaction = threadDb.transaction();
+                QSqlQuery snapshotQuery(threadDb);
+                const bool snapshot = inTransaction && snapshotQuery.exec("SELECT COUNT(*) FROM sqlite_master");
+                snapshotQuery.finish();
+                snapshotsStarted.release();
+
+                JsonStreamWriter writer(part, compression);
+                *result = snapshot && writeTableRows(threadDb, tableName, writer) && writer.finish();
+                if (inTransaction) {
+                    threadDb.commit();
+                }
+            });
+            thread->setObjectName("Export " + tableName);
+            threads << thread;
+            thread->start();
+        }
+
+        snapshotsStarted.acquire(threads.size());
+        lockQuery.exec("ROLLBACK");
+        for (QThread *thread : threads) {
+            thread->wait();
+            delete thread;
+        }
     } else {
-        query.prepare("UPDATE players SET "
-                      "win_rate = CASE WHEN total_matches > 0 THEN (wins * 100.0 / total_matches) ELSE 0 END "
-                      "WHERE player_id = :playerId");
+        qDebug() << "Database is being written, exporting tables sequentially:" << lockQuery.lastError().text();
+        const bool inTransaction = db.transaction();
+        for (int i = 0; i < tableNames.size(); ++i) {
+            TRACE_SCOPE("exportTable");
+            JsonStreamWriter writer(parts[i].get(), compression);
+            results[i] = inTransaction && writeTableRows(db, tableNames[i], writer) && writer.finish();
+        }
+        if (inTransaction) {
+            db.commit();
+        }
+    }
+
+    for (int i = 0; i < tableNames.size(); ++i) {
+        if (!results[i]) {
+            qDebug() << "Failed to export table" << tableNames[i];
+            return false;
+        }
+    }
+
+    TRACE_SCOPE("assembleJson");
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open file for writing:" << filePath;
+        return false;
+    }
+
+    for (int i = 0; i < tableNames.size(); ++i) {
+        JsonStreamWriter glue(&file, compression);
+        glue.write(i == 0 ? "{\n  " : ",\n  ");
+        glue.writeString(tableNames[i]);
+        glue.write(": ");
+        if (!glue.finish() || !appendPart(file, *parts[i])) {
+            qDebug() << "Error writing table" << tableNames[i] << "to" << filePath;
+            file.cancelWriting();
+            return false;
+        }
+    }
+
+    JsonStreamWriter tail(&file, compression);
+    tail.write("\n}\n");
+    if (!tail.finish()) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool DatabaseManager::checkImportTarget()
+{
+    QSqlQuery query(database());
+    if (!query.exec("SELECT (SELECT COUNT(*) FROM players) + (SELECT COUNT(*) FROM games) "
+                    "+ (SELECT COUNT(*) FROM game_partitions)")
+        || !query.next()) {
+        qDebug() << "Error counting rows:" << query.lastError().text();
+        return false;
+    }
+    if (query.value(0).toLongLong() > 0) {
+        qDebug() << "Error: a copy can only be imported into an empty database";
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::importFromJson(const QString& filePath, const std::function<void(int)>& progress) {
+    TRACE_SCOPE("importFromJson");
+    QSqlDatabase& db = database();
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open file for reading:" << filePath;
+        return false;
+    }
+
+    if (!checkImportTarget()) {
+        return false;
+    }
+
+    // Строк на транзакцию: крупные транзакции, но без неограниченного роста WAL
+    const int batchRows = 100000;
+    const qint64 totalBytes = qMax<qint64>(1, file.size());
+    const QStringList tableNames = {"players", "games", "game_participation"};
+    // Траектории рейтинга есть только в копиях начиная с версии схемы 6
+    const QStringList optionalTableNames = {"rating_history"};
+
+    JsonStreamReader reader(&file);
+    int lastPercent = -1;
+    auto reportProgress = [&]() {
+        int percent = static_cast<int>(qMin<qint64>(99, reader.bytesRead() * 100 / totalBytes));
+        if (progress && percent != lastPercent) {
+            lastPercent = percent;
+            progress(percent);
+        }
+    };
+
+    bool inTransaction = false;
+    // Ошибка (обрыв файла, нет таблицы) видна только по ходу чтения, когда часть
+    // пакетов уже закоммичена: они удаляются, чтобы не оставить половину копии
+    bool committedRows = false;
+    auto fail = [&](const QString& message) {
+        qDebug() << "Import failed:" << message;
+        if (inTransaction) {
+            db.rollback();
+        }
+        if (committedRows && !clearDatabase()) {
+            qDebug() << "Failed to remove partially imported rows";
+            notifyDataChanged();
+        }
+        return false;
+    };
+
+    if (reader.next() != JsonStreamReader::Token::BeginObject) {
+        return fail("backup is not a JSON object " + reader.errorString());
+    }
+    if (!db.transaction()) {
+        return fail("cannot start transaction: " + db.lastError().text());
+    }
+    inTransaction = true;
+
+    QSet<QString> importedTables;
+    QVector<QPair<int, double>> legacyRd;
+    QStringList keys;
+    QVector<QVariant> values;
+    int rowsInTransaction = 0;
+
+    for (;;) {
+        JsonStreamReader::Token token = reader.next();
+        if (token == JsonStreamReader::Token::EndObject) {
+            break;
+        }
+        if (token != JsonStreamReader::Token::String) {
+            return fail("unexpected token at top level " + reader.errorString());
+        }
+
+        const QString tableName = reader.stringValue();
+        // Резервные копии до версии схемы 3 хранят RD в отдельной таблице ratings
+        const bool isLegacyRatings = tableName == "ratings";
+        token = reader.next();
+        if (!tableNames.contains(tableName) && !optionalTableNames.contains(tableName) && !isLegacyRatings) {
+            if (!reader.skipValue(token)) {
+                return fail("malformed value of " + tableName + " " + reader.errorString());
+            }
+            continue;
+        }
+        if (token != JsonStreamReader::Token::BeginArray) {
+            return fail("table " + tableName + " is not an array");
+        }
+
+        TRACE_SCOPE("importTable");
+        const QSqlRecord tableRecord = db.record(tableName);
+        std::map<QString, std::unique_ptr<RowInserter>> inserters;
+        RowInserter* inserter = nullptr;
+        QStringList inserterKeys;
+
+        while ((token = reader.next()) == JsonStreamReader::Token::BeginObject) {
+            keys.clear();
+            values.clear();
+            while ((token = reader.next()) == JsonStreamReader::Token::String) {
+                keys << reader.stringValue();
+                JsonStreamReader::Token valueToken = reader.next();
+                if (valueToken == JsonStreamReader::Token::BeginObject || valueToken == JsonStreamReader::Token::BeginArray) {
+                    // Вложенные значения в строках таблиц не используются
+                    if (!reader.skipValue(valueToken)) {
+                        return fail("malformed row in " + tableName + " " + reader.errorString());
+                    }
+                    values << QVariant();
+                } else if (reader.skipValue(valueToken)) {
+                    values << reader.scalarValue();
+                } else {
+                    return fail("malformed row in " + tableName + " " + reader.errorString());
+                }
+            }
+            if (token != JsonStreamReader::Token::EndObject) {
+                return fail("malformed row in " + tableName + " " + reader.errorString());
+            }
+
+            if (isLegacyRatings) {
+                int idIndex = keys.indexOf("player_id");
+                int rdIndex = keys.indexOf("rd");
+                if (idIndex >= 0) {
+                    legacyRd.append({values[idIndex].toInt(), rdIndex >= 0 ? values[rdIndex].toDouble() : 350.0});
+                }
+                continue;
+            }
+
+            if (!inserter || keys != inserterKeys) {
+                const QString signature = keys.join(',');
+                auto it = inserters.find(signature);
+                if (it == inserters.end()) {
+                    std::unique_ptr<RowInserter> created = makeRowInserter(db, tableName, tableRecord, keys);
+                    if (!created) {
+                        return fail("cannot prepare insert for " + tableName);
+                    }
+                    it = inserters.emplace(signature, std::move(created)).first;
+                }
+                inserter = it->second.get();
+                inserterKeys = keys;
+            }
+
+            if (inserter->sourceIndexes.isEmpty()) {
+                continue;
+            }
+            for (int i = 0; i < inserter->sourceIndexes.size(); ++i) {
+                inserter->query.bindValue(i, importValue(inserter->kinds[i], values[inserter->sourceIndexes[i]]));
+            }
+            if (!inserter->query.exec()) {
+                return fail("error inserting into table " + tableName + ": " + inserter->query.lastError().text());
+            }
+
+            if (++rowsInTransaction >= batchRows) {
+                if (!db.commit()) {
+                    return fail("cannot commit batch: " + db.lastError().text());
+                }
+                committedRows = true;
+                if (!db.transaction()) {
+                    inTransaction = false;
+                    return fail("cannot start transaction: " + db.lastError().text());
+                }
+                rowsInTransaction = 0;
+            }
+            if ((rowsInTransaction & 0x3FF) == 0) {
+                reportProgress();
+            }
+        }
+
+        if (token != JsonStreamReader::Token::EndArray) {
+            return fail("malformed table " + tableName + " " + reader.errorString());
+        }
+        importedTables.insert(tableName);
+        reportProgress();
+    }
+
+    if (!legacyRd.isEmpty()) {
+        QSqlQuery rdQuery(db);
+        rdQuery.prepare("UPDATE players SET rd = :rd WHERE player_id = :playerId");
+        for (const auto& entry : legacyRd) {
+            rdQuery.bindValue(":rd", entry.second);
+            rdQuery.bindValue(":playerId", entry.first);
+            if (!rdQuery.exec()) {
+                return fail("error importing legacy ratings: " + rdQuery.lastError().text());
+            }
+        }
+    }
+
+    for (const QString& tableName : tableNames) {
+        if (!importedTables.contains(tableName)) {
+            return fail("JSON data does not contain table: " + tableName);
+        }
+    }
+
+    if (!db.commit()) {
+        return fail("cannot commit import: " + db.lastError().text());
+    }
+    notifyDataChanged();
+
+    if (progress) {
+        progress(100);
+    }
+    return true;
+}
+
+namespace {
+// Состав таблиц в бинарном снимке; при изменении схемы список меняется вместе с ней,
+// при восстановлении колонки сопоставляются по имени
+struct SnapshotTableSpec {
+    QByteArray name;
+    QVector<SnapshotColumnSpec> columns;
+};
+
+const QVector<SnapshotTableSpec> &snapshotTables()
+{
+    static const QVector<SnapshotTableSpec> tables = {
+        {"players", {
+             {"player_id", SnapshotColumnType::Int32},
+             {"nickname", SnapshotColumnType::String},
+             {"glicko_rating", SnapshotColumnType::Float64},
+             {"rd", SnapshotColumnType::Float64},
+             {"skill_level", SnapshotColumnType::Int32},
+             {"wins", SnapshotColumnType::Int32},
+             {"total_matches", SnapshotColumnType::Int32}}},
+        {"games", {
+             {"game_id", SnapshotColumnType::Int32},
+             {"game_date", SnapshotColumnType::Int64},
+             {"team1_score", SnapshotColumnType::Int32},
+             {"team2_score", SnapshotColumnType::Int32},
+             {"winner_team", SnapshotColumnType::Int32}}},
+        {"game_participation", {
+             {"participation_id", SnapshotColumnType::Int64},
+             {"game_id", SnapshotColumnType::Int32},
+             {"player_id", SnapshotColumnType::Int32},
+             {"team", SnapshotColumnType::Int32},
+             {"rating_change", SnapshotColumnType::Float64}}},
+        {"rating_history", {
+             {"player_id", SnapshotColumnType::Int32},
+             {"seq", SnapshotColumnType::Int32},
+             {"point_count", SnapshotColumnType::Int32},
+             {"data", SnapshotColumnType::Blob}}},
+    };
+    return tables;
+}
+}
+
+bool DatabaseManager::exportSnapshot(const QString& filePath) {
+    TRACE_SCOPE("exportSnapshot");
+    if (isPartitioned()) {
+        qDebug() << "Cannot export to" << filePath << ": game history is partitioned, use backupTo instead";
+        return false;
+    }
+    QSqlDatabase& db = database();
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open file for writing:" << filePath;
+        return false;
+    }
+
+    const QVector<SnapshotTableSpec>& tables = snapshotTables();
+    SnapshotWriter writer(&file);
+    bool ok = writer.writeHeader(schemaVersion(), tables.size());
+
+    // Все таблицы читаются в одной транзакции - из одного снимка БД
+    db.transaction();
+    for (const SnapshotTableSpec& table : tables) {
+        if (!ok) {
+            break;
+        }
+
+        QStringList columnNames;
+        for (const SnapshotColumnSpec& column : table.columns) {
+            columnNames << QString::fromUtf8(column.name);
+        }
+
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if (!query.exec("SELECT " + columnNames.join(", ") + " FROM " + QString::fromUtf8(table.name))) {
+            qDebug() << "Error querying table" << table.name << ":" << query.lastError().text();
+            ok = false;
+            break;
+        }
+
+        ok = writer.beginTable(table.name, table.columns);
+        while (ok && query.next()) {
+            for (int i = 0; i < table.columns.size(); ++i) {
+                writer.setValue(i, query.value(i));
+            }
+            ok = writer.endRow();
+        }
+        ok = ok && writer.endTable();
+    }
+    db.commit();
+
+    if (!ok) {
+        qDebug() << "Snapshot export failed:" << writer.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool DatabaseManager::importSnapshot(const QString& filePath, const std::function<void(int)>& progress) {
+    TRACE_SCOPE("importSnapshot");
+    SnapshotReader reader(filePath);
+    if (!reader.open()) {
+        qDebug() << "Snapshot import failed:" << reader.errorString();
+        return false;
+    }
+    if (reader.schemaVersion() != latestSchemaVersion()) {
+        qDebug() << "Snapshot schema version" << reader.schemaVersion()
+                 << "differs from" << latestSchemaVersion() << "- columns are matched by name";
+    }
+
+    // Оглавление снимка прочитано целиком до вставки: без основных таблиц
+    // импорт не начинается
+    QSet<QString> snapshotTableNames;
+    qint64 totalRows = 0;
+    for (const SnapshotReader::Table& table : reader.tables()) {
+        snapshotTableNames.insert(QString::fromUtf8(table.name));
+        totalRows += table.rowCount;
+    }
+    for (const QString& tableName : {QStringLiteral("players"), QStringLiteral("games"),
+                                     QStringLiteral("game_participation")}) {
+        if (!snapshotTableNames.contains(tableName)) {
+            qDebug() << "Snapshot import failed: no table" << tableName;
+            return false;
+        }
+    }
+    if (!checkImportTarget()) {
+        return false;
+    }
+
+    qint64 doneRows = 0;
+    // Группы, закоммиченные до ошибки, удаляются, как и в importFromJson
+    auto fail = [this, &doneRows]() {
+        if (doneRows > 0 && !clearDatabase()) {
+            qDebug() << "Failed to remove partially imported rows";
+            notifyDataChanged();
+        }
+        return false;
+    };
+
+    QSqlDatabase& db = database();
+    for (const SnapshotReader::Table& table : reader.tables()) {
+        const QString tableName = QString::fromUtf8(table.name);
+        const QSqlRecord tableRecord = db.record(tableName);
+        if (tableRecord.isEmpty()) {
+            qDebug() << "Snapshot table" << tableName << "is not in the schema, skipped";
+            continue;
+        }
+
+        QVector<int> sourceColumns;
+        QStringList columns;
+        QStringList placeholders;
+        for (int i = 0; i < table.columns.size(); ++i) {
+            const QString name = QString::fromUtf8(table.columns[i].name);
+            if (tableRecord.contains(name)) {
+                sourceColumns << i;
+                columns << name;
+                placeholders << "?";
+            }
+        }
+
+        QSqlQuery query(db);
+        if (!query.prepare("INSERT INTO " + tableName + " (" + columns.join(", ") + ") "
+                           "VALUES (" + placeholders.join(", ") + ")")) {
+            qDebug() << "Error preparing snapshot insert for" << tableName << ":" << query.lastError().text();
+            return fail();
+        }
+
+        // Группа строк - одна транзакция и один execBatch
+        for (const SnapshotReader::RowGroup& group : table.rowGroups) {
+            if (!db.transaction()) {
+                qDebug() << "Failed to start transaction for snapshot import";
+                return fail();
+            }
+            for (int c = 0; c < sourceColumns.size(); ++c) {
+                const SnapshotReader::ColumnView& column = group.columns[sourceColumns[c]];
+                QVariantList values;
+                values.reserve(group.rowCount);
+                for (int row = 0; row < group.rowCount; ++row) {
+                    values << column.valueAt(row);
+                }
+                query.bindValue(c, values);
+            }
+            if (!query.execBatch() || !db.commit()) {
+                qDebug() << "Error importing snapshot table" << tableName << ":" << query.lastError().text();
+                db.rollback();
+                return fail();
+            }
+
+            doneRows += group.rowCount;
+            if (progress && totalRows > 0) {
+                progress(static_cast<int>(doneRows * 100 / totalRows));
+            }
+        }
+    }
+    if (doneRows > 0) {
+        notifyDataChanged();
+    }
+
+    if (progress) {
+        progress(100);
+    }
+    return true;
+}
+
+QString DatabaseManager::backupDirectory() const
+{
+    return QDir(QFileInfo(m_dbPath).absolutePath()).filePath("backups");
+}
+
+qint64 DatabaseManager::estimatedBackupSize()
+{
+    // VACUUM INTO не копирует свободные страницы
+    QSqlQuery query(database());
+    qint64 pages = 0;
+    qint64 pageSize = 0;
+    if (query.exec("PRAGMA page_count") && query.next()) {
+        pages = query.value(0).toLongLong();
+    }
+    if (query.exec("PRAGMA freelist_count") && query.next()) {
+        pages -= query.value(0).toLongLong();
+    }
+    if (query.exec("PRAGMA page_size") && query.next()) {
+        pageSize = query.value(0).toLongLong();
+    }
+    return qMax<qint64>(0, pages) * pageSize;
+}
+
+bool DatabaseManager::backupTo(const QString& filePath)
+{
+    TRACE_SCOPE("backupTo");
+    // Постраничная копия текущего снимка БД; в WAL не блокирует читателей и писателя
+    QSqlQuery query(database());
+    query.prepare("VACUUM INTO :path");
+    query.bindValue(":path", filePath);
+    if (!query.exec()) {
+        qDebug() << "Error backing up database to" << filePath << ":" << query.lastError().text();
+        QFile::remove(filePath);
+        return false;
+    }
+    if (!isPartitioned()) {
+        return true;
+    }
+
+    // Разделы копируются после основного файла, каждый своим VACUUM INTO: каталог
+    // копии не ссылается на игры, которых нет в копиях разделов
+    QDir partitionDir(backupPartitionDirectory(filePath));
+    partitionDir.removeRecursively();
+    if (!partitionDir.mkpath(".")) {
+        qDebug() << "Error creating directory" << partitionDir.path();
+        QFile::remove(filePath);
+        return false;
+    }
+    ConnectionPool::Connection &connection = m_pool.local();
+    for (const PartitionCatalog::Partition &partition : m_partitions.partitions()) {
+        const QString partitionCopy = partitionDir.filePath(QFileInfo(m_partitions.filePath(partition.month)).fileName());
+        QSqlQuery partitionQuery(connection.db);
+        bool ok = attachPartition(connection, partition.month)
+                  && partitionQuery.prepare(QString("VACUUM %1 INTO :path").arg(PartitionCatalog::schemaName(partition.month)));
+        if (ok) {
+            partitionQuery.bindValue(":path", partitionCopy);
+            ok = partitionQuery.exec();
+        }
+        if (!ok) {
+            qDebug() << "Error backing up partition" << partition.month << "to" << partitionCopy << ":"
+                     << partitionQuery.lastError().text();
+            partitionDir.removeRecursively();
+            QFile::remove(filePath);
+            return false;
+        }
+    }
+    return true;
+}
+
+QString DatabaseManager::backupPartitionDirectory(const QString& backupPath)
+{
+    const QFileInfo info(backupPath);
+    return info.dir().filePath(info.completeBaseName() + "_partitions");
+}
+
+int DatabaseManager::pruneBackups(int keepCount, const QString& keepPath)
+{
+    QDir dir(backupDirectory());
+    // Имена содержат отметку времени yyyy-MM-dd_hh-mm-ss - сортировка по имени хронологическая
+    const QStringList backups = dir.entryList({"backup_*.db"}, QDir::Files, QDir::Name | QDir::Reversed);
+    int removed = 0;
+    for (int i = keepCount; i < backups.size(); ++i) {
+        if (!keepPath.isEmpty() && QFileInfo(dir.filePath(backups[i])) == QFileInfo(keepPath)) {
+            continue;
+        }
+        QDir(backupPartitionDirectory(dir.filePath(backups[i]))).removeRecursively();
+        if (dir.remove(backups[i])) {
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+namespace {
+// SQLite по умолчанию допускает 10 подключенных БД на соединение
+constexpr int MaxAttachedPartitions = 8;
+
+// Схема файла раздела: таблицы истории игр версии 4. game_id выдает каталог,
+// внешние ключи между файлами SQLite не поддерживает
+QStringList partitionSchema(const QString &schema)
+{
+    return {
+        QString("CREATE TABLE IF NOT EXISTS %1.\"games\" ("
+                "\"game_id\" INTEGER PRIMARY KEY,"
+                "\"game_date\" INTEGER NOT NULL,"
+                "\"team1_score\" INTEGER NOT NULL,"
+                "\"team2_score\" INTEGER NOT NULL,"
+                "\"winner_team\" INTEGER NOT NULL CHECK(\"winner_team\" IN (1, 2))"
+                ");").arg(schema),
+        QString("CREATE TABLE IF NOT EXISTS %1.\"game_participation\" ("
+                "\"participation_id\" INTEGER PRIMARY KEY,"
+                "\"game_id\" INTEGER NOT NULL,"
+                "\"player_id\" INTEGER NOT NULL,"
+                "\"team\" INTEGER NOT NULL CHECK(\"team\" IN (1, 2)),"
+                "\"rating_change\" REAL DEFAULT 0.0"
+                ");").arg(schema),
+        QString("CREATE INDEX IF NOT EXISTS %1.idx_participation_game ON game_participation(game_id);").arg(schema),
+        QString("CREATE INDEX IF NOT EXISTS %1.idx_participation_player_game ON game_participation(player_id, game_id);").arg(schema),
+    };
+}
+
+// Файл раздела вместе с журналом WAL; false, если файл занят другим соединением
+bool removePartitionFiles(const QString &filePath)
+{
+    bool removed = true;
+    for (const char *suffix : {"", "-wal", "-shm"}) {
+        const QString path = filePath + suffix;
+        if (QFile::exists(path) && !QFile::remove(path)) {
+            qDebug() << "Warning: partition file is in use and will be removed on next start:" << path;
+            removed = false;
+        }
+    }
+    return removed;
+}
+}
+
+bool DatabaseManager::restoreBackup(const QString& filePath, const std::function<void(int)>& progress)
+{
+    TRACE_SCOPE("restoreBackup");
+    if (!QFile::exists(filePath)) {
+        qDebug() << "Backup file not found:" << filePath;
+        return false;
+    }
+
+    QSqlDatabase& db = database();
+    QSqlQuery query(db);
+    // Настройки и каталог разделов заменяются настройками копии - как и
+    // включение разделов, это возможно только для пустой истории игр
+    if (!query.exec("SELECT (SELECT COUNT(*) FROM games) + (SELECT COUNT(*) FROM game_partitions)")
+        || !query.next()) {
+        qDebug() << "Error counting games:" << query.lastError().text();
+        return false;
+    }
+    if (query.value(0).toLongLong() > 0) {
+        qDebug() << "Error: a backup can only be restored into a database without games";
+        return false;
+    }
+    query.finish();
+
+    if (!execOutsideTransaction(db, "ATTACH DATABASE ? AS restore_src", {filePath})) {
+        return false;
+    }
+
+    QStringList copiedPartitions;
+    auto fail = [&](const QString& message) {
+        qDebug() << "Restore failed:" << message;
+        db.rollback();
+        for (const QString& path : copiedPartitions) {
+            removePartitionFiles(path);
+        }
+        execOutsideTransaction(db, "DETACH DATABASE restore_src");
+        return false;
+    };
+
+    if (!db.transaction()) {
+        return fail("cannot start transaction: " + db.lastError().text());
+    }
+
+    // Гистограмма рейтинга не копируется: ее пересчитывают триггеры или профиль Interactive
+    const QStringList tableNames = {"storage_settings", "game_partitions", "players",
+                                    "games", "game_participation", "rating_history"};
+    for (int i = 0; i < tableNames.size(); ++i) {
+        const QString& tableName = tableNames[i];
+        const QSqlRecord tableRecord = db.record(tableName);
+        if (!query.exec(QString("PRAGMA restore_src.table_info(%1)").arg(tableName))) {
+            return fail("cannot read columns of " + tableName + ": " + query.lastError().text());
+        }
+        QStringList columns;
+        while (query.next()) {
+            const QString name = query.value(1).toString();
+            if (tableRecord.contains(name)) {
+                columns << name;
+            }
+        }
+        if (columns.isEmpty()) {
+            qDebug() << "Backup has no table" << tableName << ", skipped";
+            continue;
+        }
+
+        if (tableName == "storage_settings" && !query.exec("DELETE FROM main.storage_settings")) {
+            return fail("cannot reset storage settings: " + query.lastError().text());
+        }
+        const QString columnList = columns.join(", ");
+        if (!query.exec(QString("INSERT INTO main.%1 (%2) SELECT %2 FROM restore_src.%1").arg(tableName, columnList))) {
+            return fail("cannot copy table " + tableName + ": " + query.lastError().text());
+        }
+        if (progress) {
+            progress((i + 1) * 90 / tableNames.size());
+        }
+    }
+
+    // Файлы разделов копии возвращаются на место до коммита: без них каталог
+    // ссылался бы на несуществующие игры
+    if (query.exec("SELECT month FROM restore_src.game_partitions WHERE archived = 0")) {
+        const QDir partitionCopies(backupPartitionDirectory(filePath));
+        while (query.next()) {
+            const int month = query.value(0).toInt();
+            // Имя файла копии содержит имя исходной БД, которое может отличаться
+            const QString target = m_partitions.filePath(month);
+            const QString source = partitionCopies.filePath(
+                partitionCopies.entryList({QString("*_%1.db").arg(month)}, QDir::Files).value(0));
+            if (!QDir().mkpath(m_partitions.directory()) || !removePartitionFiles(target)
+                || !QFile::copy(source, target)) {
+                return fail("cannot restore partition file " + source);
+            }
+            copiedPartitions << target;
+        }
+    }
+    query.finish();
+
+    if (!db.commit()) {
+        return fail("cannot commit: " + db.lastError().text());
+    }
+    execOutsideTransaction(db, "DETACH DATABASE restore_src");
+    loadPartitionCatalog();
+    notifyDataChanged();
+    if (progress) {
+        progress(100);
+    }
+    return true;
+}
+
+bool DatabaseManager::loadPartitionCatalog()
+{
+    QSqlQuery query(database());
+    bool enabled = false;
+    if (!query.exec("SELECT value FROM storage_settings WHERE name = 'partitioning'")) {
+        qDebug() << "Error reading storage settings:" << query.lastError().text();
+        return false;
+    }
+    if (query.next()) {
+        enabled = query.value(0).toString() == "monthly";
+    }
+
+    QVector<PartitionCatalog::Partition> partitions;
+    qint64 maxGameId = 0;
+    if (!query.exec("SELECT month, min_game_id, max_game_id, game_count, archived FROM game_partitions")) {
+        qDebug() << "Error reading partition catalog:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        PartitionCatalog::Partition partition;
+        partition.month = query.value(0).toInt();
+        partition.minGameId = query.value(1).toLongLong();
+        partition.maxGameId = query.value(2).toLongLong();
+        partition.gameCount = query.value(3).toLongLong();
+        partition.archived = query.value(4).toBool();
+        maxGameId = qMax(maxGameId, partition.maxGameId);
+        partitions.append(partition);
+    }
+
+    if (!query.exec("SELECT COALESCE(MAX(game_id), 0) FROM games") || !query.next()) {
+        qDebug() << "Error reading last game id:" << query.lastError().text();
+        return false;
+    }
+    maxGameId = qMax(maxGameId, query.value(0).toLongLong());
+    query.finish();
+
+    m_partitions.reset(enabled, partitions, maxGameId + 1);
+
+    // Файлы разделов, удаленных из каталога, пока их держало другое соединение
+    if (enabled) {
+        QSet<QString> known;
+        for (const PartitionCatalog::Partition &partition : partitions) {
+            known.insert(QFileInfo(m_partitions.filePath(partition.month)).fileName());
+        }
+        QDir dir(m_partitions.directory());
+        const QStringList files = dir.entryList({m_partitions.fileNamePattern()}, QDir::Files);
+        for (const QString &fileName : files) {
+            if (!known.contains(fileName)) {
+                removePartitionFiles(dir.filePath(fileName));
+            }
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::setPartitioningEnabled(bool enabled)
+{
+    if (enabled == isPartitioned()) {
+        return true;
+    }
+
+    // Перенос существующей истории между файлами не поддерживается:
+    // режим выбирается для пустой истории игр
+    QSqlQuery query(database());
+    if (!query.exec("SELECT (SELECT COUNT(*) FROM games) + (SELECT COUNT(*) FROM game_partitions)")
+        || !query.next()) {
+        qDebug() << "Error counting games:" << query.lastError().text();
+        return false;
+    }
+    if (query.value(0).toLongLong() > 0) {
+        qDebug() << "Error: partitioning can only be switched while there are no games";
+        return false;
+    }
+    query.finish();
+
+    const QString sql = enabled
+        ? "INSERT OR REPLACE INTO storage_settings (name, value) VALUES ('partitioning', 'monthly')"
+        : "DELETE FROM storage_settings WHERE name = 'partitioning'";
+    if (!executeQuery(sql)) {
+        return false;
+    }
+    return loadPartitionCatalog();
+}
+
+// ATTACH/DETACH и часть PRAGMA (journal_mode, synchronous) SQLite не выполняет
+// внутри транзакции. Чужая транзакция здесь не фиксируется: запрос внутри нее
+// завершается ошибкой, а раздел нужно подключить заранее (preparePartition)
+bool DatabaseManager::execOutsideTransaction(QSqlDatabase &db, const QString &sql, const QVariantList &values)
+{
+    QSqlQuery query(db);
+    if (!query.prepare(sql)) {
+        qDebug() << "Query error:" << query.lastError().text() << "for query:" << sql;
+        return false;
+    }
+    for (const QVariant &value : values) {
+        query.addBindValue(value);
+    }
+    if (!query.exec()) {
+        qDebug() << "Query error:" << query.lastError().text() << "for query:" << sql
+                 << "(partitions must be attached before a transaction begins)";
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::applyPartitionPragmas(ConnectionPool::Connection &connection, int month)
+{
+    // journal_mode, synchronous, cache_size и mmap_size задаются для каждой
+    // схемы отдельно; temp_store общий для соединения
+    const QStringList &pragmas =
+        (connection.profile == StorageProfile::Interactive) ? interactivePragmas : bulkLoadPragmas;
+    const QString schema = PartitionCatalog::schemaName(month);
+    for (QString pragma : pragmas) {
+        if (pragma.contains("temp_store")) {
+            continue;
+        }
+        if (!execOutsideTransaction(connection.db, pragma.replace("PRAGMA ", "PRAGMA " + schema + "."))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Подключить раздел месяца к соединению. fresh - раздел создается для записи:
+// остатки файла с тем же именем (не удаленные раньше) очищаются
+bool DatabaseManager::attachPartition(ConnectionPool::Connection &connection, int month, bool fresh)
+{
+    const int pos = connection.attachedPartitions.indexOf(month);
+    if (pos >= 0) {
+        connection.attachedPartitions.move(pos, connection.attachedPartitions.size() - 1);
+        return true;
+    }
+
+    // Разделы, удаленные или перенесенные в архив из другого потока
+    const QList<int> attached = connection.attachedPartitions;
+    for (int attachedMonth : attached) {
+        if (!m_partitions.isActive(attachedMonth)) {
+            detachPartition(connection, attachedMonth);
+        }
+    }
+
+    // Место освобождает давно не использованный раздел
+    while (connection.attachedPartitions.size() >= MaxAttachedPartitions) {
+        if (!detachPartition(connection, connection.attachedPartitions.first())) {
+            return false;
+        }
+    }
+
+    const QString filePath = m_partitions.filePath(month);
+    if (fresh) {
+        removePartitionFiles(filePath);
+    }
+    const bool created = !QFile::exists(filePath);
+    if (created && !QDir().mkpath(m_partitions.directory())) {
+        qDebug() << "Error: cannot create partition directory" << m_partitions.directory();
+        return false;
+    }
+
+    const QString schema = PartitionCatalog::schemaName(month);
+    if (!execOutsideTransaction(connection.db, QString("ATTACH DATABASE ? AS %1").arg(schema), {filePath})) {
+        return false;
+    }
+    connection.attachedPartitions.append(month);
+
+    QStringList statements;
+    if (created || fresh) {
+        statements << partitionSchema(schema);
+    }
+    if (fresh && !created) {
+        statements << QString("DELETE FROM %1.game_participation;").arg(schema)
+                   << QString("DELETE FROM %1.games;").arg(schema);
+    }
+    for (const QString &statement : statements) {
+        if (!execOutsideTransaction(connection.db, statement)) {
+            return false;
+        }
+    }
+    return applyPartitionPragmas(connection, month);
+}
+
+bool DatabaseManager::detachPartition(ConnectionPool::Connection &connection, int month)
+{
+    // Подготовленные запросы держат схему раздела - удаляем их до DETACH
+    for (auto it = connection.statements.begin(); it != connection.statements.end();) {
+        if (it.key() / StatementSlots == month) {
+            delete it.value();
+            it = connection.statements.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!execOutsideTransaction(connection.db, "DETACH DATABASE " + PartitionCatalog::schemaName(month))) {
+        return false;
+    }
+    connection.attachedPartitions.removeAll(month);
+    return true;
+}
+
+bool DatabaseManager::preparePartition(const QDateTime &gameDate)
+{
+    if (!isPartitioned()) {
+        return true;
+    }
+    const int month = PartitionCatalog::monthOf(gameDate);
+    if (m_partitions.isArchived(month)) {
+        qDebug() << "Error preparing partition: partition" << month << "is archived";
+        return false;
+    }
+    // Месяца без игр еще нет в каталоге - раздел создается заново
+    return attachPartition(m_pool.local(), month, !m_partitions.isActive(month));
+}
+
+bool DatabaseManager::isPartitionReady(const QDateTime &gameDate)
+{
+    return !isPartitioned()
+        || m_pool.local().attachedPartitions.contains(PartitionCatalog::monthOf(gameDate));
+}
+
+int DatabaseManager::partitionForGame(int gameId)
+{
+    if (!isPartitioned()) {
+        return 0;
+    }
+
+    const QVector<int> months = m_partitions.monthsForGame(gameId);
+    if (months.size() <= 1) {
+        return months.value(0, 0);
+    }
+
+    // Диапазоны месяцев пересекаются: ищем раздел, где игра действительно есть
+    for (int month : months) {
+        QSqlQuery *query = preparedStatement(Statement::GameWinner, month);
+        if (!query) {
+            continue;
+        }
+        query->bindValue(":gameId", gameId);
+        const bool found = query->exec() && query->next();
+        query->finish();
+        if (found) {
+            return month;
+        }
+    }
+    return 0;
+}
+
+int DatabaseManager::dropPartitions(const QDate &before)
+{
+    TRACE_SCOPE("dropPartitions");
+    const int cutoff = before.isValid() ? PartitionCatalog::monthOf(before) : INT_MAX;
+    ConnectionPool::Connection &connection = m_pool.local();
+    int dropped = 0;
+
+    for (const PartitionCatalog::Partition &partition : m_partitions.partitions(true)) {
+        if (partition.month >= cutoff) {
+            continue;
+        }
+        if (connection.attachedPartitions.contains(partition.month)
+            && !detachPartition(connection, partition.month)) {
+            continue;
+        }
+
+        QSqlQuery query(connection.db);
+        query.prepare("DELETE FROM game_partitions WHERE month = :month");
+        query.bindValue(":month", partition.month);
+        if (!query.exec()) {
+            qDebug() << "Error removing partition" << partition.month << ":" << query.lastError().text();
+            continue;
+        }
+
+        // Остальные соединения отключат раздел при следующем обращении к каталогу
+        m_partitions.remove(partition.month);
+        if (!partition.archived) {
+            removePartitionFiles(m_partitions.filePath(partition.month));
+        }
+        ++dropped;
+    }
+
+    // Следующий game_id считается заново: после удаления всех разделов нумерация
+    // начинается с 1, как после очистки таблицы без разделов
+    if (dropped > 0) {
+        loadPartitionCatalog();
+        notifyDataChanged();
+    }
+    return dropped;
+}
+
+int DatabaseManager::archivePartitions(const QDate &before, const QString &archiveDir)
+{
+    TRACE_SCOPE("archivePartitions");
+    if (!QDir().mkpath(archiveDir)) {
+        qDebug() << "Error: cannot create archive directory" << archiveDir;
+        return 0;
+    }
+
+    const int cutoff = PartitionCatalog::monthOf(before);
+    ConnectionPool::Connection &connection = m_pool.local();
+    int archived = 0;
+
+    for (const PartitionCatalog::Partition &partition : m_partitions.partitions()) {
+        if (partition.month >= cutoff) {
+            continue;
+        }
+
+        // Переносится один файл: содержимое WAL сначала переписывается в него
+        const QString schema = PartitionCatalog::schemaName(partition.month);
+        if (!attachPartition(connection, partition.month)
+            || !execOutsideTransaction(connection.db, QString("PRAGMA %1.wal_checkpoint(TRUNCATE);").arg(schema))
+            || !detachPartition(connection, partition.month)) {
+            continue;
+        }
+
+        const QString filePath = m_partitions.filePath(partition.month);
+        const QString target = QDir(archiveDir).filePath(QFileInfo(filePath).fileName());
+        if (QFile::exists(target) || !QFile::rename(filePath, target)) {
+            qDebug() << "Error: cannot move partition" << filePath << "to" << target;
+            continue;
+        }
+        removePartitionFiles(filePath);
+
+        QSqlQuery query(connection.db);
+        query.prepare("UPDATE game_partitions SET archived = 1 WHERE month = :month");
+        query.bindValue(":month", partition.month);
+        if (!query.exec()) {
+            qDebug() << "Error archiving partition" << partition.month << ":" << query.lastError().text();
+            continue;
+        }
+        m_partitions.setArchived(partition.month);
+        ++archived;
+    }
+    // Архивные игры пропадают из запросов
+    if (archived > 0) {
+        notifyDataChanged();
+    }
+    return archived;
+}
+
+GamesTable DatabaseManager::getGamesTable() {
+    TRACE_SCOPE("getGamesTable");
+    GamesTable result;
+    auto readGames = [this, &result](const QString &table) {
+        QSqlQuery query(database());
+        query.setForwardOnly(true);
+        if (!query.exec("SELECT game_id, game_date, team1_score, team2_score, winner_team FROM " + table)) {
+            qDebug() << "Error retrieving games table with ID:" << query.lastError().text();
+            return false;
+        }
+
+        // Значения хранятся как есть; дата и победитель форматируются при отображении
+        while (query.next()) {
+            result.gameIds.append(query.value(0).toLongLong());
+            result.gameDates.append(query.value(1).toLongLong());
+            result.team1Scores.append(query.value(2).toInt());
+            result.team2Scores.append(query.value(3).toInt());
+            result.winnerTeams.append(static_cast<quint8>(query.value(4).toInt()));
+        }
+        return true;
+    };
+
+    if (!isPartitioned()) {
+        readGames("games");
+        return result;
+    }
+
+    // Разделы по порядку месяцев; каждый подключается на время чтения
+    ConnectionPool::Connection &connection = m_pool.local();
+    for (const PartitionCatalog::Partition &partition : m_partitions.partitions()) {
+        if (!attachPartition(connection, partition.month)
+            || !readGames(PartitionCatalog::schemaName(partition.month) + ".games")) {
+            return GamesTable();
+        }
+    }
+    return result;
+}
+
+PlayersTable DatabaseManager::getPlayersWithRatings() {
+    TRACE_SCOPE("getPlayersWithRatings");
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT p.player_id, p.nickname, p.glicko_rating, p.rd, p.total_matches, p.skill_level, p.wins "
+                    "FROM players p "
+                    "ORDER BY p.glicko_rating DESC")) {
+        qDebug() << "Error retrieving players with ratings:" << query.lastError().text();
+        return PlayersTable();
+    }
+
+    PlayersTable result;
+    while (query.next()) {
+        result.playerIds.append(query.value(0).toInt());
+        result.nicknames.append(query.value(1).toString());
+        result.ratings.append(query.value(2).toDouble());
+        result.rds.append(query.value(3).toDouble());
+        result.totalMatches.append(query.value(4).toInt());
+        result.skillLevels.append(static_cast<quint8>(query.value(5).toInt()));
+        result.wins.append(query.value(6).toInt());
+    }
+    return result;
+}
+
+namespace {
+// SQL-выражения колонок сортировки списков, по номерам колонок моделей
+const char *const gamesSortExpressions[] = {
+    "game_id", "game_date", "team1_score", "team2_score", "winner_team"
+};
+const char *const playersSortExpressions[] = {
+    "nickname", "glicko_rating", "rd", "total_matches", "skill_level", "wins",
+    "(CASE WHEN total_matches > 0 THEN wins * 100.0 / total_matches ELSE 0 END)"
+};
+
+// Условие "после ключа" и ORDER BY для постраничного чтения. Сравнение пар
+// (значение, id) идет поиском по индексу колонки сортировки, если он есть
+void appendKeyset(QStringList &conditions, QString &orderBy, const QString &expression,
+                  const QString &idColumn, Qt::SortOrder order, const RowKey &after)
+{
+    const QString direction = (order == Qt::AscendingOrder) ? "ASC" : "DESC";
+    const QString comparison = (order == Qt::AscendingOrder) ? ">" : "<";
+    if (expression == idColumn) {
+        if (!after.isNull()) {
+            conditions << QString("%1 %2 :afterId").arg(idColumn, comparison);
+        }
+        orderBy = QString("%1 %2").arg(idColumn, direction);
+        return;
+    }
+    if (!after.isNull()) {
+        conditions << QString("(%1, %2) %3 (:afterValue, :afterId)").arg(expression, idColumn, comparison);
+    }
+    orderBy = QString("%1 %3, %2 %3").arg(expression, idColumn, direction);
+}
+
+QString whereClause(const QStringList &conditions)
+{
+    return conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+}
+}
+
+GamesTable DatabaseManager::getGamesPage(const GamesQuery &gamesQuery, const RowKey &after, int limit,
+                                         const std::function<bool()> &isCancelled) {
+    const int sortColumn = qBound(0, gamesQuery.sortColumn, int(GamesColumnCount) - 1);
+    QStringList conditions;
+    QString orderBy;
+    if (gamesQuery.from.isValid()) {
+        conditions << "game_date >= :from";
+    }
+    if (gamesQuery.to.isValid()) {
+        conditions << "game_date <= :to";
+    }
+    appendKeyset(conditions, orderBy, gamesSortExpressions[sortColumn], "game_id", gamesQuery.order, after);
+
+    auto readPage = [&](const QString &prefix, GamesTable &page) {
+        QSqlQuery query(database());
+        query.setForwardOnly(true);
+        if (!query.prepare("SELECT game_id, game_date, team1_score, team2_score, winner_team FROM " + prefix
+                           + "games" + whereClause(conditions) + " ORDER BY " + orderBy + " LIMIT :limit")) {
+            qDebug() << "Error preparing games page:" << query.lastError().text();
+            return false;
+        }
+        if (gamesQuery.from.isValid()) {
+            query.bindValue(":from", gamesQuery.from.toSecsSinceEpoch());
+        }
+        if (gamesQuery.to.isValid()) {
+            query.bindValue(":to", gamesQuery.to.toSecsSinceEpoch());
+        }
+        if (!after.isNull()) {
+            if (sortColumn != GamesIdColumn) {
+                query.bindValue(":afterValue", after.value);
+            }
+            query.bindValue(":afterId", after.id);
+        }
+        query.bindValue(":limit", limit);
+        if (!query.exec()) {
+            qDebug() << "Error retrieving games page:" << query.lastError().text();
+            return false;
+        }
+        while (query.next()) {
+            if (isCancelled && isCancelled()) {
+                return false;
+            }
+            page.gameIds.append(query.value(0).toLongLong());
+            page.gameDates.append(query.value(1).toLongLong());
+            page.team1Scores.append(query.value(2).toInt());
+            page.team2Scores.append(query.value(3).toInt());
+            page.winnerTeams.append(static_cast<quint8>(query.value(4).toInt()));
+        }
+        return true;
+    };
+
+    GamesTable result;
+    if (!isPartitioned()) {
+        return readPage(QString(), result) ? result : GamesTable();
+    }
+
+    // Разделы вне диапазона дат пропускаются. Каждый раздел дает до limit строк
+    // после ключа, страница - первые limit строк их слияния. При порядке по game_id
+    // раздел, который начинается после уже набранной страницы, в нее не попадет
+    QVector<PartitionCatalog::Partition> partitions = m_partitions.partitions();
+    std::sort(partitions.begin(), partitions.end(), [](const PartitionCatalog::Partition &a,
+                                                       const PartitionCatalog::Partition &b) {
+        return a.minGameId < b.minGameId;
+    });
+    const bool byGameId = (sortColumn == GamesIdColumn && gamesQuery.order == Qt::AscendingOrder);
+    ConnectionPool::Connection &connection = m_pool.local();
+
+    GamesTable candidates;
+    for (const PartitionCatalog::Partition &partition : partitions) {
+        if ((gamesQuery.from.isValid() && partition.month < PartitionCatalog::monthOf(gamesQuery.from))
+            || (gamesQuery.to.isValid() && partition.month > PartitionCatalog::monthOf(gamesQuery.to))) {
+            continue;
+        }
+        if (byGameId && !after.isNull() && partition.maxGameId <= after.id) {
+            continue;
+        }
+        if (byGameId && candidates.size() >= limit
+            && partition.minGameId > *std::max_element(candidates.gameIds.cbegin(), candidates.gameIds.cend())) {
+            break;
+        }
+        if (!attachPartition(connection, partition.month)
+            || !readPage(PartitionCatalog::schemaName(partition.month) + ".", candidates)) {
+            return GamesTable();
+        }
+    }
+
+    QVector<int> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    const bool ascending = (gamesQuery.order == Qt::AscendingOrder);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        const qint64 valueA = candidates.sortValue(a, sortColumn);
+        const qint64 valueB = candidates.sortValue(b, sortColumn);
+        if (valueA != valueB) {
+            return ascending ? valueA < valueB : valueA > valueB;
+        }
+        return ascending ? candidates.gameIds[a] < candidates.gameIds[b]
+                         : candidates.gameIds[a] > candidates.gameIds[b];
+    });
+    for (int i = 0; i < order.size() && i < limit; ++i) {
+        result.appendRow(candidates, order[i]);
+    }
+    return result;
+}
+
+PlayersTable DatabaseManager::getPlayersPage(const PlayersQuery &playersQuery, const RowKey &after, int limit,
+                                             const std::function<bool()> &isCancelled) {
+    const int sortColumn = qBound(0, playersQuery.sortColumn, int(PlayersColumnCount) - 1);
+    const QString nickname = playersQuery.nickname.trimmed();
+    // Триграммный индекс находит подстроки от 3 символов; более короткие встречаются
+    // почти в каждом никнейме, и первая страница набирается коротким просмотром
+    const bool useIndex = m_nicknameIndex && nickname.size() >= 3;
+
+    QStringList conditions;
+    QString orderBy;
+    if (playersQuery.skillLevel > 0) {
+        conditions << "skill_level = :skill";
+    }
+    if (!nickname.isEmpty()) {
+        conditions << (useIndex ? "player_id IN (SELECT rowid FROM players_fts WHERE players_fts MATCH :match)"
+                                : "nickname LIKE :like ESCAPE '\\'");
+    }
+    appendKeyset(conditions, orderBy, playersSortExpressions[sortColumn], "player_id", playersQuery.order, after);
+
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    if (!query.prepare("SELECT player_id, nickname, glicko_rating, rd, total_matches, skill_level, wins FROM players"
+                       + whereClause(conditions) + " ORDER BY " + orderBy + " LIMIT :limit")) {
+        qDebug() << "Error preparing players page:" << query.lastError().text();
+        return PlayersTable();
+    }
+    if (playersQuery.skillLevel > 0) {
+        query.bindValue(":skill", playersQuery.skillLevel);
+    }
+    if (useIndex) {
+        // Строка целиком в кавычках - одна фраза FTS5 без операторов
+        query.bindValue(":match", "\"" + QString(nickname).replace("\"", "\"\"") + "\"");
+    } else if (!nickname.isEmpty()) {
+        QString pattern = nickname;
+        pattern.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+        query.bindValue(":like", "%" + pattern + "%");
+    }
+    if (!after.isNull()) {
+        query.bindValue(":afterValue", after.value);
+        query.bindValue(":afterId", after.id);
+    }
+    query.bindValue(":limit", limit);
+    if (!query.exec()) {
+        qDebug() << "Error retrieving players page:" << query.lastError().text();
+        return PlayersTable();
+    }
+
+    PlayersTable result;
+    result.nicknames.reserve(limit);
+    while (query.next()) {
+        if (isCancelled && isCancelled()) {
+            return PlayersTable();
+        }
+        result.playerIds.append(query.value(0).toInt());
+        result.nicknames.append(query.value(1).toString());
+        result.ratings.append(query.value(2).toDouble());
+        result.rds.append(query.value(3).toDouble());
+        result.totalMatches.append(query.value(4).toInt());
+        result.skillLevels.append(static_cast<quint8>(query.value(5).toInt()));
+        result.wins.append(query.value(6).toInt());
+    }
+    return result;
+}
+
+QVector<RatingBin> DatabaseManager::getRatingHistogram() {
+    TRACE_SCOPE("getRatingHistogram");
+    QSqlQuery &query = cachedStatement(Statement::RatingHistogram);
+
+    if (!query.exec()) {
+        qDebug() << "Error retrieving rating histogram:" << query.lastError().text();
+        return QVector<RatingBin>();
+    }
+
+    QVector<RatingBin> bins;
+    while (query.next()) {
+        RatingBin bin;
+        bin.ratingFrom = query.value(0).toInt() * RatingHistogramBinWidth;
+        bin.playerCount = query.value(1).toInt();
+        bin.games = query.value(2).toLongLong();
+        bins.append(bin);
+    }
+    query.finish();
+    return bins;
+}
+
+QMap<int, qint64> DatabaseManager::getRatingData() {
+    TRACE_SCOPE("getRatingData");
+    // Рейтинг -> количество игр по корзинам гистограммы: игроки с одинаковым
+    // рейтингом суммируются, а не затирают друг друга
+    QMap<int, qint64> ratingData;
+    for (const RatingBin &bin : getRatingHistogram()) {
+        ratingData[bin.ratingFrom + RatingHistogramBinWidth / 2] += bin.games;
+    }
+    return ratingData;
+}
+
+bool DatabaseManager::getDistributionSnapshot(DistributionSnapshot &snapshot) {
+    TRACE_SCOPE("getDistributionSnapshot");
+    snapshot = DistributionSnapshot();
+
+    // Непустые корзины гистограммы -> плотный массив от первой до последней
+    const QVector<RatingBin> bins = getRatingHistogram();
+    if (!bins.isEmpty()) {
+        snapshot.firstBin = bins.first().ratingFrom / RatingHistogramBinWidth;
+        const int binCount = bins.last().ratingFrom / RatingHistogramBinWidth - snapshot.firstBin + 1;
+        snapshot.binPlayers.fill(0, binCount);
+        snapshot.binGames.fill(0, binCount);
+        for (const RatingBin &bin : bins) {
+            const int index = bin.ratingFrom / RatingHistogramBinWidth - snapshot.firstBin;
+            snapshot.binPlayers[index] = bin.playerCount;
+            snapshot.binGames[index] = bin.games;
+        }
+    }
+
+    QSqlQuery &query = cachedStatement(Statement::SkillRatings);
+    if (!query.exec()) {
+        qDebug() << "Error getting skill rating data:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        SkillRating &skill = snapshot.skills[query.value(0).toInt()];
+        skill.players = query.value(1).toInt();
+        skill.mean = query.value(2).toDouble();
+        skill.min = query.value(3).toDouble();
+        skill.max = query.value(4).toDouble();
+    }
+    query.finish();
+
+    QSqlQuery &momentsQuery = cachedStatement(Statement::RatingMoments);
+    if (!momentsQuery.exec()) {
+        qDebug() << "Error getting rating moments:" << momentsQuery.lastError().text();
+        return false;
+    }
+    if (momentsQuery.next() && !momentsQuery.value(0).isNull()) {
+        snapshot.moments.count = momentsQuery.value(0).toLongLong();
+        snapshot.moments.mean = momentsQuery.value(1).toDouble();
+        snapshot.moments.m2 = momentsQuery.value(2).toDouble();
+        snapshot.moments.m3 = momentsQuery.value(3).toDouble();
+        snapshot.moments.m4 = momentsQuery.value(4).toDouble();
+    }
+    momentsQuery.finish();
+    return true;
+}
+
+QVector<PlayerData> DatabaseManager::getPlayersForMatching() {
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+
+    if (!query.exec("SELECT player_id, nickname, glicko_rating, rd, skill_level, total_matches, wins, "
+                    "CASE WHEN total_matches > 0 THEN wins * 100.0 / total_matches ELSE 0 END "
+                    "FROM players")) {
+        qDebug() << "Error retrieving players for matching:" << query.lastError().text();
+        return QVector<PlayerData>();
+    }
+
+    QVector<PlayerData> result;
+    while (query.next()) {
+        PlayerData player;
+        player.playerId = query.value(0).toInt();
+        player.nickname = query.value(1).toString();
+        player.rating = query.value(2).toDouble();
+        player.rd = query.value(3).toDouble();
+        player.skillLevel = query.value(4).toInt();
+        player.totalMatches = query.value(5).toInt();
+        player.wins = query.value(6).toInt();
+        player.winRate = query.value(7).toDouble();
+
+        result.append(player);
+    }
+
+    return result;
+}
+
+GameDetailsTable DatabaseManager::getGameDetails(int gameId) {
+    QSqlQuery *query = partitionStatement(Statement::GameDetails, gameId);
+    if (!query) {
+        return GameDetailsTable();
+    }
+    query->bindValue(":gameId", gameId);
+
+    if (!query->exec()) {
+        qDebug() << "Error retrieving game details:" << query->lastError().text();
+        return GameDetailsTable();
+    }
+
+    GameDetailsTable result;
+    while (query->next()) {
+        result.nicknames.append(query->value(0).toString());
+        result.teams.append(static_cast<quint8>(query->value(1).toInt()));
+        result.ratings.append(query->value(2).toDouble());
+        result.ratingChanges.append(query->value(3).toDouble());
+        result.skillLevels.append(static_cast<quint8>(query->value(4).toInt()));
+        result.winRates.append(query->value(5).toDouble());
+    }
+    query->finish();
+
+    return result;
+}
+
+bool DatabaseManager::applyGameResult(int playerId, double glickoRating, double rd, bool isWin) {
+    QSqlQuery &query = cachedStatement(Statement::ApplyGameResult);
+    query.bindValue(":rating", glickoRating);
+    query.bindValue(":rd", rd);
+    query.bindValue(":win", isWin ? 1 : 0);
+    query.bindValue(":playerId", playerId);
+
+    if (!query.exec()) {
+        qDebug() << "Error updating rating:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::getPlayer(int playerId, PlayerData &player) {
+    QSqlQuery &query = cachedStatement(Statement::PlayerCard);
+    query.bindValue(":playerId", playerId);
+
+    if (!query.exec()) {
+        qDebug() << "Error retrieving player info:" << query.lastError().text();
+        return false;
+    }
+    if (!query.next()) {
+        qDebug() << "Player not found with ID:" << playerId;
+        query.finish();
+        return false;
+    }
+
+    player.playerId = playerId;
+    player.nickname = query.value(0).toString();
+    player.rating = query.value(1).toDouble();
+    player.rd = query.value(2).toDouble();
+    player.skillLevel = query.value(3).toInt();
+    player.totalMatches = query.value(4).toInt();
+    player.wins = query.value(5).toInt();
+    player.winRate = query.value(6).toDouble();
+    query.finish();
+    return true;
+}
+
+int DatabaseManager::countPlayers() {
+    QSqlQuery &query = cachedStatement(Statement::CountPlayers);
+    if (!query.exec() || !query.next()) {
+        qDebug() << "Error counting players:" << query.lastError().text();
+        query.finish();
+        return -1;
+    }
+    int count = query.value(0).toInt();
+    query.finish();
+    return count;
+}
+
+bool DatabaseManager::clearDatabase() {
+    TRACE_SCOPE("clearDatabase");
+    QSqlDatabase &db = database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start transaction for database clearing";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    // rating_histogram - после players: триггеры удаления уже обнулили корзины
+    QStringList tableNames = {"rating_history", "game_participation", "games", "players", "rating_histogram"};
+    for (const QString &tableName : tableNames) {
+        if (!query.exec("DELETE FROM " + tableName)) {
+            qDebug() << "Error clearing table" << tableName << ":" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+        if (!query.exec("DELETE FROM sqlite_sequence WHERE name='" + tableName + "'")) {
+            qDebug() << "Error resetting auto-increment for" << tableName << ":" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        return false;
+    }
+    notifyDataChanged();
+
+    // Разделы истории игр удаляются целиком, вместе с файлами
+    if (isPartitioned()) {
+        dropPartitions();
+    }
+    return true;
+}
+
+QVector<PlayerGameRecord> DatabaseManager::getPlayerHistory(int playerId) {
+    TRACE_SCOPE("getPlayerHistory");
+    // Без разделов - один запрос к основной БД; с разделами - от новых месяцев к старым
+    QVector<int> months;
+    if (isPartitioned()) {
+        const QVector<PartitionCatalog::Partition> partitions = m_partitions.partitions();
+        for (auto it = partitions.crbegin(); it != partitions.crend(); ++it) {
+            months.append(it->month);
+        }
+    } else {
+        months.append(0);
+    }
+
+    QVector<PlayerGameRecord> result;
+    for (int month : months) {
+        // Неподключенный раздел - ошибка, а не история без его игр
+        QSqlQuery *query = preparedStatement(Statement::PlayerHistory, month);
+        if (!query) {
+            return QVector<PlayerGameRecord>();
+        }
+        query->bindValue(":playerId", playerId);
+        if (!query->exec()) {
+            qDebug() << "Error retrieving game history:" << query->lastError().text();
+            return QVector<PlayerGameRecord>();
+        }
+
+        while (query->next()) {
+            PlayerGameRecord record;
+            record.gameId = query->value(0).toInt();
+            record.team1Score = query->value(1).toInt();
+            record.team2Score = query->value(2).toInt();
+            record.gameDate = query->value(3).toLongLong();
+            record.win = query->value(4).toBool();
+            record.ratingChange = query->value(5).toDouble();
+            result.append(record);
+        }
+        query->finish();
+    }
+
+    // Диапазоны game_id месяцев могут пересекаться, если игры импортированы не по порядку дат
+    if (months.size() > 1) {
+        std::stable_sort(result.begin(), result.end(), [](const PlayerGameRecord &a, const PlayerGameRecord &b) {
+            return a.gameId > b.gameId;
+        });
+    }
+    return result;
+}
+
+QVector<PlayerGameRecord> DatabaseManager::getPlayerHistoryPage(int playerId, const RowKey &after, int limit,
+                                                                const std::function<bool()> &isCancelled) {
+    TRACE_SCOPE("getPlayerHistoryPage");
+    const qint64 beforeGameId = after.isNull() ? std::numeric_limits<qint64>::max() : after.id;
+
+    auto readPage = [&](int month, QVector<PlayerGameRecord> &page) {
+        QSqlQuery *query = preparedStatement(Statement::PlayerHistoryPage, month);
+        if (!query) {
+            return false;
+        }
+        query->bindValue(":playerId", playerId);
+        query->bindValue(":beforeGameId", beforeGameId);
+        query->bindValue(":limit", limit);
+        if (!query->exec()) {
+            qDebug() << "Error retrieving game history page:" << query->lastError().text();
+            return false;
+        }
+        while (query->next()) {
+            if (isCancelled && isCancelled()) {
+                query->finish();
+                return false;
+            }
+            PlayerGameRecord record;
+            record.gameId = query->value(0).toInt();
+            record.team1Score = query->value(1).toInt();
+            record.team2Score = query->value(2).toInt();
+            record.gameDate = query->value(3).toLongLong();
+            record.win = query->value(4).toBool();
+            record.ratingChange = query->value(5).toDouble();
+            page.append(record);
+        }
+        query->finish();
+        return true;
+    };
+
+    QVector<PlayerGameRecord> result;
+    if (!isPartitioned()) {
+        return readPage(0, result) ? result : QVector<PlayerGameRecord>();
+    }
+
+    // Разделы от больших game_id к меньшим; каждый дает до limit игр до ключа.
+    // Раздел, который целиком старше уже набранной страницы, в нее не попадет
+    QVector<PartitionCatalog::Partition> partitions = m_partitions.partitions();
+    std::sort(partitions.begin(), partitions.end(), [](const PartitionCatalog::Partition &a,
+                                                       const PartitionCatalog::Partition &b) {
+        return a.maxGameId > b.maxGameId;
+    });
+    auto newestFirst = [](const PlayerGameRecord &a, const PlayerGameRecord &b) { return a.gameId > b.gameId; };
+    for (const PartitionCatalog::Partition &partition : partitions) {
+        if (partition.minGameId >= beforeGameId) {
+            continue;
+        }
+        if (result.size() >= limit) {
+            std::sort(result.begin(), result.end(), newestFirst);
+            result.resize(limit);
+            if (partition.maxGameId < result.last().gameId) {
+                break;
+            }
+        }
+        if (!readPage(partition.month, result)) {
+            return QVector<PlayerGameRecord>();
+        }
+    }
+    std::sort(result.begin(), result.end(), newestFirst);
+    if (result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+bool DatabaseManager::appendRatingHistory(int playerId, int seq, int pointCount, const QByteArray &data) {
+    QSqlQuery &query = cachedStatement(Statement::AppendRatingHistory);
+    query.bindValue(":playerId", playerId);
+    query.bindValue(":seq", seq);
+    query.bindValue(":pointCount", pointCount);
+    query.bindValue(":data", data);
+
+    if (!query.exec()) {
+        qDebug() << "Error appending rating history:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::lastRatingHistoryBlock(int playerId, int &seq, QByteArray &data) {
+    QSqlQuery &query = cachedStatement(Statement::LastRatingHistoryBlock);
+    query.bindValue(":playerId", playerId);
+
+    if (!query.exec()) {
+        qDebug() << "Error retrieving rating history:" << query.lastError().text();
+        return false;
+    }
+    if (query.next()) {
+        seq = query.value(0).toInt();
+        data = query.value(1).toByteArray();
+    } else {
+        seq = -1;
+        data.clear();
+    }
+    query.finish();
+    return true;
+}
+
+QVector<RatingPoint> DatabaseManager::getRatingHistory(int playerId) {
+    TRACE_SCOPE("getRatingHistory");
+    QSqlQuery &query = cachedStatement(Statement::RatingHistory);
+    query.bindValue(":playerId", playerId);
+
+    if (!query.exec()) {
+        qDebug() << "Error retrieving rating history:" << query.lastError().text();
+        return QVector<RatingPoint>();
+    }
+
+    // Блоки игрока лежат подряд в B-дереве (player_id, seq): один диапазон без сортировки
+    QVector<RatingPoint> points;
+    QVector<QByteArray> blocks;
+    int totalPoints = 0;
+    while (query.next()) {
+        totalPoints += query.value(0).toInt();
+        blocks.append(query.value(1).toByteArray());
+    }
+    query.finish();
+
+    points.reserve(totalPoints);
+    for (const QByteArray &block : blocks) {
+        if (!RatingHistoryEncoder::decode(block, points)) {
+            qDebug() << "Corrupted rating history block for player" << playerId;
+            break;
+        }
+    }
+    return points;
+}
+
+bool DatabaseManager::updatePlayerWinStats(int playerId, bool isWin) {
+    // Процент побед вычисляется при чтении, поэтому поражение ничего не меняет
+    if (!isWin) {
+        return true;
     }
 
+    QSqlQuery &query = cachedStatement(Statement::UpdatePlayerWinStats);
     query.bindValue(":playerId", playerId);
 
     if (!query.exec()) {
@@ -12,17 +12,91 @@
 #include <QJsonArray>
 #include <QFile>
 #include <QSqlRecord>
+#include <QDateTime>
+#include <QHash>
+#include <atomic>
+#include <functional>
+#include "connectionpool.h"
+#include "livedistribution.h"
+#include "partitioncatalog.h"
+#include "ratinghistory.h"
+#include "resulttables.h"
+#include "storagebackend.h"
 
-// Структура для хранения данных о игроке и его рейтинге
-struct PlayerData {
-    int playerId;
-    QString nickname;
-    double rating;
-    double rd;
-    int skillLevel;
-    int totalMatches;
-    int wins;
-    double winRate;
+// Корзина гистограммы рейтинга (таблица rating_histogram): рейтинги
+// [ratingFrom, ratingFrom + RatingHistogramBinWidth)
+struct RatingBin {
+    int ratingFrom;
+    int playerCount;
+    qint64 games; // сумма total_matches игроков корзины
+};
+
+// Диапазон id [first, last]; пустой, если first > last
+struct IdRange {
+    int first = 1;
+    int last = 0;
+
+    bool isEmpty() const { return first > last; }
+    bool contains(qint64 id) const { return id >= first && id <= last; }
+    void add(int id)
+    {
+        if (isEmpty()) {
+            first = last = id;
+        } else {
+            first = qMin(first, id);
+            last = qMax(last, id);
+        }
+    }
+};
+
+// Изменение данных, о котором сообщает DatabaseManager::dataChanged. Новые игры и
+// игроки получают растущие id, поэтому это диапазоны; измененные игроки -
+// непересекающиеся диапазоны по возрастанию. reset - могло измениться все
+// (очистка, импорт, удаление и архивация разделов)
+struct DataChange {
+    bool reset = false;
+    IdRange newGames;
+    IdRange newPlayers;
+    QVector<IdRange> changedPlayers;
+
+    static DataChange all()
+    {
+        DataChange change;
+        change.reset = true;
+        return change;
+    }
+    bool isEmpty() const { return !reset && newGames.isEmpty() && newPlayers.isEmpty() && changedPlayers.isEmpty(); }
+    bool playerChanged(qint64 playerId) const;
+    // Объединить с более поздним изменением
+    void merge(const DataChange &other);
+};
+
+// Идентификаторы подготовленных запросов кэша DatabaseManager::cachedStatement
+enum class Statement {
+    AddPlayer,
+    AddGame,
+    InsertGame,
+    AddPlayerToGame,
+    GetPlayerId,
+    UpdatePlayerRating,
+    UpdatePlayerWinStats,
+    GameDetails,
+    GameWinner,
+    ApplyGameResult,
+    RatingHistogram,
+    CountPlayers,
+    InsertPartitionGame,
+    RecordPartitionGame,
+    GameScore,
+    TeamSquad,
+    PlayerHistory,
+    PlayerHistoryPage,
+    PlayerCard,
+    AppendRatingHistory,
+    LastRatingHistoryBlock,
+    RatingHistory,
+    SkillRatings,
+    RatingMoments
 };
 
 class DatabaseManager : public QObject
@@ -33,17 +107,29 @@ public:
     explicit DatabaseManager(const QString &dbPath, QObject *parent = nullptr);
     ~DatabaseManager();
 
-    bool isOpen() const;
+    bool isOpen();
     bool initialize();
 
+    // Switch PRAGMAs and deferred indexes for bulk loading or interactive use.
+    // PRAGMAs apply to the calling thread's connection (and the partitions it
+    // attaches later), indexes and triggers to the whole file.
+    // Must be called outside of a transaction.
+    bool setStorageProfile(StorageProfile profile);
+    // Profile last set for the indexes and triggers of the file; a connection's
+    // PRAGMAs follow the profile set on that connection
+    StorageProfile storageProfile() const { return m_storageProfile; }
+
     // Add player with skill level
     bool addPlayer(const QString &nickname, int skillLevel = 1, double glickoRating = 1000.0);
 
     // Add game
-    bool addGame(int team1Score, int team2Score, const QString &winnerTeam);
+    bool addGame(int team1Score, int team2Score, TeamSide winnerTeam);
+
+    // Add game with explicit date, returns new game id or -1
+    int insertGame(const QDateTime &gameDate, int team1Score, int team2Score, TeamSide winnerTeam);
 
     // Add player to game with rating change
-    bool addPlayerToGame(int gameId, int playerId, const QString &team, double ratingChange = 0.0);
+    bool addPlayerToGame(int gameId, int playerId, TeamSide team, double ratingChange = 0.0);
 
     // Get player by nickname
     int getPlayerId(const QString &nickname);
@@ -51,38 +137,208 @@ public:
     // Update player rating and winrate
     bool updatePlayerRating(int playerId, double glickoRating, double rd, int totalMatches, int wins);
 
-    // Export to Json
+    // Apply a game result: new rating and RD, one more match and a win if isWin
+    bool applyGameResult(int playerId, double glickoRating, double rd, bool isWin);
+
+    // Get player card with computed winrate
+    bool getPlayer(int playerId, PlayerData &player);
+
+    int countPlayers();
+
+    // Delete all players and games, including game history partitions
+    bool clearDatabase();
+
+    // Export to Json, streamed table by table in parallel from read snapshots
+    // started together while writers are locked out, so the file is a
+    // point-in-time copy (sequential in one read transaction if a write is
+    // in progress); gzip-compressed when filePath ends with .gz (requires zlib). Fails for a
+    // partitioned database: only backupTo copies the partition files
     bool exportToJson(const QString& filePath);
 
-    // Import from Json
-    bool importFromJson(const QString& filePath);
+    // Import from Json (plain or gzip), parsed incrementally in chunks and
+    // inserted in large transactions; progress receives 0..100 by bytes read.
+    // Only into an empty database: if the import fails after some transactions
+    // were committed, the partially imported rows are cleared again
+    bool importFromJson(const QString& filePath, const std::function<void(int)>& progress = {});
+
+    // Binary columnar snapshot (see snapshot.h): several times smaller than JSON,
+    // restored from a memory-mapped file with one batch insert per row group.
+    // Like exportToJson, refuses to export a partitioned database (use backupTo)
+    bool exportSnapshot(const QString& filePath);
+    // Checks the table of contents before inserting; same empty-target and
+    // cleanup-on-failure rules as importFromJson
+    bool importSnapshot(const QString& filePath, const std::function<void(int)>& progress = {});
+
+    // Page-level copy of the database via VACUUM INTO (runs on the calling thread's connection).
+    // Active game history partitions are copied into backupPartitionDirectory(filePath);
+    // the backup fails if any of them cannot be copied
+    bool backupTo(const QString& filePath);
+    static QString backupPartitionDirectory(const QString& backupPath);
+    // Restore a backupTo copy into a database without games: the backup is attached
+    // and its tables are copied in one transaction, columns matched by name;
+    // partition copies are put back into the partitions directory
+    bool restoreBackup(const QString& filePath, const std::function<void(int)>& progress = {});
+    // Expected size of a VACUUM INTO copy, used to report backup progress
+    qint64 estimatedBackupSize();
+    // Directory for automatic backups next to the database file
+    QString backupDirectory() const;
+    QString databasePath() const { return m_dbPath; }
+    // Retention: keep only the newest keepCount backups (with their partition copies),
+    // never removing keepPath (a backup about to be restored); returns number removed
+    int pruneBackups(int keepCount, const QString& keepPath = QString());
 
     // Get games table
-    QVector<QVector<QString>> getGamesTable();
+    GamesTable getGamesTable();
 
     // Get players with ratings and winrate
-    QVector<QVector<QString>> getPlayersWithRatings();
+    PlayersTable getPlayersWithRatings();
+
+    // Keyset pagination for the lazy table models: up to limit rows following
+    // the key in the query's filter and order (ties broken by id), across
+    // partitions when enabled. isCancelled is polled while reading rows; a
+    // cancelled read returns an empty page
+    GamesTable getGamesPage(const GamesQuery &query, const RowKey &after, int limit,
+                            const std::function<bool()> &isCancelled = {});
+    PlayersTable getPlayersPage(const PlayersQuery &query, const RowKey &after, int limit,
+                                const std::function<bool()> &isCancelled = {});
+
+    // Whether nickname search uses the players_fts trigram index; without FTS5
+    // in the SQLite build it falls back to a LIKE scan
+    bool hasNicknameIndex() const { return m_nicknameIndex; }
 
-    // Get rating data for statistics
-    QMap<int, int> getRatingData();
+    // Width of rating_histogram bins in rating points
+    static constexpr int RatingHistogramBinWidth = 10;
+
+    // Non-empty histogram bins, lowest rating first. Maintained by triggers on
+    // players, so reading costs O(bins) regardless of the number of players
+    QVector<RatingBin> getRatingHistogram();
+
+    // Get rating data for statistics: bin midpoint -> games played by its players
+    QMap<int, qint64> getRatingData();
+
+    // Histogram bins and per-skill rating aggregates in the layout of the
+    // generator's live snapshots: O(bins) plus one GROUP BY over players.
+    // The rating moments are exact (two aggregate passes over players, weighted
+    // by total_matches), not taken from bin midpoints.
+    // gamesDone is left at 0. Returns false on a query error
+    bool getDistributionSnapshot(DistributionSnapshot &snapshot);
+
+    // Data version: bumped after every commit that changes players or games (batch
+    // commits, import, clearing, dropping and archiving partitions). Results
+    // derived from the data are still valid while the counter is unchanged
+    quint64 changeCounter() const { return m_changeCounter.load(std::memory_order_acquire); }
+    // Bump the version and emit dataChanged; called by writers after the commit
+    // from whatever thread they run in
+    void notifyDataChanged(const DataChange &change = DataChange::all());
 
     // Get player data for matching
     QVector<PlayerData> getPlayersForMatching();
 
     // Get game details with rating changes
-    QVector<QVector<QString>> getGameDetails(int gameId);
+    GameDetailsTable getGameDetails(int gameId);
+
+    // Get player's games, newest first
+    QVector<PlayerGameRecord> getPlayerHistory(int playerId);
+    // Up to limit of the player's games older than after.id (newest first when
+    // after is null), read by idx_participation_player_game. isCancelled is
+    // polled while reading rows; a cancelled read returns an empty page
+    QVector<PlayerGameRecord> getPlayerHistoryPage(int playerId, const RowKey &after, int limit,
+                                                   const std::function<bool()> &isCancelled = {});
+
+    // Append encoded rating points to block seq of the player's rating history
+    bool appendRatingHistory(int playerId, int seq, int pointCount, const QByteArray &data);
+    // Last rating history block of the player; seq is -1 when there is none
+    bool lastRatingHistoryBlock(int playerId, int &seq, QByteArray &data);
+    // Player's rating trajectory, oldest first, read as one contiguous range
+    QVector<RatingPoint> getRatingHistory(int playerId);
 
     // Update player win stats
     bool updatePlayerWinStats(int playerId, bool isWin);
 
-    QSqlDatabase& database() { return m_db; }
+    // Connection of the calling thread. Each thread gets its own named
+    // connection to the same file from the pool; it is closed when the thread exits.
+    QSqlDatabase& database();
+
+    // Close the calling thread's connection before the thread exits
+    void releaseThreadConnection();
+
+    // Schema version stored in PRAGMA user_version
+    int schemaVersion();
+    static int latestSchemaVersion();
+
+    // EXPLAIN QUERY PLAN details for a statement (used to verify index usage)
+    QStringList queryPlan(const QString &sql);
+
+    // Prepared statement from the per-connection cache; prepared on first use
+    // and reused afterwards. Bind values and exec() as usual, call finish()
+    // after reading a SELECT.
+    QSqlQuery &cachedStatement(Statement id);
+    // Same, routed to the partition holding gameId when partitioning is enabled.
+    // Returns nullptr if that partition cannot be attached: the caller must fail
+    // rather than read or write the main schema instead.
+    QSqlQuery *partitionStatement(Statement id, int gameId);
+    StatementCacheStats statementCacheStats() { return m_pool.local().stats; }
+    void clearStatementCache();
+
+    // Optional monthly partitioning of games/game_participation into separate
+    // database files attached on demand (see partitioncatalog.h). The setting is
+    // stored in the database and can only be switched while there are no games.
+    bool setPartitioningEnabled(bool enabled);
+    bool isPartitioned() const { return m_partitions.isEnabled(); }
+    QVector<PartitionCatalog::Partition> partitions() const { return m_partitions.partitions(true); }
+    // Attach (creating if needed) the partition for games dated gameDate to the
+    // calling thread's connection. ATTACH is impossible inside a transaction, so
+    // writers call this before beginning one; isPartitionReady tells whether the
+    // partition is already attached. Both are no-ops without partitioning.
+    bool preparePartition(const QDateTime &gameDate);
+    bool isPartitionReady(const QDateTime &gameDate);
+    // Reread the partition catalog, e.g. after rolling back a transaction that
+    // inserted partitioned games
+    bool loadPartitionCatalog();
+
+    // Drop partitions of months before the given date (all when the date is invalid):
+    // a catalog row and a file removal per partition, independent of row count
+    int dropPartitions(const QDate &before = QDate());
+    // Move partition files of months before the given date into archiveDir;
+    // archived partitions are excluded from queries
+    int archivePartitions(const QDate &before, const QString &archiveDir);
+
+signals:
+    // Committed change of players or games. Emitted from the writer's thread, so
+    // receivers in the GUI thread get it queued, after the commit is visible
+    // to their own connections
+    void dataChanged(quint64 changeCounter, const DataChange &change);
 
 private:
-    bool createTables();
+    bool migrateSchema();
     bool executeQuery(const QString &query);
+    bool createDeferredIndexes();
+    bool dropDeferredIndexes();
+    bool createHistogramTriggers();
+    bool dropHistogramTriggers();
+    bool createNicknameIndex();
+    // Imports load a whole copy and clear it again on failure - the target must be empty
+    bool checkImportTarget();
+
+    bool execOutsideTransaction(QSqlDatabase &db, const QString &sql, const QVariantList &values = {});
+    bool attachPartition(ConnectionPool::Connection &connection, int month, bool fresh = false);
+    bool detachPartition(ConnectionPool::Connection &connection, int month);
+    bool applyPartitionPragmas(ConnectionPool::Connection &connection, int month);
+    int partitionForGame(int gameId);
+    QSqlQuery *preparedStatement(Statement id, int month);
 
-    QSqlDatabase m_db;
     QString m_dbPath;
+    std::atomic<StorageProfile> m_storageProfile{StorageProfile::Interactive};
+    std::atomic<bool> m_nicknameIndex{false};
+    std::atomic<quint64> m_changeCounter{0};
+
+    // Соединения потоков вместе с их кэшами подготовленных запросов
+    ConnectionPool m_pool;
+
+    // Каталог разделов истории игр, общий для всех соединений
+    PartitionCatalog m_partitions;
 };
 
+Q_DECLARE_METATYPE(DataChange)
+
 #endif // DATABASEMANAGER_H
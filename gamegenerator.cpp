@@ -1,37 +1,54 @@
 #include "gamegenerator.h"
-#include "gamegeneratorthread.h"
+#include "sqlitestoragebackend.h"
+#include "tracer.h"
 #include <QDebug>
-#include <QSqlError>
+#include <QElapsedTimer>
 #include <QVector>
 #include <algorithm>
-#include <QProgressDialog>
-#include <QCoreApplication>
 
 GameGenerator::GameGenerator(DatabaseManager *dbManager, QObject *parent)
-    : QObject(parent), m_dbManager(dbManager), m_random(*QRandomGenerator::global())
+    : QObject(parent), m_ownedStorage(new SqliteStorageBackend(dbManager)),
+    m_storage(m_ownedStorage.get()), m_random(*QRandomGenerator::global())
 {
 }
 
+GameGenerator::GameGenerator(StorageBackend *storage, QObject *parent)
+    : QObject(parent), m_storage(storage), m_random(*QRandomGenerator::global())
+{
+}
+
+GameGenerator::~GameGenerator() = default;
+
+void GameGenerator::setLiveDistribution(LiveDistribution *live)
+{
+    m_live = live;
+}
+
 // Исправленный метод для работы с прогресс-баром и корректного подсчета побед
 bool GameGenerator::generateGames(int gameCount, const QDateTime &startDate,
                                   const QDateTime &endDate, int playersPerTeam,
-                                  QObject* progressObject)
+                                  ProgressChannel* progress)
 {
-    QSqlQuery playerQuery(m_dbManager->database());
-    if (!playerQuery.exec("SELECT COUNT(*) FROM players")) {
-        qDebug() << "Error counting players:" << playerQuery.lastError().text();
+    TRACE_SCOPE("generateGames");
+    if (progress) {
+        progress->beginStage("Загрузка игроков");
+    }
+    int totalPlayers = m_storage->playerCount();
+    if (totalPlayers < 0) {
         return false;
     }
-
-    playerQuery.next();
-    int totalPlayers = playerQuery.value(0).toInt();
     if (totalPlayers < playersPerTeam * 2) {
         qDebug() << "Not enough players for games. Need at least" << (playersPerTeam * 2) << "players, but have" << totalPlayers;
         return false;
     }
 
-    // Получаем данные игроков для подбора
-    QVector<PlayerData> allPlayers = m_dbManager->getPlayersForMatching();
+    // Данные игроков читаются один раз и дальше ведутся в памяти:
+    // рейтинги считаются по ним, в хранилище только пишутся
+    QVector<PlayerData> allPlayers = m_storage->players();
+    QHash<int, int> playerIndex;
+    for (int i = 0; i < allPlayers.size(); ++i) {
+        playerIndex.insert(allPlayers[i].playerId, i);
+    }
 
     qint64 totalSecondsInRange = startDate.secsTo(endDate);
     if (totalSecondsInRange <= 0) {
@@ -45,8 +62,29 @@ bool GameGenerator::generateGames(int gameCount, const QDateTime &startDate,
     // Начальное время для первой игры
     QDateTime currentGameTime = startDate;
 
-    m_dbManager->database().transaction();
+    if (!m_storage->preparePeriod(startDate) || !m_storage->beginBatch()) {
+        return false;
+    }
+    if (progress) {
+        progress->beginStage("Генерация игр", gameCount);
+    }
+    // Снимок распределения строится по состоянию в памяти, без запросов к хранилищу
+    QElapsedTimer sinceSnapshot;
+    if (m_live) {
+        m_live->writeBuffer().build(allPlayers, 0);
+        m_live->publish();
+        sinceSnapshot.start();
+    }
     for (int i = 0; i < gameCount; ++i) {
+        TRACE_SCOPE("game");
+
+        // Отмена: незафиксированный пакет откатывается, хранилище остается согласованным
+        if (progress && progress->isCancelRequested()) {
+            qDebug() << "Game generation cancelled after" << i << "games";
+            m_storage->rollbackBatch();
+            return false;
+        }
+
         // Вместо случайного смещения используем последовательное увеличение времени
         // Добавляем небольшую случайность (до 30 минут) к интервалу, чтобы время не было строго равномерным
         qint64 randomExtraOffset = m_random.bounded(1800); // до 30 минут в секундах
@@ -69,7 +107,7 @@ bool GameGenerator::generateGames(int gameCount, const QDateTime &startDate,
 
         if (selectedPlayers.size() < playersPerTeam * 2) {
             qDebug() << "Not enough players available for a balanced game";
-            m_dbManager->database().rollback();
+            m_storage->rollbackBatch();
             return false;
         }
 
@@ -96,135 +134,60 @@ bool GameGenerator::generateGames(int gameCount, const QDateTime &startDate,
 
         // Определяем победителя на основе вероятности
         double randomValue = m_random.generateDouble();
-        QString winnerTeam;
+        TeamSide winnerTeam;
         int team1Score, team2Score;
 
         if (randomValue < team1WinProb) {
-            winnerTeam = "team1";
+            winnerTeam = Team1;
             team1Score = 5 + m_random.bounded(6); // 5-10
             team2Score = m_random.bounded(5);     // 0-4
         } else {
-            winnerTeam = "team2";
+            winnerTeam = Team2;
             team2Score = 5 + m_random.bounded(6); // 5-10
             team1Score = m_random.bounded(5);     // 0-4
         }
 
-        // Добавляем игру в БД
-        QSqlQuery gameQuery(m_dbManager->database());
-        gameQuery.prepare("INSERT INTO games (game_date, team1_score, team2_score, winner_team) "
-                          "VALUES (:gameDate, :team1Score, :team2Score, :winnerTeam)");
-        gameQuery.bindValue(":gameDate", currentGameTime);
-        gameQuery.bindValue(":team1Score", team1Score);
-        gameQuery.bindValue(":team2Score", team2Score);
-        gameQuery.bindValue(":winnerTeam", winnerTeam);
-
-        if (!gameQuery.exec()) {
-            qDebug() << "Error creating game:" << gameQuery.lastError().text();
-            m_dbManager->database().rollback();
-            return false;
-        }
-
-        int gameId = gameQuery.lastInsertId().toInt();
-
-
-        // Добавляем игроков в игру (просто участие)
-        for (const auto& player : team1Players) {
-            QSqlQuery participationQuery(m_dbManager->database());
-            participationQuery.prepare("INSERT INTO game_participation (game_id, player_id, team) "
-                                       "VALUES (:gameId, :playerId, 'team1')");
-            participationQuery.bindValue(":gameId", gameId);
-            participationQuery.bindValue(":playerId", player.playerId);
-
-            if (!participationQuery.exec()) {
-                qDebug() << "Error adding player to game:" << participationQuery.lastError().text();
-                m_dbManager->database().rollback();
+        // Хранилище не готово к новому периоду (раздел месяца еще не подключен):
+        // пакет фиксируется на границе игр, подготовка идет между пакетами
+        if (!m_storage->isPeriodReady(currentGameTime)) {
+            if (!m_storage->commitBatch() || !m_storage->preparePeriod(currentGameTime)
+                || !m_storage->beginBatch()) {
                 return false;
             }
         }
 
-        for (const auto& player : team2Players) {
-            QSqlQuery participationQuery(m_dbManager->database());
-            participationQuery.prepare("INSERT INTO game_participation (game_id, player_id, team) "
-                                       "VALUES (:gameId, :playerId, 'team2')");
-            participationQuery.bindValue(":gameId", gameId);
-            participationQuery.bindValue(":playerId", player.playerId);
-
-            if (!participationQuery.exec()) {
-                qDebug() << "Error adding player to game:" << participationQuery.lastError().text();
-                m_dbManager->database().rollback();
-                return false;
-            }
+        // Добавляем игру в хранилище
+        int gameId = m_storage->insertGame(currentGameTime, team1Score, team2Score, winnerTeam);
+        if (gameId < 0) {
+            m_storage->rollbackBatch();
+            return false;
         }
 
-        // Обновляем рейтинги по системе Glicko и заполняем rating_change
-        updatePlayerRatings(gameId);
-
-        // Обновляем статистику побед и общего числа игр
-        for (const auto& player : team1Players) {
-            QSqlQuery updateStatsQuery(m_dbManager->database());
-            updateStatsQuery.prepare("UPDATE players SET total_matches = total_matches + 1, "
-                                     "wins = CASE WHEN :isWinner THEN wins + 1 ELSE wins END, "
-                                     "win_rate = CASE WHEN (total_matches + 1) > 0 THEN "
-                                     "(CASE WHEN :isWinner THEN (wins + 1) ELSE wins END) * 100.0 / (total_matches + 1) "
-                                     "ELSE 0 END "
-                                     "WHERE player_id = :playerId");
-            updateStatsQuery.bindValue(":isWinner", winnerTeam == "team1");
-            updateStatsQuery.bindValue(":playerId", player.playerId);
-
-            if (!updateStatsQuery.exec()) {
-                qDebug() << "Error updating player stats:" << updateStatsQuery.lastError().text();
-            }
-
-            // Также обновляем total_matches в ratings
-            QSqlQuery updateRatingMatchesQuery(m_dbManager->database());
-            updateRatingMatchesQuery.prepare("UPDATE ratings SET total_matches = total_matches + 1 "
-                                             "WHERE player_id = :playerId");
-            updateRatingMatchesQuery.bindValue(":playerId", player.playerId);
-
-            if (!updateRatingMatchesQuery.exec()) {
-                qDebug() << "Error updating rating total matches:" << updateRatingMatchesQuery.lastError().text();
-            }
+        // Рейтинги по системе Glicko, участие с rating_change и статистика побед
+        if (!recordGameResult(gameId, currentGameTime.toSecsSinceEpoch(), team1Players, team2Players, winnerTeam,
+                              allPlayers, playerIndex)) {
+            m_storage->rollbackBatch();
+            return false;
         }
 
-        for (const auto& player : team2Players) {
-            QSqlQuery updateStatsQuery(m_dbManager->database());
-            updateStatsQuery.prepare("UPDATE players SET total_matches = total_matches + 1, "
-                                     "wins = CASE WHEN :isWinner THEN wins + 1 ELSE wins END, "
-                                     "win_rate = CASE WHEN (total_matches + 1) > 0 THEN "
-                                     "(CASE WHEN :isWinner THEN (wins + 1) ELSE wins END) * 100.0 / (total_matches + 1) "
-                                     "ELSE 0 END "
-                                     "WHERE player_id = :playerId");
-            updateStatsQuery.bindValue(":isWinner", winnerTeam == "team2");
-            updateStatsQuery.bindValue(":playerId", player.playerId);
-
-            if (!updateStatsQuery.exec()) {
-                qDebug() << "Error updating player stats:" << updateStatsQuery.lastError().text();
-            }
-
-            QSqlQuery updateRatingMatchesQuery(m_dbManager->database());
-            updateRatingMatchesQuery.prepare("UPDATE ratings SET total_matches = total_matches + 1 "
-                                             "WHERE player_id = :playerId");
-            updateRatingMatchesQuery.bindValue(":playerId", player.playerId);
-
-            if (!updateRatingMatchesQuery.exec()) {
-                qDebug() << "Error updating rating total matches:" << updateRatingMatchesQuery.lastError().text();
-            }
+        // Счетчик для GUI: одна запись в атомарную переменную, без событий
+        if (progress) {
+            progress->setDone(i + 1);
         }
-
-        // Обновляем локальный список игроков для следующих игр
-        refreshPlayerData(allPlayers);
-
-        // Обновляем прогресс-бар
-        if (progressObject) {
-            if (auto thread = qobject_cast<GameGeneratorThread*>(progressObject)) {
-                emit thread->progressUpdate(i + 1);
-            } else {
-                emit progressUpdate(i + 1);
-            }
+        // Время проверяется раз в 64 игры; снимок - O(игроков) несколько раз в секунду
+        if (m_live && ((i + 1) % 64 == 0 || i + 1 == gameCount)
+            && (sinceSnapshot.elapsed() >= LiveDistribution::PublishIntervalMs || i + 1 == gameCount)) {
+            m_live->writeBuffer().build(allPlayers, i + 1);
+            m_live->publish();
+            sinceSnapshot.restart();
         }
     }
 
-    return m_dbManager->database().commit();
+    TRACE_SCOPE("commit");
+    if (progress) {
+        progress->beginStage("Запись в хранилище");
+    }
+    return m_storage->commitBatch();
 }
 // Выбрать игроков с близким уровнем навыка
 QVector<PlayerData> GameGenerator::selectBalancedPlayers(int count, QVector<PlayerData> &availablePlayers)
@@ -319,193 +282,80 @@ QVector<double> GameGenerator::calculateRatingChanges(const QVector<PlayerData>&
     return changes;
 }
 
-void GameGenerator::updatePlayerRatings(int gameId)
+bool GameGenerator::recordGameResult(int gameId, qint64 gameDate, const QVector<PlayerData> &team1,
+                                     const QVector<PlayerData> &team2, TeamSide winnerTeam, QVector<PlayerData> &allPlayers,
+                                     const QHash<int, int> &playerIndex)
 {
-    QSqlQuery gameQuery(m_dbManager->database());
-    gameQuery.prepare("SELECT winner_team FROM games WHERE game_id = :gameId");
-    gameQuery.bindValue(":gameId", gameId);
-    if (!gameQuery.exec() || !gameQuery.next()) {
-        qDebug() << "Error retrieving game details:" << gameQuery.lastError().text();
-        return;
-    }
-    QString winnerTeam = gameQuery.value(0).toString();
-
-    // Получаем всех участников игры с их текущими рейтингами и RD
-    QSqlQuery participantsQuery(m_dbManager->database());
-    participantsQuery.prepare("SELECT gp.player_id, gp.team, r.glicko_rating, r.rd "
-                              "FROM game_participation gp "
-                              "JOIN ratings r ON gp.player_id = r.player_id "
-                              "WHERE gp.game_id = :gameId");
-    participantsQuery.bindValue(":gameId", gameId);
-
-    if (!participantsQuery.exec()) {
-        qDebug() << "Error retrieving game participants:" << participantsQuery.lastError().text();
-        return;
-    }
-
+    TRACE_SCOPE("recordGameResult");
     struct PlayerGlickoData {
         int playerId;
-        QString team;
+        TeamSide team;
         double rating;
         double rd;
+        double ratingChange;
     };
 
+    // Текущие рейтинги участников берутся из состояния в памяти
     QVector<PlayerGlickoData> team1Players;
     QVector<PlayerGlickoData> team2Players;
-
-    while (participantsQuery.next()) {
-        PlayerGlickoData player;
-        player.playerId = participantsQuery.value(0).toInt();
-        player.team = participantsQuery.value(1).toString();
-        player.rating = participantsQuery.value(2).toDouble();
-        player.rd = participantsQuery.value(3).toDouble();
-
-        if (player.team == "team1") {
-            team1Players.append(player);
-        } else {
-            team2Players.append(player);
-        }
+    for (const PlayerData &player : team1) {
+        const PlayerData &current = allPlayers[playerIndex.value(player.playerId)];
+        team1Players.append({player.playerId, Team1, current.rating, current.rd, 0.0});
     }
-
-    // Обновляем рейтинги игроков по системе Glicko
-    for (PlayerGlickoData& player : team1Players) {
-        // Данные о противниках
-        QVector<double> opponentRatings;
-        QVector<double> opponentRDs;
-        QVector<bool> outcomes;
-
-        for (const PlayerGlickoData& opponent : team2Players) {
-            opponentRatings.append(opponent.rating);
-            opponentRDs.append(opponent.rd);
-            outcomes.append(winnerTeam == "team1"); // true если игрок выиграл
-        }
-
-        // Сохраняем старый рейтинг
-        double oldRating = player.rating;
-
-        // Обновляем рейтинг по системе Glicko
-        m_ratingSystem.updateRating(player.rating, player.rd, opponentRatings, opponentRDs, outcomes);
-
-        // Вычисляем изменение рейтинга
-        double ratingChange = player.rating - oldRating;
-
-        // Обновляем данные в базе
-        QSqlQuery updateQuery(m_dbManager->database());
-        updateQuery.prepare("UPDATE ratings SET glicko_rating = :rating, rd = :rd "
-                            "WHERE player_id = :playerId");
-        updateQuery.bindValue(":rating", player.rating);
-        updateQuery.bindValue(":rd", player.rd);
-        updateQuery.bindValue(":playerId", player.playerId);
-
-        if (!updateQuery.exec()) {
-            qDebug() << "Error updating rating:" << updateQuery.lastError().text();
-        }
-
-        // Обновляем рейтинг в таблице players
-        QSqlQuery updatePlayerQuery(m_dbManager->database());
-        updatePlayerQuery.prepare("UPDATE players SET glicko_rating = :rating "
-                                  "WHERE player_id = :playerId");
-        updatePlayerQuery.bindValue(":rating", player.rating);
-        updatePlayerQuery.bindValue(":playerId", player.playerId);
-
-        if (!updatePlayerQuery.exec()) {
-            qDebug() << "Error updating player rating:" << updatePlayerQuery.lastError().text();
-        }
-
-        // Обновляем rating_change в game_participation
-        QSqlQuery updateParticipationQuery(m_dbManager->database());
-        updateParticipationQuery.prepare("UPDATE game_participation SET rating_change = :ratingChange "
-                                         "WHERE game_id = :gameId AND player_id = :playerId");
-        updateParticipationQuery.bindValue(":ratingChange", ratingChange);
-        updateParticipationQuery.bindValue(":gameId", gameId);
-        updateParticipationQuery.bindValue(":playerId", player.playerId);
-
-        if (!updateParticipationQuery.exec()) {
-            qDebug() << "Error updating rating change:" << updateParticipationQuery.lastError().text();
-        }
+    for (const PlayerData &player : team2) {
+        const PlayerData &current = allPlayers[playerIndex.value(player.playerId)];
+        team2Players.append({player.playerId, Team2, current.rating, current.rd, 0.0});
     }
 
-    // Аналогично для второй команды
-    for (PlayerGlickoData& player : team2Players) {
-        QVector<double> opponentRatings;
-        QVector<double> opponentRDs;
-        QVector<bool> outcomes;
-
-        for (const PlayerGlickoData& opponent : team1Players) {
-            opponentRatings.append(opponent.rating);
-            opponentRDs.append(opponent.rd);
-            outcomes.append(winnerTeam == "team2"); // true если игрок выиграл
-        }
-
-        double oldRating = player.rating;
-        m_ratingSystem.updateRating(player.rating, player.rd, opponentRatings, opponentRDs, outcomes);
-        double ratingChange = player.rating - oldRating;
-
-        QSqlQuery updateQuery(m_dbManager->database());
-        updateQuery.prepare("UPDATE ratings SET glicko_rating = :rating, rd = :rd "
-                            "WHERE player_id = :playerId");
-        updateQuery.bindValue(":rating", player.rating);
-        updateQuery.bindValue(":rd", player.rd);
-        updateQuery.bindValue(":playerId", player.playerId);
-
-        if (!updateQuery.exec()) {
-            qDebug() << "Error updating rating:" << updateQuery.lastError().text();
-        }
-
-        QSqlQuery updatePlayerQuery(m_dbManager->database());
-        updatePlayerQuery.prepare("UPDATE players SET glicko_rating = :rating "
-                                  "WHERE player_id = :playerId");
-        updatePlayerQuery.bindValue(":rating", player.rating);
-        updatePlayerQuery.bindValue(":playerId", player.playerId);
+    // Обновляем рейтинги игроков по системе Glicko. Вторая команда, как и раньше,
+    // считается против уже обновленных рейтингов первой
+    auto updateTeam = [this, winnerTeam](QVector<PlayerGlickoData> &players,
+                                         const QVector<PlayerGlickoData> &opponents) {
+        for (PlayerGlickoData &player : players) {
+            // Данные о противниках
+            QVector<double> opponentRatings;
+            QVector<double> opponentRDs;
+            QVector<bool> outcomes;
+
+            for (const PlayerGlickoData &opponent : opponents) {
+                opponentRatings.append(opponent.rating);
+                opponentRDs.append(opponent.rd);
+                outcomes.append(winnerTeam == player.team); // true если игрок выиграл
+            }
 
-        if (!updatePlayerQuery.exec()) {
-            qDebug() << "Error updating player rating:" << updatePlayerQuery.lastError().text();
+            double oldRating = player.rating;
+            m_ratingSystem.updateRating(player.rating, player.rd, opponentRatings, opponentRDs, outcomes);
+            player.ratingChange = player.rating - oldRating;
         }
+    };
+    updateTeam(team1Players, team2Players);
+    updateTeam(team2Players, team1Players);
+
+    // Участие с изменением рейтинга, новый рейтинг, статистика и точка траектории игрока
+    for (const QVector<PlayerGlickoData> *team : {&team1Players, &team2Players}) {
+        for (const PlayerGlickoData &player : *team) {
+            const bool win = winnerTeam == player.team;
+            if (!m_storage->addParticipation(gameId, player.playerId, player.team, player.ratingChange)
+                || !m_storage->applyGameResult(player.playerId, player.rating, player.rd, win)
+                || !m_storage->appendRatingPoint(player.playerId, {gameDate, player.rating, player.rd})) {
+                return false;
+            }
 
-        QSqlQuery updateParticipationQuery(m_dbManager->database());
-        updateParticipationQuery.prepare("UPDATE game_participation SET rating_change = :ratingChange "
-                                         "WHERE game_id = :gameId AND player_id = :playerId");
-        updateParticipationQuery.bindValue(":ratingChange", ratingChange);
-        updateParticipationQuery.bindValue(":gameId", gameId);
-        updateParticipationQuery.bindValue(":playerId", player.playerId);
-
-        if (!updateParticipationQuery.exec()) {
-            qDebug() << "Error updating rating change:" << updateParticipationQuery.lastError().text();
+            // Локальный список игроков для следующих игр
+            PlayerData &state = allPlayers[playerIndex.value(player.playerId)];
+            state.rating = player.rating;
+            state.rd = player.rd;
+            state.totalMatches += 1;
+            state.wins += win ? 1 : 0;
+            state.winRate = state.wins * 100.0 / state.totalMatches;
         }
     }
+    return true;
 }
 
 bool GameGenerator::clearDatabase() {
-    // Генерируем уникальное имя файла для резервной копии
-    QString backupFilePath = "backup_" + QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss") + ".json";
-
-    if (!m_dbManager->exportToJson(backupFilePath)) {
-        qDebug() << "Failed to export database to JSON before clearing.";
-        return false;
-    }
-
-    // Очистка базы данных
-    QSqlQuery query(m_dbManager->database());
-
-    if (!m_dbManager->database().transaction()) {
-        qDebug() << "Failed to start transaction for database clearing";
-        return false;
-    }
-
-    QStringList tableNames = {"game_participation", "games", "ratings", "players"};
-    for (const QString &tableName : tableNames) {
-        if (!query.exec("DELETE FROM " + tableName)) {
-            qDebug() << "Error clearing table" << tableName << ":" << query.lastError().text();
-            m_dbManager->database().rollback();
-            return false;
-        }
-        if (!query.exec("DELETE FROM sqlite_sequence WHERE name='" + tableName + "'")) {
-            qDebug() << "Error resetting auto-increment for" << tableName << ":" << query.lastError().text();
-            m_dbManager->database().rollback();
-            return false;
-        }
-    }
-    return m_dbManager->database().commit();
+    TRACE_SCOPE("clearDatabase");
+    return m_storage->clear();
 }
 
 // Генерирует игроков с указанным уровнем навыка
@@ -516,7 +366,7 @@ bool GameGenerator::generatePlayers(int count, int skillLevel)
         return false;
     }
 
-    if (!m_dbManager->database().transaction()) {
+    if (!m_storage->beginBatch()) {
         qDebug() << "Failed to start transaction for player generation";
         return false;
     }
@@ -527,38 +377,14 @@ bool GameGenerator::generatePlayers(int count, int skillLevel)
         // Фиксированный начальный рейтинг 1000
         double initialRating = 1000.0;
 
-        QSqlQuery playerQuery(m_dbManager->database());
-        playerQuery.prepare("INSERT INTO players (nickname, glicko_rating, skill_level, wins, total_matches, win_rate) "
-                            "VALUES (:nickname, :rating, :skill, 0, 0, 0.0)");
-        playerQuery.bindValue(":nickname", nickname);
-        playerQuery.bindValue(":rating", initialRating);
-        playerQuery.bindValue(":skill", skillLevel);
-
-        if (!playerQuery.exec()) {
-            if (playerQuery.lastError().text().contains("UNIQUE constraint failed")) {
-                continue;
-            }
-            qDebug() << "Error creating player:" << playerQuery.lastError().text();
-            m_dbManager->database().rollback();
-            return false;
-        }
-
-        int playerId = playerQuery.lastInsertId().toInt();
-
-        QSqlQuery ratingQuery(m_dbManager->database());
-        ratingQuery.prepare("INSERT INTO ratings (player_id, glicko_rating, rd, total_matches) "
-                            "VALUES (:playerId, :rating, 350.0, 0)");
-        ratingQuery.bindValue(":playerId", playerId);
-        ratingQuery.bindValue(":rating", initialRating);
-
-        if (!ratingQuery.exec()) {
-            qDebug() << "Error creating player rating:" << ratingQuery.lastError().text();
-            m_dbManager->database().rollback();
+        // 0 - ник уже занят, такой игрок пропускается
+        if (m_storage->addPlayer(nickname, skillLevel, initialRating) < 0) {
+            m_storage->rollbackBatch();
             return false;
         }
     }
 
-    return m_dbManager->database().commit();
+    return m_storage->commitBatch();
 }
 
 // Генерирует заданное количество игроков каждого уровня навыка
@@ -598,37 +424,3 @@ QVector<PlayerData> GameGenerator::selectRandomPlayers(int count, QVector<Player
 
     return selectedPlayers;
 }
-
-// Новый вспомогательный метод для обновления данных игроков
-void GameGenerator::refreshPlayerData(QVector<PlayerData>& players)
-{
-    QSqlQuery query(m_dbManager->database());
-    query.prepare("SELECT p.player_id, p.glicko_rating, r.rd, p.total_matches, p.wins, p.win_rate, p.skill_level "
-                  "FROM players p JOIN ratings r ON p.player_id = r.player_id");
-
-    if (!query.exec()) {
-        qDebug() << "Error refreshing player data:" << query.lastError().text();
-        return;
-    }
-
-    // Создаем временную карту для быстрого доступа к игрокам
-    QMap<int, int> playerIdToIndex;
-    for (int i = 0; i < players.size(); ++i) {
-        playerIdToIndex[players[i].playerId] = i;
-    }
-
-    while (query.next()) {
-        int playerId = query.value(0).toInt();
-
-        if (playerIdToIndex.contains(playerId)) {
-            int idx = playerIdToIndex[playerId];
-
-            players[idx].rating = query.value(1).toDouble();
-            players[idx].rd = query.value(2).toDouble();
-            players[idx].totalMatches = query.value(3).toInt();
-            players[idx].wins = query.value(4).toInt();
-            players[idx].winRate = query.value(5).toDouble();
-            players[idx].skillLevel = query.value(6).toInt();
-        }
-    }
-}
@@ -3,23 +3,33 @@
 
 #include <QObject>
 #include "databasemanager.h"
+#include "storagebackend.h"
 #include <QRandomGenerator>
 #include <QDateTime>
+#include <QHash>
 #include <QVector>
-#include <QSqlDatabase>
-#include <QSqlError>
-#include <QSqlQuery>
+#include <memory>
 #include "glickoratingssystem.h"
+#include "livedistribution.h"
+#include "progresschannel.h"
 
 class GameGenerator : public QObject
 {
     Q_OBJECT
 public:
+    // Генератор поверх БД приложения (SqliteStorageBackend)
     explicit GameGenerator(DatabaseManager *dbManager, QObject *parent = nullptr);
+    // Генератор поверх другого хранилища, например LogStorageBackend
+    explicit GameGenerator(StorageBackend *storage, QObject *parent = nullptr);
+    ~GameGenerator() override;
 
-    // Генерировать игры с учетом уровня навыка
+    // Генерировать игры с учетом уровня навыка; этапы и число готовых игр пишутся в progress.
+    // Запрос отмены в progress проверяется перед каждой игрой: текущий пакет откатывается
     bool generateGames(int gameCount, const QDateTime &startDate,
-                       const QDateTime &endDate, int playersPerTeam, QObject* progressObject = nullptr);
+                       const QDateTime &endDate, int playersPerTeam, ProgressChannel* progress = nullptr);
+
+    // Публиковать снимки распределения рейтинга во время generateGames; nullptr - не публиковать
+    void setLiveDistribution(LiveDistribution *live);
 
     // Очистить базу данных
     bool clearDatabase();
@@ -31,15 +41,11 @@ public:
     bool generatePlayersBySkill(int lowSkillCount, int mediumSkillCount,
                                 int aboveAverageSkillCount, int highSkillCount);
 
-    void refreshPlayerData(QVector<PlayerData>& players);
-
-signals:
-    // Сигнал для обновления прогресса
-    void progressUpdate(int value);
-
 private:
-    DatabaseManager *m_dbManager;
+    std::unique_ptr<StorageBackend> m_ownedStorage;
+    StorageBackend *m_storage;
     QRandomGenerator m_random;
+    LiveDistribution *m_live = nullptr;
 
     // Выбор случайных игроков из доступных
     QVector<PlayerData> selectRandomPlayers(int count, QVector<PlayerData> &availablePlayers);
@@ -47,8 +53,10 @@ private:
     // Подбор игроков с близким уровнем навыка
     QVector<PlayerData> selectBalancedPlayers(int count, QVector<PlayerData> &availablePlayers);
 
-    // Обновление рейтингов игроков после игры
-    void updatePlayerRatings(int gameId);
+    // Рейтинги участников по состоянию в памяти, запись участия, итогов игры и траектории
+    bool recordGameResult(int gameId, qint64 gameDate, const QVector<PlayerData> &team1,
+                          const QVector<PlayerData> &team2, TeamSide winnerTeam, QVector<PlayerData> &allPlayers,
+                          const QHash<int, int> &playerIndex);
 
     // Расчет изменения рейтинга для игроков команды
     QVector<double> calculateRatingChanges(const QVector<PlayerData>& team,
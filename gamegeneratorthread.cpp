@@ -1,42 +1,152 @@
 // gamegeneratorthread.cpp
 #include "gamegeneratorthread.h"
+#include "logstoragebackend.h"
+#include "tracer.h"
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
 #include <QThread>
+#include <algorithm>
 
 GameGeneratorThread::GameGeneratorThread(DatabaseManager* dbManager, int gameCount,
                                          const QDateTime &startDate, const QDateTime &endDate,
                                          int playersPerTeam, QObject *parent)
     : QThread(parent), m_dbManager(dbManager), m_gameCount(gameCount),
-    m_startDate(startDate), m_endDate(endDate), m_playersPerTeam(playersPerTeam) {}
+    m_startDate(startDate), m_endDate(endDate), m_playersPerTeam(playersPerTeam),
+    m_live(std::make_shared<LiveDistribution>()), m_meter(&m_progress), m_pollTimer(new QTimer(this))
+{
+    // Таймер живет в потоке GUI и опрашивает канал, пока идет генерация
+    m_pollTimer->setInterval(ProgressChannel::SampleIntervalMs);
+    connect(m_pollTimer, &QTimer::timeout, this, &GameGeneratorThread::pollProgress);
+    connect(this, &QThread::started, m_pollTimer, qOverload<>(&QTimer::start));
+    connect(this, &QThread::finished, m_pollTimer, &QTimer::stop);
+    m_clock.start();
+}
 
 GameGeneratorThread::~GameGeneratorThread() {
     // Правильное завершение потока при уничтожении объекта
     if (isRunning()) {
-        quit();
+        cancel();
         wait();
     }
 }
 
+void GameGeneratorThread::cancel() {
+    m_progress.requestCancel();
+}
+
+bool GameGeneratorThread::isCancelled() const {
+    return m_progress.isCancelRequested();
+}
+
+bool GameGeneratorThread::success() const {
+    return m_success;
+}
+
+void GameGeneratorThread::pollProgress() {
+    emit progressSampled(m_meter.sample(m_clock.elapsed()));
+}
+
 void GameGeneratorThread::run() {
+    TRACE_SCOPE("GameGeneratorThread::run");
     qint64 start = QDateTime::currentMSecsSinceEpoch();
 
+    const bool success = m_logStorage ? generateInLog() : generateInDatabase();
+    m_dbManager->releaseThreadConnection();
+    m_success = success;
+
+    if (!success && !isCancelled()) {
+        qDebug() << "Game generation failed in thread!";
+    }
+
+    qint64 end = QDateTime::currentMSecsSinceEpoch();
+    qint64 duration = end - start;
+
+    if (!isCancelled()) {
+        emit timeElapsed(duration);
+    }
+    emit finished();
+}
+
+bool GameGeneratorThread::generateInDatabase() {
     // Создаем генератор игр в потоке
     GameGenerator gameGen(m_dbManager);
+    gameGen.setLiveDistribution(m_live.get());
 
-    // Соединяем сигнал прогресса из GameGenerator с сигналом в этом классе
-    connect(&gameGen, &GameGenerator::progressUpdate,
-            this, &GameGeneratorThread::progressUpdate, Qt::DirectConnection);
+    // Запускаем генерацию игр в профиле массовой загрузки. Таблицы открыты во
+    // время генерации, поэтому индексы, которые они читают, не удаляются
+    m_progress.beginStage("Подготовка хранилища");
+    bool success = m_dbManager->setStorageProfile(StorageProfile::ConcurrentBulkLoad);
+    if (!success) {
+        qDebug() << "Failed to switch storage to the bulk load profile";
+    }
+    success = success && gameGen.generateGames(m_gameCount, m_startDate, m_endDate, m_playersPerTeam, &m_progress);
+    // Interactive возвращается и после ошибки: иначе триггеры гистограммы остались бы удаленными
+    m_progress.beginStage("Построение индексов");
+    if (!m_dbManager->setStorageProfile(StorageProfile::Interactive)) {
+        qDebug() << "Failed to restore the interactive storage profile";
+        success = false;
+    }
+    return success;
+}
 
-    // Запускаем генерацию игр
-    bool success = gameGen.generateGames(m_gameCount, m_startDate, m_endDate, m_playersPerTeam, this);
+bool GameGeneratorThread::generateInLog() {
+    TRACE_SCOPE("generateInLog");
+    // Снимок журнала загружается в основную БД, разделы он не заполняет
+    if (m_dbManager->isPartitioned()) {
+        qDebug() << "Log storage generation is not available for a partitioned database";
+        return false;
+    }
 
-    if (!success) {
-        qDebug() << "Game generation failed in thread!";
+    m_progress.beginStage("Подготовка хранилища");
+    const QString basePath = QDir(QFileInfo(m_dbManager->databasePath()).absolutePath()).filePath("simulation");
+    LogStorageBackend storage(basePath);
+    if (!storage.open() || !storage.clear()) {
+        qDebug() << "Failed to open the simulation log" << storage.logPath();
+        return false;
     }
+    // Как synchronous=OFF у BulkLoad: журнал остается согласованным, результат и так
+    // попадает в БД только после успешной генерации
+    storage.setSyncOnCommit(false);
 
-    qint64 end = QDateTime::currentMSecsSinceEpoch();
-    int duration = end - start;
+    // Игроки уже созданы в очищенной БД: журнал получает их с теми же id (1..N по порядку)
+    QVector<PlayerData> players = m_dbManager->getPlayersForMatching();
+    std::sort(players.begin(), players.end(), [](const PlayerData &a, const PlayerData &b) {
+        return a.playerId < b.playerId;
+    });
+    if (!storage.beginBatch()) {
+        return false;
+    }
+    for (const PlayerData &player : players) {
+        if (storage.addPlayer(player.nickname, player.skillLevel, player.rating) != player.playerId) {
+            qDebug() << "Failed to copy player" << player.playerId << "to the simulation log";
+            storage.rollbackBatch();
+            return false;
+        }
+    }
+    if (!storage.commitBatch()) {
+        return false;
+    }
 
-    emit timeElapsed(duration);
-    emit finished();
+    GameGenerator gameGen(&storage);
+    gameGen.setLiveDistribution(m_live.get());
+    // Отмена или ошибка оставляют БД с одними игроками, как до генерации
+    if (!gameGen.generateGames(m_gameCount, m_startDate, m_endDate, m_playersPerTeam, &m_progress)) {
+        return false;
+    }
+
+    // Журнал сжимается в снимок, снимок заменяет содержимое БД. Таблицы открыты и во
+    // время загрузки, поэтому индексы не удаляются
+    m_progress.beginStage("Запись");
+    if (!storage.compact() || !m_dbManager->clearDatabase()) {
+        return false;
+    }
+    bool success = m_dbManager->setStorageProfile(StorageProfile::ConcurrentBulkLoad)
+                   && m_dbManager->importSnapshot(storage.snapshotPath());
+    m_progress.beginStage("Построение индексов");
+    if (!m_dbManager->setStorageProfile(StorageProfile::Interactive)) {
+        qDebug() << "Failed to restore the interactive storage profile";
+        success = false;
+    }
+    return success;
 }
@@ -3,9 +3,18 @@
 
 #include <QThread>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QTimer>
 #include "databasemanager.h"
 #include "gamegenerator.h"
+#include "livedistribution.h"
+#include "progresschannel.h"
+#include <memory>
 
+// Генерация игр в фоновом потоке. Прогресс генератор пишет в ProgressChannel,
+// таймер в потоке GUI опрашивает канал с постоянной частотой и отправляет
+// progressSampled не чаще раза в ProgressChannel::SampleIntervalMs. Снимки
+// распределения рейтинга генератор публикует в liveDistribution().
 class GameGeneratorThread : public QThread {
     Q_OBJECT
 public:
@@ -14,20 +23,49 @@ public:
                         int playersPerTeam, QObject *parent = nullptr);
     ~GameGeneratorThread() override;
 
+    // Кооперативная отмена: генератор откатывает текущий пакет, хранилище
+    // возвращается к профилю Interactive, затем поток отправляет finished
+    void cancel();
+    bool isCancelled() const;
+    // Игры записаны и хранилище вернулось к профилю Interactive
+    bool success() const;
+
+    // Снимки распределения во время генерации; окна графиков могут держать их дольше потока
+    std::shared_ptr<LiveDistribution> liveDistribution() const { return m_live; }
+
+    // Генерация в журнал LogStorageBackend рядом с БД (simulation.log/.rss) вместо
+    // построчной записи в SQLite; итоговый снимок журнала загружается в БД через importSnapshot.
+    // Вызывается до start()
+    void setLogStorage(bool enabled) { m_logStorage = enabled; }
+
 protected:
     void run() override;
 
+private slots:
+    void pollProgress();
+
 signals:
-    void progressUpdate(int value);
-    void timeElapsed(int msec);
+    void progressSampled(const ProgressSample &sample);
+    void timeElapsed(qint64 msec);
     void finished();
 
 private:
+    bool generateInDatabase();
+    bool generateInLog();
+
     DatabaseManager* m_dbManager;
+    bool m_logStorage = false;
     int m_gameCount;
     QDateTime m_startDate;
     QDateTime m_endDate;
     int m_playersPerTeam;
+    bool m_success = false;
+
+    ProgressChannel m_progress;
+    std::shared_ptr<LiveDistribution> m_live;
+    ProgressMeter m_meter;
+    QElapsedTimer m_clock;
+    QTimer* m_pollTimer;
 };
 
 #endif // GAMEGENERATORTHREAD_H
@@ -3,7 +3,10 @@
 GameInfoWindow::GameInfoWindow(int gameId, DatabaseManager* dbManager, QWidget *parent)
     : QDialog(parent), ui(new Ui::GameInfoWindow), gameId(gameId), dbManager(dbManager) {
     ui->setupUi(this);
+    // Счет и составы команд читаются из одного снимка БД
+    dbManager->database().transaction();
     loadGameInfo();
+    dbManager->database().commit();
     setWindowTitle("Информация об игре");
 }
 
@@ -13,26 +16,27 @@ GameInfoWindow::~GameInfoWindow() {
 }
 
 void GameInfoWindow::loadGameInfo() {
-    QSqlDatabase db = dbManager->database();
-    QSqlQuery query(db);
-
-    // Получаем основную информацию об игре
-    query.prepare("SELECT team1_score, team2_score, winner_team FROM games WHERE game_id = :gameId");
-    query.bindValue(":gameId", gameId);
+    // Запросы направляются в раздел месяца игры, если история разбита на разделы
+    QSqlQuery *query = dbManager->partitionStatement(Statement::GameScore, gameId);
+    if (!query) {
+        return;
+    }
+    query->bindValue(":gameId", gameId);
 
-    if (!query.exec()) {
-        qDebug() << "Error retrieving game info:" << query.lastError().text();
+    if (!query->exec()) {
+        qDebug() << "Error retrieving game info:" << query->lastError().text();
         return;
     }
 
-    if (query.next()) {
-        int team1Score = query.value(0).toInt();
-        int team2Score = query.value(1).toInt();
-        QString winnerTeam = query.value(2).toString();
+    if (query->next()) {
+        int team1Score = query->value(0).toInt();
+        int team2Score = query->value(1).toInt();
+        QString winnerTeam = teamSideName(query->value(2).toInt());
+        query->finish();
 
         //  Получаем ID команд из таблицы game_participation
-        QString team1Squad = getTeamSquad(gameId, "team1");
-        QString team2Squad = getTeamSquad(gameId, "team2");
+        QString team1Squad = getTeamSquad(gameId, Team1);
+        QString team2Squad = getTeamSquad(gameId, Team2);
         // Отображаем информацию в UI
         ui->team1SquadLabel->setText("Состав команды 1:\n" + team1Squad);
         ui->team2SquadLabel->setText("Состав команды 2:\n" + team2Squad);
@@ -44,24 +48,26 @@ void GameInfoWindow::loadGameInfo() {
     }
     ui->gameIDLabel->setText("ID игры: " + QString::number(gameId));
 }
-QString GameInfoWindow::getTeamSquad(int gameId, const QString& team) {
-    QSqlDatabase db = dbManager->database();
-    QSqlQuery query(db);
+QString GameInfoWindow::getTeamSquad(int gameId, TeamSide team) {
     QString squad;
 
     // Запрос для получения игроков команды, участвовавших в данной игре
-    query.prepare("SELECT p.nickname FROM players p JOIN game_participation gp ON p.player_id = gp.player_id WHERE gp.game_id = :gameId AND gp.team = :team");
-    query.bindValue(":gameId", gameId);
-    query.bindValue(":team", team);
+    QSqlQuery *query = dbManager->partitionStatement(Statement::TeamSquad, gameId);
+    if (!query) {
+        return "Ошибка получения состава";
+    }
+    query->bindValue(":gameId", gameId);
+    query->bindValue(":team", static_cast<int>(team));
 
-    if (!query.exec()) {
-        qDebug() << "Error retrieving team squad:" << query.lastError().text();
+    if (!query->exec()) {
+        qDebug() << "Error retrieving team squad:" << query->lastError().text();
         return "Ошибка получения состава";
     }
 
-    while (query.next()) {
-        squad += query.value(0).toString() + "\n";
+    while (query->next()) {
+        squad += query->value(0).toString() + "\n";
     }
+    query->finish();
 
     return squad;
 }
@@ -21,7 +21,7 @@ private:
     DatabaseManager* dbManager;
 
     void loadGameInfo();
-    QString getTeamSquad(int teamId, const QString& team);
+    QString getTeamSquad(int teamId, TeamSide team);
 };
 
 #endif // GAMEINFOWINDOW_H
@@ -1,5 +1,6 @@
 // importdatabasethread.cpp
 #include "importdatabasethread.h"
+#include "tracer.h"
 #include <QDebug>
 
 ImportDatabaseThread::ImportDatabaseThread(DatabaseManager* dbManager, const QString& filePath, QProgressDialog* progressDialog, QObject *parent)
@@ -12,7 +13,29 @@ bool ImportDatabaseThread::success() const {
 }
 
 void ImportDatabaseThread::run() {
-    m_success = m_dbManager->importFromJson(m_filePath);
+    TRACE_SCOPE("ImportDatabaseThread::run");
+    const bool bulkLoad = m_dbManager->setStorageProfile(StorageProfile::BulkLoad);
+    if (!bulkLoad) {
+        qDebug() << "Failed to switch storage to the bulk load profile";
+    }
+    auto progress = [this](int percent) {
+        emit progressUpdate(percent);
+    };
+    // Автоматические резервные копии (.db) - копии файла БД, остальное - экспорт
+    if (!bulkLoad) {
+        m_success = false;
+    } else if (m_filePath.endsWith(".db", Qt::CaseInsensitive)) {
+        m_success = m_dbManager->restoreBackup(m_filePath, progress);
+    } else if (m_filePath.endsWith(".rss", Qt::CaseInsensitive)) {
+        m_success = m_dbManager->importSnapshot(m_filePath, progress);
+    } else {
+        m_success = m_dbManager->importFromJson(m_filePath, progress);
+    }
+    // Индексы и триггеры гистограммы восстанавливаются и после неудачного импорта
+    if (!m_dbManager->setStorageProfile(StorageProfile::Interactive)) {
+        qDebug() << "Failed to restore the interactive storage profile";
+        m_success = false;
+    }
     emit finished();
 }
 
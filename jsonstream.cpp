@@ -0,0 +1,487 @@
+#include "jsonstream.h"
+#include <QLocale>
+#include <QDebug>
+#include <cmath>
+
+#ifdef RSS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+JsonStreamWriter::JsonStreamWriter(QIODevice *device, Compression compression)
+    : m_device(device), m_compression(compression)
+{
+    m_buffer.reserve(BufferSize + 4096);
+
+    if (m_compression == Compression::Gzip) {
+#ifdef RSS_HAVE_ZLIB
+        z_stream *stream = new z_stream{};
+        // 15 + 16: окно 32 КБ с gzip-заголовком вместо zlib
+        if (deflateInit2(stream, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            qDebug() << "Failed to initialize gzip stream";
+            delete stream;
+            m_error = true;
+        } else {
+            m_zstream = stream;
+            m_compressed.resize(BufferSize / 2);
+        }
+#else
+        qDebug() << "Gzip output is not available: built without zlib";
+        m_error = true;
+#endif
+    }
+}
+
+JsonStreamWriter::~JsonStreamWriter()
+{
+    finish();
+#ifdef RSS_HAVE_ZLIB
+    if (m_zstream) {
+        deflateEnd(static_cast<z_stream*>(m_zstream));
+        delete static_cast<z_stream*>(m_zstream);
+    }
+#endif
+}
+
+bool JsonStreamWriter::gzipSupported()
+{
+#ifdef RSS_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void JsonStreamWriter::write(const char *text)
+{
+    m_buffer += text;
+    flushIfFull();
+}
+
+void JsonStreamWriter::write(const QByteArray &text)
+{
+    m_buffer += text;
+    flushIfFull();
+}
+
+void JsonStreamWriter::writeString(const QString &value)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    const QByteArray utf8 = value.toUtf8();
+    m_buffer += '"';
+    for (char ch : utf8) {
+        switch (ch) {
+        case '"': m_buffer += "\\\""; break;
+        case '\\': m_buffer += "\\\\"; break;
+        case '\n': m_buffer += "\\n"; break;
+        case '\r': m_buffer += "\\r"; break;
+        case '\t': m_buffer += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                m_buffer += "\\u00";
+                m_buffer += hexDigits[(ch >> 4) & 0xF];
+                m_buffer += hexDigits[ch & 0xF];
+            } else {
+                m_buffer += ch;
+            }
+        }
+    }
+    m_buffer += '"';
+    flushIfFull();
+}
+
+void JsonStreamWriter::writeValue(const QVariant &value)
+{
+    if (value.isNull()) {
+        write("null");
+        return;
+    }
+
+    switch (value.userType()) {
+    case QMetaType::Bool:
+        write(value.toBool() ? "true" : "false");
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+        write(QByteArray::number(value.toLongLong()));
+        break;
+    case QMetaType::Double:
+    case QMetaType::Float: {
+        double number = value.toDouble();
+        // JSON не умеет NaN/inf, как и QJsonDocument - пишем null
+        write(std::isfinite(number)
+                  ? QString::number(number, 'g', QLocale::FloatingPointShortest).toLatin1()
+                  : QByteArray("null"));
+        break;
+    }
+    default:
+        writeString(value.toString());
+    }
+}
+
+bool JsonStreamWriter::finish()
+{
+    if (m_finished) {
+        return !m_error;
+    }
+    m_finished = true;
+    return flush(true);
+}
+
+void JsonStreamWriter::flushIfFull()
+{
+    if (m_buffer.size() >= BufferSize) {
+        flush(false);
+    }
+}
+
+bool JsonStreamWriter::flush(bool finishStream)
+{
+    if (m_error) {
+        m_buffer.clear();
+        return false;
+    }
+
+    if (m_compression == Compression::None) {
+        if (!m_buffer.isEmpty() && m_device->write(m_buffer) != m_buffer.size()) {
+            qDebug() << "Error writing JSON stream:" << m_device->errorString();
+            m_error = true;
+        }
+        m_buffer.clear();
+        return !m_error;
+    }
+
+#ifdef RSS_HAVE_ZLIB
+    z_stream *stream = static_cast<z_stream*>(m_zstream);
+    stream->next_in = reinterpret_cast<Bytef*>(m_buffer.data());
+    stream->avail_in = static_cast<uInt>(m_buffer.size());
+
+    int status = Z_OK;
+    do {
+        stream->next_out = reinterpret_cast<Bytef*>(m_compressed.data());
+        stream->avail_out = static_cast<uInt>(m_compressed.size());
+        status = deflate(stream, finishStream ? Z_FINISH : Z_NO_FLUSH);
+        if (status == Z_STREAM_ERROR) {
+            qDebug() << "Error compressing JSON stream";
+            m_error = true;
+            break;
+        }
+
+        qint64 produced = m_compressed.size() - stream->avail_out;
+        if (produced > 0 && m_device->write(m_compressed.constData(), produced) != produced) {
+            qDebug() << "Error writing JSON stream:" << m_device->errorString();
+            m_error = true;
+            break;
+        }
+    } while (stream->avail_out == 0 || (finishStream && status != Z_STREAM_END));
+#endif
+
+    m_buffer.clear();
+    return !m_error;
+}
+
+JsonStreamReader::JsonStreamReader(QIODevice *device)
+    : m_device(device)
+{
+    const QByteArray magic = device->peek(2);
+    m_gzip = magic.size() == 2 && static_cast<unsigned char>(magic[0]) == 0x1f
+             && static_cast<unsigned char>(magic[1]) == 0x8b;
+
+    if (m_gzip) {
+#ifdef RSS_HAVE_ZLIB
+        z_stream *stream = new z_stream{};
+        // 15 + 32: автоопределение gzip/zlib-заголовка
+        if (inflateInit2(stream, 15 + 32) != Z_OK) {
+            delete stream;
+            m_errorString = "Failed to initialize gzip stream";
+        } else {
+            m_zstream = stream;
+        }
+#else
+        m_errorString = "Gzip input is not available: built without zlib";
+#endif
+    }
+}
+
+JsonStreamReader::~JsonStreamReader()
+{
+#ifdef RSS_HAVE_ZLIB
+    if (m_zstream) {
+        inflateEnd(static_cast<z_stream*>(m_zstream));
+        delete static_cast<z_stream*>(m_zstream);
+    }
+#endif
+}
+
+bool JsonStreamReader::fill()
+{
+    m_pos = 0;
+    m_buffer.clear();
+
+    while (m_buffer.isEmpty() && !m_eof && m_errorString.isEmpty()) {
+        if (!m_gzip) {
+            m_buffer = m_device->read(ChunkSize);
+            m_bytesRead += m_buffer.size();
+            if (m_buffer.isEmpty()) {
+                m_eof = true;
+            }
+            continue;
+        }
+
+#ifdef RSS_HAVE_ZLIB
+        z_stream *stream = static_cast<z_stream*>(m_zstream);
+        if (stream->avail_in == 0 && !m_outputFull) {
+            m_input = m_device->read(ChunkSize);
+            m_bytesRead += m_input.size();
+            if (m_input.isEmpty()) {
+                m_eof = true;
+                break;
+            }
+            stream->next_in = reinterpret_cast<Bytef*>(m_input.data());
+            stream->avail_in = static_cast<uInt>(m_input.size());
+        }
+
+        m_buffer.resize(ChunkSize);
+        stream->next_out = reinterpret_cast<Bytef*>(m_buffer.data());
+        stream->avail_out = ChunkSize;
+        int status = inflate(stream, Z_NO_FLUSH);
+        m_buffer.resize(ChunkSize - static_cast<int>(stream->avail_out));
+        m_outputFull = stream->avail_out == 0;
+
+        if (status == Z_STREAM_END) {
+            // Дальше может идти следующий gzip-член (экспорт пишет их по одному на фрагмент)
+            inflateReset(stream);
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            m_errorString = "Corrupted gzip data";
+            m_buffer.clear();
+        }
+#endif
+    }
+
+    return !m_buffer.isEmpty();
+}
+
+int JsonStreamReader::getChar()
+{
+    if (m_pos >= m_buffer.size() && !fill()) {
+        return -1;
+    }
+    return static_cast<unsigned char>(m_buffer[m_pos++]);
+}
+
+int JsonStreamReader::peekChar()
+{
+    if (m_pos >= m_buffer.size() && !fill()) {
+        return -1;
+    }
+    return static_cast<unsigned char>(m_buffer[m_pos]);
+}
+
+JsonStreamReader::Token JsonStreamReader::fail(const QString &message)
+{
+    if (m_errorString.isEmpty()) {
+        m_errorString = message;
+    }
+    m_token = Token::Error;
+    return m_token;
+}
+
+JsonStreamReader::Token JsonStreamReader::next()
+{
+    if (!m_errorString.isEmpty()) {
+        return fail(m_errorString);
+    }
+
+    for (;;) {
+        int ch = getChar();
+        switch (ch) {
+        case -1:
+            if (!m_errorString.isEmpty()) {
+                return fail(m_errorString);
+            }
+            m_token = Token::End;
+            return m_token;
+        case ' ': case '\t': case '\n': case '\r': case ',': case ':':
+            continue;
+        case '{': m_token = Token::BeginObject; return m_token;
+        case '}': m_token = Token::EndObject; return m_token;
+        case '[': m_token = Token::BeginArray; return m_token;
+        case ']': m_token = Token::EndArray; return m_token;
+        case '"':
+            if (!readString()) {
+                return fail(m_errorString);
+            }
+            m_token = Token::String;
+            return m_token;
+        case 't': case 'f': case 'n':
+            if (!readLiteral(static_cast<char>(ch))) {
+                return fail(m_errorString);
+            }
+            return m_token;
+        default:
+            if (ch == '-' || (ch >= '0' && ch <= '9')) {
+                readNumber(static_cast<char>(ch));
+                m_token = Token::Number;
+                return m_token;
+            }
+            return fail(QString("Unexpected character '%1' in JSON").arg(QChar(ch)));
+        }
+    }
+}
+
+int JsonStreamReader::readHex4()
+{
+    int code = 0;
+    for (int i = 0; i < 4; ++i) {
+        int ch = getChar();
+        int digit = (ch >= '0' && ch <= '9') ? ch - '0'
+                    : (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10
+                    : (ch >= 'A' && ch <= 'F') ? ch - 'A' + 10 : -1;
+        if (digit < 0) {
+            return -1;
+        }
+        code = code * 16 + digit;
+    }
+    return code;
+}
+
+bool JsonStreamReader::readString()
+{
+    m_text.clear();
+    for (;;) {
+        if (m_pos >= m_buffer.size() && !fill()) {
+            fail("Unterminated string in JSON");
+            return false;
+        }
+
+        // Быстрый путь: участок без кавычек и escape-последовательностей копируется целиком
+        const char *data = m_buffer.constData();
+        const int start = m_pos;
+        while (m_pos < m_buffer.size() && data[m_pos] != '"' && data[m_pos] != '\\') {
+            ++m_pos;
+        }
+        m_text.append(data + start, m_pos - start);
+        if (m_pos >= m_buffer.size()) {
+            continue;
+        }
+
+        if (data[m_pos++] == '"') {
+            return true;
+        }
+
+        int escaped = getChar();
+        switch (escaped) {
+        case '"': case '\\': case '/': m_text += static_cast<char>(escaped); break;
+        case 'b': m_text += '\b'; break;
+        case 'f': m_text += '\f'; break;
+        case 'n': m_text += '\n'; break;
+        case 'r': m_text += '\r'; break;
+        case 't': m_text += '\t'; break;
+        case 'u': {
+            int code = readHex4();
+            if (code < 0) {
+                fail("Invalid \\u escape in JSON");
+                return false;
+            }
+            char32_t codePoint = static_cast<char32_t>(code);
+            // Символы вне BMP приходят суррогатной парой \uXXXX\uXXXX
+            if (code >= 0xD800 && code <= 0xDBFF && getChar() == '\\' && getChar() == 'u') {
+                int low = readHex4();
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    codePoint = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+            }
+            m_text += QString::fromUcs4(&codePoint, 1).toUtf8();
+            break;
+        }
+        default:
+            fail("Invalid escape sequence in JSON");
+            return false;
+        }
+    }
+}
+
+bool JsonStreamReader::readNumber(char first)
+{
+    m_text.clear();
+    m_text += first;
+    m_numberIsInteger = true;
+    for (;;) {
+        int ch = peekChar();
+        if (ch >= '0' && ch <= '9') {
+            m_text += static_cast<char>(ch);
+        } else if (ch == '.' || ch == 'e' || ch == 'E' || ch == '+' || ch == '-') {
+            m_text += static_cast<char>(ch);
+            m_numberIsInteger = false;
+        } else {
+            break;
+        }
+        ++m_pos;
+    }
+    return true;
+}
+
+bool JsonStreamReader::readLiteral(char first)
+{
+    const char *expected = first == 't' ? "true" : (first == 'f' ? "false" : "null");
+    for (const char *rest = expected + 1; *rest; ++rest) {
+        if (getChar() != *rest) {
+            fail(QString("Invalid literal in JSON, expected %1").arg(expected));
+            return false;
+        }
+    }
+    m_text = expected;
+    m_token = first == 'n' ? Token::Null : Token::Bool;
+    return true;
+}
+
+QVariant JsonStreamReader::scalarValue() const
+{
+    switch (m_token) {
+    case Token::String:
+        return stringValue();
+    case Token::Number:
+        if (m_numberIsInteger) {
+            bool ok = false;
+            qlonglong value = m_text.toLongLong(&ok);
+            if (ok) {
+                return value;
+            }
+        }
+        return m_text.toDouble();
+    case Token::Bool:
+        return m_text == "true";
+    default:
+        return QVariant();
+    }
+}
+
+bool JsonStreamReader::skipValue(Token first)
+{
+    if (first != Token::BeginObject && first != Token::BeginArray) {
+        return first != Token::Error && first != Token::End
+               && first != Token::EndObject && first != Token::EndArray;
+    }
+
+    int depth = 1;
+    while (depth > 0) {
+        switch (next()) {
+        case Token::BeginObject:
+        case Token::BeginArray:
+            ++depth;
+            break;
+        case Token::EndObject:
+        case Token::EndArray:
+            --depth;
+            break;
+        case Token::End:
+        case Token::Error:
+            return false;
+        default:
+            break;
+        }
+    }
+    return true;
+}
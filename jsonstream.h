@@ -0,0 +1,129 @@
+#ifndef JSONSTREAM_H
+#define JSONSTREAM_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QVariant>
+
+// Потоковая запись JSON в устройство через буфер фиксированного размера,
+// при необходимости со сжатием gzip (если сборка с zlib). Память не зависит
+// от объема данных: строки пишутся сразу из курсора запроса.
+// Каждый писатель со сжатием образует отдельный gzip-член; конкатенация
+// таких членов - корректный gzip-файл.
+class JsonStreamWriter
+{
+public:
+    enum class Compression {
+        None,
+        Gzip
+    };
+
+    explicit JsonStreamWriter(QIODevice *device, Compression compression = Compression::None);
+    ~JsonStreamWriter();
+
+    JsonStreamWriter(const JsonStreamWriter &) = delete;
+    JsonStreamWriter &operator=(const JsonStreamWriter &) = delete;
+
+    static bool gzipSupported();
+
+    // Сырой JSON-текст (скобки, разделители, готовые ключи)
+    void write(const char *text);
+    void write(const QByteArray &text);
+
+    // Экранированная JSON-строка в кавычках
+    void writeString(const QString &value);
+
+    // Значение столбца: null, число, bool или строка
+    void writeValue(const QVariant &value);
+
+    // Сбросить буфер и завершить gzip-член; повторный вызов ничего не делает
+    bool finish();
+
+    bool hasError() const { return m_error; }
+
+private:
+    static constexpr int BufferSize = 1 << 20;
+
+    void flushIfFull();
+    bool flush(bool finishStream);
+
+    QIODevice *m_device;
+    Compression m_compression;
+    QByteArray m_buffer;
+    QByteArray m_compressed;
+    void *m_zstream = nullptr; // z_stream, чтобы не тянуть zlib.h в заголовок
+    bool m_finished = false;
+    bool m_error = false;
+};
+
+// Потоковое чтение JSON (pull-парсер): файл читается блоками по 1 МБ,
+// в памяти только текущий блок и текущее значение. gzip-вход (в том числе
+// из нескольких членов) распознается по сигнатуре и распаковывается на лету.
+// Разделители ',' и ':' пропускаются - структуру отслеживает вызывающий код.
+class JsonStreamReader
+{
+public:
+    enum class Token {
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        String,
+        Number,
+        Bool,
+        Null,
+        End,
+        Error
+    };
+
+    explicit JsonStreamReader(QIODevice *device);
+    ~JsonStreamReader();
+
+    JsonStreamReader(const JsonStreamReader &) = delete;
+    JsonStreamReader &operator=(const JsonStreamReader &) = delete;
+
+    Token next();
+
+    // Значение последнего токена String/Number/Bool/Null
+    QString stringValue() const { return QString::fromUtf8(m_text); }
+    QVariant scalarValue() const;
+
+    // Пропустить значение, начинающееся с уже прочитанного токена first
+    bool skipValue(Token first);
+
+    // Сколько байт прочитано из устройства (для gzip - сжатых байт)
+    qint64 bytesRead() const { return m_bytesRead; }
+
+    QString errorString() const { return m_errorString; }
+
+private:
+    static constexpr int ChunkSize = 1 << 20;
+
+    int getChar();
+    int peekChar();
+    bool fill();
+    int readHex4();
+    bool readString();
+    bool readNumber(char first);
+    bool readLiteral(char first);
+    Token fail(const QString &message);
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    int m_pos = 0;
+    qint64 m_bytesRead = 0;
+
+    QByteArray m_input;        // сжатый блок для gzip
+    void *m_zstream = nullptr; // z_stream
+    bool m_gzip = false;
+    bool m_outputFull = false; // inflate заполнил выход целиком - мог остаться хвост
+    bool m_eof = false;
+
+    Token m_token = Token::Error;
+    QByteArray m_text;
+    bool m_numberIsInteger = false;
+    QString m_errorString;
+};
+
+#endif // JSONSTREAM_H
@@ -0,0 +1,61 @@
+// livedistribution.cpp
+#include "livedistribution.h"
+#include "databasemanager.h"
+#include <algorithm>
+#include <cmath>
+
+void DistributionSnapshot::build(const QVector<PlayerData> &players, qint64 games) {
+    gamesDone = games;
+    binPlayers.clear();
+    binGames.clear();
+    skills.clear();
+    moments = RatingMoments();
+    if (players.isEmpty()) {
+        return;
+    }
+
+    auto binOf = [](double rating) {
+        return static_cast<int>(std::floor(rating / DatabaseManager::RatingHistogramBinWidth));
+    };
+    auto [lowest, highest] = std::minmax_element(players.cbegin(), players.cend(),
+                                                 [](const PlayerData &a, const PlayerData &b) {
+                                                     return a.rating < b.rating;
+                                                 });
+    firstBin = binOf(lowest->rating);
+    const int binCount = binOf(highest->rating) - firstBin + 1;
+    binPlayers.fill(0, binCount);
+    binGames.fill(0, binCount);
+
+    for (const PlayerData &player : players) {
+        const int bin = binOf(player.rating) - firstBin;
+        binPlayers[bin] += 1;
+        binGames[bin] += player.totalMatches;
+        if (player.totalMatches > 0) {
+            moments.add(player.rating, player.totalMatches);
+        }
+
+        SkillRating &skill = skills[player.skillLevel];
+        if (skill.players == 0) {
+            skill.min = skill.max = player.rating;
+        } else {
+            skill.min = std::min(skill.min, player.rating);
+            skill.max = std::max(skill.max, player.rating);
+        }
+        skill.players += 1;
+        skill.mean += (player.rating - skill.mean) / skill.players;
+    }
+}
+
+void LiveDistribution::publish() {
+    const int previous = m_middle.exchange(m_writeIndex | FreshFlag, std::memory_order_acq_rel);
+    m_writeIndex = previous & IndexMask;
+}
+
+bool LiveDistribution::update() {
+    if (!(m_middle.load(std::memory_order_relaxed) & FreshFlag)) {
+        return false;
+    }
+    const int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+    m_readIndex = previous & IndexMask;
+    return true;
+}
@@ -0,0 +1,63 @@
+// livedistribution.h
+#ifndef LIVEDISTRIBUTION_H
+#define LIVEDISTRIBUTION_H
+
+#include <QMap>
+#include <QVector>
+#include <atomic>
+#include "ratingstatistics.h"
+#include "storagebackend.h"
+
+// Рейтинги уровня навыка в снимке
+struct SkillRating {
+    int players = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+};
+
+// Распределение рейтинга по состоянию генератора в памяти: те же корзины, что и
+// в таблице rating_histogram (DatabaseManager::RatingHistogramBinWidth)
+struct DistributionSnapshot {
+    qint64 gamesDone = 0;
+    int firstBin = 0;           // номер корзины binPlayers[0]
+    QVector<int> binPlayers;    // игроков в корзине
+    QVector<qint64> binGames;   // сумма игр игроков корзины
+    QMap<int, SkillRating> skills; // уровень навыка -> рейтинги
+    // Точные моменты рейтинга по игрокам с весом - числом игр; средние точек корзин
+    // ошибаются до половины ширины корзины
+    RatingMoments moments;
+
+    bool isEmpty() const { return binPlayers.isEmpty(); }
+    // Заполнить по списку игроков; память корзин переиспользуется
+    void build(const QVector<PlayerData> &players, qint64 games);
+};
+
+// Снимки распределения от потока генерации к GUI через тройной буфер: писатель
+// заполняет свой буфер и обменивает его с промежуточным, читатель забирает
+// промежуточный, только если там новый снимок. Без блокировок и ожидания с
+// обеих сторон; читатель всегда видит целый снимок, писатель не ждет читателя.
+class LiveDistribution {
+public:
+    // Как часто генератор публикует снимок
+    static constexpr int PublishIntervalMs = 250;
+
+    // Поток генерации: буфер для следующего снимка и его публикация
+    DistributionSnapshot &writeBuffer() { return m_buffers[m_writeIndex]; }
+    void publish();
+
+    // Поток GUI: забрать новый снимок, если он есть; false - снимок не менялся
+    bool update();
+    const DistributionSnapshot &snapshot() const { return m_buffers[m_readIndex]; }
+
+private:
+    static constexpr int FreshFlag = 4;
+    static constexpr int IndexMask = 3;
+
+    DistributionSnapshot m_buffers[3];
+    int m_writeIndex = 0;
+    int m_readIndex = 1;
+    std::atomic<int> m_middle{2}; // номер промежуточного буфера | FreshFlag
+};
+
+#endif // LIVEDISTRIBUTION_H
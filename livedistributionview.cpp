@@ -0,0 +1,89 @@
+// livedistributionview.cpp
+#include "livedistributionview.h"
+#include <QMainWindow>
+
+LiveDistributionView::LiveDistributionView(std::shared_ptr<LiveDistribution> live, QWidget *parentWindow)
+    : QObject(parentWindow), m_live(std::move(live)), m_parentWindow(parentWindow), m_timer(new QTimer(this))
+{
+    m_timer->setInterval(RefreshIntervalMs);
+    connect(m_timer, &QTimer::timeout, this, &LiveDistributionView::refresh);
+    m_timer->start();
+    refresh();
+}
+
+void LiveDistributionView::finish() {
+    m_timer->stop();
+    refresh();
+    // Окна так и не открылись - показывать нечего
+    if (m_openWindows == 0) {
+        deleteLater();
+    }
+}
+
+void LiveDistributionView::refresh() {
+    if (!m_live->update()) {
+        return;
+    }
+    const DistributionSnapshot &snapshot = m_live->snapshot();
+    if (snapshot.isEmpty()) {
+        return;
+    }
+    m_analyzer.setSnapshot(snapshot);
+
+    if (!m_opened) {
+        openWindows();
+        return;
+    }
+    if (m_gamesChart) {
+        m_analyzer.updateDistributionChart(m_gamesChart);
+    }
+    if (m_playersChart) {
+        m_analyzer.updatePlayerDistributionChart(m_playersChart);
+    }
+    if (m_skillChart) {
+        m_analyzer.updateSkillRatingChart(m_skillChart);
+    }
+    updateTitles();
+}
+
+void LiveDistributionView::openWindows() {
+    m_opened = true;
+    m_gamesChart = openWindow(m_analyzer.createDistributionChart(), "Распределение рейтинга по количеству игр");
+    m_playersChart = openWindow(m_analyzer.createPlayerDistributionChart(), "Распределение рейтинга по количеству игроков");
+    m_skillChart = openWindow(m_analyzer.createSkillRatingChart(), "Зависимость рейтинга от уровня скилла");
+    updateTitles();
+}
+
+QChartView *LiveDistributionView::openWindow(QChartView *view, const QString &title) {
+    if (!view) {
+        return nullptr;
+    }
+    // Анимация серий при каждом снимке только мешает следить за изменениями
+    view->chart()->setAnimationOptions(QChart::NoAnimation);
+
+    QMainWindow *window = new QMainWindow(m_parentWindow);
+    window->setAttribute(Qt::WA_DeleteOnClose);
+    window->setCentralWidget(view);
+    window->resize(800, 600);
+    window->setObjectName(title);
+    window->show();
+
+    // Все окна закрыты - наблюдать больше нечего
+    ++m_openWindows;
+    connect(window, &QObject::destroyed, this, [this]() {
+        if (--m_openWindows == 0) {
+            m_timer->stop();
+            deleteLater();
+        }
+    });
+    return view;
+}
+
+void LiveDistributionView::updateTitles() {
+    const QString games = QString(" - сыграно игр: %1").arg(m_live->snapshot().gamesDone);
+    for (QChartView *view : {m_gamesChart.data(), m_playersChart.data(), m_skillChart.data()}) {
+        if (view) {
+            view->window()->setWindowTitle(view->window()->objectName() + games);
+        }
+    }
+}
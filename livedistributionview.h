@@ -0,0 +1,48 @@
+// livedistributionview.h
+#ifndef LIVEDISTRIBUTIONVIEW_H
+#define LIVEDISTRIBUTIONVIEW_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <memory>
+#include "livedistribution.h"
+#include "ratingdistributionanalyzer.h"
+
+// Окна графиков RatingDistributionAnalyzer, которые во время генерации
+// перерисовываются по снимкам LiveDistribution несколько раз в секунду.
+// К SQLite не обращаются; окна открываются с первым снимком, объект удаляется,
+// когда закрыты все окна.
+class LiveDistributionView : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int RefreshIntervalMs = 250;
+
+    LiveDistributionView(std::shared_ptr<LiveDistribution> live, QWidget *parentWindow);
+
+    // Генерация завершена: показать последний снимок и больше не опрашивать.
+    // Объект удаляется вместе с последним окном (сразу, если окон нет)
+    void finish();
+
+private slots:
+    void refresh();
+
+private:
+    void openWindows();
+    QChartView *openWindow(QChartView *view, const QString &title);
+    void updateTitles();
+
+    std::shared_ptr<LiveDistribution> m_live;
+    QWidget *m_parentWindow;
+    RatingDistributionAnalyzer m_analyzer;
+    QTimer *m_timer;
+    bool m_opened = false;
+    int m_openWindows = 0;
+
+    QPointer<QChartView> m_gamesChart;
+    QPointer<QChartView> m_playersChart;
+    QPointer<QChartView> m_skillChart;
+};
+
+#endif // LIVEDISTRIBUTIONVIEW_H
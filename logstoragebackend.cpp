@@ -0,0 +1,777 @@
+#include "logstoragebackend.h"
+#include "databasemanager.h"
+#include "snapshot.h"
+#include "tracer.h"
+#include <QDebug>
+#include <QSaveFile>
+#include <cstring>
+#include <functional>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Записи журнала кодируются как в памяти, без перестановки байтов
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "Log format assumes a little-endian host");
+
+namespace {
+const char LogMagic[8] = {'R', 'S', 'S', 'L', 'O', 'G', '\0', '\0'};
+const quint32 LogFormatVersion = 2; // 2 - записи RatingPoint
+const int LogHeaderSize = 24; // магия, версия, резерв, поколение
+
+// Буфер пакета сбрасывается в файл частями, чтобы длинный пакет не рос в памяти
+const int PendingFlushSize = 4 * 1024 * 1024;
+
+template <typename T>
+void appendPod(QByteArray &out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readPod(const uchar *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+}
+
+LogStorageBackend::LogStorageBackend(const QString &basePath)
+    : m_basePath(basePath)
+{
+}
+
+LogStorageBackend::~LogStorageBackend()
+{
+    if (m_inBatch) {
+        qDebug() << "Warning: log storage closed inside a batch, uncommitted records are discarded";
+    }
+}
+
+void LogStorageBackend::resetState()
+{
+    m_players.clear();
+    m_nicknames.clear();
+    m_playerCount = 0;
+    m_games.clear();
+    m_gameCount = 0;
+    m_participations.clear();
+    m_playerParticipations.clear();
+}
+
+bool LogStorageBackend::open()
+{
+    TRACE_SCOPE("LogStorageBackend::open");
+    m_failed = false;
+    m_log.close();
+    m_pending.clear();
+    m_inBatch = false;
+    resetState();
+
+    quint64 snapshotGeneration = 0;
+    if (QFile::exists(snapshotPath()) && !loadSnapshot(snapshotGeneration)) {
+        return false;
+    }
+
+    m_log.setFileName(logPath());
+    if (!m_log.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open log" << logPath() << ":" << m_log.errorString();
+        return false;
+    }
+
+    quint64 logGeneration = 0;
+    if (m_log.size() >= LogHeaderSize) {
+        QByteArray header = m_log.read(LogHeaderSize);
+        const uchar *data = reinterpret_cast<const uchar*>(header.constData());
+        const quint32 version = readPod<quint32>(data + 8);
+        if (std::memcmp(data, LogMagic, sizeof(LogMagic)) != 0 || version < 1 || version > LogFormatVersion) {
+            qDebug() << "Not a storage log or unsupported version:" << logPath();
+            return false;
+        }
+        logGeneration = readPod<quint64>(data + 16);
+    }
+
+    // Журнал того же или старшего поколения уже вошел в снимок
+    if (logGeneration <= snapshotGeneration) {
+        return startLog(snapshotGeneration + 1);
+    }
+
+    m_generation = logGeneration;
+    qint64 validSize = 0;
+    if (!replayLog(validSize)) {
+        return false;
+    }
+    if (validSize < m_log.size()) {
+        qDebug() << "Discarding" << (m_log.size() - validSize) << "bytes of an unfinished batch in" << logPath();
+        if (!m_log.resize(validSize)) {
+            qDebug() << "Failed to truncate log:" << m_log.errorString();
+            return false;
+        }
+    }
+    return m_log.seek(validSize);
+}
+
+bool LogStorageBackend::loadSnapshot(quint64 &generation)
+{
+    TRACE_SCOPE("LogStorageBackend::loadSnapshot");
+    SnapshotReader reader(snapshotPath());
+    if (!reader.open()) {
+        qDebug() << "Failed to load snapshot:" << reader.errorString();
+        return false;
+    }
+
+    // Колонки ищутся по имени, отсутствующие получают значения по умолчанию
+    auto forEachRow = [&reader](const QByteArray &tableName, const QList<QByteArray> &columnNames,
+                                const std::function<void(const QVector<const SnapshotReader::ColumnView*> &, int)> &handler) {
+        const SnapshotReader::Table *table = reader.table(tableName);
+        if (!table) {
+            return;
+        }
+        QVector<int> indexes;
+        for (const QByteArray &name : columnNames) {
+            indexes.append(table->columnIndex(name));
+        }
+        for (const SnapshotReader::RowGroup &group : table->rowGroups) {
+            QVector<const SnapshotReader::ColumnView*> columns;
+            for (int index : indexes) {
+                columns.append(index >= 0 ? &group.columns[index] : nullptr);
+            }
+            for (int row = 0; row < group.rowCount; ++row) {
+                handler(columns, row);
+            }
+        }
+    };
+    auto intAt = [](const SnapshotReader::ColumnView *column, int row, qint64 defaultValue) {
+        return column ? column->intAt(row) : defaultValue;
+    };
+    auto doubleAt = [](const SnapshotReader::ColumnView *column, int row, double defaultValue) {
+        return column ? column->doubleAt(row) : defaultValue;
+    };
+
+    forEachRow("players", {"player_id", "nickname", "glicko_rating", "rd", "skill_level", "wins", "total_matches"},
+               [&](const QVector<const SnapshotReader::ColumnView*> &c, int row) {
+        const qint32 playerId = static_cast<qint32>(intAt(c[0], row, 0));
+        if (playerId <= 0) {
+            return;
+        }
+        applyAddPlayer(playerId, c[1] ? QString::fromUtf8(c[1]->stringAt(row)) : QString(),
+                       static_cast<qint32>(intAt(c[4], row, 1)), doubleAt(c[2], row, 1000.0));
+        PlayerRow &player = m_players[playerId - 1];
+        player.rd = doubleAt(c[3], row, 350.0);
+        player.wins = static_cast<qint32>(intAt(c[5], row, 0));
+        player.totalMatches = static_cast<qint32>(intAt(c[6], row, 0));
+    });
+
+    forEachRow("games", {"game_id", "game_date", "team1_score", "team2_score", "winner_team"},
+               [&](const QVector<const SnapshotReader::ColumnView*> &c, int row) {
+        applyInsertGame(static_cast<qint32>(intAt(c[0], row, 0)), intAt(c[1], row, 0),
+                        static_cast<qint32>(intAt(c[2], row, 0)), static_cast<qint32>(intAt(c[3], row, 0)),
+                        static_cast<quint8>(intAt(c[4], row, Team1)));
+    });
+
+    forEachRow("game_participation", {"game_id", "player_id", "team", "rating_change"},
+               [&](const QVector<const SnapshotReader::ColumnView*> &c, int row) {
+        applyParticipation(static_cast<qint32>(intAt(c[0], row, 0)), static_cast<qint32>(intAt(c[1], row, 0)),
+                           static_cast<quint8>(intAt(c[2], row, Team1)), doubleAt(c[3], row, 0.0));
+    });
+
+    // Блоки траекторий идут по (player_id, seq); последний блок игрока продолжается
+    forEachRow("rating_history", {"player_id", "point_count", "data"},
+               [&](const QVector<const SnapshotReader::ColumnView*> &c, int row) {
+        const qint32 playerId = static_cast<qint32>(intAt(c[0], row, 0));
+        if (playerId <= 0 || playerId > m_players.size() || !c[2]) {
+            return;
+        }
+        m_players[playerId - 1].history.append({c[2]->stringAt(row), static_cast<qint32>(intAt(c[1], row, 0))});
+    });
+    for (PlayerRow &player : m_players) {
+        if (!player.history.isEmpty()) {
+            player.historyEncoder.reset(player.history.last().data);
+        }
+    }
+
+    // Снимок БД приложения таблицы log_state не содержит - журнал к нему не относится
+    generation = 0;
+    forEachRow("log_state", {"generation"}, [&](const QVector<const SnapshotReader::ColumnView*> &c, int row) {
+        generation = static_cast<quint64>(intAt(c[0], row, 0));
+    });
+    return true;
+}
+
+bool LogStorageBackend::replayLog(qint64 &validSize)
+{
+    TRACE_SCOPE("LogStorageBackend::replayLog");
+    const qint64 size = m_log.size();
+    validSize = LogHeaderSize;
+    if (size == LogHeaderSize) {
+        return true;
+    }
+
+    const uchar *data = m_log.map(0, size);
+    if (!data) {
+        qDebug() << "Failed to map log:" << m_log.errorString();
+        return false;
+    }
+
+    // Первый проход находит конец последнего зафиксированного пакета,
+    // второй применяет записи до него
+    auto parse = [this, data](qint64 begin, qint64 end, bool apply) {
+        qint64 pos = begin;
+        qint64 committedEnd = begin;
+        while (pos < end) {
+            const RecordType type = static_cast<RecordType>(data[pos]);
+            const uchar *p = data + pos + 1;
+            const qint64 available = end - pos - 1;
+            qint64 length = 0;
+            switch (type) {
+            case RecordType::AddPlayer:
+                if (available < 18 || available < 18 + readPod<quint16>(p + 16)) {
+                    return committedEnd;
+                }
+                length = 18 + readPod<quint16>(p + 16);
+                if (apply) {
+                    applyAddPlayer(readPod<qint32>(p), QString::fromUtf8(reinterpret_cast<const char*>(p + 18), readPod<quint16>(p + 16)),
+                                   readPod<qint32>(p + 4), readPod<double>(p + 8));
+                }
+                break;
+            case RecordType::InsertGame:
+                length = 21;
+                if (available < length) {
+                    return committedEnd;
+                }
+                if (apply) {
+                    applyInsertGame(readPod<qint32>(p), readPod<qint64>(p + 4), readPod<qint32>(p + 12),
+                                    readPod<qint32>(p + 16), p[20]);
+                }
+                break;
+            case RecordType::Participation:
+                length = 17;
+                if (available < length) {
+                    return committedEnd;
+                }
+                if (apply) {
+                    applyParticipation(readPod<qint32>(p), readPod<qint32>(p + 4), p[8], readPod<double>(p + 9));
+                }
+                break;
+            case RecordType::GameResult:
+                length = 21;
+                if (available < length) {
+                    return committedEnd;
+                }
+                if (apply) {
+                    applyGameResultRow(readPod<qint32>(p), readPod<double>(p + 4), readPod<double>(p + 12), p[20] != 0);
+                }
+                break;
+            case RecordType::RatingPoint:
+                length = 28;
+                if (available < length) {
+                    return committedEnd;
+                }
+                if (apply) {
+                    applyRatingPoint(readPod<qint32>(p), {readPod<qint64>(p + 4), readPod<double>(p + 12),
+                                                          readPod<double>(p + 20)});
+                }
+                break;
+            case RecordType::Clear:
+                if (apply) {
+                    applyClear();
+                }
+                break;
+            case RecordType::Commit:
+                committedEnd = pos + 1;
+                break;
+            default:
+                // Мусор после оборванной записи
+                return committedEnd;
+            }
+            pos += 1 + length;
+        }
+        return committedEnd;
+    };
+
+    validSize = parse(LogHeaderSize, size, false);
+    parse(LogHeaderSize, validSize, true);
+    m_log.unmap(const_cast<uchar*>(data));
+    return true;
+}
+
+bool LogStorageBackend::startLog(quint64 generation)
+{
+    QByteArray header(LogMagic, sizeof(LogMagic));
+    appendPod<quint32>(header, LogFormatVersion);
+    appendPod<quint32>(header, 0);
+    appendPod<quint64>(header, generation);
+
+    if (!m_log.resize(0) || !m_log.seek(0) || m_log.write(header) != header.size() || !syncLog()) {
+        qDebug() << "Failed to start log" << logPath() << ":" << m_log.errorString();
+        return false;
+    }
+    m_generation = generation;
+    return true;
+}
+
+bool LogStorageBackend::syncLog()
+{
+    if (!m_log.flush()) {
+        return false;
+    }
+#if defined(Q_OS_WIN)
+    return _commit(m_log.handle()) == 0;
+#else
+    return ::fsync(m_log.handle()) == 0;
+#endif
+}
+
+bool LogStorageBackend::flushPending()
+{
+    if (m_pending.isEmpty()) {
+        return true;
+    }
+    if (m_log.write(m_pending) != m_pending.size()) {
+        qDebug() << "Failed to write log" << logPath() << ":" << m_log.errorString();
+        return false;
+    }
+    m_pending.clear();
+    return true;
+}
+
+bool LogStorageBackend::commitPending()
+{
+    appendPod<quint8>(m_pending, static_cast<quint8>(RecordType::Commit));
+    if (!flushPending()) {
+        return false;
+    }
+    if (m_syncOnCommit ? !syncLog() : !m_log.flush()) {
+        qDebug() << "Failed to flush log" << logPath() << ":" << m_log.errorString();
+        return false;
+    }
+
+    if (m_compactThreshold > 0 && m_log.size() > m_compactThreshold) {
+        return compact();
+    }
+    return true;
+}
+
+// Вне пакета каждая запись фиксируется сразу, как в SQLite без транзакции
+bool LogStorageBackend::endWrite()
+{
+    if (m_failed) {
+        qDebug() << "Log storage is unusable after a failed rollback, reopen it";
+        return false;
+    }
+    if (!m_inBatch) {
+        return commitPending();
+    }
+    if (m_pending.size() >= PendingFlushSize) {
+        return flushPending();
+    }
+    return true;
+}
+
+bool LogStorageBackend::beginBatch()
+{
+    if (m_inBatch) {
+        qDebug() << "Log storage batch is already active";
+        return false;
+    }
+    if (m_failed) {
+        qDebug() << "Log storage is unusable after a failed rollback, reopen it";
+        return false;
+    }
+    m_inBatch = true;
+    m_batchStart = m_log.pos();
+    return true;
+}
+
+bool LogStorageBackend::commitBatch()
+{
+    TRACE_SCOPE("LogStorageBackend::commitBatch");
+    if (!m_inBatch) {
+        qDebug() << "No active log storage batch to commit";
+        return false;
+    }
+    m_inBatch = false;
+    return commitPending();
+}
+
+void LogStorageBackend::rollbackBatch()
+{
+    if (!m_inBatch) {
+        return;
+    }
+    // Записи пакета отрезаются от журнала, состояние восстанавливается из файлов
+    m_pending.clear();
+    m_inBatch = false;
+    m_log.flush();
+    if (!m_log.resize(m_batchStart)) {
+        // Не страшно, если журнал перечитается: хвост без маркера фиксации отбрасывается
+        qDebug() << "Failed to truncate log:" << m_log.errorString();
+    }
+    if (!open()) {
+        // Состояние в памяти сброшено, журнал мог остаться закрытым: дальнейшие
+        // записи испортили бы его
+        qDebug() << "Failed to reload log storage after rollback, storage is unusable until reopened";
+        m_failed = true;
+    }
+}
+
+bool LogStorageBackend::compact()
+{
+    TRACE_SCOPE("LogStorageBackend::compact");
+    if (m_inBatch) {
+        qDebug() << "Cannot compact the log inside a batch";
+        return false;
+    }
+    // Состояние в памяти сброшено неудачным откатом: снимок стер бы данные
+    if (m_failed) {
+        qDebug() << "Log storage is unusable after a failed rollback, reopen it";
+        return false;
+    }
+
+    QSaveFile file(snapshotPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open file for writing:" << snapshotPath();
+        return false;
+    }
+
+    SnapshotWriter writer(&file);
+    bool ok = writer.writeHeader(DatabaseManager::latestSchemaVersion(), 5);
+
+    ok = ok && writer.beginTable("players", {
+        {"player_id", SnapshotColumnType::Int32}, {"nickname", SnapshotColumnType::String},
+        {"glicko_rating", SnapshotColumnType::Float64}, {"rd", SnapshotColumnType::Float64},
+        {"skill_level", SnapshotColumnType::Int32}, {"wins", SnapshotColumnType::Int32},
+        {"total_matches", SnapshotColumnType::Int32}});
+    for (int i = 0; ok && i < m_players.size(); ++i) {
+        const PlayerRow &player = m_players[i];
+        if (!player.exists) {
+            continue;
+        }
+        writer.setValue(0, i + 1);
+        writer.setValue(1, player.nickname);
+        writer.setValue(2, player.rating);
+        writer.setValue(3, player.rd);
+        writer.setValue(4, player.skillLevel);
+        writer.setValue(5, player.wins);
+        writer.setValue(6, player.totalMatches);
+        ok = writer.endRow();
+    }
+    ok = ok && writer.endTable();
+
+    ok = ok && writer.beginTable("games", {
+        {"game_id", SnapshotColumnType::Int32}, {"game_date", SnapshotColumnType::Int64},
+        {"team1_score", SnapshotColumnType::Int32}, {"team2_score", SnapshotColumnType::Int32},
+        {"winner_team", SnapshotColumnType::Int32}});
+    for (int i = 0; ok && i < m_games.size(); ++i) {
+        const GameRow &game = m_games[i];
+        if (!game.exists) {
+            continue;
+        }
+        writer.setValue(0, i + 1);
+        writer.setValue(1, game.gameDate);
+        writer.setValue(2, game.team1Score);
+        writer.setValue(3, game.team2Score);
+        writer.setValue(4, static_cast<int>(game.winnerTeam));
+        ok = writer.endRow();
+    }
+    ok = ok && writer.endTable();
+
+    ok = ok && writer.beginTable("game_participation", {
+        {"participation_id", SnapshotColumnType::Int64}, {"game_id", SnapshotColumnType::Int32},
+        {"player_id", SnapshotColumnType::Int32}, {"team", SnapshotColumnType::Int32},
+        {"rating_change", SnapshotColumnType::Float64}});
+    for (qint64 i = 0; ok && i < m_participations.size(); ++i) {
+        const ParticipationRow &participation = m_participations[i];
+        writer.setValue(0, i + 1);
+        writer.setValue(1, participation.gameId);
+        writer.setValue(2, participation.playerId);
+        writer.setValue(3, static_cast<int>(participation.team));
+        writer.setValue(4, participation.ratingChange);
+        ok = writer.endRow();
+    }
+    ok = ok && writer.endTable();
+
+    ok = ok && writer.beginTable("rating_history", {
+        {"player_id", SnapshotColumnType::Int32}, {"seq", SnapshotColumnType::Int32},
+        {"point_count", SnapshotColumnType::Int32}, {"data", SnapshotColumnType::Blob}});
+    for (int i = 0; ok && i < m_players.size(); ++i) {
+        const QVector<HistoryBlock> &history = m_players[i].history;
+        for (int seq = 0; ok && seq < history.size(); ++seq) {
+            writer.setValue(0, i + 1);
+            writer.setValue(1, seq);
+            writer.setValue(2, history[seq].pointCount);
+            writer.setValue(3, history[seq].data);
+            ok = writer.endRow();
+        }
+    }
+    ok = ok && writer.endTable();
+
+    // Поколение журнала, записи которого уже вошли в снимок
+    ok = ok && writer.beginTable("log_state", {{"generation", SnapshotColumnType::Int64}});
+    if (ok) {
+        writer.setValue(0, static_cast<qint64>(m_generation));
+        ok = writer.endRow() && writer.endTable();
+    }
+
+    if (!ok || !file.commit()) {
+        qDebug() << "Failed to write snapshot" << snapshotPath() << ":" << writer.errorString();
+        return false;
+    }
+    return startLog(m_generation + 1);
+}
+
+void LogStorageBackend::applyClear()
+{
+    resetState();
+}
+
+void LogStorageBackend::applyAddPlayer(qint32 playerId, const QString &nickname, qint32 skillLevel, double rating)
+{
+    if (playerId <= 0) {
+        return;
+    }
+    if (playerId > m_players.size()) {
+        m_players.resize(playerId);
+        m_playerParticipations.resize(playerId);
+    }
+    PlayerRow &player = m_players[playerId - 1];
+    player.nickname = nickname;
+    player.rating = rating;
+    player.rd = 350.0;
+    player.skillLevel = skillLevel;
+    player.wins = 0;
+    player.totalMatches = 0;
+    player.history.clear();
+    player.historyEncoder.reset();
+    if (!player.exists) {
+        player.exists = true;
+        ++m_playerCount;
+    }
+    m_nicknames.insert(nickname, playerId);
+}
+
+void LogStorageBackend::applyInsertGame(qint32 gameId, qint64 gameDate, qint32 team1Score, qint32 team2Score, quint8 winnerTeam)
+{
+    if (gameId <= 0) {
+        return;
+    }
+    if (gameId > m_games.size()) {
+        m_games.resize(gameId);
+    }
+    GameRow &game = m_games[gameId - 1];
+    game.gameDate = gameDate;
+    game.team1Score = team1Score;
+    game.team2Score = team2Score;
+    game.winnerTeam = winnerTeam;
+    if (!game.exists) {
+        game.exists = true;
+        ++m_gameCount;
+    }
+}
+
+bool LogStorageBackend::applyParticipation(qint32 gameId, qint32 playerId, quint8 team, double ratingChange)
+{
+    if (playerId <= 0 || playerId > m_players.size() || gameId <= 0 || gameId > m_games.size()) {
+        return false;
+    }
+    m_playerParticipations[playerId - 1].append(static_cast<qint32>(m_participations.size()));
+    m_participations.append({gameId, playerId, team, ratingChange});
+    return true;
+}
+
+bool LogStorageBackend::applyGameResultRow(qint32 playerId, double rating, double rd, bool win)
+{
+    if (playerId <= 0 || playerId > m_players.size() || !m_players[playerId - 1].exists) {
+        return false;
+    }
+    PlayerRow &player = m_players[playerId - 1];
+    player.rating = rating;
+    player.rd = rd;
+    player.totalMatches += 1;
+    player.wins += win ? 1 : 0;
+    return true;
+}
+
+bool LogStorageBackend::applyRatingPoint(qint32 playerId, const RatingPoint &point)
+{
+    if (playerId <= 0 || playerId > m_players.size() || !m_players[playerId - 1].exists) {
+        return false;
+    }
+    PlayerRow &player = m_players[playerId - 1];
+    if (player.history.isEmpty() || player.historyEncoder.isFull()) {
+        player.history.append(HistoryBlock());
+        player.historyEncoder.reset();
+    }
+    HistoryBlock &block = player.history.last();
+    player.historyEncoder.append(point, block.data);
+    block.pointCount = player.historyEncoder.pointCount();
+    return true;
+}
+
+bool LogStorageBackend::clear()
+{
+    appendPod<quint8>(m_pending, static_cast<quint8>(RecordType::Clear));
+    applyClear();
+    if (!endWrite()) {
+        return false;
+    }
+    // Пустое состояние - самый дешевый момент начать журнал заново
+    return m_inBatch || compact();
+}
+
+int LogStorageBackend::addPlayer(const QString &nickname, int skillLevel, double rating)
+{
+    if (m_nicknames.contains(nickname)) {
+        return 0;
+    }
+
+    const QByteArray name = nickname.toUtf8();
+    if (name.size() > 0xFFFF) {
+        qDebug() << "Error creating player: nickname is too long";
+        return -1;
+    }
+
+    const qint32 playerId = static_cast<qint32>(m_players.size() + 1);
+    appendPod<quint8>(m_pending, static_cast<quint8>(RecordType::AddPlayer));
+    appendPod<qint32>(m_pending, playerId);
+    appendPod<qint32>(m_pending, skillLevel);
+    appendPod<double>(m_pending, rating);
+    appendPod<quint16>(m_pending, static_cast<quint16>(name.size()));
+    m_pending.append(name);
+
+    applyAddPlayer(playerId, nickname, skillLevel, rating);
+    return endWrite() ? playerId : -1;
+}
+
+QVector<PlayerData> LogStorageBackend::players()
+{
+    QVector<PlayerData> result;
+    result.reserve(m_playerCount);
+    for (int i = 0; i < m_players.size(); ++i) {
+        PlayerData data;
+        if (player(i + 1, data)) {
+            result.append(data);
+        }
+    }
+    return result;
+}
+
+bool LogStorageBackend::player(int playerId, PlayerData &data)
+{
+    if (playerId <= 0 || playerId > m_players.size() || !m_players[playerId - 1].exists) {
+        return false;
+    }
+    const PlayerRow &row = m_players[playerId - 1];
+    data.playerId = playerId;
+    data.nickname = row.nickname;
+    data.rating = row.rating;
+    data.rd = row.rd;
+    data.skillLevel = row.skillLevel;
+    data.totalMatches = row.totalMatches;
+    data.wins = row.wins;
+    data.winRate = row.totalMatches > 0 ? row.wins * 100.0 / row.totalMatches : 0.0;
+    return true;
+}
+
+bool LogStorageBackend::applyGameResult(int playerId, double rating, double rd, bool win)
+{
+    if (!applyGameResultRow(playerId, rating, rd, win)) {
+        qDebug() << "Error updating rating: unknown player" << playerId;
+        return false;
+    }
+    appendPod<quint8>(m_pending, static_cast<quint8>(RecordType::GameResult));
+    appendPod<qint32>(m_pending, playerId);
+    appendPod<double>(m_pending, rating);
+    appendPod<double>(m_pending, rd);
+    appendPod<quint8>(m_pending, win ? 1 : 0);
+    return endWrite();
+}
+
+int LogStorageBackend::insertGame(const QDateTime &gameDate, int team1Score, int team2Score, TeamSide winnerTeam)
+{
+    const qint32 gameId = static_cast<qint32>(m_games.size() + 1);
+    const qint64 date = gameDate.toSecsSinceEpoch();
+    appendPod<quint8>(m_pending, static_cast<quint8>(RecordType::InsertGame));
+    appendPod<qint32>(m_pending, gameId);
+    appendPod<qint64>(m_pending, date);
+    appendPod<qint32>(m_pending, team1Score);
+    appendPod<qint32>(m_pending, team2Score);
+    appendPod<quint8>(m_pending, static_cast<quint8>(winnerTeam));
+
+    applyInsertGame(gameId, date, team1Score, team2Score, static_cast<quint8>(winnerTeam));
+    return endWrite() ? gameId : -1;
+}
+
+bool LogStorageBackend::addParticipation(int gameId, int playerId, TeamSide team, double ratingChange)
+{
+    if (!applyParticipation(gameId, playerId, static_cast<quint8>(team), ratingChange)) {
+        qDebug() << "Error adding player to game: unknown game" << gameId << "or player" << playerId;
+        return false;
+    }
+    appendPod<quint8>(m_pending, static_cast<quint8>(RecordType::Participation));
+    appendPod<qint32>(m_pending, gameId);
+    appendPod<qint32>(m_pending, playerId);
+    appendPod<quint8>(m_pending, static_cast<quint8>(team));
+    appendPod<double>(m_pending, ratingChange);
+    return endWrite();
+}
+
+QVector<PlayerGameRecord> LogStorageBackend::playerHistory(int playerId)
+{
+    QVector<PlayerGameRecord> result;
+    if (playerId <= 0 || playerId > m_playerParticipations.size()) {
+        return result;
+    }
+
+    // Участия игрока добавлялись в порядке игр - с конца идут новые
+    const QVector<qint32> &indexes = m_playerParticipations[playerId - 1];
+    result.reserve(indexes.size());
+    for (auto it = indexes.crbegin(); it != indexes.crend(); ++it) {
+        const ParticipationRow &participation = m_participations[*it];
+        const GameRow &game = m_games[participation.gameId - 1];
+        PlayerGameRecord record;
+        record.gameId = participation.gameId;
+        record.team1Score = game.team1Score;
+        record.team2Score = game.team2Score;
+        record.gameDate = game.gameDate;
+        record.win = participation.team == game.winnerTeam;
+        record.ratingChange = participation.ratingChange;
+        result.append(record);
+    }
+    return result;
+}
+
+bool LogStorageBackend::appendRatingPoint(int playerId, const RatingPoint &point)
+{
+    if (!applyRatingPoint(playerId, point)) {
+        qDebug() << "Error appending rating history: unknown player" << playerId;
+        return false;
+    }
+    appendPod<quint8>(m_pending, static_cast<quint8>(RecordType::RatingPoint));
+    appendPod<qint32>(m_pending, playerId);
+    appendPod<qint64>(m_pending, point.timestamp);
+    appendPod<double>(m_pending, point.rating);
+    appendPod<double>(m_pending, point.rd);
+    return endWrite();
+}
+
+QVector<RatingPoint> LogStorageBackend::ratingHistory(int playerId)
+{
+    QVector<RatingPoint> points;
+    if (playerId <= 0 || playerId > m_players.size()) {
+        return points;
+    }
+    const QVector<HistoryBlock> &history = m_players[playerId - 1].history;
+    int totalPoints = 0;
+    for (const HistoryBlock &block : history) {
+        totalPoints += block.pointCount;
+    }
+    points.reserve(totalPoints);
+    for (const HistoryBlock &block : history) {
+        RatingHistoryEncoder::decode(block.data, points);
+    }
+    return points;
+}
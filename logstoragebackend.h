@@ -0,0 +1,151 @@
+#ifndef LOGSTORAGEBACKEND_H
+#define LOGSTORAGEBACKEND_H
+
+#include <QFile>
+#include <QHash>
+#include "storagebackend.h"
+
+// Хранилище в памяти с журналом только на дописывание (<base>.log) и
+// сжимающим снимком (<base>.rss, формат snapshot.h с таблицами как в БД приложения).
+//
+// Каждая операция - запись фиксированного формата в буфер; commitBatch дописывает
+// буфер и маркер фиксации в журнал. При открытии загружается снимок и
+// воспроизводится журнал до последнего маркера: хвост незафиксированного пакета
+// (сбой посреди записи) отбрасывается. Когда журнал перерастает порог, состояние
+// пишется в новый снимок, а журнал начинается заново. Поколение журнала в его
+// заголовке и в снимке (таблица log_state) исключает повторное воспроизведение,
+// если сбой произошел между записью снимка и очисткой журнала.
+//
+// Снимок можно загрузить в БД приложения через DatabaseManager::importSnapshot,
+// а снимок БД (exportSnapshot) - открыть этим хранилищем.
+// Объект не потокобезопасен: используется из одного потока.
+class LogStorageBackend : public StorageBackend
+{
+public:
+    static constexpr qint64 DefaultCompactThreshold = 256 * 1024 * 1024;
+
+    explicit LogStorageBackend(const QString &basePath);
+    ~LogStorageBackend() override;
+
+    // Загрузить снимок и журнал; вызывается перед первым использованием
+    bool open();
+    // Состояние не удалось перечитать после отката пакета: записи отклоняются
+    // до успешного open()
+    bool isFailed() const { return m_failed; }
+
+    // Записать состояние в снимок и начать журнал заново (вне пакета)
+    bool compact();
+
+    // Порог размера журнала для автоматического сжатия, 0 - не сжимать
+    void setCompactThreshold(qint64 bytes) { m_compactThreshold = bytes; }
+    // fsync при фиксации пакета. Без него запись быстрее, но при сбое ОС могут
+    // пропасть последние пакеты (журнал при этом остается согласованным)
+    void setSyncOnCommit(bool sync) { m_syncOnCommit = sync; }
+
+    QString logPath() const { return m_basePath + ".log"; }
+    QString snapshotPath() const { return m_basePath + ".rss"; }
+    qint64 gameCount() const { return m_gameCount; }
+    qint64 participationCount() const { return m_participations.size(); }
+
+    bool beginBatch() override;
+    bool commitBatch() override;
+    void rollbackBatch() override;
+
+    bool clear() override;
+
+    int addPlayer(const QString &nickname, int skillLevel, double rating) override;
+    int playerCount() override { return m_playerCount; }
+    QVector<PlayerData> players() override;
+    bool player(int playerId, PlayerData &data) override;
+    bool applyGameResult(int playerId, double rating, double rd, bool win) override;
+
+    int insertGame(const QDateTime &gameDate, int team1Score, int team2Score, TeamSide winnerTeam) override;
+    bool addParticipation(int gameId, int playerId, TeamSide team, double ratingChange) override;
+
+    QVector<PlayerGameRecord> playerHistory(int playerId) override;
+
+    bool appendRatingPoint(int playerId, const RatingPoint &point) override;
+    QVector<RatingPoint> ratingHistory(int playerId) override;
+
+private:
+    enum class RecordType : quint8 {
+        AddPlayer = 1,
+        InsertGame = 2,
+        Participation = 3,
+        GameResult = 4,
+        Clear = 5,
+        Commit = 6,
+        RatingPoint = 7
+    };
+
+    // Блок траектории рейтинга в кодировке rating_history
+    struct HistoryBlock {
+        QByteArray data;
+        qint32 pointCount = 0;
+    };
+
+    // Строки состояния; id = индекс + 1, пропуски (exists = false) возможны
+    // только после загрузки снимка БД с удаленными строками
+    struct PlayerRow {
+        QString nickname;
+        double rating = 1000.0;
+        double rd = 350.0;
+        qint32 skillLevel = 1;
+        qint32 wins = 0;
+        qint32 totalMatches = 0;
+        bool exists = false;
+        QVector<HistoryBlock> history;
+        RatingHistoryEncoder historyEncoder; // продолжает последний блок history
+    };
+
+    struct GameRow {
+        qint64 gameDate = 0;
+        qint32 team1Score = 0;
+        qint32 team2Score = 0;
+        quint8 winnerTeam = 0;
+        bool exists = false;
+    };
+
+    struct ParticipationRow {
+        qint32 gameId;
+        qint32 playerId;
+        quint8 team;
+        double ratingChange;
+    };
+
+    void resetState();
+    bool loadSnapshot(quint64 &generation);
+    bool replayLog(qint64 &validSize);
+    bool startLog(quint64 generation);
+    bool endWrite();
+    bool commitPending();
+    bool flushPending();
+    bool syncLog();
+
+    void applyClear();
+    void applyAddPlayer(qint32 playerId, const QString &nickname, qint32 skillLevel, double rating);
+    void applyInsertGame(qint32 gameId, qint64 gameDate, qint32 team1Score, qint32 team2Score, quint8 winnerTeam);
+    bool applyParticipation(qint32 gameId, qint32 playerId, quint8 team, double ratingChange);
+    bool applyGameResultRow(qint32 playerId, double rating, double rd, bool win);
+    bool applyRatingPoint(qint32 playerId, const RatingPoint &point);
+
+    QString m_basePath;
+    QFile m_log;
+    QByteArray m_pending;
+    quint64 m_generation = 1;
+    qint64 m_compactThreshold = DefaultCompactThreshold;
+    bool m_syncOnCommit = true;
+    bool m_inBatch = false;
+    qint64 m_batchStart = 0;
+    bool m_failed = false;
+
+    QVector<PlayerRow> m_players;
+    QHash<QString, qint32> m_nicknames;
+    int m_playerCount = 0;
+    QVector<GameRow> m_games;
+    qint64 m_gameCount = 0;
+    QVector<ParticipationRow> m_participations;
+    QVector<QVector<qint32>> m_playerParticipations; // индексы в m_participations по игрокам
+};
+
+#endif // LOGSTORAGEBACKEND_H
@@ -1,15 +1,26 @@
 #include "mainwindow.h"
+#include "tracer.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    // RSS_TRACE=<файл.json> включает трассировку; трасса пишется при выходе
+    const QString traceFile = qEnvironmentVariable("RSS_TRACE");
+    Tracer::instance().setEnabled(!traceFile.isEmpty());
+
     MainWindow w;
     w.show();
     a.setOrganizationName("USOGUII");
     a.setOrganizationDomain("STANKIN");
     a.setApplicationName("RatingSystemSimulation");
     a.setApplicationVersion("0.0.3");
-    return a.exec();
+    int result = a.exec();
+
+    if (Tracer::isEnabled()) {
+        Tracer::instance().writeChromeTrace(traceFile);
+    }
+    return result;
 }
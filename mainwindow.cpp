@@ -5,14 +5,43 @@
 #include "gamegeneratorthread.h" // Include the header file for your thread
 #include "gameinfowindow.h"
 #include "importdatabasethread.h"
+#include "analysisthread.h"
+#include "backupthread.h"
+#include "jsonstream.h"
 #include "playerinfowindow.h"
 #include "ratingdistributionanalyzer.h"
+#include "resulttablemodels.h"
+#include "tracer.h"
+#include <QThread>
+#include <limits>
+#include <memory>
+#include <utility>
+
+namespace {
+// Подпись прогресс-диалога: этап, готовые шаги, скорость и оставшееся время
+QString progressText(const ProgressSample &sample)
+{
+    if (sample.total <= 0) {
+        return sample.stage + "...";
+    }
+    QString text = QString("%1: %2 из %3").arg(sample.stage).arg(sample.done).arg(sample.total);
+    if (sample.perSecond > 0.0) {
+        text += QString("\n%1 в секунду").arg(qRound64(sample.perSecond));
+    }
+    if (sample.remainingMs >= 0) {
+        const qint64 seconds = (sample.remainingMs + 999) / 1000;
+        text += QString(", осталось %1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    return text;
+}
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , dbManager("game_stats.db")  // Инициализируем dbManager здесь
     , gameGen(&dbManager)
+    , tableQueries(new TableQueryThread(&dbManager, this))
 {
     ui->setupUi(this);
     setWindowTitle("Симуляция рейтинговой системы");
@@ -22,13 +51,36 @@ MainWindow::MainWindow(QWidget *parent)
     QStringList options = QStringList() << "Список игр" << "Игроки";
     ui->comboBox->addItems(options);
     connect(ui->tableView, &QTableView::doubleClicked, this, &MainWindow::onRowDoubleClicked);
+
+    // Фильтры списка: каждое изменение сразу перезапрашивает первую страницу,
+    // незавершенный запрос прежнего фильтра отменяется
+    ui->skillFilterBox->addItem("Все уровни", 0);
+    for (int level = 1; level <= 4; ++level) {
+        ui->skillFilterBox->addItem(skillLevelName(level), level);
+    }
+    ui->dateFromEdit->setDate(QDate::currentDate().addYears(-1));
+    ui->dateToEdit->setDate(QDate::currentDate());
+    connect(ui->searchEdit, &QLineEdit::textChanged, this, &MainWindow::applyTableFilters);
+    connect(ui->skillFilterBox, &QComboBox::currentIndexChanged, this, &MainWindow::applyTableFilters);
+    connect(ui->dateFilterCheck, &QCheckBox::toggled, this, &MainWindow::applyTableFilters);
+    connect(ui->dateFromEdit, &QDateEdit::dateChanged, this, &MainWindow::applyTableFilters);
+    connect(ui->dateToEdit, &QDateEdit::dateChanged, this, &MainWindow::applyTableFilters);
+    tableQueries->start();
+
+    // Списки обновляются по уведомлениям об изменениях: изменения, пришедшие подряд
+    // (очистка, игроки, игры), применяются к текущей модели одним обновлением
+    dataChangeTimer = new QTimer(this);
+    dataChangeTimer->setSingleShot(true);
+    dataChangeTimer->setInterval(DataChangeDelayMs);
+    connect(&dbManager, &DatabaseManager::dataChanged, this, &MainWindow::onDataChanged);
+    connect(dataChangeTimer, &QTimer::timeout, this, &MainWindow::applyDataChange);
     connect(ui->analyzeButton, &QPushButton::clicked, this, &MainWindow::onAnalyzeRatingDistributionClicked);
     /*
     // Print top 5 players by rating
     QSqlQuery topPlayersQuery(dbManager.database());
-    if (topPlayersQuery.exec("SELECT p.nickname, r.glicko_rating, r.total_matches "
-                             "FROM players p JOIN ratings r ON p.player_id = r.player_id "
-                             "ORDER BY r.glicko_rating DESC LIMIT 5")) {
+    if (topPlayersQuery.exec("SELECT nickname, glicko_rating, total_matches "
+                             "FROM players "
+                             "ORDER BY glicko_rating DESC LIMIT 5")) {
         qDebug() << "Top 5 players by rating:";
         while (topPlayersQuery.next()) {
             QString nickname = topPlayersQuery.value(0).toString();
@@ -41,11 +93,31 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // Потоки и окна ниже используют dbManager. Дочерние объекты удаляет ~QWidget
+    // уже после членов класса, поэтому все они останавливаются здесь, до его разрушения
+    tableQueries->stop();
+    tableQueries->wait();
+    if (ratingAnalysisThread) {
+        ratingAnalysisThread->cancel();
+        ratingAnalysisThread->wait();
+    }
+    // Генерация прерывается между играми; импорт, копия и экспорт доводятся до конца
+    for (QThread *thread : findChildren<QThread *>(Qt::FindDirectChildrenOnly)) {
+        if (GameGeneratorThread *generator = qobject_cast<GameGeneratorThread *>(thread)) {
+            generator->cancel();
+        }
+        thread->wait();
+    }
+    // Окна игроков держат свои потоки запросов, окна игр читают БД при открытии
+    qDeleteAll(findChildren<QDialog *>(Qt::FindDirectChildrenOnly));
     delete ui;
 }
 
 void MainWindow::on_pushButton_2_clicked()
 {
+    if (busy) {
+        return;
+    }
     QDateTime startDate = ui->startDateBox->dateTime();
     QDateTime endDate = ui->endDateBox->dateTime();
 
@@ -67,11 +139,18 @@ void MainWindow::on_pushButton_2_clicked()
     ui->medianRatingLabel->setText("Медиана: ");
     ui->stdDevLabel->setText("Стандартное отклонение: ");
 
-    if (!gameGen.clearDatabase()) {
-        QMessageBox::critical(this, "Ошибка", "Не удалось очистить базу данных!");
-        return;
-    }
+    // Сначала резервная копия (в фоне), затем очистка и генерация
+    backupThen([=]() {
+        if (!gameGen.clearDatabase()) {
+            QMessageBox::critical(this, "Ошибка", "Не удалось очистить базу данных!");
+            return;
+        }
+        startGeneration(startDate, endDate, playersInTeam);
+    });
+}
 
+void MainWindow::startGeneration(const QDateTime &startDate, const QDateTime &endDate, int playersInTeam)
+{
     // Генерация игроков разных уровней навыка
     if (!gameGen.generatePlayersBySkill(
             ui->playerCountBox->value() / 4,  // низкий уровень
@@ -85,66 +164,88 @@ void MainWindow::on_pushButton_2_clicked()
 
     int gameCount = ui->gameCountBox->value();
 
-    // Отключаем кнопку на время генерации
-    ui->pushButton_2->setEnabled(false);
+    // Отключаем кнопки на время генерации: очистка или импорт попали бы между ее пакетами
+    setBusy(true);
 
     // Создаем прогресс-диалог
     QProgressDialog* progressDialog = new QProgressDialog("Идет генерация игр...", "Отмена", 0, gameCount, this);
     progressDialog->setStyleSheet("background-color: #2f2f2f; color: white;");
-    progressDialog->setWindowModality(Qt::WindowModal);
-    progressDialog->setAutoClose(true);
-    progressDialog->setAutoReset(true);
+    // Немодальный: таблицы и окна информации доступны во время генерации,
+    // генератор пишет через собственное соединение
+    progressDialog->setWindowModality(Qt::NonModal);
+    // После игр идут запись и построение индексов: диалог закрывается по finished
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
     progressDialog->setValue(0);
-    progressDialog->setFixedSize(progressDialog->size());
+    progressDialog->setMinimumWidth(360);
     progressDialog->show();
 
     // Создаем и запускаем поток
     GameGeneratorThread* thread = new GameGeneratorThread(&dbManager, gameCount, startDate, endDate, playersInTeam, this);
+    // RSS_STORAGE=log - симуляция в журнале LogStorageBackend, результат загружается в БД в конце
+    thread->setLogStorage(qEnvironmentVariable("RSS_STORAGE") == "log");
 
     // Подключаем сигналы
     connect(thread, &GameGeneratorThread::timeElapsed, this, &MainWindow::showTimeElapsed);
 
-    // При обновлении прогресса обновляем прогресс-диалог
-    connect(thread, &GameGeneratorThread::progressUpdate, progressDialog, &QProgressDialog::setValue);
+    // Опрос прогресса с постоянной частотой: этап, число игр, скорость и ETA.
+    // Этапы без известного числа шагов показываются бегущим индикатором
+    connect(thread, &GameGeneratorThread::progressSampled, progressDialog, [=](const ProgressSample &sample) {
+        const int maximum = static_cast<int>(qMin<qint64>(sample.total, std::numeric_limits<int>::max()));
+        if (progressDialog->maximum() != maximum) {
+            progressDialog->setRange(0, maximum);
+        }
+        if (maximum > 0) {
+            progressDialog->setValue(static_cast<int>(qMin<qint64>(sample.done, maximum)));
+        }
+        progressDialog->setLabelText(thread->isCancelled() ? QString("Отмена генерации...") : progressText(sample));
+    });
+
+    // Анализ во время генерации показывает графики по снимкам генератора
+    liveDistribution = thread->liveDistribution();
 
     // Когда поток завершится, выполняем очистку
     connect(thread, &GameGeneratorThread::finished, this, [=]() {
-        progressDialog->setValue(gameCount); // Показываем 100% завершение
+        finishLiveDistribution();
         progressDialog->close();
         delete progressDialog;  // Важно: освобождаем память диалога
         thread->deleteLater();  // Важно: удаляем поток после его завершения
-        ui->pushButton_2->setEnabled(true); // Включаем кнопку
+        setBusy(false); // Включаем кнопки
+
+        // Последние изменения генерации применяются сразу; список игроков, отсортированный
+        // по изменяемой колонке, перечитывается в точном порядке
+        dataChangeTimer->stop();
+        applyDataChange();
+        if (PlayersTableModel* playersModel = qobject_cast<PlayersTableModel*>(ui->tableView->model())) {
+            playersModel->refreshOrder();
+        }
 
-        // Обновляем интерфейс после генерации
-        int currentIndex = ui->comboBox->currentIndex();
-        ui->comboBox->setCurrentIndex(currentIndex == 0 ? 1 : 0);
-        ui->comboBox->setCurrentIndex(currentIndex);
+        if (!thread->success() && !thread->isCancelled()) {
+            QMessageBox::critical(this, "Ошибка", "Не удалось сгенерировать игры!");
+        }
     });
 
-    // Если пользователь отменяет операцию, останавливаем поток
+    // Отмена кооперативная: генератор откатывает текущий пакет и возвращает
+    // индексы, диалог закрывается по finished
     connect(progressDialog, &QProgressDialog::canceled, thread, [=]() {
-        thread->terminate(); // Можно использовать quit() и wait() для более безопасной остановки
-        thread->deleteLater();
-        ui->pushButton_2->setEnabled(true);
+        thread->cancel();
+        progressDialog->setCancelButton(nullptr);
+        progressDialog->setLabelText("Отмена генерации...");
+        progressDialog->show();
     });
 
     thread->start();  // Запускаем поток
 }
 
-void MainWindow::showTimeElapsed(int msec) {
-    int currentIndex = ui->comboBox->currentIndex();
-    ui->comboBox->setCurrentIndex(1);
-    ui->comboBox->setCurrentIndex(0);
-    ui->comboBox->setCurrentIndex(currentIndex);
-
+void MainWindow::showTimeElapsed(qint64 msec) {
     QDialog *dialog = new QDialog(this);
     dialog->setAttribute(Qt::WA_DeleteOnClose);
     dialog->setFixedSize(300, 150);
     dialog->setStyleSheet("background-color: #2f2f2f; color: white;");
 
-    int minutes = msec / 60000;
-    int seconds = (msec % 60000) / 1000;
-    int milliseconds = msec % 1000;
+    qint64 minutes = msec / 60000;
+    qint64 seconds = (msec % 60000) / 1000;
+    qint64 milliseconds = msec % 1000;
 
     QString timeText = QString("Генерация заняла %1 мин. %2 с. %3 мс").arg(minutes).arg(seconds).arg(milliseconds);
 
@@ -189,10 +290,17 @@ void MainWindow::showTimeElapsed(int msec) {
 }
 
 void MainWindow::on_pushButton_clicked() {
+    if (busy) {
+        return;
+    }
 
+    QString filePath = QFileDialog::getOpenFileName(this, "Выбрать файл базы данных", dbManager.backupDirectory(),
+                                                    "Резервные копии (*.db *.json *.json.gz *.rss)");
+    if (filePath.isEmpty()) {
+        return;
+    }
 
-    QString filePath = QFileDialog::getOpenFileName(this, "Выбрать файл базы данных", "", "JSON-файлы (*.json)");
-    if (!filePath.isEmpty()) {
+    backupThen([=]() {
         if (!gameGen.clearDatabase()) {
             QMessageBox::critical(this, "Ошибка", "Не удалось очистить базу данных!");
             return;
@@ -201,118 +309,317 @@ void MainWindow::on_pushButton_clicked() {
         ui->meanRatingLabel->setText("Средний рейтинг: ");
         ui->medianRatingLabel->setText("Медиана: ");
         ui->stdDevLabel->setText("Стандартное отклонение: ");
+        startImport(filePath);
+    }, filePath);
+}
 
-        QProgressDialog* progressDialog = new QProgressDialog("Импорт базы данных...", "Отмена", 0, 100, this);
-        progressDialog->setStyleSheet("background-color: #2f2f2f; color: white;");
-        progressDialog->setWindowModality(Qt::WindowModal);
-        progressDialog->setAutoClose(true);
-        progressDialog->setAutoReset(true);
-        progressDialog->setValue(0);
-        progressDialog->show();
+void MainWindow::startImport(const QString &filePath)
+{
+    QProgressDialog* progressDialog = new QProgressDialog("Импорт базы данных...", "Отмена", 0, 100, this);
+    progressDialog->setStyleSheet("background-color: #2f2f2f; color: white;");
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setAutoClose(true);
+    progressDialog->setAutoReset(true);
+    progressDialog->setValue(0);
+    progressDialog->show();
+
+    setBusy(true);
 
-        // Создаем поток для импорта базы данных
-        ImportDatabaseThread* thread = new ImportDatabaseThread(&dbManager, filePath, progressDialog, this);
-
-        // Подключаем сигналы
-        connect(thread, &ImportDatabaseThread::progressUpdate, progressDialog, &QProgressDialog::setValue);
-        connect(thread, &ImportDatabaseThread::finished, this, [=]() {
-            progressDialog->setValue(100); // Установить прогресс в 100%
-            progressDialog->close();
-            delete progressDialog; // Удалить прогресс-бар
-            thread->deleteLater(); // Удалить поток
-
-            if (thread->success()) {
-                QMessageBox::information(this, "База данных загружена", "База данных была успешно загружена из JSON.");
-                int currentIndex = ui->comboBox->currentIndex();
-                ui->comboBox->setCurrentIndex(1);
-                ui->comboBox->setCurrentIndex(0);
-                ui->comboBox->setCurrentIndex(currentIndex);
-            } else {
-                QMessageBox::critical(this, "База данных не загружена", "Ошибка при загрузке БД.");
-                int currentIndex = ui->comboBox->currentIndex();
-                ui->comboBox->setCurrentIndex(1);
-                ui->comboBox->setCurrentIndex(0);
-                ui->comboBox->setCurrentIndex(currentIndex);
+    // Создаем поток для импорта базы данных
+    ImportDatabaseThread* thread = new ImportDatabaseThread(&dbManager, filePath, progressDialog, this);
+
+    // Подключаем сигналы
+    connect(thread, &ImportDatabaseThread::progressUpdate, progressDialog, &QProgressDialog::setValue);
+    connect(thread, &ImportDatabaseThread::finished, this, [=]() {
+        progressDialog->setValue(100); // Установить прогресс в 100%
+        progressDialog->close();
+        delete progressDialog; // Удалить прогресс-бар
+        thread->deleteLater(); // Удалить поток
+        setBusy(false);
+
+        if (thread->success()) {
+            QMessageBox::information(this, "База данных загружена", "База данных была успешно загружена из резервной копии.");
+        } else {
+            // Частично загруженные строки удалены; прежние данные - в копии перед импортом
+            QString message = "Ошибка при загрузке БД.";
+            if (!lastBackupPath.isEmpty()) {
+                message += "\nДанные до загрузки сохранены в резервной копии:\n" + lastBackupPath;
             }
-        });
+            QMessageBox::critical(this, "База данных не загружена", message);
+        }
+    });
 
-        thread->start(); // Запустить поток
-    }
+    thread->start(); // Запустить поток
 }
 
+void MainWindow::setBusy(bool value)
+{
+    busy = value;
+    ui->pushButton->setEnabled(!value);
+    ui->pushButton_2->setEnabled(!value);
+}
 
+void MainWindow::backupThen(const std::function<void()> &next, const QString &keepBackup)
+{
+    // next сам отмечает начало своей операции; здесь возвращается прежнее состояние
+    const bool wasBusy = busy;
+    setBusy(true);
 
-void MainWindow::on_comboBox_currentIndexChanged(int index) {
-    QStandardItemModel* model = new QStandardItemModel(this);
-
-    if (index == 0) { // Список игр
-        QVector<QVector<QString>> gamesData = dbManager.getGamesTable();
+    QProgressDialog* progressDialog = new QProgressDialog("Резервное копирование базы данных...", QString(), 0, 100, this);
+    progressDialog->setStyleSheet("background-color: #2f2f2f; color: white;");
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setValue(0);
+    progressDialog->show();
 
-        model->setHorizontalHeaderLabels(QStringList() << "ID игры" << "Дата игры" << "Счёт команды 1" << "Счёт команды 2" << "Победившая команда");
+    BackupThread* thread = new BackupThread(&dbManager, this);
+    thread->setKeepBackup(keepBackup);
+    connect(thread, &BackupThread::progressUpdate, progressDialog, &QProgressDialog::setValue);
+    connect(thread, &BackupThread::finished, this, [=]() {
+        progressDialog->close();
+        delete progressDialog;
+        thread->deleteLater();
+        setBusy(wasBusy);
+        lastBackupPath = thread->success() ? thread->backupPath() : QString();
 
-        for (const auto& row : gamesData) {
-            QList<QStandardItem*> items;
-            for (const QString& value : row) {
-                items.append(new QStandardItem(value));
-            }
-            model->appendRow(items);
+        if (!thread->success()
+            && QMessageBox::question(this, "Ошибка", "Не удалось создать резервную копию. Продолжить без нее?")
+                   != QMessageBox::Yes) {
+            return;
         }
-    } else if (index == 1) { // Игроки
-        QVector<QVector<QString>> playersData = dbManager.getPlayersWithRatings();
+        next();
+    });
+
+    thread->start();
+}
+
+void MainWindow::runExport(const QString &title, const std::function<bool()> &task)
+{
+    // Диапазон 0..0 - бегущий индикатор: объем экспорта заранее не известен
+    QProgressDialog* progressDialog = new QProgressDialog(title, QString(), 0, 0, this);
+    progressDialog->setStyleSheet("background-color: #2f2f2f; color: white;");
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->show();
 
-        model->setHorizontalHeaderLabels(QStringList() << "Никнейм" << "Рейтинг" << "RD" << "Общее количество игр" << "Уровень игры" << "Количество побед" << "Winrate");
+    auto result = std::make_shared<bool>(false);
+    QThread* thread = QThread::create([task, result]() {
+        *result = task();
+    });
+    thread->setParent(this); // Дожидается ~MainWindow вместе с остальными потоками
+    connect(thread, &QThread::finished, this, [=]() {
+        progressDialog->close();
+        delete progressDialog;
+        thread->deleteLater();
 
-        for (const auto& row : playersData) {
-            QList<QStandardItem*> items;
-            for (const QString& value : row) {
-                items.append(new QStandardItem(value));
-            }
-            model->appendRow(items);
+        if (*result) {
+            QMessageBox::information(this, "Экспорт", "Экспорт завершен.");
+        } else {
+            QMessageBox::critical(this, "Экспорт", "Ошибка при экспорте базы данных.");
         }
+    });
+    thread->start();
+}
+
+void MainWindow::on_actionExportJson_triggered()
+{
+    QString filter = JsonStreamWriter::gzipSupported() ? "JSON (*.json);;Сжатый JSON (*.json.gz)" : "JSON (*.json)";
+    QString filePath = QFileDialog::getSaveFileName(this, "Экспорт в JSON", "game_stats.json", filter);
+    if (!filePath.isEmpty()) {
+        runExport("Экспорт в JSON...", [this, filePath]() { return dbManager.exportToJson(filePath); });
     }
+}
+
+void MainWindow::on_actionExportSnapshot_triggered()
+{
+    QString filePath = QFileDialog::getSaveFileName(this, "Экспорт бинарного снимка", "game_stats.rss",
+                                                    "Бинарный снимок (*.rss)");
+    if (!filePath.isEmpty()) {
+        runExport("Экспорт снимка...", [this, filePath]() { return dbManager.exportSnapshot(filePath); });
+    }
+}
+
+
+
+void MainWindow::on_comboBox_currentIndexChanged(int index) {
+    TRACE_SCOPE("refreshTableView");
+    // Строки подгружаются страницами по мере прокрутки, в памяти - ограниченное число страниц.
+    // Сортировка по щелчку на заголовке и фильтры выполняются запросом к БД
+    QAbstractItemModel* model = nullptr;
+    int sortColumn = 0;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+
+    if (index == 0) { // Список игр
+        GamesTableModel* gamesModel = new GamesTableModel(tableQueries, this);
+        sortColumn = gamesModel->query().sortColumn;
+        sortOrder = gamesModel->query().order;
+        connect(gamesModel, &GamesTableModel::firstPageLoaded, this, [this](int rows, qint64 elapsedMs) {
+            statusBar()->showMessage(QString("Игр на первой странице: %1, запрос %2 мс").arg(rows).arg(elapsedMs));
+        });
+        model = gamesModel;
+    } else if (index == 1) { // Игроки
+        PlayersTableModel* playersModel = new PlayersTableModel(tableQueries, this);
+        sortColumn = playersModel->query().sortColumn;
+        sortOrder = playersModel->query().order;
+        connect(playersModel, &PlayersTableModel::firstPageLoaded, this, [this](int rows, qint64 elapsedMs) {
+            statusBar()->showMessage(QString("Игроков на первой странице: %1, запрос %2 мс").arg(rows).arg(elapsedMs));
+        });
+        model = playersModel;
+    }
+
+    // Поиск и уровень навыка относятся к игрокам, период - к играм
+    ui->searchEdit->setVisible(index == 1);
+    ui->skillFilterBox->setVisible(index == 1);
+    ui->dateFilterCheck->setVisible(index == 0);
+    ui->dateFromEdit->setVisible(index == 0);
+    ui->dateToEdit->setVisible(index == 0);
+
+    QAbstractItemModel* previousModel = ui->tableView->model();
+    ui->tableView->setSortingEnabled(false);
     ui->tableView->setModel(model);
+    if (previousModel) {
+        previousModel->deleteLater();
+    }
+    ui->tableView->horizontalHeader()->setSortIndicator(sortColumn, sortOrder);
+    ui->tableView->setSortingEnabled(true);
     ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     ui->tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
     ui->tableView->setSelectionMode(QAbstractItemView::SingleSelection);
     ui->tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    applyTableFilters();
+}
+
+void MainWindow::onDataChanged(quint64 changeCounter, const DataChange &change) {
+    Q_UNUSED(changeCounter);
+    pendingChange.merge(change);
+    if (!dataChangeTimer->isActive()) {
+        dataChangeTimer->start();
+    }
+}
+
+void MainWindow::applyDataChange() {
+    TRACE_SCOPE("applyDataChange");
+    const DataChange change = std::exchange(pendingChange, DataChange());
+    if (GamesTableModel* gamesModel = qobject_cast<GamesTableModel*>(ui->tableView->model())) {
+        gamesModel->applyChange(change);
+    } else if (PlayersTableModel* playersModel = qobject_cast<PlayersTableModel*>(ui->tableView->model())) {
+        playersModel->applyChange(change);
+    }
+}
+
+void MainWindow::applyTableFilters() {
+    if (GamesTableModel* gamesModel = qobject_cast<GamesTableModel*>(ui->tableView->model())) {
+        GamesQuery query = gamesModel->query();
+        if (ui->dateFilterCheck->isChecked()) {
+            query.from = QDateTime(ui->dateFromEdit->date(), QTime(0, 0));
+            query.to = QDateTime(ui->dateToEdit->date(), QTime(23, 59, 59));
+        } else {
+            query.from = QDateTime();
+            query.to = QDateTime();
+        }
+        gamesModel->setQuery(query);
+    } else if (PlayersTableModel* playersModel = qobject_cast<PlayersTableModel*>(ui->tableView->model())) {
+        PlayersQuery query = playersModel->query();
+        query.nickname = ui->searchEdit->text();
+        query.skillLevel = ui->skillFilterBox->currentData().toInt();
+        playersModel->setQuery(query);
+    }
 }
 
 void MainWindow::onRowDoubleClicked(const QModelIndex &index) {
     int currentIndex = ui->comboBox->currentIndex();
 
     if (currentIndex == 0) { // Список игр
-        int gameId = index.sibling(index.row(), 0).data().toInt(); // ID игры в первом столбце
+        int gameId = index.sibling(index.row(), 0).data(Qt::UserRole).toInt(); // ID игры
+        if (gameId <= 0) {
+            return; // страница строки еще загружается
+        }
         GameInfoWindow* gameInfo = new GameInfoWindow(gameId, &dbManager, this); // Pass the dbManager
         gameInfo->show();
     } else if (currentIndex == 1) { // Игроки
-        int playerId = dbManager.getPlayerId(index.sibling(index.row(), 0).data().toString()); // ID игрока по никнейму
+        int playerId = index.sibling(index.row(), 0).data(Qt::UserRole).toInt(); // ID игрока
+        if (playerId <= 0) {
+            return;
+        }
         PlayerInfoWindow* playerInfo = new PlayerInfoWindow(playerId, &dbManager, this);
         playerInfo->show();
     }
 }
 
+void MainWindow::finishLiveDistribution() {
+    // Окна завершенной генерации остаются с последним снимком; Analyze во время
+    // следующей генерации открывает новое представление ее распределения
+    if (liveDistributionView) {
+        liveDistributionView->finish();
+        liveDistributionView = nullptr;
+    }
+    liveDistribution.reset();
+}
+
 void MainWindow::onAnalyzeRatingDistributionClicked() {
-    // Получаем данные через метод DatabaseManager
-    QMap<int, int> ratingData = dbManager.getRatingData();
+    TRACE_SCOPE("analyzeRatingDistribution");
+    // Идет генерация: БД в середине транзакции, графики строятся по снимкам в памяти
+    if (liveDistribution) {
+        if (!liveDistributionView) {
+            liveDistributionView = new LiveDistributionView(liveDistribution, this);
+        }
+        return;
+    }
 
-    if (ratingData.isEmpty()) {
-        QMessageBox::warning(this, "Ошибка", "Нет данных для анализа");
+    // БД не менялась с прошлого анализа - результат показывается сразу
+    if (ratingAnalysis && ratingAnalysis->changeCounter == dbManager.changeCounter()) {
+        showRatingAnalysis(*ratingAnalysis);
+        return;
+    }
+    // Анализ уже идет: повторное нажатие не запускает второй
+    if (ratingAnalysisThread) {
         return;
     }
 
-    // Создаем и настраиваем анализатор
-    RatingDistributionAnalyzer analyzer;
-    for (auto it = ratingData.constBegin(); it != ratingData.constEnd(); ++it) {
-        analyzer.addData(it.key(), it.value());
+    // Данные и статистика считаются в фоне, здесь строятся только графики
+    QProgressDialog* progressDialog = new QProgressDialog("Анализ распределения рейтинга...", "Отмена", 0, 0, this);
+    progressDialog->setStyleSheet("background-color: #2f2f2f; color: white;");
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->show();
+
+    AnalysisThread* thread = new AnalysisThread(&dbManager, this);
+    ratingAnalysisThread = thread;
+    connect(progressDialog, &QProgressDialog::canceled, thread, &AnalysisThread::cancel);
+    connect(thread, &AnalysisThread::finished, this, [=]() {
+        progressDialog->close();
+        delete progressDialog;
+        thread->wait();
+        thread->deleteLater();
+
+        if (thread->isCancelled()) {
+            return;
+        }
+        if (!thread->success()) {
+            QMessageBox::critical(this, "Ошибка", "Ошибка при чтении распределения рейтинга.");
+            return;
+        }
+        ratingAnalysis = std::make_shared<RatingAnalysis>(thread->result());
+        showRatingAnalysis(*ratingAnalysis);
+    });
+    thread->start();
+}
+
+void MainWindow::showRatingAnalysis(const RatingAnalysis &analysis) {
+    TRACE_SCOPE("showRatingAnalysis");
+    if (analysis.distribution.isEmpty()) {
+        QMessageBox::warning(this, "Ошибка", "Нет данных для анализа");
+        return;
     }
 
-    // Получаем статистику
-    QMap<QString, double> stats = analyzer.calculateStatistics();
+    // Анализатор только строит графики по готовому распределению, к БД не обращается
+    RatingDistributionAnalyzer analyzer;
+    analyzer.setSnapshot(analysis.distribution);
 
     // Обновляем UI с статистикой
-    ui->meanRatingLabel->setText("Средний рейтинг: " + QString::number(stats["Средний рейтинг"], 'f', 1));
-    ui->medianRatingLabel->setText("Медиана: " + QString::number(stats["Медиана"], 'f', 1));
-    ui->stdDevLabel->setText("Стандартное отклонение: " + QString::number(stats["Стандартное отклонение"], 'f', 1));
+    const QMap<QString, double> &stats = analysis.statistics;
+    ui->meanRatingLabel->setText("Средний рейтинг: " + QString::number(stats.value("Средний рейтинг"), 'f', 1));
+    // Медиана - по корзинам гистограммы, точнее половины ширины корзины ее не показать
+    ui->medianRatingLabel->setText(QString("Медиана: %1 (±%2)").arg(stats.value("Медиана"), 0, 'f', 0)
+                                       .arg(DatabaseManager::RatingHistogramBinWidth / 2));
+    ui->stdDevLabel->setText("Стандартное отклонение: " + QString::number(stats.value("Стандартное отклонение"), 'f', 1));
 
     // Создаем и отображаем все три графика
 
@@ -346,7 +653,6 @@ void MainWindow::onAnalyzeRatingDistributionClicked() {
         skillChartWindow->show();
     }
 
-    // Анализ справедливости
-    QString analysis = analyzer.analyzeDistributionFairness();
-    ui->analysisTextEdit->setPlainText(analysis);
+    // Анализ справедливости посчитан в фоне
+    ui->analysisTextEdit->setPlainText(analysis.fairness);
 }
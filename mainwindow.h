@@ -4,8 +4,13 @@
 #include <QMainWindow>
 #include "databasemanager.h"
 #include "gamegenerator.h"
+#include "tablequerythread.h"
+#include "livedistributionview.h"
+#include "analysisthread.h"
 #include "QFileDialog"
 #include "QStandardItemModel"
+#include <QTimer>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -23,7 +28,7 @@ public:
 
 private slots:
     void on_pushButton_2_clicked();
-    void showTimeElapsed(int msec);
+    void showTimeElapsed(qint64 msec);
 
     void on_pushButton_clicked();
 
@@ -33,10 +38,53 @@ private slots:
 
     void onAnalyzeRatingDistributionClicked();
 
+    void on_actionExportJson_triggered();
+
+    void on_actionExportSnapshot_triggered();
+
+    // Фильтры списка (поиск, уровень навыка, период) -> запрос текущей модели
+    void applyTableFilters();
+
+    // Уведомление DatabaseManager::dataChanged копится до срабатывания таймера,
+    // затем применяется к модели текущего списка
+    void onDataChanged(quint64 changeCounter, const DataChange &change);
+    void applyDataChange();
+
 private:
+    // Резервная копия в фоне, затем next (при ошибке - по подтверждению пользователя);
+    // keepBackup - копия, которую ротация не удаляет
+    void backupThen(const std::function<void()> &next, const QString &keepBackup = QString());
+    void startGeneration(const QDateTime &startDate, const QDateTime &endDate, int playersInTeam);
+    // Генерация закончилась или отменена: окна графиков больше не обновляются
+    void finishLiveDistribution();
+    void startImport(const QString &filePath);
+    // Статистика в подписях, три окна графиков и текст анализа по готовому результату
+    void showRatingAnalysis(const RatingAnalysis &analysis);
+    void runExport(const QString &title, const std::function<bool()> &task);
+    // Кнопки генерации и загрузки копии отключены, пока идет запись в БД
+    void setBusy(bool value);
+
     Ui::MainWindow *ui;
     DatabaseManager dbManager;
     GameGenerator gameGen;
+    // Страницы списков читаются в этом потоке через его собственное соединение
+    TableQueryThread *tableQueries;
+    // Идет резервное копирование, генерация или импорт: новая операция записи
+    // (очистка, импорт, еще одна генерация) не запускается
+    bool busy = false;
+    // Копия, созданная перед последней очисткой; пусто, если ее создать не удалось
+    QString lastBackupPath;
+    // Снимки распределения идущей генерации (пусто, если генерация не идет) и их окна
+    std::shared_ptr<LiveDistribution> liveDistribution;
+    QPointer<LiveDistributionView> liveDistributionView;
+    // Последний результат анализа распределения (действителен при том же счетчике
+    // изменений БД) и идущий анализ
+    std::shared_ptr<const RatingAnalysis> ratingAnalysis;
+    QPointer<AnalysisThread> ratingAnalysisThread;
+    // Изменения БД, еще не примененные к текущему списку
+    static constexpr int DataChangeDelayMs = 200;
+    DataChange pendingChange;
+    QTimer *dataChangeTimer;
 
 };
 #endif // MAINWINDOW_H
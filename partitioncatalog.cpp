@@ -0,0 +1,138 @@
+#include "partitioncatalog.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+PartitionCatalog::PartitionCatalog(const QString &dbPath)
+{
+    QFileInfo info(dbPath);
+    m_directory = info.absoluteDir().filePath("partitions");
+    m_baseName = info.completeBaseName();
+}
+
+int PartitionCatalog::monthOf(const QDateTime &dateTime)
+{
+    return monthOf(dateTime.date());
+}
+
+int PartitionCatalog::monthOf(const QDate &date)
+{
+    return date.year() * 100 + date.month();
+}
+
+QString PartitionCatalog::schemaName(int month)
+{
+    return QString("p_%1").arg(month);
+}
+
+QString PartitionCatalog::directory() const
+{
+    return m_directory;
+}
+
+QString PartitionCatalog::filePath(int month) const
+{
+    return QDir(m_directory).filePath(QString("%1_%2.db").arg(m_baseName).arg(month));
+}
+
+QString PartitionCatalog::fileNamePattern() const
+{
+    return m_baseName + "_*.db";
+}
+
+bool PartitionCatalog::isEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_enabled;
+}
+
+void PartitionCatalog::reset(bool enabled, const QVector<Partition> &partitions, qint64 nextGameId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_enabled = enabled;
+    m_partitions.clear();
+    for (const Partition &partition : partitions) {
+        m_partitions.insert(partition.month, partition);
+    }
+    m_nextGameId = nextGameId;
+}
+
+QVector<PartitionCatalog::Partition> PartitionCatalog::partitions(bool includeArchived) const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<Partition> result;
+    for (const Partition &partition : m_partitions) {
+        if (includeArchived || !partition.archived) {
+            result.append(partition);
+        }
+    }
+    return result;
+}
+
+bool PartitionCatalog::isActive(int month) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_partitions.constFind(month);
+    return it != m_partitions.constEnd() && !it->archived;
+}
+
+bool PartitionCatalog::isArchived(int month) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_partitions.constFind(month);
+    return it != m_partitions.constEnd() && it->archived;
+}
+
+QVector<int> PartitionCatalog::monthsForGame(qint64 gameId) const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<int> months;
+    // С конца: генератор и просмотр чаще всего обращаются к последним играм
+    for (auto it = m_partitions.constEnd(); it != m_partitions.constBegin();) {
+        --it;
+        if (!it->archived && gameId >= it->minGameId && gameId <= it->maxGameId) {
+            months.append(it->month);
+        }
+    }
+    return months;
+}
+
+qint64 PartitionCatalog::allocateGameId()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_nextGameId++;
+}
+
+void PartitionCatalog::recordGame(int month, qint64 gameId)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_partitions.find(month);
+    if (it == m_partitions.end()) {
+        Partition partition;
+        partition.month = month;
+        partition.minGameId = gameId;
+        partition.maxGameId = gameId;
+        partition.gameCount = 1;
+        m_partitions.insert(month, partition);
+    } else {
+        it->minGameId = qMin(it->minGameId, gameId);
+        it->maxGameId = qMax(it->maxGameId, gameId);
+        ++it->gameCount;
+    }
+    m_nextGameId = qMax(m_nextGameId, gameId + 1);
+}
+
+void PartitionCatalog::remove(int month)
+{
+    QMutexLocker locker(&m_mutex);
+    m_partitions.remove(month);
+}
+
+void PartitionCatalog::setArchived(int month)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_partitions.find(month);
+    if (it != m_partitions.end()) {
+        it->archived = true;
+    }
+}
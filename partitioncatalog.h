@@ -0,0 +1,68 @@
+#ifndef PARTITIONCATALOG_H
+#define PARTITIONCATALOG_H
+
+#include <QDateTime>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Каталог помесячных разделов истории игр. Таблицы games и game_participation
+// каждого месяца лежат в отдельном файле partitions/<имя БД>_ГГГГММ.db рядом с
+// основной БД и подключаются к соединению (ATTACH) по требованию как p_ГГГГММ.
+// Постоянная копия каталога - таблица game_partitions основной БД; здесь ее образ
+// в памяти, общий для всех потоков: по нему запросы направляются в нужные разделы.
+// game_id назначается каталогом и уникален во всех разделах.
+class PartitionCatalog
+{
+public:
+    struct Partition {
+        int month = 0;         // ГГГГММ
+        qint64 minGameId = 0;
+        qint64 maxGameId = 0;
+        qint64 gameCount = 0;
+        bool archived = false; // файл перенесен в архив и в запросах не участвует
+    };
+
+    explicit PartitionCatalog(const QString &dbPath);
+
+    // Месяц раздела для даты игры (по локальному времени, как она показывается)
+    static int monthOf(const QDateTime &dateTime);
+    static int monthOf(const QDate &date);
+    // Имя схемы подключенного раздела: p_ГГГГММ
+    static QString schemaName(int month);
+
+    QString directory() const;
+    QString filePath(int month) const;
+    // Имена файлов разделов в directory(): <имя БД>_*.db
+    QString fileNamePattern() const;
+
+    bool isEnabled() const;
+    // Заменить содержимое каталога (при открытии БД и включении/выключении разделов)
+    void reset(bool enabled, const QVector<Partition> &partitions, qint64 nextGameId);
+
+    // Разделы по возрастанию месяца
+    QVector<Partition> partitions(bool includeArchived = false) const;
+    bool isActive(int month) const;
+    bool isArchived(int month) const;
+
+    // Активные разделы, в диапазон game_id которых попадает gameId. Обычно один:
+    // игры пишутся в порядке дат, поэтому диапазоны месяцев не пересекаются
+    QVector<int> monthsForGame(qint64 gameId) const;
+
+    qint64 allocateGameId();
+    void recordGame(int month, qint64 gameId);
+    void remove(int month);
+    void setArchived(int month);
+
+private:
+    QString m_directory;
+    QString m_baseName;
+
+    mutable QMutex m_mutex;
+    bool m_enabled = false;
+    QMap<int, Partition> m_partitions;
+    qint64 m_nextGameId = 1;
+};
+
+#endif // PARTITIONCATALOG_H
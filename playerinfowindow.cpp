@@ -1,117 +1,123 @@
 #include "playerinfowindow.h"
 #include "gameinfowindow.h"
-#include "qstandarditemmodel.h"
+#include "resulttablemodels.h"
+#include "tablequerythread.h"
+#include <QDateTimeAxis>
+#include <QLineSeries>
+#include <QValueAxis>
 
 PlayerInfoWindow::PlayerInfoWindow(int playerId, DatabaseManager* dbManager, QWidget *parent)
-    : QDialog(parent), ui(new Ui::PlayerInfoWindow), playerId(playerId), dbManager(dbManager) {
+    : QDialog(parent), ui(new Ui::PlayerInfoWindow), playerId(playerId), dbManager(dbManager),
+    queries(new TableQueryThread(dbManager, this)), ratingChartView(new QChartView(this)) {
     ui->setupUi(this);
     setWindowTitle("Информация об игроке");
+
+    // График рейтинга под таблицей истории, поровну по высоте
+    ratingChartView->setRenderHint(QPainter::Antialiasing);
+    ui->gridLayout->addWidget(ratingChartView, 2, 0, 1, 4);
+    ui->gridLayout->setRowStretch(1, 1);
+    ui->gridLayout->setRowStretch(2, 1);
+
+    // Карточка - одна строка по ключу; история и траектория - в потоке запросов
     loadPlayerInfo();
+    queries->start();
     loadGameHistory();
+    loadRatingChart();
 
     // Подключаем сигнал для двойного клика на строку
     connect(ui->tableView, &QTableView::doubleClicked, this, &PlayerInfoWindow::onRowDoubleClicked);
 }
 
 PlayerInfoWindow::~PlayerInfoWindow() {
+    // Поток использует dbManager - останавливается до закрытия окна
+    queries->stop();
+    queries->wait();
     delete ui;
 }
 
 void PlayerInfoWindow::loadPlayerInfo() {
-    QSqlDatabase db = dbManager->database();
-    QSqlQuery query(db);
-
-    query.prepare("SELECT p.nickname, r.glicko_rating, r.rd, p.win_rate FROM players p JOIN ratings r ON p.player_id = r.player_id WHERE p.player_id = :playerId");
-    query.bindValue(":playerId", playerId);
-
-    if (!query.exec()) {
-        qDebug() << "Error retrieving player info:" << query.lastError().text() << "Query:" << query.lastQuery();
+    PlayerData player;
+    if (!dbManager->getPlayer(playerId, player)) {
         return;
     }
 
-    if (query.next()) {
-        QString nickname = query.value(0).toString();
-        int rating = qRound(query.value(1).toDouble()); // Округляем до целого
-        int rd = qRound(query.value(2).toDouble());     // Округляем до целого
-        QString winrate = QString::number(query.value(3).toDouble(), 'f', 1) + "%"; // Процент побед
-
-        ui->playerLabel->setText(nickname);
-        ui->rdLabel_2->setText("Рейтинг: " + QString::number(rating));
-        ui->raitingLabel->setText("RD: " + QString::number(rd));
-        ui->winrateLabel->setText("Winrate: " + winrate);
-    } else {
-        qDebug() << "Player not found with ID:" << playerId;
-    }
+    int rating = qRound(player.rating); // Округляем до целого
+    int rd = qRound(player.rd);         // Округляем до целого
+    QString winrate = QString::number(player.winRate, 'f', 1) + "%"; // Процент побед
+
+    ui->playerLabel->setText(player.nickname);
+    ui->rdLabel_2->setText("Рейтинг: " + QString::number(rating));
+    ui->raitingLabel->setText("RD: " + QString::number(rd));
+    ui->winrateLabel->setText("Winrate: " + winrate);
 }
 
 
 
 void PlayerInfoWindow::loadGameHistory() {
-    QSqlDatabase db = dbManager->database();
-    QSqlQuery query(db);
-
-    query.prepare("SELECT gp.game_id, g.team1_score, g.team2_score, g.game_date, "
-                  "CASE WHEN gp.team = g.winner_team THEN 'Победа' ELSE 'Поражение' END AS result, "
-                  "gp.rating_change " // Добавляем изменение рейтинга
-                  "FROM game_participation gp "
-                  "JOIN games g ON gp.game_id = g.game_id "
-                  "WHERE gp.player_id = :playerId "
-                  "ORDER BY gp.game_id DESC"); // Сортировка по ID игры по убыванию
-    query.bindValue(":playerId", playerId);
-
-    if (!query.exec()) {
-        qDebug() << "Error retrieving game history:" << query.lastError().text();
+    // История подгружается страницами по мере прокрутки, новые игры первыми
+    PlayerHistoryModel *model = new PlayerHistoryModel(playerId, queries, this);
+    ui->tableView->setModel(model);
+    ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+}
+
+void PlayerInfoWindow::loadRatingChart() {
+    QChart *chart = new QChart();
+    chart->setTitle("Рейтинг по времени");
+    chart->legend()->hide();
+    ratingChartView->setChart(chart);
+
+    connect(queries, &TableQueryThread::ratingHistoryReady, this, &PlayerInfoWindow::onRatingHistoryReady);
+    // То же поколение, что и у модели истории: новое поколение отменило бы ее запрос
+    queries->requestRatingHistory(queries->currentGeneration(), playerId, MaxChartPoints);
+}
+
+void PlayerInfoWindow::onRatingHistoryReady(quint64 generation, const QVector<RatingPoint> &points, int totalPoints,
+                                            qint64 elapsedMs) {
+    Q_UNUSED(generation);
+    Q_UNUSED(elapsedMs);
+    if (points.isEmpty()) {
         return;
     }
 
-    QStandardItemModel* model = new QStandardItemModel(0, 6, this);
-    model->setHorizontalHeaderLabels(QStringList()
-                                     << "ID игры"
-                                     << "Счет команды 1"
-                                     << "Счет команды 2"
-                                     << "Дата игры"
-                                     << "Результат"
-                                     << "Δ Рейтинга"); // Новый заголовок
-
-    while (query.next()) {
-        QList<QStandardItem*> items;
-        // Основные данные
-        items << new QStandardItem(query.value(0).toString())
-              << new QStandardItem(query.value(1).toString())
-              << new QStandardItem(query.value(2).toString())
-              << new QStandardItem(query.value(3).toDateTime().toString("dd.MM.yyyy HH:mm"));
-
-        // Результат с цветовым оформлением
-        QStandardItem* resultItem = new QStandardItem(query.value(4).toString());
-        resultItem->setForeground(query.value(4).toString() == "Победа"
-                                      ? QBrush(Qt::darkGreen)
-                                      : QBrush(Qt::red));
-
-        // Изменение рейтинга с форматированием
-        double ratingChange = query.value(5).toDouble();
-        QStandardItem* changeItem = new QStandardItem();
-        changeItem->setData(ratingChange, Qt::DisplayRole);
-        changeItem->setText(QString("%1%2")
-                                .arg(ratingChange > 0 ? "+" : "")
-                                .arg(ratingChange, 0, 'f', 1));
-
-        changeItem->setForeground(ratingChange >= 0
-                                      ? QBrush(Qt::darkGreen)
-                                      : QBrush(Qt::red));
-
-        items << resultItem << changeItem;
-        model->appendRow(items);
+    QList<QPointF> seriesPoints;
+    seriesPoints.reserve(points.size());
+    double minRating = points.first().rating;
+    double maxRating = minRating;
+    for (const RatingPoint &point : points) {
+        seriesPoints.append(QPointF(point.timestamp * 1000.0, point.rating));
+        minRating = qMin(minRating, point.rating);
+        maxRating = qMax(maxRating, point.rating);
     }
 
-    ui->tableView->setModel(model);
-    ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    ui->tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
-}
+    QLineSeries *series = new QLineSeries();
+    series->replace(seriesPoints);
 
+    QChart *chart = ratingChartView->chart();
+    chart->addSeries(series);
+    if (totalPoints > points.size()) {
+        chart->setTitle(QString("Рейтинг по времени (%1 из %2 точек)").arg(points.size()).arg(totalPoints));
+    }
 
+    QDateTimeAxis *axisX = new QDateTimeAxis();
+    axisX->setFormat("dd.MM.yyyy");
+    axisX->setRange(QDateTime::fromSecsSinceEpoch(points.first().timestamp),
+                    QDateTime::fromSecsSinceEpoch(points.last().timestamp));
+    chart->addAxis(axisX, Qt::AlignBottom);
+    series->attachAxis(axisX);
+
+    QValueAxis *axisY = new QValueAxis();
+    axisY->setTitleText("Рейтинг");
+    axisY->setRange(minRating - 20, maxRating + 20);
+    chart->addAxis(axisY, Qt::AlignLeft);
+    series->attachAxis(axisY);
+}
 
 void PlayerInfoWindow::onRowDoubleClicked(const QModelIndex &index) {
-    int gameId = index.sibling(index.row(), 0).data().toInt();
+    int gameId = index.data(Qt::UserRole).toInt();
+    if (gameId <= 0) {
+        return;
+    }
     GameInfoWindow* gameInfo = new GameInfoWindow(gameId, dbManager, this);
     gameInfo->show();
 }
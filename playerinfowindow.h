@@ -6,12 +6,18 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlRecord>
+#include <QChartView>
 #include "databasemanager.h"
 
+class TableQueryThread;
+
 class PlayerInfoWindow : public QDialog {
     Q_OBJECT
 
 public:
+    // Точек графика рейтинга после прореживания - порядка ширины графика в пикселях
+    static constexpr int MaxChartPoints = 800;
+
     explicit PlayerInfoWindow(int playerId, DatabaseManager* dbManager, QWidget *parent = nullptr);
     ~PlayerInfoWindow();
 
@@ -19,12 +25,17 @@ private:
     Ui::PlayerInfoWindow *ui;
     int playerId;
     DatabaseManager* dbManager;
+    // История и траектория читаются в этом потоке, окно открывается без ожидания БД
+    TableQueryThread *queries;
+    QChartView *ratingChartView;
 
     void loadPlayerInfo();
     void loadGameHistory();
+    void loadRatingChart();
 
 private slots:
     void onRowDoubleClicked(const QModelIndex &index);
+    void onRatingHistoryReady(quint64 generation, const QVector<RatingPoint> &points, int totalPoints, qint64 elapsedMs);
 };
 
 #endif // PLAYERINFOWINDOW_H
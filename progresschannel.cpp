@@ -0,0 +1,53 @@
+// progresschannel.cpp
+#include "progresschannel.h"
+
+namespace {
+// Постоянная времени сглаживания скорости: скачки отдельных кадров не видны в ETA
+constexpr double RateSmoothingMs = 1000.0;
+}
+
+void ProgressChannel::beginStage(const char *stage, qint64 total) {
+    m_total.store(total, std::memory_order_relaxed);
+    m_done.store(0, std::memory_order_relaxed);
+    m_stage.store(stage, std::memory_order_relaxed);
+    m_stageIndex.fetch_add(1, std::memory_order_release);
+}
+
+QString ProgressChannel::stage() const {
+    return QString::fromUtf8(m_stage.load(std::memory_order_relaxed));
+}
+
+ProgressMeter::ProgressMeter(const ProgressChannel *channel)
+    : m_channel(channel) {}
+
+ProgressSample ProgressMeter::sample(qint64 nowMs) {
+    ProgressSample result;
+    const int stageIndex = m_channel->stageIndex();
+    result.stage = m_channel->stage();
+    result.done = m_channel->done();
+    result.total = m_channel->total();
+
+    // Новый этап: скорость считается заново
+    if (stageIndex != m_stageIndex) {
+        m_stageIndex = stageIndex;
+        m_lastDone = result.done;
+        m_lastMs = nowMs;
+        m_rate = 0.0;
+        return result;
+    }
+
+    const qint64 elapsedMs = nowMs - m_lastMs;
+    if (elapsedMs > 0 && result.done >= m_lastDone) {
+        const double instant = (result.done - m_lastDone) * 1000.0 / elapsedMs;
+        const double alpha = elapsedMs / (elapsedMs + RateSmoothingMs);
+        m_rate = m_rate > 0.0 ? m_rate + alpha * (instant - m_rate) : instant;
+        m_lastDone = result.done;
+        m_lastMs = nowMs;
+    }
+
+    result.perSecond = m_rate;
+    if (result.total > 0 && m_rate > 0.0) {
+        result.remainingMs = static_cast<qint64>(qMax<qint64>(0, result.total - result.done) * 1000.0 / m_rate);
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+// progresschannel.h
+#ifndef PROGRESSCHANNEL_H
+#define PROGRESSCHANNEL_H
+
+#include <QString>
+#include <atomic>
+
+// Канал прогресса долгой операции. Рабочий поток только записывает счетчик и этап
+// в атомарные переменные, без сигналов и событий; GUI опрашивает канал таймером с
+// постоянной частотой (SampleIntervalMs). Стоимость отчета для GUI не зависит от
+// числа шагов: очередь событий получает не больше одного обновления за кадр.
+// В обратную сторону канал передает запрос отмены: рабочий поток проверяет его
+// между шагами и сам откатывает незавершенную работу.
+class ProgressChannel {
+public:
+    static constexpr int SampleIntervalMs = 50;
+
+    // Новый этап: имя (строковый литерал UTF-8) и число шагов, 0 - число неизвестно
+    void beginStage(const char *stage, qint64 total = 0);
+    // Выполнено шагов текущего этапа; пишет один поток
+    void setDone(qint64 done) { m_done.store(done, std::memory_order_relaxed); }
+
+    // Номер этапа меняется при каждом beginStage
+    int stageIndex() const { return m_stageIndex.load(std::memory_order_acquire); }
+    QString stage() const;
+    qint64 done() const { return m_done.load(std::memory_order_relaxed); }
+    qint64 total() const { return m_total.load(std::memory_order_relaxed); }
+
+    // Запрос отмены из GUI; рабочий поток опрашивает его между шагами
+    void requestCancel() { m_cancelRequested.store(true, std::memory_order_relaxed); }
+    bool isCancelRequested() const { return m_cancelRequested.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<const char *> m_stage{""};
+    std::atomic<int> m_stageIndex{0};
+    std::atomic<qint64> m_done{0};
+    std::atomic<qint64> m_total{0};
+    std::atomic<bool> m_cancelRequested{false};
+};
+
+// Состояние канала в момент опроса со скоростью и оценкой оставшегося времени
+struct ProgressSample {
+    QString stage;
+    qint64 done = 0;
+    qint64 total = 0;        // 0 - число шагов неизвестно
+    double perSecond = 0.0;  // шагов в секунду, сглаженно
+    qint64 remainingMs = -1; // -1 - оценки еще нет
+};
+
+// Оценка скорости по последовательным опросам одного канала (поток GUI)
+class ProgressMeter {
+public:
+    explicit ProgressMeter(const ProgressChannel *channel);
+
+    // Опрос канала; nowMs - монотонное время опроса
+    ProgressSample sample(qint64 nowMs);
+
+private:
+    const ProgressChannel *m_channel;
+    int m_stageIndex = -1;
+    qint64 m_lastDone = 0;
+    qint64 m_lastMs = 0;
+    double m_rate = 0.0;
+};
+
+#endif // PROGRESSCHANNEL_H
@@ -1,4 +1,4 @@
-#include "RatingDistributionAnalyzer.h"
+#include "ratingdistributionanalyzer.h"
 
 #include <QtMath>
 #include <QDebug>
@@ -11,93 +11,77 @@
 #include <QLineSeries>
 #include <QScatterSeries>
 #include <QMainWindow>
-#include <algorithm>
+#include "tracer.h"
+#include "databasemanager.h"
 
 RatingDistributionAnalyzer::RatingDistributionAnalyzer(QObject *parent) : QObject(parent) {}
 
+void RatingDistributionAnalyzer::setDatabase(const QSqlDatabase &db) {
+    m_db = db;
+}
+
 void RatingDistributionAnalyzer::setDataFromTable(QTableWidget *table) {
-    m_ratingData.clear();
+    clearData();
     // Предполагаем, что в первом столбце рейтинг, во втором - количество игр
     for (int row = 0; row < table->rowCount(); ++row) {
         if (table->item(row, 0) && table->item(row, 1)) {
             int rating = table->item(row, 0)->text().toInt();
-            int games = table->item(row, 1)->text().toInt();
-            m_ratingData[rating] = games;
+            qint64 games = table->item(row, 1)->text().toLongLong();
+            addData(rating, games);
         }
     }
 }
 
-void RatingDistributionAnalyzer::addData(int rating, int gamesCount) {
-    m_ratingData[rating] = gamesCount;
+void RatingDistributionAnalyzer::addData(int rating, qint64 gamesCount) {
+    m_data.add(rating, gamesCount);
+    m_statsValid = false;
 }
 
-void RatingDistributionAnalyzer::clearData() {
-    m_ratingData.clear();
+void RatingDistributionAnalyzer::addData(const RatingAccumulator &partial) {
+    m_data.merge(partial);
+    m_statsValid = false;
 }
 
-QMap<QString, double> RatingDistributionAnalyzer::calculateStatistics() {
-    QMap<QString, double> stats;
-    if (m_ratingData.isEmpty()) {
-        qWarning() << "Нет данных для анализа";
-        return stats;
-    }
-
-    // Вычислить среднее значение рейтинга, взвешенное по количеству игр
-    double totalRatingPoints = 0;
-    int totalGames = 0;
-    for (auto it = m_ratingData.constBegin(); it != m_ratingData.constEnd(); ++it) {
-        totalRatingPoints += it.key() * it.value();
-        totalGames += it.value();
-    }
-
-    double meanRating = totalRatingPoints / totalGames;
-    stats["Средний рейтинг"] = meanRating;
-
-    // Вычислить стандартное отклонение
-    double variance = 0;
-    for (auto it = m_ratingData.constBegin(); it != m_ratingData.constEnd(); ++it) {
-        variance += pow(it.key() - meanRating, 2) * it.value();
-    }
-
-    variance /= totalGames;
-    double stdDeviation = qSqrt(variance);
-    stats["Стандартное отклонение"] = stdDeviation;
+void RatingDistributionAnalyzer::clearData() {
+    m_data = RatingAccumulator();
+    m_exactMoments = RatingMoments();
+    m_statsValid = false;
+}
 
-    // Вычислить медиану рейтинга
-    QVector<int> allRatings;
-    for (auto it = m_ratingData.constBegin(); it != m_ratingData.constEnd(); ++it) {
-        for (int i = 0; i < it.value(); ++i) {
-            allRatings.append(it.key());
+void RatingDistributionAnalyzer::setSnapshot(const DistributionSnapshot &snapshot) {
+    // Рейтинг -> количество игр по корзинам, как в DatabaseManager::getRatingData
+    clearData();
+    for (int i = 0; i < snapshot.binGames.size(); ++i) {
+        if (snapshot.binPlayers[i] > 0) {
+            int ratingFrom = (snapshot.firstBin + i) * DatabaseManager::RatingHistogramBinWidth;
+            addData(ratingFrom + DatabaseManager::RatingHistogramBinWidth / 2, snapshot.binGames[i]);
         }
     }
+    // Среднее и моменты - точные из снимка; по корзинам остается только медиана
+    m_exactMoments = snapshot.moments;
+    m_snapshot = snapshot;
+    m_fromSnapshot = true;
+}
 
-    std::sort(allRatings.begin(), allRatings.end());
-    int medianIndex = allRatings.size() / 2;
-    if (allRatings.size() % 2 == 0 && allRatings.size() > 0) {
-        stats["Медиана"] = (allRatings[medianIndex - 1] + allRatings[medianIndex]) / 2.0;
-    } else if (allRatings.size() > 0) {
-        stats["Медиана"] = allRatings[medianIndex];
-    }
-
-    // Вычислить асимметрию (skewness)
-    double skewness = 0;
-    for (auto it = m_ratingData.constBegin(); it != m_ratingData.constEnd(); ++it) {
-        skewness += pow((it.key() - meanRating) / stdDeviation, 3) * it.value();
+QMap<QString, double> RatingDistributionAnalyzer::calculateStatistics() {
+    TRACE_SCOPE("calculateStatistics");
+    if (m_data.count() <= 0) {
+        qWarning() << "Нет данных для анализа";
+        return QMap<QString, double>();
     }
-
-    skewness /= totalGames;
-    stats["Асимметрия"] = skewness;
-
-    // Вычислить эксцесс (kurtosis)
-    double kurtosis = 0;
-    for (auto it = m_ratingData.constBegin(); it != m_ratingData.constEnd(); ++it) {
-        kurtosis += pow((it.key() - meanRating) / stdDeviation, 4) * it.value();
+    // Моменты накоплены при добавлении данных, медиана - по накопленным весам;
+    // результат хранится до следующего изменения данных
+    if (!m_statsValid) {
+        const RatingMoments &moments = m_exactMoments.isEmpty() ? m_data.moments() : m_exactMoments;
+        m_stats.clear();
+        m_stats["Средний рейтинг"] = moments.mean;
+        m_stats["Стандартное отклонение"] = moments.stdDeviation();
+        m_stats["Медиана"] = m_data.median();
+        m_stats["Асимметрия"] = moments.skewness();
+        m_stats["Эксцесс"] = moments.kurtosis(); // Excess kurtosis (нормальное распределение = 0)
+        m_statsValid = true;
     }
-
-    kurtosis = kurtosis / totalGames - 3; // Excess kurtosis (нормальное распределение = 0)
-    stats["Эксцесс"] = kurtosis;
-
-    return stats;
+    return m_stats;
 }
 
 double RatingDistributionAnalyzer::checkNormalDistribution() {
@@ -117,95 +101,155 @@ double RatingDistributionAnalyzer::checkNormalDistribution() {
 QChartView* RatingDistributionAnalyzer::createDistributionChart() {
     // Создаем серию для гистограммы
     QBarSeries *series = new QBarSeries();
+
+    // Создаем график
+    QChart *chart = new QChart();
+    chart->addSeries(series);
+    chart->setTitle("Распределение рейтинга по количеству игр");
+    chart->setAnimationOptions(QChart::SeriesAnimations);
+
+    // Настраиваем ось X (рейтинг)
+    QBarCategoryAxis *axisX = new QBarCategoryAxis();
+    axisX->setTitleText("Рейтинг");
+    chart->addAxis(axisX, Qt::AlignBottom);
+    series->attachAxis(axisX);
+
+    // Настраиваем ось Y (количество игр)
+    QValueAxis *axisY = new QValueAxis();
+    axisY->setTitleText("Количество игр");
+    chart->addAxis(axisY, Qt::AlignLeft);
+    series->attachAxis(axisY);
+
+    // Настраиваем легенду
+    chart->legend()->setVisible(true);
+    chart->legend()->setAlignment(Qt::AlignBottom);
+
+    // Создаем представление графика
+    QChartView *chartView = new QChartView(chart);
+    chartView->setRenderHint(QPainter::Antialiasing);
+
+    updateDistributionChart(chartView);
+    return chartView;
+}
+
+void RatingDistributionAnalyzer::updateDistributionChart(QChartView *view) {
+    QChart *chart = view->chart();
+    auto *series = qobject_cast<QBarSeries *>(chart->series().value(0));
+    auto *axisX = qobject_cast<QBarCategoryAxis *>(chart->axes(Qt::Horizontal).value(0));
+    auto *axisY = qobject_cast<QValueAxis *>(chart->axes(Qt::Vertical).value(0));
+    if (!series || !axisX || !axisY) {
+        return;
+    }
+
     QBarSet *ratingSet = new QBarSet("Количество игр");
     QStringList categories;
 
     // Создаем диапазоны рейтинга для лучшей визуализации
-    int minRating = m_ratingData.isEmpty() ? 0 : m_ratingData.firstKey();
-    int maxRating = m_ratingData.isEmpty() ? 0 : m_ratingData.lastKey();
+    const QMap<int, qint64> &ratingData = m_data.weights();
+    int minRating = ratingData.isEmpty() ? 0 : ratingData.firstKey();
+    int maxRating = ratingData.isEmpty() ? 0 : ratingData.lastKey();
 
     // Определение размера интервала
     int intervalSize = qMax(1, (maxRating - minRating) / 20);
 
     // Группируем данные по диапазонам рейтинга
-    QMap<int, int> groupedData;
-    for (auto it = m_ratingData.constBegin(); it != m_ratingData.constEnd(); ++it) {
+    QMap<int, qint64> groupedData;
+    for (auto it = ratingData.constBegin(); it != ratingData.constEnd(); ++it) {
         int intervalStart = (it.key() / intervalSize) * intervalSize;
-        // В данном случае m_ratingData содержит рейтинг -> количество игр
-        // Итак, it.value() - это количество игроков с данным рейтингом
+        // В данном случае ratingData содержит рейтинг -> количество игр
         groupedData[intervalStart] += it.value();
     }
 
     // Заполняем данные для графика
+    qint64 maxGames = 0;
     for (auto it = groupedData.constBegin(); it != groupedData.constEnd(); ++it) {
         // Добавляем метку оси X - это рейтинг
         categories << QString("%1").arg(it.key());
-        // Добавляем значение - это количество игроков с данным рейтингом
+        // Добавляем значение - это количество игр в диапазоне рейтинга
         *ratingSet << it.value();
+        maxGames = qMax(maxGames, it.value());
     }
 
+    series->clear();
     series->append(ratingSet);
+    axisX->clear();
+    axisX->append(categories);
+    // Диапазон оси Y от 0 до максимального количества игр (с небольшим запасом)
+    axisY->setRange(0, qMax<qint64>(1, maxGames) * 1.1); // +10% для лучшего отображения
+}
 
-    // Создаем график
-    QChart *chart = new QChart();
-    chart->addSeries(series);
-    chart->setTitle("Распределение рейтинга по количеству игр");
-    chart->setAnimationOptions(QChart::SeriesAnimations);
+// Число игроков по группам рейтинга [группа, группа + groupWidth) из таблицы
+// rating_histogram (или из снимка): O(корзин) вместо GROUP BY по всем игрокам
+bool RatingDistributionAnalyzer::playersByRatingGroup(int groupWidth, QMap<int, int> &groups) {
+    // Деление с округлением вниз и для отрицательных рейтингов
+    auto addBin = [&groups, groupWidth](int bin, int players) {
+        int ratingFrom = bin * DatabaseManager::RatingHistogramBinWidth;
+        int group = (ratingFrom >= 0 ? ratingFrom / groupWidth : -((-ratingFrom + groupWidth - 1) / groupWidth)) * groupWidth;
+        groups[group] += players;
+    };
+
+    if (m_fromSnapshot) {
+        for (int i = 0; i < m_snapshot.binPlayers.size(); ++i) {
+            if (m_snapshot.binPlayers[i] > 0) {
+                addBin(m_snapshot.firstBin + i, m_snapshot.binPlayers[i]);
+            }
+        }
+        return true;
+    }
 
-    // Настраиваем ось X (рейтинг)
-    QBarCategoryAxis *axisX = new QBarCategoryAxis();
-    axisX->append(categories);
-    axisX->setTitleText("Рейтинг");
-    chart->addAxis(axisX, Qt::AlignBottom);
-    series->attachAxis(axisX);
+    QSqlQuery query(m_db);
+    query.prepare("SELECT bin, player_count FROM rating_histogram WHERE player_count > 0 ORDER BY bin");
 
-    // Настраиваем ось Y (количество игроков)
-    QValueAxis *axisY = new QValueAxis();
-    axisY->setTitleText("Количество игр");
-    // Устанавливаем диапазон оси Y от 0 до максимального количества игроков (с небольшим запасом)
-    int maxPlayers = 0;
-    for (auto value : groupedData.values()) {
-        maxPlayers = qMax(maxPlayers, value);
+    if (!query.exec()) {
+        qDebug() << "Error reading rating histogram:" << query.lastError().text();
+        return false;
     }
-    axisY->setRange(0, maxPlayers * 1.1); // +10% для лучшего отображения
 
-    chart->addAxis(axisY, Qt::AlignLeft);
-    series->attachAxis(axisY);
+    while (query.next()) {
+        addBin(query.value(0).toInt(), query.value(1).toInt());
+    }
+    return true;
+}
 
-    // Настраиваем легенду
-    chart->legend()->setVisible(true);
-    chart->legend()->setAlignment(Qt::AlignBottom);
+bool RatingDistributionAnalyzer::skillRatings(QMap<int, SkillRating> &skills) {
+    if (m_fromSnapshot) {
+        skills = m_snapshot.skills;
+        return true;
+    }
 
-    // Создаем представление графика
-    QChartView *chartView = new QChartView(chart);
-    chartView->setRenderHint(QPainter::Antialiasing);
+    // Запрос к базе данных для получения данных о рейтинге и уровне скилла
+    QSqlQuery query(m_db);
+    query.prepare("SELECT skill_level, COUNT(*), AVG(glicko_rating) as avg_rating, "
+                  "MIN(glicko_rating) as min_rating, MAX(glicko_rating) as max_rating "
+                  "FROM players "
+                  "GROUP BY skill_level "
+                  "ORDER BY skill_level");
 
-    return chartView;
+    if (!query.exec()) {
+        qDebug() << "Error getting skill rating data:" << query.lastError().text();
+        return false;
+    }
+
+    while (query.next()) {
+        SkillRating &skill = skills[query.value(0).toInt()];
+        skill.players = query.value(1).toInt();
+        skill.mean = query.value(2).toDouble();
+        skill.min = query.value(3).toDouble();
+        skill.max = query.value(4).toDouble();
+    }
+    return true;
 }
 
 // Новый метод для создания графика распределения рейтинга по количеству игроков
 QChartView* RatingDistributionAnalyzer::createPlayerDistributionChart() {
+    TRACE_SCOPE("createPlayerDistributionChart");
     // Получаем данные о количестве игроков для каждого рейтинга
     QMap<int, int> playersByRating;
 
-    // Запрос к базе данных для получения распределения игроков по рейтингу
-    QSqlQuery query;
-    query.prepare("SELECT ROUND(glicko_rating/50)*50 as rating_group, COUNT(*) as player_count "
-                  "FROM players "
-                  "GROUP BY rating_group "
-                  "ORDER BY rating_group");
-
-    if (!query.exec()) {
-        qDebug() << "Error getting player distribution data:" << query.lastError().text();
+    if (!playersByRatingGroup(50, playersByRating)) {
         return nullptr;
     }
 
-    while (query.next()) {
-        int ratingGroup = query.value(0).toInt();
-        int playerCount = query.value(1).toInt();
-        playersByRating[ratingGroup] = playerCount;
-    }
-
     if (playersByRating.isEmpty()) {
         qWarning() << "Нет данных о распределении игроков по рейтингу";
         return nullptr;
@@ -213,16 +257,6 @@ QChartView* RatingDistributionAnalyzer::createPlayerDistributionChart() {
 
     // Создаем столбиковую диаграмму
     QBarSeries *series = new QBarSeries();
-    QBarSet *playerSet = new QBarSet("Количество игроков");
-    QStringList categories;
-
-    // Заполняем данные для графика
-    for (auto it = playersByRating.constBegin(); it != playersByRating.constEnd(); ++it) {
-        categories << QString("%1").arg(it.key());
-        *playerSet << it.value();
-    }
-
-    series->append(playerSet);
 
     // Создаем график
     QChart *chart = new QChart();
@@ -232,7 +266,6 @@ QChartView* RatingDistributionAnalyzer::createPlayerDistributionChart() {
 
     // Настраиваем ось X (рейтинг)
     QBarCategoryAxis *axisX = new QBarCategoryAxis();
-    axisX->append(categories);
     axisX->setTitleText("Рейтинг (группы)");
     chart->addAxis(axisX, Qt::AlignBottom);
     series->attachAxis(axisX);
@@ -240,13 +273,6 @@ QChartView* RatingDistributionAnalyzer::createPlayerDistributionChart() {
     // Настраиваем ось Y (количество игроков)
     QValueAxis *axisY = new QValueAxis();
     axisY->setTitleText("Количество игроков");
-    // Находим максимальное количество игроков
-    int maxPlayers = 0;
-    for (auto value : playersByRating.values()) {
-        maxPlayers = qMax(maxPlayers, value);
-    }
-    axisY->setRange(0, maxPlayers * 1.1); // +10% для лучшего отображения
-
     chart->addAxis(axisY, Qt::AlignLeft);
     series->attachAxis(axisY);
 
@@ -258,21 +284,43 @@ QChartView* RatingDistributionAnalyzer::createPlayerDistributionChart() {
     QChartView *chartView = new QChartView(chart);
     chartView->setRenderHint(QPainter::Antialiasing);
 
+    updatePlayerDistributionChart(chartView);
     return chartView;
 }
 
+void RatingDistributionAnalyzer::updatePlayerDistributionChart(QChartView *view) {
+    QChart *chart = view->chart();
+    auto *series = qobject_cast<QBarSeries *>(chart->series().value(0));
+    auto *axisX = qobject_cast<QBarCategoryAxis *>(chart->axes(Qt::Horizontal).value(0));
+    auto *axisY = qobject_cast<QValueAxis *>(chart->axes(Qt::Vertical).value(0));
+    QMap<int, int> playersByRating;
+    if (!series || !axisX || !axisY || !playersByRatingGroup(50, playersByRating)) {
+        return;
+    }
+
+    QBarSet *playerSet = new QBarSet("Количество игроков");
+    QStringList categories;
+
+    // Заполняем данные для графика
+    int maxPlayers = 0;
+    for (auto it = playersByRating.constBegin(); it != playersByRating.constEnd(); ++it) {
+        categories << QString("%1").arg(it.key());
+        *playerSet << it.value();
+        maxPlayers = qMax(maxPlayers, it.value());
+    }
+
+    series->clear();
+    series->append(playerSet);
+    axisX->clear();
+    axisX->append(categories);
+    axisY->setRange(0, qMax(1, maxPlayers) * 1.1); // +10% для лучшего отображения
+}
+
 // Новый метод для создания графика зависимости рейтинга от уровня скилла
 QChartView* RatingDistributionAnalyzer::createSkillRatingChart() {
-    // Запрос к базе данных для получения данных о рейтинге и уровне скилла
-    QSqlQuery query;
-    query.prepare("SELECT skill_level, AVG(glicko_rating) as avg_rating, "
-                  "MIN(glicko_rating) as min_rating, MAX(glicko_rating) as max_rating "
-                  "FROM players "
-                  "GROUP BY skill_level "
-                  "ORDER BY skill_level");
-
-    if (!query.exec()) {
-        qDebug() << "Error getting skill rating data:" << query.lastError().text();
+    TRACE_SCOPE("createSkillRatingChart");
+    QMap<int, SkillRating> skills;
+    if (!skillRatings(skills)) {
         return nullptr;
     }
 
@@ -288,17 +336,6 @@ QChartView* RatingDistributionAnalyzer::createSkillRatingChart() {
     QStringList skillLabels;
     skillLabels << "Низкий" << "Средний" << "Выше среднего" << "Высокий";
 
-    while (query.next()) {
-        int skillLevel = query.value(0).toInt();
-        double avgRating = query.value(1).toDouble();
-        double minRating = query.value(2).toDouble();
-        double maxRating = query.value(3).toDouble();
-
-        avgSeries->append(skillLevel, avgRating);
-        minSeries->append(skillLevel, minRating);
-        maxSeries->append(skillLevel, maxRating);
-    }
-
     // Создаем график
     QChart *chart = new QChart();
     chart->addSeries(avgSeries);
@@ -325,24 +362,6 @@ QChartView* RatingDistributionAnalyzer::createSkillRatingChart() {
     QValueAxis *axisY = new QValueAxis();
     axisY->setTitleText("Рейтинг");
 
-    // Находим минимальное и максимальное значение рейтинга для настройки диапазона оси Y
-    double minYValue = -1, maxYValue = -1;
-
-    for (QPointF point : minSeries->points()) {
-        if (minYValue == -1 || point.y() < minYValue) {
-            minYValue = point.y();
-        }
-    }
-
-    for (QPointF point : maxSeries->points()) {
-        if (maxYValue == -1 || point.y() > maxYValue) {
-            maxYValue = point.y();
-        }
-    }
-
-    // Устанавливаем диапазон с запасом
-    axisY->setRange(qMax(0.0, minYValue - 100), maxYValue + 100);
-
     chart->addAxis(axisY, Qt::AlignLeft);
     avgSeries->attachAxis(axisY);
     minSeries->attachAxis(axisY);
@@ -356,12 +375,49 @@ QChartView* RatingDistributionAnalyzer::createSkillRatingChart() {
     QChartView *chartView = new QChartView(chart);
     chartView->setRenderHint(QPainter::Antialiasing);
 
+    updateSkillRatingChart(chartView);
     return chartView;
 }
 
+void RatingDistributionAnalyzer::updateSkillRatingChart(QChartView *view) {
+    QChart *chart = view->chart();
+    const QList<QAbstractSeries *> series = chart->series();
+    auto *axisY = qobject_cast<QValueAxis *>(chart->axes(Qt::Vertical).value(0));
+    QMap<int, SkillRating> skills;
+    if (series.size() != 3 || !axisY || !skillRatings(skills)) {
+        return;
+    }
+
+    // Серии в порядке создания: средний, минимальный, максимальный рейтинг
+    QList<QPointF> avgPoints, minPoints, maxPoints;
+    for (auto it = skills.constBegin(); it != skills.constEnd(); ++it) {
+        avgPoints.append(QPointF(it.key(), it.value().mean));
+        minPoints.append(QPointF(it.key(), it.value().min));
+        maxPoints.append(QPointF(it.key(), it.value().max));
+    }
+    static_cast<QLineSeries *>(series[0])->replace(avgPoints);
+    static_cast<QLineSeries *>(series[1])->replace(minPoints);
+    static_cast<QLineSeries *>(series[2])->replace(maxPoints);
+
+    if (skills.isEmpty()) {
+        return;
+    }
+
+    // Находим минимальное и максимальное значение рейтинга для настройки диапазона оси Y
+    double minYValue = skills.first().min, maxYValue = skills.first().max;
+    for (const SkillRating &skill : skills) {
+        minYValue = qMin(minYValue, skill.min);
+        maxYValue = qMax(maxYValue, skill.max);
+    }
+
+    // Устанавливаем диапазон с запасом
+    axisY->setRange(qMax(0.0, minYValue - 100), maxYValue + 100);
+}
+
 QString RatingDistributionAnalyzer::analyzeDistributionFairness() {
+    TRACE_SCOPE("analyzeDistributionFairness");
     QString result;
-    if (m_ratingData.isEmpty()) {
+    if (m_data.count() <= 0) {
         return "Нет данных для анализа";
     }
 
@@ -370,7 +426,13 @@ QString RatingDistributionAnalyzer::analyzeDistributionFairness() {
 
     result += "Результаты анализа распределения:\n\n";
     result += QString("Средний рейтинг: %1\n").arg(stats["Средний рейтинг"]);
-    result += QString("Медиана: %1\n").arg(stats["Медиана"]);
+    if (m_fromSnapshot) {
+        // Медиана снимка - середина корзины гистограммы
+        result += QString("Медиана: %1 (±%2)\n").arg(stats["Медиана"], 0, 'f', 0)
+                      .arg(DatabaseManager::RatingHistogramBinWidth / 2);
+    } else {
+        result += QString("Медиана: %1\n").arg(stats["Медиана"]);
+    }
     result += QString("Стандартное отклонение: %1\n").arg(stats["Стандартное отклонение"]);
     result += QString("Асимметрия: %1\n").arg(stats["Асимметрия"]);
     result += QString("Эксцесс: %1\n").arg(stats["Эксцесс"]);
@@ -407,14 +469,9 @@ QString RatingDistributionAnalyzer::analyzeDistributionFairness() {
     result += "\nАнализ распределения рейтинга по игрокам:\n";
     result += "График распределения рейтинга по количеству игроков показывает, ";
 
-    // Запрос к БД для проверки распределения игроков по рейтингу
-    QSqlQuery query;
-    query.prepare("SELECT ROUND(glicko_rating/50)*50 as rating_group, COUNT(*) as player_count "
-                  "FROM players "
-                  "GROUP BY rating_group "
-                  "ORDER BY rating_group");
-
-    if (query.exec()) {
+    // Распределение игроков по рейтингу - из гистограммы
+    QMap<int, int> playersByRating;
+    if (playersByRatingGroup(50, playersByRating)) {
         // Анализируем форму распределения
         bool hasPeakAroundAverage = false;
         int totalPlayers = 0;
@@ -424,9 +481,9 @@ QString RatingDistributionAnalyzer::analyzeDistributionFairness() {
         double avgRangeMin = avgRating - 100;
         double avgRangeMax = avgRating + 100;
 
-        while (query.next()) {
-            int ratingGroup = query.value(0).toInt();
-            int playerCount = query.value(1).toInt();
+        for (auto it = playersByRating.constBegin(); it != playersByRating.constEnd(); ++it) {
+            int ratingGroup = it.key();
+            int playerCount = it.value();
             totalPlayers += playerCount;
 
             if (ratingGroup >= avgRangeMin && ratingGroup <= avgRangeMax) {
@@ -453,31 +510,18 @@ QString RatingDistributionAnalyzer::analyzeDistributionFairness() {
     // Анализ зависимости рейтинга от уровня скилла
     result += "\nАнализ зависимости рейтинга от уровня скилла:\n";
 
-    QSqlQuery skillQuery;
-    skillQuery.prepare("SELECT skill_level, AVG(glicko_rating) as avg_rating "
-                       "FROM players "
-                       "GROUP BY skill_level "
-                       "ORDER BY skill_level");
-
-    if (skillQuery.exec()) {
-        QMap<int, double> avgRatingBySkill;
-
-        while (skillQuery.next()) {
-            int skillLevel = skillQuery.value(0).toInt();
-            double avgRating = skillQuery.value(1).toDouble();
-            avgRatingBySkill[skillLevel] = avgRating;
-        }
-
-        if (avgRatingBySkill.size() > 1) {
+    QMap<int, SkillRating> skills;
+    if (skillRatings(skills)) {
+        if (skills.size() > 1) {
             bool isMonotonic = true;
             double prevRating = -1;
 
-            for (auto it = avgRatingBySkill.constBegin(); it != avgRatingBySkill.constEnd(); ++it) {
-                if (prevRating != -1 && it.value() <= prevRating) {
+            for (auto it = skills.constBegin(); it != skills.constEnd(); ++it) {
+                if (prevRating != -1 && it.value().mean <= prevRating) {
                     isMonotonic = false;
                     break;
                 }
-                prevRating = it.value();
+                prevRating = it.value().mean;
             }
 
             if (isMonotonic) {
@@ -489,30 +533,17 @@ QString RatingDistributionAnalyzer::analyzeDistributionFairness() {
             }
 
             // Анализ разброса рейтинга в пределах одного уровня скилла
-            QSqlQuery dispersionQuery;
-            dispersionQuery.prepare("SELECT skill_level, MAX(glicko_rating) - MIN(glicko_rating) as dispersion "
-                                    "FROM players "
-                                    "GROUP BY skill_level");
-
-            if (dispersionQuery.exec()) {
-                double avgDispersion = 0;
-                int count = 0;
-
-                while (dispersionQuery.next()) {
-                    avgDispersion += dispersionQuery.value(1).toDouble();
-                    count++;
-                }
-
-                if (count > 0) {
-                    avgDispersion /= count;
-                    result += QString("Средний разброс рейтинга в пределах одного уровня скилла: %1. ").arg(avgDispersion, 0, 'f', 1);
+            double avgDispersion = 0;
+            for (const SkillRating &skill : skills) {
+                avgDispersion += skill.max - skill.min;
+            }
+            avgDispersion /= skills.size();
+            result += QString("Средний разброс рейтинга в пределах одного уровня скилла: %1. ").arg(avgDispersion, 0, 'f', 1);
 
-                    if (avgDispersion > 300) {
-                        result += "Большой разброс указывает на то, что на рейтинг значительно влияют индивидуальные особенности игры и количество проведенных матчей.\n";
-                    } else {
-                        result += "Умеренный разброс свидетельствует о стабильности системы рейтинга в пределах одного уровня навыков.\n";
-                    }
-                }
+            if (avgDispersion > 300) {
+                result += "Большой разброс указывает на то, что на рейтинг значительно влияют индивидуальные особенности игры и количество проведенных матчей.\n";
+            } else {
+                result += "Умеренный разброс свидетельствует о стабильности системы рейтинга в пределах одного уровня навыков.\n";
             }
         }
     }
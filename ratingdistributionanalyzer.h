@@ -9,6 +9,8 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QCategoryAxis>
+#include "livedistribution.h"
+#include "ratingstatistics.h"
 
     class RatingDistributionAnalyzer : public QObject
 {
@@ -16,10 +18,19 @@
 public:
     explicit RatingDistributionAnalyzer(QObject *parent = nullptr);
 
+    // Соединение для запросов графиков (соединение потока, в котором идет анализ)
+    void setDatabase(const QSqlDatabase &db);
+
     void setDataFromTable(QTableWidget *table);
-    void addData(int rating, int gamesCount);
+    void addData(int rating, qint64 gamesCount);
+    // Частичный результат, накопленный отдельно (например, в другом потоке)
+    void addData(const RatingAccumulator &partial);
     void clearData();
+    // Данные из снимка генератора: графики и анализ больше не обращаются к БД
+    void setSnapshot(const DistributionSnapshot &snapshot);
 
+    // Среднее, отклонение, медиана, асимметрия и эксцесс по накопленным моментам:
+    // без проходов по данным, повторные вызовы до изменения данных берут готовый результат
     QMap<QString, double> calculateStatistics();
     double checkNormalDistribution();
 
@@ -27,10 +38,25 @@ public:
     QChartView* createPlayerDistributionChart();  // Новый метод для графика распределения по игрокам
     QChartView* createSkillRatingChart();        // Новый метод для графика зависимости рейтинга от скилла
 
+    // Перестроить серии и оси уже открытого графика по текущим данным
+    void updateDistributionChart(QChartView *view);
+    void updatePlayerDistributionChart(QChartView *view);
+    void updateSkillRatingChart(QChartView *view);
+
     QString analyzeDistributionFairness();
 
 private:
-    QMap<int, int> m_ratingData;  // Рейтинг -> количество игр
+    bool playersByRatingGroup(int groupWidth, QMap<int, int> &groups);
+    // Число игроков, средний, минимальный и максимальный рейтинг по уровням навыка
+    bool skillRatings(QMap<int, SkillRating> &skills);
+
+    RatingAccumulator m_data;  // Рейтинг -> количество игр и их моменты
+    RatingMoments m_exactMoments; // моменты снимка по игрокам; пустые - берутся из m_data
+    QMap<QString, double> m_stats;
+    bool m_statsValid = false;
+    QSqlDatabase m_db;
+    DistributionSnapshot m_snapshot;
+    bool m_fromSnapshot = false;
 };
 
 #endif // RATINGDISTRIBUTIONANALYZER_H
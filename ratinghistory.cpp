@@ -0,0 +1,141 @@
+#include "ratinghistory.h"
+#include <QtMath>
+
+namespace {
+const double FixedPointScale = 1000.0;
+
+void appendVarint(QByteArray &out, qint64 value)
+{
+    // Зигзаг: малые по модулю отрицательные числа тоже занимают мало байт
+    quint64 zigzag = (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+    while (zigzag >= 0x80) {
+        out.append(static_cast<char>((zigzag & 0x7F) | 0x80));
+        zigzag >>= 7;
+    }
+    out.append(static_cast<char>(zigzag));
+}
+
+bool readVarint(const uchar *&data, const uchar *end, qint64 &value)
+{
+    quint64 zigzag = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7) {
+        const uchar byte = *data++;
+        zigzag |= static_cast<quint64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            value = static_cast<qint64>(zigzag >> 1) ^ -static_cast<qint64>(zigzag & 1);
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+void RatingHistoryEncoder::reset(const QByteArray &block)
+{
+    m_lastTimestamp = 0;
+    m_lastRating = 0;
+    m_lastRd = 0;
+    m_blockBytes = block.size();
+    m_pointCount = 0;
+
+    const uchar *data = reinterpret_cast<const uchar*>(block.constData());
+    const uchar *end = data + block.size();
+    qint64 deltas[3];
+    while (data < end
+           && readVarint(data, end, deltas[0]) && readVarint(data, end, deltas[1]) && readVarint(data, end, deltas[2])) {
+        m_lastTimestamp += deltas[0];
+        m_lastRating += deltas[1];
+        m_lastRd += deltas[2];
+        ++m_pointCount;
+    }
+}
+
+void RatingHistoryEncoder::append(const RatingPoint &point, QByteArray &out)
+{
+    const qint64 rating = qRound64(point.rating * FixedPointScale);
+    const qint64 rd = qRound64(point.rd * FixedPointScale);
+
+    const int sizeBefore = out.size();
+    appendVarint(out, point.timestamp - m_lastTimestamp);
+    appendVarint(out, rating - m_lastRating);
+    appendVarint(out, rd - m_lastRd);
+    m_blockBytes += out.size() - sizeBefore;
+    ++m_pointCount;
+
+    m_lastTimestamp = point.timestamp;
+    m_lastRating = rating;
+    m_lastRd = rd;
+}
+
+bool RatingHistoryEncoder::decode(const QByteArray &block, QVector<RatingPoint> &points)
+{
+    const uchar *data = reinterpret_cast<const uchar*>(block.constData());
+    const uchar *end = data + block.size();
+    qint64 timestamp = 0;
+    qint64 rating = 0;
+    qint64 rd = 0;
+    while (data < end) {
+        qint64 deltas[3];
+        if (!readVarint(data, end, deltas[0]) || !readVarint(data, end, deltas[1])
+            || !readVarint(data, end, deltas[2])) {
+            return false;
+        }
+        timestamp += deltas[0];
+        rating += deltas[1];
+        rd += deltas[2];
+        points.append({timestamp, rating / FixedPointScale, rd / FixedPointScale});
+    }
+    return true;
+}
+
+QVector<RatingPoint> downsampleRatingHistory(const QVector<RatingPoint> &points, int maxPoints)
+{
+    const int count = points.size();
+    if (maxPoints < 3 || count <= maxPoints) {
+        return points;
+    }
+
+    QVector<RatingPoint> result;
+    result.reserve(maxPoints);
+    result.append(points.first());
+
+    // Точки между первой и последней делятся на maxPoints - 2 корзины
+    const double bucketSize = double(count - 2) / (maxPoints - 2);
+    int previous = 0;
+    for (int bucket = 0; bucket < maxPoints - 2; ++bucket) {
+        const int begin = int(bucket * bucketSize) + 1;
+        const int end = int((bucket + 1) * bucketSize) + 1;
+
+        // Третья вершина - среднее следующей корзины (для последней - последняя точка)
+        const int nextBegin = end;
+        const int nextEnd = qMin(int((bucket + 2) * bucketSize) + 1, count);
+        double averageTime = 0.0;
+        double averageRating = 0.0;
+        for (int i = nextBegin; i < nextEnd; ++i) {
+            averageTime += points[i].timestamp;
+            averageRating += points[i].rating;
+        }
+        const int nextCount = qMax(1, nextEnd - nextBegin);
+        averageTime /= nextCount;
+        averageRating /= nextCount;
+
+        const double previousTime = points[previous].timestamp;
+        const double previousRating = points[previous].rating;
+        double maxArea = -1.0;
+        int chosen = begin;
+        for (int i = begin; i < end; ++i) {
+            // Удвоенная площадь треугольника (previous, i, среднее следующей корзины)
+            const double area = qAbs((previousTime - averageTime) * (points[i].rating - previousRating)
+                                     - (previousTime - points[i].timestamp) * (averageRating - previousRating));
+            if (area > maxArea) {
+                maxArea = area;
+                chosen = i;
+            }
+        }
+        result.append(points[chosen]);
+        previous = chosen;
+    }
+
+    result.append(points.last());
+    return result;
+}
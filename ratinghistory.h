@@ -0,0 +1,54 @@
+#ifndef RATINGHISTORY_H
+#define RATINGHISTORY_H
+
+#include <QByteArray>
+#include <QVector>
+
+// Точка траектории рейтинга игрока: состояние после игры
+struct RatingPoint {
+    qint64 timestamp; // секунды эпохи
+    double rating;
+    double rd;
+};
+
+// Кодирование траектории рейтинга блоками (таблица rating_history).
+//
+// Точка - три varint в зигзаг-кодировке: разность времени, разность рейтинга и
+// разность RD с предыдущей точкой блока (первая точка блока - от нуля, поэтому
+// каждый блок декодируется отдельно). Рейтинг и RD хранятся с точностью 0.001.
+// Обычная точка занимает 6-8 байт против 24 в несжатом виде. Блоки игрока
+// нумеруются по возрастанию времени; новый блок начинается, когда текущий
+// достиг MaxBlockBytes, так что дописывание не переписывает длинные строки.
+class RatingHistoryEncoder
+{
+public:
+    static constexpr int MaxBlockBytes = 2048;
+
+    // Начать новый блок или продолжить существующий (последний блок игрока)
+    void reset(const QByteArray &block = QByteArray());
+
+    // Закодировать точку и дописать ее байты в out (хвост текущего блока)
+    void append(const RatingPoint &point, QByteArray &out);
+
+    bool isFull() const { return m_blockBytes >= MaxBlockBytes; }
+    int blockBytes() const { return m_blockBytes; }
+    int pointCount() const { return m_pointCount; }
+
+    // Дописать точки блока в points; false - блок поврежден
+    static bool decode(const QByteArray &block, QVector<RatingPoint> &points);
+
+private:
+    qint64 m_lastTimestamp = 0;
+    qint64 m_lastRating = 0; // тысячные доли
+    qint64 m_lastRd = 0;
+    int m_blockBytes = 0;
+    int m_pointCount = 0;
+};
+
+// Прореживание траектории для графика методом LTTB (Largest-Triangle-Three-Buckets):
+// не больше maxPoints точек; первая и последняя сохраняются, из каждой корзины
+// берется точка, дающая наибольший треугольник с соседними, поэтому пики и
+// провалы рейтинга остаются видны. O(точек), без сортировки
+QVector<RatingPoint> downsampleRatingHistory(const QVector<RatingPoint> &points, int maxPoints);
+
+#endif // RATINGHISTORY_H
@@ -0,0 +1,104 @@
+#include "ratingstatistics.h"
+#include <cmath>
+
+void RatingMoments::add(double value, qint64 weight) {
+    if (weight <= 0) {
+        return;
+    }
+    // Значение с весом - часть данных из weight одинаковых значений: моменты выше
+    // первого у нее нулевые
+    RatingMoments single;
+    single.count = weight;
+    single.mean = value;
+    merge(single);
+}
+
+void RatingMoments::merge(const RatingMoments &other) {
+    if (other.isEmpty()) {
+        return;
+    }
+    if (isEmpty()) {
+        *this = other;
+        return;
+    }
+
+    const double na = static_cast<double>(count);
+    const double nb = static_cast<double>(other.count);
+    const double n = na + nb;
+    const double delta = other.mean - mean;
+    const double deltaN = delta / n;
+    const double deltaN2 = deltaN * deltaN;
+    const double term = delta * deltaN * na * nb; // delta^2 * na * nb / n
+
+    // Старшие моменты считаются по прежним младшим, поэтому в обратном порядке
+    m4 += other.m4 + term * deltaN2 * (na * na - na * nb + nb * nb)
+          + 6.0 * deltaN2 * (na * na * other.m2 + nb * nb * m2)
+          + 4.0 * deltaN * (na * other.m3 - nb * m3);
+    m3 += other.m3 + term * deltaN * (na - nb) + 3.0 * deltaN * (na * other.m2 - nb * m2);
+    m2 += other.m2 + term;
+    mean += deltaN * nb;
+    count += other.count;
+}
+
+double RatingMoments::variance() const {
+    return isEmpty() ? 0.0 : m2 / count;
+}
+
+double RatingMoments::stdDeviation() const {
+    return std::sqrt(variance());
+}
+
+double RatingMoments::skewness() const {
+    if (isEmpty() || m2 <= 0.0) {
+        return 0.0;
+    }
+    return std::sqrt(static_cast<double>(count)) * m3 / (m2 * std::sqrt(m2));
+}
+
+double RatingMoments::kurtosis() const {
+    if (isEmpty() || m2 <= 0.0) {
+        return 0.0;
+    }
+    return static_cast<double>(count) * m4 / (m2 * m2) - 3.0;
+}
+
+void RatingAccumulator::add(int rating, qint64 weight) {
+    if (weight <= 0) {
+        return;
+    }
+    m_moments.add(rating, weight);
+    m_weights[rating] += weight;
+}
+
+void RatingAccumulator::merge(const RatingAccumulator &other) {
+    m_moments.merge(other.m_moments);
+    for (auto it = other.m_weights.constBegin(); it != other.m_weights.constEnd(); ++it) {
+        m_weights[it.key()] += it.value();
+    }
+}
+
+double RatingAccumulator::median() const {
+    const qint64 total = m_moments.count;
+    if (total <= 0) {
+        return 0.0;
+    }
+
+    // Значения с номерами lower и upper в отсортированном списке (с нуля): при
+    // четном count это два средних, при нечетном - одно и то же
+    const qint64 upper = total / 2;
+    const qint64 lower = total % 2 == 0 ? upper - 1 : upper;
+    bool haveLower = false;
+    double lowerValue = 0.0;
+    qint64 cumulative = 0;
+    for (auto it = m_weights.constBegin(); it != m_weights.constEnd(); ++it) {
+        cumulative += it.value();
+        if (!haveLower && cumulative > lower) {
+            lowerValue = it.key();
+            haveLower = true;
+        }
+        if (cumulative > upper) {
+            return (lowerValue + it.key()) / 2.0;
+        }
+    }
+    return lowerValue;
+}
@@ -0,0 +1,51 @@
+#ifndef RATINGSTATISTICS_H
+#define RATINGSTATISTICS_H
+
+#include <QMap>
+#include <QtGlobal>
+
+// Взвешенные центральные моменты рейтинга до четвертого за один проход.
+// Добавление значения с весом и объединение двух накопителей - одна и та же
+// формула попарного объединения (Pébay, обобщение Уэлфорда/Терриберри), поэтому
+// накопители частей данных, посчитанные в разных потоках, объединяются без
+// повторного прохода и без потери точности на больших средних.
+struct RatingMoments {
+    qint64 count = 0; // суммарный вес (количество игр)
+    double mean = 0.0;
+    double m2 = 0.0;  // суммы степеней отклонений от среднего, взвешенные
+    double m3 = 0.0;
+    double m4 = 0.0;
+
+    void add(double value, qint64 weight = 1);
+    void merge(const RatingMoments &other);
+
+    bool isEmpty() const { return count <= 0; }
+    // Дисперсия генеральной совокупности (деление на count)
+    double variance() const;
+    double stdDeviation() const;
+    double skewness() const;
+    // Избыточный эксцесс: 0 у нормального распределения
+    double kurtosis() const;
+};
+
+// Накопитель статистики распределения рейтинга: моменты и веса по значениям
+// рейтинга для медианы. Медиана берется из накопленных весов по возрастанию
+// рейтинга, без развертывания по одному значению на игру. Частичные накопители
+// потоков объединяются через merge; память - O(различных рейтингов).
+class RatingAccumulator {
+public:
+    void add(int rating, qint64 weight = 1);
+    void merge(const RatingAccumulator &other);
+
+    const RatingMoments &moments() const { return m_moments; }
+    qint64 count() const { return m_moments.count; }
+    const QMap<int, qint64> &weights() const { return m_weights; }
+    // Среднее двух средних значений при четном count, как у отсортированного списка
+    double median() const;
+
+private:
+    RatingMoments m_moments;
+    QMap<int, qint64> m_weights; // рейтинг -> вес
+};
+
+#endif // RATINGSTATISTICS_H
@@ -0,0 +1,456 @@
+#include "resulttablemodels.h"
+#include <QBrush>
+#include <QDateTime>
+#include <iterator>
+#include "tablequerythread.h"
+
+namespace {
+const char *const gamesHeaders[] = {"ID игры", "Дата игры", "Счёт команды 1", "Счёт команды 2", "Победившая команда"};
+const char *const playersHeaders[] = {"Никнейм", "Рейтинг", "RD", "Общее количество игр", "Уровень игры",
+                                      "Количество побед", "Winrate"};
+static_assert(std::size(gamesHeaders) == GamesColumnCount, "games header per column");
+static_assert(std::size(playersHeaders) == PlayersColumnCount, "players header per column");
+const char *const historyHeaders[] = {"ID игры", "Счет команды 1", "Счет команды 2", "Дата игры", "Результат",
+                                      "Δ Рейтинга"};
+}
+
+GamesTableModel::GamesTableModel(TableQueryThread *queries, QObject *parent)
+    : QAbstractTableModel(parent), m_queries(queries), m_rows(PageRows, MaxCachedPages)
+{
+    connect(m_queries, &TableQueryThread::gamesPageReady, this, &GamesTableModel::onPageReady);
+    m_generation = m_queries->startGeneration();
+}
+
+void GamesTableModel::setQuery(const GamesQuery &query)
+{
+    beginResetModel();
+    m_query = query;
+    m_generation = m_queries->startGeneration();
+    m_rows.reset();
+    endResetModel();
+    fetchMore(QModelIndex());
+}
+
+void GamesTableModel::applyChange(const DataChange &change)
+{
+    if (change.newGames.isEmpty() && !change.reset) {
+        return;
+    }
+    if (change.reset || m_query.sortColumn != GamesIdColumn || m_query.order != Qt::AscendingOrder) {
+        setQuery(m_query);
+        return;
+    }
+
+    // Новые игры - после последней строки
+    RowKey start;
+    const int index = m_rows.resume(start);
+    if (index == m_rows.pageCount()) {
+        fetchMore(QModelIndex());
+    } else if (index >= 0) {
+        m_queries->requestGamesPage(m_generation, index, m_query, start, PageRows);
+    }
+}
+
+int GamesTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.rowCount();
+}
+
+int GamesTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : GamesColumnCount;
+}
+
+QVariant GamesTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::UserRole)) {
+        return QVariant();
+    }
+    int row = index.row();
+    const GamesTable *page = m_rows.page(row);
+    if (!page) {
+        requestReload();
+        return QVariant();
+    }
+    if (role == Qt::UserRole) {
+        return page->gameIds[row];
+    }
+
+    switch (index.column()) {
+    case GamesIdColumn: return page->gameIds[row];
+    case GamesDateColumn: return QDateTime::fromSecsSinceEpoch(page->gameDates[row]).toString("dd.MM.yyyy HH:mm");
+    case GamesTeam1ScoreColumn: return page->team1Scores[row];
+    case GamesTeam2ScoreColumn: return page->team2Scores[row];
+    case GamesWinnerColumn: return teamSideName(page->winnerTeams[row]);
+    default: return QVariant();
+    }
+}
+
+QVariant GamesTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < GamesColumnCount) {
+        return QString(gamesHeaders[section]);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool GamesTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_rows.canFetchMore();
+}
+
+void GamesTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !m_rows.canFetchMore()) {
+        return;
+    }
+    const RowKey after = m_rows.beginFetch();
+    m_queries->requestGamesPage(m_generation, m_rows.pageCount(), m_query, after, PageRows);
+}
+
+void GamesTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= GamesColumnCount || (column == m_query.sortColumn && order == m_query.order)) {
+        return;
+    }
+    GamesQuery query = m_query;
+    query.sortColumn = column;
+    query.order = order;
+    setQuery(query);
+}
+
+void GamesTableModel::requestReload() const
+{
+    RowKey start;
+    const int index = m_rows.takeReload(start);
+    if (index >= 0) {
+        m_queries->requestGamesPage(m_generation, index, m_query, start, PageRows);
+    }
+}
+
+void GamesTableModel::onPageReady(quint64 generation, int pageIndex, const GamesTable &page, qint64 elapsedMs)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    RowKey lastKey;
+    if (page.size() > 0) {
+        lastKey.value = page.sortValue(page.size() - 1, m_query.sortColumn);
+        lastKey.id = page.gameIds.last();
+    }
+
+    if (m_rows.isResumed(pageIndex)) {
+        // Последняя страница после новых игр: прежние строки те же, новые - в конец
+        const int added = page.size() - m_rows.lastPageRows();
+        if (added > 0) {
+            beginInsertRows(QModelIndex(), m_rows.rowCount(), m_rows.rowCount() + added - 1);
+        }
+        m_rows.extendLastPage(page, lastKey);
+        if (added > 0) {
+            endInsertRows();
+        }
+        return;
+    }
+
+    if (pageIndex < m_rows.pageCount()) {
+        // Вытесненная страница прочитана заново
+        m_rows.setPage(pageIndex, page);
+        const int first = pageIndex * PageRows;
+        const int last = qMin(first + PageRows, m_rows.rowCount()) - 1;
+        emit dataChanged(index(first, 0), index(last, GamesColumnCount - 1));
+        return;
+    }
+
+    if (page.size() == 0) {
+        m_rows.appendPage(page, lastKey);
+    } else {
+        const int first = m_rows.rowCount();
+        beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+        m_rows.appendPage(page, lastKey);
+        endInsertRows();
+    }
+    if (pageIndex == 0) {
+        emit firstPageLoaded(page.size(), elapsedMs);
+    }
+}
+
+PlayersTableModel::PlayersTableModel(TableQueryThread *queries, QObject *parent)
+    : QAbstractTableModel(parent), m_queries(queries), m_rows(PageRows, MaxCachedPages)
+{
+    connect(m_queries, &TableQueryThread::playersPageReady, this, &PlayersTableModel::onPageReady);
+    m_generation = m_queries->startGeneration();
+}
+
+void PlayersTableModel::setQuery(const PlayersQuery &query)
+{
+    beginResetModel();
+    m_query = query;
+    m_generation = m_queries->startGeneration();
+    m_orderStale = false;
+    m_rows.reset();
+    endResetModel();
+    fetchMore(QModelIndex());
+}
+
+void PlayersTableModel::applyChange(const DataChange &change)
+{
+    if (change.newPlayers.isEmpty() && change.changedPlayers.isEmpty() && !change.reset) {
+        return;
+    }
+    if (change.reset || !change.newPlayers.isEmpty()) {
+        setQuery(m_query);
+        return;
+    }
+
+    // Сброс на каждый коммит генерации возвращал бы список к первой странице; вместо
+    // него при изменяемой колонке сортировки перечитывается весь кэш (не больше
+    // MaxCachedPages страниц), а точный порядок - один раз, в refreshOrder
+    const bool stableOrder = m_query.sortColumn == PlayersNicknameColumn || m_query.sortColumn == PlayersSkillColumn;
+    if (!stableOrder) {
+        m_orderStale = true;
+    }
+    const QVector<int> stale = m_rows.takeStalePages([&change, stableOrder](const PlayersTable &page, int row) {
+        return !stableOrder || change.playerChanged(page.playerIds[row]);
+    });
+    for (int pageIndex : stale) {
+        m_queries->requestPlayersPage(m_generation, pageIndex, m_query, m_rows.pageStart(pageIndex), PageRows);
+    }
+}
+
+void PlayersTableModel::refreshOrder()
+{
+    if (m_orderStale) {
+        setQuery(m_query);
+    }
+}
+
+int PlayersTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.rowCount();
+}
+
+int PlayersTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : PlayersColumnCount;
+}
+
+QVariant PlayersTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::UserRole)) {
+        return QVariant();
+    }
+    int row = index.row();
+    const PlayersTable *page = m_rows.page(row);
+    if (!page) {
+        requestReload();
+        return QVariant();
+    }
+    if (role == Qt::UserRole) {
+        return page->playerIds[row];
+    }
+
+    switch (index.column()) {
+    case PlayersNicknameColumn: return page->nicknames.at(row);
+    case PlayersRatingColumn: return qRound(page->ratings[row]);
+    case PlayersRdColumn: return qRound(page->rds[row]);
+    case PlayersMatchesColumn: return page->totalMatches[row];
+    case PlayersSkillColumn: return skillLevelName(page->skillLevels[row]);
+    case PlayersWinsColumn: return page->wins[row];
+    case PlayersWinRateColumn: return QString::number(page->winRate(row), 'f', 1) + "%";
+    default: return QVariant();
+    }
+}
+
+QVariant PlayersTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < PlayersColumnCount) {
+        return QString(playersHeaders[section]);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool PlayersTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_rows.canFetchMore();
+}
+
+void PlayersTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !m_rows.canFetchMore()) {
+        return;
+    }
+    const RowKey after = m_rows.beginFetch();
+    m_queries->requestPlayersPage(m_generation, m_rows.pageCount(), m_query, after, PageRows);
+}
+
+void PlayersTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= PlayersColumnCount || (column == m_query.sortColumn && order == m_query.order)) {
+        return;
+    }
+    PlayersQuery query = m_query;
+    query.sortColumn = column;
+    query.order = order;
+    setQuery(query);
+}
+
+void PlayersTableModel::requestReload() const
+{
+    RowKey start;
+    const int index = m_rows.takeReload(start);
+    if (index >= 0) {
+        m_queries->requestPlayersPage(m_generation, index, m_query, start, PageRows);
+    }
+}
+
+void PlayersTableModel::onPageReady(quint64 generation, int pageIndex, const PlayersTable &page, qint64 elapsedMs)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    if (pageIndex < m_rows.pageCount()) {
+        m_rows.setPage(pageIndex, page);
+        const int first = pageIndex * PageRows;
+        const int last = qMin(first + PageRows, m_rows.rowCount()) - 1;
+        emit dataChanged(index(first, 0), index(last, PlayersColumnCount - 1));
+        return;
+    }
+
+    RowKey lastKey;
+    if (page.size() > 0) {
+        lastKey.value = page.sortValue(page.size() - 1, m_query.sortColumn);
+        lastKey.id = page.playerIds.last();
+    }
+    if (page.size() == 0) {
+        m_rows.appendPage(page, lastKey);
+    } else {
+        const int first = m_rows.rowCount();
+        beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+        m_rows.appendPage(page, lastKey);
+        endInsertRows();
+    }
+    if (pageIndex == 0) {
+        emit firstPageLoaded(page.size(), elapsedMs);
+    }
+}
+
+PlayerHistoryModel::PlayerHistoryModel(int playerId, TableQueryThread *queries, QObject *parent)
+    : QAbstractTableModel(parent), m_playerId(playerId), m_queries(queries), m_rows(PageRows, MaxCachedPages)
+{
+    connect(m_queries, &TableQueryThread::historyPageReady, this, &PlayerHistoryModel::onPageReady);
+    m_generation = m_queries->startGeneration();
+    fetchMore(QModelIndex());
+}
+
+int PlayerHistoryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.rowCount();
+}
+
+int PlayerHistoryModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(std::size(historyHeaders));
+}
+
+QVariant PlayerHistoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::UserRole && role != Qt::ForegroundRole)) {
+        return QVariant();
+    }
+    int row = index.row();
+    const QVector<PlayerGameRecord> *page = m_rows.page(row);
+    if (!page) {
+        requestReload();
+        return QVariant();
+    }
+    const PlayerGameRecord &record = page->at(row);
+    if (role == Qt::UserRole) {
+        return record.gameId;
+    }
+
+    // Результат и изменение рейтинга с цветовым оформлением
+    if (role == Qt::ForegroundRole) {
+        switch (index.column()) {
+        case 4: return QBrush(record.win ? Qt::darkGreen : Qt::red);
+        case 5: return QBrush(record.ratingChange >= 0 ? Qt::darkGreen : Qt::red);
+        default: return QVariant();
+        }
+    }
+
+    switch (index.column()) {
+    case 0: return record.gameId;
+    case 1: return record.team1Score;
+    case 2: return record.team2Score;
+    case 3: return QDateTime::fromSecsSinceEpoch(record.gameDate).toString("dd.MM.yyyy HH:mm");
+    case 4: return record.win ? QStringLiteral("Победа") : QStringLiteral("Поражение");
+    case 5: return QString("%1%2").arg(record.ratingChange > 0 ? "+" : "").arg(record.ratingChange, 0, 'f', 1);
+    default: return QVariant();
+    }
+}
+
+QVariant PlayerHistoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < columnCount()) {
+        return QString(historyHeaders[section]);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool PlayerHistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_rows.canFetchMore();
+}
+
+void PlayerHistoryModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !m_rows.canFetchMore()) {
+        return;
+    }
+    const RowKey after = m_rows.beginFetch();
+    m_queries->requestHistoryPage(m_generation, m_rows.pageCount(), m_playerId, after, PageRows);
+}
+
+void PlayerHistoryModel::requestReload() const
+{
+    RowKey start;
+    const int index = m_rows.takeReload(start);
+    if (index >= 0) {
+        m_queries->requestHistoryPage(m_generation, index, m_playerId, start, PageRows);
+    }
+}
+
+void PlayerHistoryModel::onPageReady(quint64 generation, int pageIndex, const QVector<PlayerGameRecord> &page,
+                                     qint64 elapsedMs)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    if (pageIndex < m_rows.pageCount()) {
+        m_rows.setPage(pageIndex, page);
+        const int first = pageIndex * PageRows;
+        const int last = qMin(first + PageRows, m_rows.rowCount()) - 1;
+        emit dataChanged(index(first, 0), index(last, columnCount() - 1));
+        return;
+    }
+
+    // Ключ страницы - game_id последней (самой старой) игры
+    RowKey lastKey;
+    if (!page.isEmpty()) {
+        lastKey.value = page.last().gameId;
+        lastKey.id = page.last().gameId;
+    }
+    if (page.isEmpty()) {
+        m_rows.appendPage(page, lastKey);
+    } else {
+        const int first = m_rows.rowCount();
+        beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+        m_rows.appendPage(page, lastKey);
+        endInsertRows();
+    }
+    if (pageIndex == 0) {
+        emit firstPageLoaded(page.size(), elapsedMs);
+    }
+}
@@ -0,0 +1,328 @@
+#ifndef RESULTTABLEMODELS_H
+#define RESULTTABLEMODELS_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <utility>
+#include "databasemanager.h"
+#include "resulttables.h"
+#include "storagebackend.h"
+
+class TableQueryThread;
+
+// Строки ленивой модели, загружаемые страницами по ключу (keyset pagination).
+// Для каждой загруженной страницы хранится только ключ, после которого она
+// начинается; сами строки - в кэше из не более maxCachedPages страниц. Вытесненная
+// страница читается заново по своему ключу, поэтому память не зависит от того,
+// сколько строк уже прокручено. Страницы приходят асинхронно (TableQueryThread).
+template <typename Page>
+class PagedRows
+{
+public:
+    PagedRows(int pageRows, int maxCachedPages)
+        : m_pageRows(pageRows), m_maxCachedPages(maxCachedPages)
+    {
+    }
+
+    void reset()
+    {
+        m_nextKey = RowKey();
+        m_pageStarts.clear();
+        m_rowCount = 0;
+        m_exhausted = false;
+        m_fetching = false;
+        m_pages.clear();
+        m_recent.clear();
+        m_loading.clear();
+        m_resumed = -1;
+    }
+
+    int pageRows() const { return m_pageRows; }
+    int pageCount() const { return m_pageStarts.size(); }
+    int rowCount() const { return m_rowCount; }
+
+    // Следующая страница: можно запросить, если список не кончился и запрос не идет
+    bool canFetchMore() const { return !m_exhausted && !m_fetching; }
+    RowKey beginFetch()
+    {
+        m_fetching = true;
+        return m_nextKey;
+    }
+
+    // Следующая страница пришла; lastKey - ключ ее последней строки
+    void appendPage(Page page, const RowKey &lastKey)
+    {
+        m_fetching = false;
+        if (page.size() < m_pageRows) {
+            m_exhausted = true;
+        }
+        if (page.size() == 0) {
+            return;
+        }
+        m_pageStarts.append(m_nextKey);
+        m_nextKey = lastKey;
+        m_rowCount += page.size();
+        cache(m_pageStarts.size() - 1, std::move(page));
+    }
+
+    // Страница со строкой row из кэша; row становится номером строки в странице.
+    // nullptr, если страница вытеснена (см. takeReload) или строки нет
+    const Page *page(int &row)
+    {
+        const int index = row / m_pageRows;
+        row %= m_pageRows;
+        auto it = m_pages.find(index);
+        if (it == m_pages.end()) {
+            if (index < m_pageStarts.size() && !m_loading.contains(index)) {
+                m_reload = index;
+            }
+            return nullptr;
+        }
+        m_recent.removeOne(index);
+        m_recent.append(index);
+        return row < it->size() ? &*it : nullptr;
+    }
+
+    // Вытесненная страница, которую запросило представление: номер и ключ начала, -1 - нет
+    int takeReload(RowKey &start)
+    {
+        const int index = m_reload;
+        m_reload = -1;
+        if (index >= 0) {
+            m_loading.insert(index);
+            start = m_pageStarts[index];
+        }
+        return index;
+    }
+
+    void setPage(int index, Page page)
+    {
+        m_loading.remove(index);
+        if (index < m_pageStarts.size()) {
+            cache(index, std::move(page));
+        }
+    }
+
+    // В конце прочитанного до конца списка появились строки. Неполная последняя
+    // страница читается заново (ее номер и ключ начала, ответ - в extendLastPage),
+    // после полной - pageCount(): следующая страница через beginFetch. -1 - список
+    // еще не дочитан, новые строки придут при прокрутке
+    int resume(RowKey &start)
+    {
+        if (!m_exhausted) {
+            return -1;
+        }
+        m_exhausted = false;
+        const int last = m_pageStarts.size() - 1;
+        if (last < 0 || lastPageRows() == m_pageRows) {
+            return m_pageStarts.size();
+        }
+        m_fetching = true;
+        m_loading.insert(last);
+        m_resumed = last;
+        start = m_pageStarts[last];
+        return last;
+    }
+    bool isResumed(int index) const { return index == m_resumed; }
+    int lastPageRows() const { return m_rowCount - (m_pageStarts.size() - 1) * m_pageRows; }
+
+    // Последняя страница после resume: строки сверх прежних добавляются в конец
+    void extendLastPage(Page page, const RowKey &lastKey)
+    {
+        const int index = m_resumed;
+        m_resumed = -1;
+        m_fetching = false;
+        m_loading.remove(index);
+        if (page.size() < m_pageRows) {
+            m_exhausted = true;
+        }
+        if (page.size() > lastPageRows()) {
+            m_rowCount += page.size() - lastPageRows();
+            m_nextKey = lastKey;
+        }
+        cache(index, std::move(page));
+    }
+
+    // Номера кэшированных страниц со строками, для которых stale(page, row) истинно.
+    // Страницы помечаются загружаемыми и читаются заново с прежних ключей начала;
+    // до ответа видны прежние строки. Вытесненные страницы и так будут прочитаны заново
+    template <typename Predicate>
+    QVector<int> takeStalePages(Predicate stale)
+    {
+        QVector<int> indexes;
+        for (auto it = m_pages.cbegin(); it != m_pages.cend(); ++it) {
+            if (m_loading.contains(it.key())) {
+                continue;
+            }
+            for (int row = 0; row < it->size(); ++row) {
+                if (stale(*it, row)) {
+                    indexes.append(it.key());
+                    m_loading.insert(it.key());
+                    break;
+                }
+            }
+        }
+        return indexes;
+    }
+    RowKey pageStart(int index) const { return m_pageStarts[index]; }
+
+private:
+    void cache(int index, Page page)
+    {
+        m_recent.removeOne(index);
+        while (m_pages.size() >= m_maxCachedPages && !m_recent.isEmpty()) {
+            m_pages.remove(m_recent.takeFirst());
+        }
+        m_recent.append(index);
+        m_pages.insert(index, std::move(page));
+    }
+
+    int m_pageRows;
+    int m_maxCachedPages;
+
+    RowKey m_nextKey;
+    QVector<RowKey> m_pageStarts;
+    int m_rowCount = 0;
+    bool m_exhausted = false;
+    bool m_fetching = false;
+
+    QHash<int, Page> m_pages;
+    QList<int> m_recent; // номера страниц кэша, давно использованные - первыми
+    QSet<int> m_loading; // вытесненные страницы, запрошенные заново
+    int m_reload = -1;
+    int m_resumed = -1; // последняя страница, перечитываемая после resume
+};
+
+// Модели только для чтения для списков игр и игроков главного окна. Строки
+// подгружаются через canFetchMore/fetchMore по мере прокрутки, фильтр и сортировка
+// (sort по щелчку на заголовке) выполняются в SQL. Текст ячейки формируется в
+// data() только для видимых строк.
+// Qt::UserRole первой колонки - ключ строки (game_id / player_id).
+// applyChange обновляет уже загруженные строки по DatabaseManager::dataChanged:
+// новые строки дописываются, измененные страницы читаются заново. С первой страницы
+// список загружается, когда изменение сдвигает строки: новые игры при порядке не по
+// возрастанию id, новые игроки. Порядок игроков по рейтингу во время генерации
+// приблизителен и уточняется по ее окончании (PlayersTableModel::refreshOrder).
+
+class GamesTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    static constexpr int PageRows = 500;
+    static constexpr int MaxCachedPages = 20;
+
+    explicit GamesTableModel(TableQueryThread *queries, QObject *parent = nullptr);
+
+    GamesQuery query() const { return m_query; }
+    // Новый фильтр или порядок: строки загружаются заново с первой страницы
+    void setQuery(const GamesQuery &query);
+    // Игры не меняются после записи: новые дописываются в конец при сортировке по
+    // возрастанию id, при другом порядке список загружается заново
+    void applyChange(const DataChange &change);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+signals:
+    // Первая страница текущего запроса загружена
+    void firstPageLoaded(int rows, qint64 elapsedMs);
+
+private slots:
+    void onPageReady(quint64 generation, int pageIndex, const GamesTable &page, qint64 elapsedMs);
+
+private:
+    void requestReload() const;
+
+    TableQueryThread *m_queries;
+    GamesQuery m_query;
+    quint64 m_generation = 0;
+    mutable PagedRows<GamesTable> m_rows;
+};
+
+class PlayersTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    static constexpr int PageRows = 500;
+    static constexpr int MaxCachedPages = 20;
+
+    explicit PlayersTableModel(TableQueryThread *queries, QObject *parent = nullptr);
+
+    PlayersQuery query() const { return m_query; }
+    void setQuery(const PlayersQuery &query);
+    // При сортировке по никнейму или уровню навыка порядок строк от результатов игр не
+    // зависит: перечитываются только страницы кэша с измененными игроками. При сортировке
+    // по рейтингу, RD, играм или победам перечитываются все страницы кэша с прежних ключей
+    // начала: значения свежие, но порядок приблизителен - игрок, сменивший место, может
+    // до refreshOrder повториться или пропасть на границе страниц. Новые игроки - список
+    // загружается заново
+    void applyChange(const DataChange &change);
+    // Точный порядок после изменений в приблизительном режиме applyChange: список
+    // загружается заново с первой страницы (по окончании генерации)
+    void refreshOrder();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+signals:
+    void firstPageLoaded(int rows, qint64 elapsedMs);
+
+private slots:
+    void onPageReady(quint64 generation, int pageIndex, const PlayersTable &page, qint64 elapsedMs);
+
+private:
+    void requestReload() const;
+
+    TableQueryThread *m_queries;
+    PlayersQuery m_query;
+    quint64 m_generation = 0;
+    bool m_orderStale = false;
+    mutable PagedRows<PlayersTable> m_rows;
+};
+
+// История игр игрока (окно игрока), новые игры первыми, страницами по game_id.
+// Qt::UserRole - ID игры
+class PlayerHistoryModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    static constexpr int PageRows = 500;
+    static constexpr int MaxCachedPages = 20;
+
+    PlayerHistoryModel(int playerId, TableQueryThread *queries, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+signals:
+    void firstPageLoaded(int rows, qint64 elapsedMs);
+
+private slots:
+    void onPageReady(quint64 generation, int pageIndex, const QVector<PlayerGameRecord> &page, qint64 elapsedMs);
+
+private:
+    void requestReload() const;
+
+    int m_playerId;
+    TableQueryThread *m_queries;
+    quint64 m_generation = 0;
+    mutable PagedRows<QVector<PlayerGameRecord>> m_rows;
+};
+
+#endif // RESULTTABLEMODELS_H
@@ -0,0 +1,173 @@
+#ifndef RESULTTABLES_H
+#define RESULTTABLES_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+// Типизированные наборы строк представлений (список игр, игроков, состав игры).
+// Каждая колонка - отдельный массив значений в виде, в котором они хранятся в БД;
+// строки для отображения формируются моделями таблиц только для видимых ячеек.
+
+// Колонка строк: UTF-8 в одной общей куче и смещения, без отдельного QString на строку
+class StringColumn
+{
+public:
+    void reserve(int rows, int averageBytes = 16)
+    {
+        m_offsets.reserve(rows + 1);
+        m_heap.reserve(rows * averageBytes);
+    }
+
+    void append(const QString &value)
+    {
+        m_heap.append(value.toUtf8());
+        m_offsets.append(static_cast<quint32>(m_heap.size()));
+    }
+
+    QString at(int row) const
+    {
+        const quint32 begin = m_offsets[row];
+        return QString::fromUtf8(m_heap.constData() + begin, m_offsets[row + 1] - begin);
+    }
+
+    int size() const { return m_offsets.size() - 1; }
+
+private:
+    QByteArray m_heap;
+    QVector<quint32> m_offsets{0};
+};
+
+// Текстовое имя уровня навыка (players.skill_level)
+inline QString skillLevelName(int skillLevel)
+{
+    switch (skillLevel) {
+    case 1: return QStringLiteral("Низкий");
+    case 2: return QStringLiteral("Средний");
+    case 3: return QStringLiteral("Выше среднего");
+    case 4: return QStringLiteral("Высокий");
+    default: return QStringLiteral("Неизвестный");
+    }
+}
+
+// Колонки списков главного окна: номера колонок моделей и колонки сортировки
+enum GamesColumn {
+    GamesIdColumn,
+    GamesDateColumn,
+    GamesTeam1ScoreColumn,
+    GamesTeam2ScoreColumn,
+    GamesWinnerColumn,
+    GamesColumnCount
+};
+
+enum PlayersColumn {
+    PlayersNicknameColumn,
+    PlayersRatingColumn,
+    PlayersRdColumn,
+    PlayersMatchesColumn,
+    PlayersSkillColumn,
+    PlayersWinsColumn,
+    PlayersWinRateColumn,
+    PlayersColumnCount
+};
+
+// Фильтр и порядок списка игр
+struct GamesQuery {
+    int sortColumn = GamesIdColumn;
+    Qt::SortOrder order = Qt::AscendingOrder;
+    QDateTime from; // невалидная дата - без ограничения
+    QDateTime to;
+};
+
+// Фильтр и порядок списка игроков
+struct PlayersQuery {
+    int sortColumn = PlayersRatingColumn;
+    Qt::SortOrder order = Qt::DescendingOrder;
+    QString nickname; // подстрока никнейма, пустая - все
+    int skillLevel = 0; // 0 - все уровни
+};
+
+// Позиция в отсортированном списке для постраничного чтения: строки после пары
+// (значение колонки сортировки, id строки). Без значения - с начала списка
+struct RowKey {
+    QVariant value;
+    qint64 id = 0;
+
+    bool isNull() const { return !value.isValid(); }
+};
+
+// Список игр (таблица games), в порядке чтения
+struct GamesTable {
+    QVector<qint64> gameIds;
+    QVector<qint64> gameDates; // секунды Unix
+    QVector<qint32> team1Scores;
+    QVector<qint32> team2Scores;
+    QVector<quint8> winnerTeams; // TeamSide
+
+    int size() const { return gameIds.size(); }
+
+    // Значение колонки сортировки; все колонки списка игр целочисленные
+    qint64 sortValue(int row, int column) const
+    {
+        switch (column) {
+        case GamesDateColumn: return gameDates[row];
+        case GamesTeam1ScoreColumn: return team1Scores[row];
+        case GamesTeam2ScoreColumn: return team2Scores[row];
+        case GamesWinnerColumn: return winnerTeams[row];
+        default: return gameIds[row];
+        }
+    }
+
+    void appendRow(const GamesTable &other, int row)
+    {
+        gameIds.append(other.gameIds[row]);
+        gameDates.append(other.gameDates[row]);
+        team1Scores.append(other.team1Scores[row]);
+        team2Scores.append(other.team2Scores[row]);
+        winnerTeams.append(other.winnerTeams[row]);
+    }
+};
+
+// Игроки по убыванию рейтинга
+struct PlayersTable {
+    QVector<qint32> playerIds;
+    StringColumn nicknames;
+    QVector<double> ratings;
+    QVector<double> rds;
+    QVector<qint32> totalMatches;
+    QVector<qint32> wins;
+    QVector<quint8> skillLevels;
+
+    int size() const { return playerIds.size(); }
+    // Та же формула, что и в SQL-выражении сортировки по проценту побед
+    double winRate(int row) const { return totalMatches[row] > 0 ? wins[row] * 100.0 / totalMatches[row] : 0.0; }
+
+    QVariant sortValue(int row, int column) const
+    {
+        switch (column) {
+        case PlayersNicknameColumn: return nicknames.at(row);
+        case PlayersRdColumn: return rds[row];
+        case PlayersMatchesColumn: return totalMatches[row];
+        case PlayersSkillColumn: return int(skillLevels[row]);
+        case PlayersWinsColumn: return wins[row];
+        case PlayersWinRateColumn: return winRate(row);
+        default: return ratings[row];
+        }
+    }
+};
+
+// Участники игры с изменением рейтинга
+struct GameDetailsTable {
+    StringColumn nicknames;
+    QVector<quint8> teams; // TeamSide
+    QVector<double> ratings;
+    QVector<double> ratingChanges;
+    QVector<quint8> skillLevels;
+    QVector<double> winRates; // проценты
+
+    int size() const { return teams.size(); }
+};
+
+#endif // RESULTTABLES_H
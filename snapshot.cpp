@@ -0,0 +1,430 @@
+#include "snapshot.h"
+#include <QDebug>
+#include <cstring>
+#include <limits>
+
+// Колонки пишутся и читаются как массивы в памяти без перестановки байтов
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "Snapshot format assumes a little-endian host");
+
+namespace {
+const char SnapshotMagic[8] = {'R', 'S', 'S', 'S', 'N', 'A', 'P', '\0'};
+const quint32 ByteOrderMark = 0x01020304;
+
+const int FileHeaderSize = 32;
+const int NameSize = 32;
+const int TableHeaderSize = NameSize + 16;
+const int ColumnDescriptorSize = NameSize + 8;
+const int RowGroupHeaderSize = 8;
+
+// String и Blob хранятся одинаково: смещения плюс куча байтов
+bool hasOffsets(SnapshotColumnType type)
+{
+    return type == SnapshotColumnType::String || type == SnapshotColumnType::Blob;
+}
+
+qint64 align8(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+template <typename T>
+void appendPod(QByteArray &out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readPod(const uchar *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+QByteArray fixedName(const QByteArray &name)
+{
+    QByteArray result = name.left(NameSize - 1);
+    result.append(NameSize - result.size(), '\0');
+    return result;
+}
+}
+
+SnapshotWriter::SnapshotWriter(QFileDevice *device)
+    : m_device(device)
+{
+}
+
+bool SnapshotWriter::fail(const QString &message)
+{
+    if (m_errorString.isEmpty()) {
+        m_errorString = message;
+    }
+    return false;
+}
+
+bool SnapshotWriter::writeBytes(const char *data, qint64 size)
+{
+    if (m_device->write(data, size) != size) {
+        return fail("Error writing snapshot: " + m_device->errorString());
+    }
+    return true;
+}
+
+bool SnapshotWriter::writePadded(const QByteArray &data)
+{
+    static const char zeros[8] = {};
+    return writeBytes(data.constData(), data.size())
+           && writeBytes(zeros, align8(data.size()) - data.size());
+}
+
+bool SnapshotWriter::writeHeader(int schemaVersion, int tableCount)
+{
+    QByteArray header(SnapshotMagic, sizeof(SnapshotMagic));
+    appendPod<quint32>(header, FormatVersion);
+    appendPod<quint32>(header, ByteOrderMark);
+    appendPod<quint32>(header, static_cast<quint32>(schemaVersion));
+    appendPod<quint32>(header, static_cast<quint32>(tableCount));
+    appendPod<quint64>(header, 0);
+    return writeBytes(header.constData(), header.size());
+}
+
+bool SnapshotWriter::beginTable(const QByteArray &name, const QVector<SnapshotColumnSpec> &columns)
+{
+    m_tableHeaderPos = m_device->pos();
+    m_tableRows = 0;
+    m_rowGroups = 0;
+    m_groupRows = 0;
+
+    // Число групп и строк заранее неизвестно - дописываются в endTable()
+    QByteArray header = fixedName(name);
+    appendPod<quint32>(header, static_cast<quint32>(columns.size()));
+    appendPod<quint32>(header, 0);
+    appendPod<quint64>(header, 0);
+
+    m_columns.clear();
+    for (const SnapshotColumnSpec &spec : columns) {
+        header += fixedName(spec.name);
+        appendPod<quint32>(header, static_cast<quint32>(spec.type));
+        appendPod<quint32>(header, 0);
+
+        ColumnBuffer buffer;
+        buffer.spec = spec;
+        if (hasOffsets(spec.type)) {
+            buffer.stringOffsets.append(0);
+        }
+        m_columns.append(buffer);
+    }
+
+    return writeBytes(header.constData(), header.size());
+}
+
+void SnapshotWriter::setValue(int column, const QVariant &value)
+{
+    ColumnBuffer &buffer = m_columns[column];
+    switch (buffer.spec.type) {
+    case SnapshotColumnType::Int32:
+        appendPod<qint32>(buffer.data, value.toInt());
+        break;
+    case SnapshotColumnType::Int64:
+        appendPod<qint64>(buffer.data, value.toLongLong());
+        break;
+    case SnapshotColumnType::Float64:
+        appendPod<double>(buffer.data, value.toDouble());
+        break;
+    case SnapshotColumnType::String:
+        buffer.data += value.toString().toUtf8();
+        buffer.stringOffsets.append(static_cast<quint32>(buffer.data.size()));
+        break;
+    case SnapshotColumnType::Blob:
+        buffer.data += value.toByteArray();
+        buffer.stringOffsets.append(static_cast<quint32>(buffer.data.size()));
+        break;
+    }
+}
+
+bool SnapshotWriter::endRow()
+{
+    ++m_tableRows;
+    if (++m_groupRows >= RowGroupSize) {
+        return flushRowGroup();
+    }
+    return m_errorString.isEmpty();
+}
+
+bool SnapshotWriter::flushRowGroup()
+{
+    if (m_groupRows == 0) {
+        return m_errorString.isEmpty();
+    }
+
+    QByteArray header;
+    appendPod<quint32>(header, static_cast<quint32>(m_groupRows));
+    appendPod<quint32>(header, static_cast<quint32>(m_columns.size()));
+    if (!writeBytes(header.constData(), header.size())) {
+        return false;
+    }
+
+    for (ColumnBuffer &buffer : m_columns) {
+        QByteArray offsets;
+        if (hasOffsets(buffer.spec.type)) {
+            offsets = QByteArray(reinterpret_cast<const char*>(buffer.stringOffsets.constData()),
+                                 buffer.stringOffsets.size() * sizeof(quint32));
+        }
+
+        QByteArray blockSize;
+        appendPod<quint64>(blockSize, align8(offsets.size()) + align8(buffer.data.size()));
+        if (!writeBytes(blockSize.constData(), blockSize.size())
+            || (!offsets.isEmpty() && !writePadded(offsets))
+            || !writePadded(buffer.data)) {
+            return false;
+        }
+
+        buffer.data.clear();
+        if (hasOffsets(buffer.spec.type)) {
+            buffer.stringOffsets.clear();
+            buffer.stringOffsets.append(0);
+        }
+    }
+
+    ++m_rowGroups;
+    m_groupRows = 0;
+    return true;
+}
+
+bool SnapshotWriter::endTable()
+{
+    if (!flushRowGroup()) {
+        return false;
+    }
+
+    const qint64 endPos = m_device->pos();
+    QByteArray counts;
+    appendPod<quint32>(counts, m_rowGroups);
+    appendPod<quint64>(counts, static_cast<quint64>(m_tableRows));
+    if (!m_device->seek(m_tableHeaderPos + NameSize + 4)
+        || !writeBytes(counts.constData(), counts.size())
+        || !m_device->seek(endPos)) {
+        return fail("Error finalizing snapshot table: " + m_device->errorString());
+    }
+    return true;
+}
+
+qint64 SnapshotReader::ColumnView::intAt(int row) const
+{
+    switch (type) {
+    case SnapshotColumnType::Int32:
+        return reinterpret_cast<const qint32*>(data)[row];
+    case SnapshotColumnType::Int64:
+        return reinterpret_cast<const qint64*>(data)[row];
+    case SnapshotColumnType::Float64:
+        return static_cast<qint64>(reinterpret_cast<const double*>(data)[row]);
+    case SnapshotColumnType::String:
+    case SnapshotColumnType::Blob:
+        break;
+    }
+    return stringAt(row).toLongLong();
+}
+
+double SnapshotReader::ColumnView::doubleAt(int row) const
+{
+    if (type == SnapshotColumnType::Float64) {
+        return reinterpret_cast<const double*>(data)[row];
+    }
+    return static_cast<double>(intAt(row));
+}
+
+QByteArray SnapshotReader::ColumnView::stringAt(int row) const
+{
+    if (!hasOffsets(type)) {
+        return QByteArray::number(intAt(row));
+    }
+    return QByteArray(data + stringOffsets[row], stringOffsets[row + 1] - stringOffsets[row]);
+}
+
+QVariant SnapshotReader::ColumnView::valueAt(int row) const
+{
+    switch (type) {
+    case SnapshotColumnType::Int32:
+        return reinterpret_cast<const qint32*>(data)[row];
+    case SnapshotColumnType::Int64:
+        return reinterpret_cast<const qint64*>(data)[row];
+    case SnapshotColumnType::Float64:
+        return reinterpret_cast<const double*>(data)[row];
+    case SnapshotColumnType::String:
+        break;
+    case SnapshotColumnType::Blob:
+        return stringAt(row);
+    }
+    return QString::fromUtf8(stringAt(row));
+}
+
+int SnapshotReader::Table::columnIndex(const QByteArray &columnName) const
+{
+    for (int i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == columnName) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SnapshotReader::SnapshotReader(const QString &filePath)
+    : m_file(filePath)
+{
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+bool SnapshotReader::fail(const QString &message)
+{
+    m_errorString = message;
+    m_tables.clear();
+    return false;
+}
+
+const SnapshotReader::Table *SnapshotReader::table(const QByteArray &name) const
+{
+    for (const Table &table : m_tables) {
+        if (table.name == name) {
+            return &table;
+        }
+    }
+    return nullptr;
+}
+
+bool SnapshotReader::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return fail("Failed to open snapshot: " + m_file.errorString());
+    }
+    m_size = m_file.size();
+    if (m_size < FileHeaderSize) {
+        return fail("Snapshot file is too small");
+    }
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        return fail("Failed to map snapshot: " + m_file.errorString());
+    }
+
+    if (std::memcmp(m_data, SnapshotMagic, sizeof(SnapshotMagic)) != 0) {
+        return fail("Not a snapshot file");
+    }
+    // Версия 2 добавила тип Blob, файлы версии 1 читаются как есть
+    const quint32 formatVersion = readPod<quint32>(m_data + 8);
+    if (formatVersion < 1 || formatVersion > SnapshotWriter::FormatVersion) {
+        return fail("Unsupported snapshot format version");
+    }
+    if (readPod<quint32>(m_data + 12) != ByteOrderMark) {
+        return fail("Snapshot was written with a different byte order");
+    }
+    m_schemaVersion = static_cast<int>(readPod<quint32>(m_data + 16));
+    const quint32 tableCount = readPod<quint32>(m_data + 20);
+
+    qint64 pos = FileHeaderSize;
+    auto available = [&](qint64 bytes) { return bytes >= 0 && pos + bytes <= m_size; };
+
+    for (quint32 t = 0; t < tableCount; ++t) {
+        if (!available(TableHeaderSize)) {
+            return fail("Truncated snapshot table header");
+        }
+        Table table;
+        // Имя дополнено нулями до NameSize; без завершающего нуля чтение не выходит за поле
+        const char *tableName = reinterpret_cast<const char*>(m_data + pos);
+        table.name = QByteArray(tableName, int(qstrnlen(tableName, NameSize)));
+        const quint32 columnCount = readPod<quint32>(m_data + pos + NameSize);
+        const quint32 rowGroupCount = readPod<quint32>(m_data + pos + NameSize + 4);
+        table.rowCount = static_cast<qint64>(readPod<quint64>(m_data + pos + NameSize + 8));
+        pos += TableHeaderSize;
+
+        if (!available(qint64(columnCount) * ColumnDescriptorSize)) {
+            return fail("Truncated snapshot column list");
+        }
+        for (quint32 c = 0; c < columnCount; ++c) {
+            SnapshotColumnSpec spec;
+            const char *columnName = reinterpret_cast<const char*>(m_data + pos);
+            spec.name = QByteArray(columnName, int(qstrnlen(columnName, NameSize)));
+            spec.type = static_cast<SnapshotColumnType>(readPod<quint32>(m_data + pos + NameSize));
+            if (spec.type < SnapshotColumnType::Int32 || spec.type > SnapshotColumnType::Blob) {
+                return fail("Unknown snapshot column type");
+            }
+            table.columns.append(spec);
+            pos += ColumnDescriptorSize;
+        }
+
+        qint64 rowsSeen = 0;
+        for (quint32 g = 0; g < rowGroupCount; ++g) {
+            if (!available(RowGroupHeaderSize)) {
+                return fail("Truncated snapshot row group");
+            }
+            RowGroup group;
+            const quint32 groupRows = readPod<quint32>(m_data + pos);
+            if (groupRows > quint32(std::numeric_limits<int>::max())) {
+                return fail("Corrupted snapshot row group");
+            }
+            group.rowCount = static_cast<int>(groupRows);
+            if (readPod<quint32>(m_data + pos + 4) != columnCount) {
+                return fail("Corrupted snapshot row group");
+            }
+            pos += RowGroupHeaderSize;
+
+            for (quint32 c = 0; c < columnCount; ++c) {
+                if (!available(8)) {
+                    return fail("Truncated snapshot column block");
+                }
+                const qint64 blockSize = static_cast<qint64>(readPod<quint64>(m_data + pos));
+                pos += 8;
+                if (!available(blockSize)) {
+                    return fail("Truncated snapshot column block");
+                }
+
+                ColumnView view;
+                view.type = table.columns[c].type;
+                const char *block = reinterpret_cast<const char*>(m_data + pos);
+                if (hasOffsets(view.type)) {
+                    const qint64 offsetsSize = align8((qint64(group.rowCount) + 1) * sizeof(quint32));
+                    view.stringOffsets = reinterpret_cast<const quint32*>(block);
+                    view.data = block + offsetsSize;
+                    if (offsetsSize > blockSize) {
+                        return fail("Corrupted snapshot string column");
+                    }
+                    // stringAt доверяет смещениям: они не убывают, начинаются с 0 и не выходят за
+                    // данные колонки, иначе длина строки отрицательна или чтение идет за блок
+                    const quint32 heapSize = quint32(qMin<qint64>(blockSize - offsetsSize,
+                                                                  std::numeric_limits<quint32>::max()));
+                    if (view.stringOffsets[0] != 0) {
+                        return fail("Corrupted snapshot string column");
+                    }
+                    for (int row = 0; row < group.rowCount; ++row) {
+                        if (view.stringOffsets[row + 1] < view.stringOffsets[row]
+                            || view.stringOffsets[row + 1] > heapSize) {
+                            return fail("Corrupted snapshot string column");
+                        }
+                    }
+                } else {
+                    view.data = block;
+                    const qint64 width = view.type == SnapshotColumnType::Int32 ? 4 : 8;
+                    if (qint64(group.rowCount) * width > blockSize) {
+                        return fail("Corrupted snapshot column block");
+                    }
+                }
+                group.columns.append(view);
+                pos += blockSize;
+            }
+
+            rowsSeen += group.rowCount;
+            table.rowGroups.append(group);
+        }
+
+        if (rowsSeen != table.rowCount) {
+            return fail("Snapshot row count mismatch in table " + QString::fromUtf8(table.name));
+        }
+        m_tables.append(table);
+    }
+
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+// Бинарный колоночный снимок БД (.rss).
+//
+// Файл: заголовок, затем таблицы подряд. Таблица: заголовок, описания колонок и
+// группы строк по RowGroupSize строк. Внутри группы каждая колонка - отдельный блок:
+// Int32/Int64/Float64 - массив фиксированной ширины, String и Blob - смещения (u32,
+// строк+1) и куча байтов (UTF-8 или произвольных). Все блоки выровнены на 8 байт, порядок байтов - little-endian,
+// поэтому после mmap колонки читаются как обычные массивы без разбора.
+enum class SnapshotColumnType : quint32 {
+    Int32 = 1,
+    Int64 = 2,
+    Float64 = 3,
+    String = 4,
+    Blob = 5   // с версии формата 2
+};
+
+struct SnapshotColumnSpec {
+    QByteArray name;
+    SnapshotColumnType type;
+};
+
+// Последовательная запись снимка; строки добавляются по значению колонки,
+// группа строк сбрасывается в файл при заполнении
+class SnapshotWriter
+{
+public:
+    static constexpr quint32 FormatVersion = 2;
+    static constexpr int RowGroupSize = 65536;
+
+    explicit SnapshotWriter(QFileDevice *device);
+
+    bool writeHeader(int schemaVersion, int tableCount);
+
+    bool beginTable(const QByteArray &name, const QVector<SnapshotColumnSpec> &columns);
+    void setValue(int column, const QVariant &value);
+    bool endRow();
+    bool endTable();
+
+    QString errorString() const { return m_errorString; }
+
+private:
+    struct ColumnBuffer {
+        SnapshotColumnSpec spec;
+        QByteArray data;
+        QVector<quint32> stringOffsets;
+    };
+
+    bool flushRowGroup();
+    bool writeBytes(const char *data, qint64 size);
+    bool writePadded(const QByteArray &data);
+    bool fail(const QString &message);
+
+    QFileDevice *m_device;
+    QVector<ColumnBuffer> m_columns;
+    qint64 m_tableHeaderPos = 0;
+    qint64 m_tableRows = 0;
+    quint32 m_rowGroups = 0;
+    int m_groupRows = 0;
+    QString m_errorString;
+};
+
+// Чтение снимка через mmap: заголовки разбираются при open(), данные колонок
+// остаются в отображенном файле и читаются напрямую
+class SnapshotReader
+{
+public:
+    struct ColumnView {
+        SnapshotColumnType type;
+        const char *data = nullptr;            // массив значений или куча строк
+        const quint32 *stringOffsets = nullptr; // только для String и Blob
+
+        qint64 intAt(int row) const;
+        double doubleAt(int row) const;
+        QByteArray stringAt(int row) const;
+        QVariant valueAt(int row) const;
+    };
+
+    struct RowGroup {
+        int rowCount = 0;
+        QVector<ColumnView> columns;
+    };
+
+    struct Table {
+        QByteArray name;
+        qint64 rowCount = 0;
+        QVector<SnapshotColumnSpec> columns;
+        QVector<RowGroup> rowGroups;
+
+        int columnIndex(const QByteArray &columnName) const;
+    };
+
+    explicit SnapshotReader(const QString &filePath);
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+    bool open();
+
+    int schemaVersion() const { return m_schemaVersion; }
+    const QVector<Table> &tables() const { return m_tables; }
+    const Table *table(const QByteArray &name) const;
+    qint64 fileSize() const { return m_size; }
+
+    QString errorString() const { return m_errorString; }
+
+private:
+    bool fail(const QString &message);
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    int m_schemaVersion = 0;
+    QVector<Table> m_tables;
+    QString m_errorString;
+};
+
+#endif // SNAPSHOT_H
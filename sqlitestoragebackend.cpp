@@ -0,0 +1,217 @@
+#include "sqlitestoragebackend.h"
+#include "databasemanager.h"
+#include "tracer.h"
+
+SqliteStorageBackend::SqliteStorageBackend(DatabaseManager *dbManager)
+    : m_dbManager(dbManager)
+{
+}
+
+bool SqliteStorageBackend::beginBatch()
+{
+    if (!m_dbManager->database().transaction()) {
+        qDebug() << "Failed to start transaction:" << m_dbManager->database().lastError().text();
+        return false;
+    }
+    m_inBatch = true;
+    return true;
+}
+
+bool SqliteStorageBackend::commitBatch()
+{
+    if (!flushRatingHistory()) {
+        rollbackBatch();
+        return false;
+    }
+    if (!m_dbManager->database().commit()) {
+        qDebug() << "Failed to commit transaction:" << m_dbManager->database().lastError().text();
+        rollbackBatch();
+        return false;
+    }
+    m_inBatch = false;
+    m_dbManager->notifyDataChanged(takeBatchChange());
+    return true;
+}
+
+void SqliteStorageBackend::rollbackBatch()
+{
+    m_inBatch = false;
+    m_dbManager->database().rollback();
+    // Каталог разделов в памяти уже учел игры пакета
+    if (m_dbManager->isPartitioned()) {
+        m_dbManager->loadPartitionCatalog();
+    }
+    // Хвосты траекторий перечитываются из БД при следующей записи
+    m_historyTails.clear();
+    m_dirtyHistory.clear();
+    takeBatchChange();
+}
+
+bool SqliteStorageBackend::preparePeriod(const QDateTime &gameDate)
+{
+    return m_dbManager->preparePartition(gameDate);
+}
+
+bool SqliteStorageBackend::isPeriodReady(const QDateTime &gameDate)
+{
+    return m_dbManager->isPartitionReady(gameDate);
+}
+
+bool SqliteStorageBackend::clear()
+{
+    m_historyTails.clear();
+    m_dirtyHistory.clear();
+    takeBatchChange();
+    return m_dbManager->clearDatabase();
+}
+
+int SqliteStorageBackend::addPlayer(const QString &nickname, int skillLevel, double rating)
+{
+    QSqlQuery &query = m_dbManager->cachedStatement(Statement::AddPlayer);
+    query.bindValue(":nickname", nickname);
+    query.bindValue(":rating", rating);
+    query.bindValue(":skillLevel", skillLevel);
+
+    if (!query.exec()) {
+        // SQLITE_CONSTRAINT_UNIQUE: ник уже занят
+        if (query.lastError().nativeErrorCode() == QLatin1String("2067")) {
+            return 0;
+        }
+        qDebug() << "Error creating player:" << query.lastError().text();
+        return -1;
+    }
+    const int playerId = query.lastInsertId().toInt();
+    m_newPlayers.add(playerId);
+    return playerId;
+}
+
+int SqliteStorageBackend::playerCount()
+{
+    return m_dbManager->countPlayers();
+}
+
+QVector<PlayerData> SqliteStorageBackend::players()
+{
+    return m_dbManager->getPlayersForMatching();
+}
+
+bool SqliteStorageBackend::player(int playerId, PlayerData &data)
+{
+    return m_dbManager->getPlayer(playerId, data);
+}
+
+bool SqliteStorageBackend::applyGameResult(int playerId, double rating, double rd, bool win)
+{
+    if (!m_dbManager->applyGameResult(playerId, rating, rd, win)) {
+        return false;
+    }
+    if (playerId >= m_changedPlayers.size()) {
+        m_changedPlayers.resize(qMax(playerId + 1, m_changedPlayers.size() * 2));
+    }
+    m_changedPlayers.setBit(playerId);
+    return true;
+}
+
+int SqliteStorageBackend::insertGame(const QDateTime &gameDate, int team1Score, int team2Score, TeamSide winnerTeam)
+{
+    const int gameId = m_dbManager->insertGame(gameDate, team1Score, team2Score, winnerTeam);
+    if (gameId > 0) {
+        m_newGames.add(gameId);
+    }
+    return gameId;
+}
+
+bool SqliteStorageBackend::addParticipation(int gameId, int playerId, TeamSide team, double ratingChange)
+{
+    return m_dbManager->addPlayerToGame(gameId, playerId, team, ratingChange);
+}
+
+QVector<PlayerGameRecord> SqliteStorageBackend::playerHistory(int playerId)
+{
+    return m_dbManager->getPlayerHistory(playerId);
+}
+
+bool SqliteStorageBackend::appendRatingPoint(int playerId, const RatingPoint &point)
+{
+    auto it = m_historyTails.find(playerId);
+    if (it == m_historyTails.end()) {
+        // Первая точка игрока в этом хранилище: продолжаем его последний блок в БД
+        int seq = -1;
+        QByteArray lastBlock;
+        if (!m_dbManager->lastRatingHistoryBlock(playerId, seq, lastBlock)) {
+            return false;
+        }
+        it = m_historyTails.insert(playerId, HistoryTail());
+        it->seq = qMax(seq, 0);
+        it->encoder.reset(lastBlock);
+    }
+
+    HistoryTail &tail = *it;
+    if (tail.encoder.isFull()) {
+        // Точки заполненного блока записываются сразу, новые идут в следующий блок
+        if (tail.pendingPoints > 0
+            && !m_dbManager->appendRatingHistory(playerId, tail.seq, tail.pendingPoints, tail.pending)) {
+            return false;
+        }
+        tail.pending.clear();
+        tail.pendingPoints = 0;
+        ++tail.seq;
+        tail.encoder.reset();
+    }
+
+    if (tail.pendingPoints == 0) {
+        m_dirtyHistory.append(playerId);
+    }
+    tail.encoder.append(point, tail.pending);
+    ++tail.pendingPoints;
+
+    return m_inBatch || flushRatingHistory();
+}
+
+bool SqliteStorageBackend::flushRatingHistory()
+{
+    TRACE_SCOPE("flushRatingHistory");
+    for (int playerId : m_dirtyHistory) {
+        HistoryTail &tail = m_historyTails[playerId];
+        if (tail.pendingPoints == 0) {
+            continue;
+        }
+        if (!m_dbManager->appendRatingHistory(playerId, tail.seq, tail.pendingPoints, tail.pending)) {
+            return false;
+        }
+        tail.pending.clear();
+        tail.pendingPoints = 0;
+    }
+    m_dirtyHistory.clear();
+    return true;
+}
+
+QVector<RatingPoint> SqliteStorageBackend::ratingHistory(int playerId)
+{
+    return m_dbManager->getRatingHistory(playerId);
+}
+
+DataChange SqliteStorageBackend::takeBatchChange()
+{
+    DataChange change;
+    change.newGames = m_newGames;
+    change.newPlayers = m_newPlayers;
+    // Измененные игроки - подряд идущие установленные биты
+    for (int id = 0; id < m_changedPlayers.size(); ++id) {
+        if (!m_changedPlayers.testBit(id)) {
+            continue;
+        }
+        IdRange range;
+        range.first = id;
+        while (id + 1 < m_changedPlayers.size() && m_changedPlayers.testBit(id + 1)) {
+            ++id;
+        }
+        range.last = id;
+        change.changedPlayers.append(range);
+    }
+
+    m_newGames = IdRange();
+    m_newPlayers = IdRange();
+    m_changedPlayers.clear();
+    return change;
+}
@@ -0,0 +1,65 @@
+#ifndef SQLITESTORAGEBACKEND_H
+#define SQLITESTORAGEBACKEND_H
+
+#include <QBitArray>
+#include <QHash>
+#include "databasemanager.h"
+#include "storagebackend.h"
+
+// Хранилище поверх БД приложения: запросы выполняет DatabaseManager на
+// соединении вызывающего потока, пакет записей - транзакция SQLite.
+// Точки траектории рейтинга копятся в памяти по игрокам и дописываются
+// в rating_history одним запросом на игрока при фиксации пакета. Новые игры и
+// игроки и игроки с новым результатом пакета после коммита сообщаются
+// через DatabaseManager::notifyDataChanged
+class SqliteStorageBackend : public StorageBackend
+{
+public:
+    explicit SqliteStorageBackend(DatabaseManager *dbManager);
+
+    bool beginBatch() override;
+    bool commitBatch() override;
+    void rollbackBatch() override;
+    bool preparePeriod(const QDateTime &gameDate) override;
+    bool isPeriodReady(const QDateTime &gameDate) override;
+
+    bool clear() override;
+
+    int addPlayer(const QString &nickname, int skillLevel, double rating) override;
+    int playerCount() override;
+    QVector<PlayerData> players() override;
+    bool player(int playerId, PlayerData &data) override;
+    bool applyGameResult(int playerId, double rating, double rd, bool win) override;
+
+    int insertGame(const QDateTime &gameDate, int team1Score, int team2Score, TeamSide winnerTeam) override;
+    bool addParticipation(int gameId, int playerId, TeamSide team, double ratingChange) override;
+
+    QVector<PlayerGameRecord> playerHistory(int playerId) override;
+
+    bool appendRatingPoint(int playerId, const RatingPoint &point) override;
+    QVector<RatingPoint> ratingHistory(int playerId) override;
+
+private:
+    // Последний блок траектории игрока: состояние кодировщика и еще не записанные точки
+    struct HistoryTail {
+        int seq = 0;
+        RatingHistoryEncoder encoder;
+        QByteArray pending;
+        int pendingPoints = 0;
+    };
+
+    bool flushRatingHistory();
+    // Изменения пакета для DatabaseManager::dataChanged
+    DataChange takeBatchChange();
+
+    DatabaseManager *m_dbManager;
+    bool m_inBatch = false;
+    QHash<int, HistoryTail> m_historyTails;
+    QVector<int> m_dirtyHistory;
+    // Изменения пакета: id новых игр и игроков, бит на каждого измененного игрока
+    IdRange m_newGames;
+    IdRange m_newPlayers;
+    QBitArray m_changedPlayers;
+};
+
+#endif // SQLITESTORAGEBACKEND_H
@@ -0,0 +1,93 @@
+#ifndef STORAGEBACKEND_H
+#define STORAGEBACKEND_H
+
+#include <QDateTime>
+#include <QString>
+#include <QVector>
+#include "ratinghistory.h"
+
+// Сторона команды в игре; в БД хранится как INTEGER (games.winner_team, game_participation.team)
+enum TeamSide : quint8 {
+    Team1 = 1,
+    Team2 = 2
+};
+
+// Текстовое имя стороны ('team1'/'team2') для отображения и JSON-экспорта
+inline QString teamSideName(int side)
+{
+    return side == Team1 ? QStringLiteral("team1") : QStringLiteral("team2");
+}
+
+inline TeamSide teamSideFromName(const QString &name)
+{
+    return name == QLatin1String("team1") ? Team1 : Team2;
+}
+
+// Структура для хранения данных о игроке и его рейтинге
+struct PlayerData {
+    int playerId;
+    QString nickname;
+    double rating;
+    double rd;
+    int skillLevel;
+    int totalMatches;
+    int wins;
+    double winRate;
+};
+
+// Строка истории игр игрока
+struct PlayerGameRecord {
+    int gameId;
+    int team1Score;
+    int team2Score;
+    qint64 gameDate; // секунды эпохи
+    bool win;
+    double ratingChange;
+};
+
+// Хранилище данных симуляции: игроки, игры, участия и рейтинги. Генератор игр
+// работает только через этот интерфейс. Реализации: SqliteStorageBackend (БД
+// приложения через DatabaseManager) и LogStorageBackend (состояние в памяти и
+// журнал только на дописывание - для длинных симуляций без произвольного SQL).
+class StorageBackend
+{
+public:
+    virtual ~StorageBackend() = default;
+
+    // Пакет записей: для SQLite - транзакция, для журнала - одна запись на диск;
+    // rollbackBatch отменяет незафиксированные записи пакета
+    virtual bool beginBatch() = 0;
+    virtual bool commitBatch() = 0;
+    virtual void rollbackBatch() = 0;
+
+    // Подготовить запись игр с датой gameDate; вызывается вне пакета (SQLite с
+    // разделами подключает файл месяца, что невозможно внутри транзакции).
+    // isPeriodReady - подготовка уже сделана и игру можно писать в текущий пакет
+    virtual bool preparePeriod(const QDateTime &gameDate) { Q_UNUSED(gameDate); return true; }
+    virtual bool isPeriodReady(const QDateTime &gameDate) { Q_UNUSED(gameDate); return true; }
+
+    // Удалить всех игроков и историю игр
+    virtual bool clear() = 0;
+
+    // Новый игрок: id, 0 если ник уже занят, -1 при ошибке
+    virtual int addPlayer(const QString &nickname, int skillLevel, double rating) = 0;
+    virtual int playerCount() = 0;
+    virtual QVector<PlayerData> players() = 0;
+    virtual bool player(int playerId, PlayerData &data) = 0;
+
+    // Итог игры для игрока: новый рейтинг и RD, +1 игра и +1 победа при win
+    virtual bool applyGameResult(int playerId, double rating, double rd, bool win) = 0;
+
+    // Новая игра: id или -1
+    virtual int insertGame(const QDateTime &gameDate, int team1Score, int team2Score, TeamSide winnerTeam) = 0;
+    virtual bool addParticipation(int gameId, int playerId, TeamSide team, double ratingChange) = 0;
+
+    // Игры игрока, новые первыми
+    virtual QVector<PlayerGameRecord> playerHistory(int playerId) = 0;
+
+    // Точка траектории рейтинга игрока (после игры) и вся траектория, старые точки первыми
+    virtual bool appendRatingPoint(int playerId, const RatingPoint &point) = 0;
+    virtual QVector<RatingPoint> ratingHistory(int playerId) = 0;
+};
+
+#endif // STORAGEBACKEND_H
@@ -0,0 +1,144 @@
+// tablequerythread.cpp
+#include "tablequerythread.h"
+#include "tracer.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+TableQueryThread::TableQueryThread(DatabaseManager* dbManager, QObject *parent)
+    : QThread(parent), m_dbManager(dbManager)
+{
+    qRegisterMetaType<GamesTable>("GamesTable");
+    qRegisterMetaType<PlayersTable>("PlayersTable");
+    qRegisterMetaType<QVector<PlayerGameRecord>>("QVector<PlayerGameRecord>");
+    qRegisterMetaType<QVector<RatingPoint>>("QVector<RatingPoint>");
+}
+
+TableQueryThread::~TableQueryThread() {
+    stop();
+    if (isRunning()) {
+        wait();
+    }
+}
+
+quint64 TableQueryThread::startGeneration() {
+    return ++m_generation;
+}
+
+void TableQueryThread::requestGamesPage(quint64 generation, int pageIndex, const GamesQuery &query,
+                                        const RowKey &after, int limit) {
+    Request request;
+    request.generation = generation;
+    request.pageIndex = pageIndex;
+    request.gamesQuery = query;
+    request.after = after;
+    request.limit = limit;
+    enqueue(request);
+}
+
+void TableQueryThread::requestPlayersPage(quint64 generation, int pageIndex, const PlayersQuery &query,
+                                          const RowKey &after, int limit) {
+    Request request;
+    request.generation = generation;
+    request.pageIndex = pageIndex;
+    request.kind = Kind::PlayersPage;
+    request.playersQuery = query;
+    request.after = after;
+    request.limit = limit;
+    enqueue(request);
+}
+
+void TableQueryThread::requestHistoryPage(quint64 generation, int pageIndex, int playerId,
+                                          const RowKey &after, int limit) {
+    Request request;
+    request.generation = generation;
+    request.pageIndex = pageIndex;
+    request.kind = Kind::HistoryPage;
+    request.playerId = playerId;
+    request.after = after;
+    request.limit = limit;
+    enqueue(request);
+}
+
+void TableQueryThread::requestRatingHistory(quint64 generation, int playerId, int maxPoints) {
+    Request request;
+    request.generation = generation;
+    request.kind = Kind::RatingHistory;
+    request.playerId = playerId;
+    request.limit = maxPoints;
+    enqueue(request);
+}
+
+void TableQueryThread::stop() {
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+    ++m_generation;
+    m_wakeUp.wakeAll();
+}
+
+void TableQueryThread::enqueue(const Request &request) {
+    QMutexLocker locker(&m_mutex);
+    m_requests.enqueue(request);
+    m_wakeUp.wakeOne();
+}
+
+void TableQueryThread::run() {
+    forever {
+        Request request;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_requests.isEmpty() && !m_stopping) {
+                m_wakeUp.wait(&m_mutex);
+            }
+            if (m_stopping) {
+                break;
+            }
+            request = m_requests.dequeue();
+        }
+
+        // Запрос устарел, пока ждал в очереди (пользователь продолжил ввод)
+        auto isCancelled = [this, &request]() { return request.generation != m_generation.load(); };
+        if (isCancelled()) {
+            continue;
+        }
+
+        TRACE_SCOPE("TableQueryThread::page");
+        QElapsedTimer timer;
+        timer.start();
+        switch (request.kind) {
+        case Kind::GamesPage: {
+            GamesTable page = m_dbManager->getGamesPage(request.gamesQuery, request.after,
+                                                        request.limit, isCancelled);
+            if (!isCancelled()) {
+                emit gamesPageReady(request.generation, request.pageIndex, page, timer.elapsed());
+            }
+            break;
+        }
+        case Kind::PlayersPage: {
+            PlayersTable page = m_dbManager->getPlayersPage(request.playersQuery, request.after,
+                                                            request.limit, isCancelled);
+            if (!isCancelled()) {
+                emit playersPageReady(request.generation, request.pageIndex, page, timer.elapsed());
+            }
+            break;
+        }
+        case Kind::HistoryPage: {
+            QVector<PlayerGameRecord> page = m_dbManager->getPlayerHistoryPage(request.playerId, request.after,
+                                                                               request.limit, isCancelled);
+            if (!isCancelled()) {
+                emit historyPageReady(request.generation, request.pageIndex, page, timer.elapsed());
+            }
+            break;
+        }
+        case Kind::RatingHistory: {
+            // Траектория читается одним диапазоном блоков, прореживается здесь же
+            const QVector<RatingPoint> points = m_dbManager->getRatingHistory(request.playerId);
+            if (!isCancelled()) {
+                emit ratingHistoryReady(request.generation, downsampleRatingHistory(points, request.limit),
+                                        points.size(), timer.elapsed());
+            }
+            break;
+        }
+        }
+    }
+    m_dbManager->releaseThreadConnection();
+}
@@ -0,0 +1,82 @@
+// tablequerythread.h
+#ifndef TABLEQUERYTHREAD_H
+#define TABLEQUERYTHREAD_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+#include "databasemanager.h"
+
+// Поток запросов страниц для списков главного окна и окна игрока. Запросы выполняются через
+// собственное соединение потока, GUI не ждет БД. Каждое изменение фильтра или
+// сортировки начинает новое поколение: запросы прежних поколений из очереди не
+// выполняются, а уже выполняемый прекращает чтение строк. Сам шаг SQLite (например,
+// сортировка без индекса) не прерывается - его результат просто отбрасывается.
+class TableQueryThread : public QThread {
+    Q_OBJECT
+
+public:
+    explicit TableQueryThread(DatabaseManager* dbManager, QObject *parent = nullptr);
+    ~TableQueryThread() override;
+
+    // Новое поколение запросов; все запросы прежних поколений отменяются
+    quint64 startGeneration();
+    quint64 currentGeneration() const { return m_generation.load(); }
+
+    void requestGamesPage(quint64 generation, int pageIndex, const GamesQuery &query, const RowKey &after, int limit);
+    void requestPlayersPage(quint64 generation, int pageIndex, const PlayersQuery &query, const RowKey &after, int limit);
+    void requestHistoryPage(quint64 generation, int pageIndex, int playerId, const RowKey &after, int limit);
+    // Траектория рейтинга игрока, прореженная до maxPoints точек
+    void requestRatingHistory(quint64 generation, int playerId, int maxPoints);
+
+    // Завершить поток после текущего запроса
+    void stop();
+
+signals:
+    void gamesPageReady(quint64 generation, int pageIndex, const GamesTable &page, qint64 elapsedMs);
+    void playersPageReady(quint64 generation, int pageIndex, const PlayersTable &page, qint64 elapsedMs);
+    void historyPageReady(quint64 generation, int pageIndex, const QVector<PlayerGameRecord> &page, qint64 elapsedMs);
+    // totalPoints - число точек траектории до прореживания
+    void ratingHistoryReady(quint64 generation, const QVector<RatingPoint> &points, int totalPoints, qint64 elapsedMs);
+
+protected:
+    void run() override;
+
+private:
+    enum class Kind {
+        GamesPage,
+        PlayersPage,
+        HistoryPage,
+        RatingHistory
+    };
+
+    struct Request {
+        quint64 generation = 0;
+        int pageIndex = 0;
+        Kind kind = Kind::GamesPage;
+        GamesQuery gamesQuery;
+        PlayersQuery playersQuery;
+        int playerId = 0;
+        RowKey after;
+        int limit = 0; // строк страницы или точек траектории
+    };
+
+    void enqueue(const Request &request);
+
+    DatabaseManager* m_dbManager;
+    std::atomic<quint64> m_generation{0};
+
+    QMutex m_mutex;
+    QWaitCondition m_wakeUp;
+    QQueue<Request> m_requests;
+    bool m_stopping = false;
+};
+
+Q_DECLARE_METATYPE(GamesTable)
+Q_DECLARE_METATYPE(PlayersTable)
+Q_DECLARE_METATYPE(PlayerGameRecord)
+Q_DECLARE_METATYPE(RatingPoint)
+
+#endif // TABLEQUERYTHREAD_H
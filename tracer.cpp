@@ -0,0 +1,200 @@
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <QDebug>
+#include <chrono>
+
+std::atomic<bool> Tracer::s_enabled{false};
+
+namespace {
+// Буфер текущего потока; буферы живут до конца процесса, поэтому указатель
+// остается валидным и после завершения потока (события нужны при записи трассы)
+thread_local void *t_buffer = nullptr;
+
+QByteArray escapeJson(const QByteArray &value)
+{
+    QByteArray result;
+    result.reserve(value.size());
+    for (char ch : value) {
+        switch (ch) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                result += ' ';
+            } else {
+                result += ch;
+            }
+        }
+    }
+    return result;
+}
+}
+
+Tracer::ThreadBuffer::ThreadBuffer()
+{
+    for (auto &chunk : chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+Tracer::ThreadBuffer::~ThreadBuffer()
+{
+    for (auto &chunk : chunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+Tracer &Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer()
+    : m_originNs(0)
+{
+    m_originNs = nowNs();
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::begin(const char *name)
+{
+    record(name, 'B');
+}
+
+void Tracer::end(const char *name)
+{
+    record(name, 'E');
+}
+
+qint64 Tracer::nowNs() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Tracer::ThreadBuffer *Tracer::localBuffer()
+{
+    if (t_buffer) {
+        return static_cast<ThreadBuffer*>(t_buffer);
+    }
+
+    auto buffer = std::make_unique<ThreadBuffer>();
+    QThread *thread = QThread::currentThread();
+    if (thread && !thread->objectName().isEmpty()) {
+        buffer->name = thread->objectName().toUtf8();
+    } else if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        buffer->name = "GUI";
+    } else if (thread) {
+        buffer->name = thread->metaObject()->className();
+    }
+
+    QMutexLocker locker(&m_registryMutex);
+    buffer->tid = static_cast<int>(m_buffers.size()) + 1;
+    t_buffer = buffer.get();
+    m_buffers.push_back(std::move(buffer));
+    return static_cast<ThreadBuffer*>(t_buffer);
+}
+
+void Tracer::record(const char *name, char phase)
+{
+    ThreadBuffer *buffer = localBuffer();
+    qint64 index = buffer->count.load(std::memory_order_relaxed);
+    int chunkIndex = static_cast<int>(index / ThreadBuffer::ChunkSize);
+
+    // B принимается, только если останется место для его E и для E всех открытых
+    // спанов; иначе спан отбрасывается целиком, и пары B/E в трассе не разрываются
+    if (phase == 'B') {
+        constexpr qint64 capacity = qint64(ThreadBuffer::ChunkSize) * ThreadBuffer::MaxChunks;
+        if (buffer->droppedDepth > 0 || index + buffer->openSpans + 2 > capacity) {
+            ++buffer->droppedDepth;
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ++buffer->openSpans;
+    } else if (buffer->droppedDepth > 0) {
+        --buffer->droppedDepth;
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    } else {
+        --buffer->openSpans;
+    }
+
+    Event *chunk = buffer->chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Event[ThreadBuffer::ChunkSize];
+        buffer->chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+
+    Event &event = chunk[index % ThreadBuffer::ChunkSize];
+    event.name = name;
+    event.timestampNs = nowNs();
+    event.phase = phase;
+
+    // Публикуем событие для читателя
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+bool Tracer::writeChromeTrace(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Failed to open trace file for writing:" << filePath;
+        return false;
+    }
+
+    QMutexLocker locker(&m_registryMutex);
+
+    QByteArray out;
+    out.reserve(1 << 20);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+
+    auto flushIfLarge = [&]() {
+        if (out.size() > (1 << 20)) {
+            file.write(out);
+            out.clear();
+        }
+    };
+
+    for (const auto &buffer : m_buffers) {
+        if (!first) out += ",\n";
+        first = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(buffer->tid)
+               + ",\"args\":{\"name\":\"" + escapeJson(buffer->name) + "\"}}";
+
+        qint64 count = buffer->count.load(std::memory_order_acquire);
+        for (qint64 i = 0; i < count; ++i) {
+            const Event *chunk = buffer->chunks[i / ThreadBuffer::ChunkSize].load(std::memory_order_acquire);
+            const Event &event = chunk[i % ThreadBuffer::ChunkSize];
+
+            out += ",\n{\"name\":\"";
+            out += escapeJson(QByteArray(event.name));
+            out += "\",\"cat\":\"rss\",\"ph\":\"";
+            out += event.phase;
+            out += "\",\"pid\":1,\"tid\":";
+            out += QByteArray::number(buffer->tid);
+            out += ",\"ts\":";
+            out += QByteArray::number((event.timestampNs - m_originNs) / 1000.0, 'f', 3);
+            out += "}";
+            flushIfLarge();
+        }
+
+        qint64 dropped = buffer->dropped.load(std::memory_order_relaxed);
+        if (dropped > 0) {
+            qDebug() << "Tracer: dropped" << dropped << "events for thread" << buffer->name;
+        }
+    }
+
+    out += "\n]}\n";
+    file.write(out);
+    file.close();
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Трассировщик для экспорта в формат Chrome trace_event (открывается в Perfetto / chrome://tracing).
+// Каждый поток пишет события в собственный буфер без блокировок; общий мьютекс
+// берется только один раз при регистрации потока. Имя потока в трассе - objectName
+// QThread, иначе имя его класса. Когда трассировка выключена, стоимость
+// TRACE_SCOPE - одна relaxed-загрузка атомарного флага. Переполненный буфер
+// отбрасывает спаны целиком: место под E открытых спанов зарезервировано.
+class Tracer
+{
+public:
+    static Tracer& instance();
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+
+    // name должен указывать на строку со статическим временем жизни (литерал)
+    void begin(const char *name);
+    void end(const char *name);
+
+    // Записать все накопленные события в JSON-файл
+    bool writeChromeTrace(const QString &filePath);
+
+private:
+    Tracer();
+
+    struct Event {
+        const char *name;
+        qint64 timestampNs;
+        char phase; // 'B' или 'E'
+    };
+
+    // Буфер событий одного потока. Пишет только поток-владелец, читатель
+    // видит только события с индексом меньше count (release/acquire).
+    struct ThreadBuffer {
+        static constexpr int ChunkSize = 1 << 16;
+        static constexpr int MaxChunks = 1024;
+
+        int tid = 0;
+        QByteArray name;
+        std::atomic<Event*> chunks[MaxChunks];
+        std::atomic<qint64> count{0};
+        std::atomic<qint64> dropped{0};
+        // Только для потока-владельца: записанные незакрытые спаны и вложенность
+        // отброшенного спана (его E и вложенные события тоже отбрасываются)
+        qint64 openSpans = 0;
+        qint64 droppedDepth = 0;
+
+        ThreadBuffer();
+        ~ThreadBuffer();
+    };
+
+    ThreadBuffer *localBuffer();
+    void record(const char *name, char phase);
+    qint64 nowNs() const;
+
+    static std::atomic<bool> s_enabled;
+
+    QMutex m_registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    qint64 m_originNs;
+};
+
+// RAII-спан: begin в конструкторе, end в деструкторе.
+// Состояние флага запоминается, чтобы пары B/E не разрывались при переключении.
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(Tracer::isEnabled() ? name : nullptr)
+    {
+        if (m_name) {
+            Tracer::instance().begin(m_name);
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (m_name) {
+            Tracer::instance().end(m_name);
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#endif // TRACER_H